@@ -15,13 +15,21 @@
             is being used on.
 
     Last Modified By : Benjamin Kleynhans
-    Last Modified Date : June 24, 2020
+    Last Modified Date : October 19, 2026
     Filename : AdafruitDataloggingShield.cpp
 */
 
 #include "AdafruitDataloggingShield.h"
 
-AdafruitDataloggingShield::AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, int* baud, char* pHeadingString)
+// CRC-32 of every 4 bit value, reflected polynomial 0xEDB88320.  Two lookups a byte in a
+// 64 byte table leave more of the Uno's flash free than one lookup in a 1 KB table.
+static const uint32_t CRC32_TABLE[16] PROGMEM = {
+    0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL, 0x76DC4190UL, 0x6B6B51F4UL,
+    0x4DB26158UL, 0x5005713CUL, 0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+    0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+};
+
+AdafruitDataloggingShield::AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, const int* baud, char* pHeadingString)
 {
     this->pSerial = pSerial;
     this->pBaud = baud;
@@ -32,7 +40,7 @@ AdafruitDataloggingShield::AdafruitDataloggingShield(char* pSiteName, HardwareSe
     this->initializeSdCard();
 }
 
-AdafruitDataloggingShield::AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, int* baud)
+AdafruitDataloggingShield::AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, const int* baud)
 {
     this->pSerial = pSerial;
     this->pBaud = baud;
@@ -42,10 +50,7 @@ AdafruitDataloggingShield::AdafruitDataloggingShield(char* pSiteName, HardwareSe
     this->initializeSdCard();
 }
 
-AdafruitDataloggingShield::~AdafruitDataloggingShield()
-{
-    delete this->pOpenedFile;
-}
+AdafruitDataloggingShield::~AdafruitDataloggingShield() {}
 
 // Set or change a heading after construction
 void AdafruitDataloggingShield::setHeading(char* pHeadingString)
@@ -88,14 +93,41 @@ void AdafruitDataloggingShield::dir()
     }
 }
 
+// List the files in the root of the card in a form a host program can read
+void AdafruitDataloggingShield::list(Print* pOutput)
+{
+    if (!SD.begin(this->chipSelect)) {
+        SD.end();
+        
+        return;
+    }
+    
+    File root = SD.open("/");
+    File entry = root.openNextFile();
+    
+    while (entry) {
+        if (!entry.isDirectory()) {
+            pOutput->print(entry.name());
+            pOutput->print(' ');
+            pOutput->println((unsigned long)entry.size());
+        }
+        
+        entry.close();
+        entry = root.openNextFile();
+    }
+    
+    root.close();
+    SD.end();
+}
+
 // Open the serial connection
 void AdafruitDataloggingShield::openSerial()
 {
-    if (!this->pSerial) {
+    if (!*this->pSerial) {
         
         this->pSerial->begin(*this->pBaud);
 
-        while (!this->pSerial) {
+        while (!*this->pSerial) {
             ; // Wait for the serial port to connect.
         }
     }
@@ -148,7 +180,7 @@ bool AdafruitDataloggingShield::write(char* filename, char* data)
             }
             
             if (this->openFile('w', filename)) {                
-                this->pOpenedFile->println(data);
+                this->putLine(data);
                 this->closeFile();
             }
         }
@@ -159,41 +191,693 @@ bool AdafruitDataloggingShield::write(char* filename, char* data)
     }
 }
 
+// Open a file to write several lines to it.  Every successful call must be followed
+// by closeAppend().
+bool AdafruitDataloggingShield::openForAppend(const char* filename, bool withHeading)
+{
+    if (!SD.begin(this->chipSelect)) {
+        
+        this->pSerial->print(F("\n      !!! Failed on write. !!!"));
+        SD.end();
+        
+        return false;
+    }
+    
+    if (!this->fileExists(filename)) {
+        this->createFile(filename, withHeading);
+    }
+    
+    if (!this->openFile('w', filename)) {
+        SD.end();
+        
+        return false;
+    }
+    
+    return true;
+}
+
+// Write a line to the file opened by openForAppend()
+void AdafruitDataloggingShield::append(char* data)
+{
+    this->putLine(data);
+}
+
+// Close the file opened by openForAppend()
+void AdafruitDataloggingShield::closeAppend()
+{
+    this->closeFile();
+    SD.end();
+}
+
+// Open a file and start a journal block in it.  Every successful call must be followed
+// by commitBlock().
+bool AdafruitDataloggingShield::openBlock(char* filename)
+{
+    char line[JOURNAL_LINE_SIZE];
+    
+    if (!this->openForAppend(filename)) {
+        return false;
+    }
+    
+    snprintf_P(line, sizeof(line), PSTR("#B,%lu"), (unsigned long)++this->journalSequence);
+    this->putLine(line);
+    
+    this->blockLength = 0;
+    this->blockCrc = 0;
+    
+    return true;
+}
+
+// Write a line to the block opened by openBlock()
+void AdafruitDataloggingShield::appendToBlock(char* data)
+{
+    int length = strlen(data);
+    
+    this->putLine(data);
+    
+    this->blockCrc = updateCrc16(this->blockCrc, data, length);
+    this->blockCrc = updateCrc16(this->blockCrc, "\r\n", 2);
+    this->blockLength += length + 2;
+}
+
+// Commit the block opened by openBlock() and close the file.  The block is valid once the
+// commit line is on the card.
+void AdafruitDataloggingShield::commitBlock()
+{
+    char line[JOURNAL_LINE_SIZE];
+    
+    snprintf_P(
+        line,
+        sizeof(line),
+        PSTR("#C,%lu,%u,%04X"),
+        (unsigned long)this->journalSequence,
+        (unsigned int)this->blockLength,
+        (unsigned int)this->blockCrc
+    );
+    
+    this->putLine(line);
+    this->closeAppend();
+}
+
+// Read back from the end of the file to the last commit that checks out.  Blocks started
+// after it were cut short by a power loss, and the first of them is where the discarded
+// bytes start.  Only the tail of the file is read, however long the file is.
+bool AdafruitDataloggingShield::recoverJournal(char* filename, JournalRecovery* pRecovery)
+{
+    char line[JOURNAL_LINE_SIZE];
+    char marker;
+    
+    memset(pRecovery, 0, sizeof(JournalRecovery));
+    this->journalSequence = 0;
+    
+    if (!this->openForUpdate(filename)) {
+        return false;
+    }
+    
+    uint32_t size = this->getOpenFileSize();
+    uint32_t floor = (size > JOURNAL_SCAN_LIMIT) ? size - JOURNAL_SCAN_LIMIT : 0;
+    uint32_t position = size;
+    uint32_t firstOpen = size;
+    
+    while (this->findMarker(floor, &position, &marker, &pRecovery->scanned)) {
+        if (marker == 'B') {
+            firstOpen = position;
+        } else if (this->checkCommit(position, &pRecovery->sequence, &pRecovery->scanned)) {
+            break;
+        }
+    }
+    
+    pRecovery->discarded = size - firstOpen;
+    
+    // A line cut short outside a block is closed off by the marker too, so the next block
+    // starts on a line of its own
+    bool lineEnd = size == 0 || (this->readAt(size - 1, line, 1) == 1 && line[0] == '\n');
+    
+    if (pRecovery->discarded > 0 || !lineEnd) {
+        int length = snprintf_P(
+            line,
+            sizeof(line),
+            PSTR("%s#R,%lu,%lu\r\n"),
+            lineEnd ? "" : "\r\n",
+            (unsigned long)pRecovery->sequence,
+            (unsigned long)pRecovery->discarded
+        );
+        
+        this->writeAt(size, line, length);
+    }
+    
+    this->journalSequence = pRecovery->sequence;
+    this->closeUpdate();
+    
+    return true;
+}
+
+// Start keeping the CRC index of a file.  Normally the index is at most a block behind, but
+// after a power cut, or for a file that never had an index, the blocks it is missing are read
+// back from the card.  The block still being written is read back too, to carry on its CRC.
+bool AdafruitDataloggingShield::openCrcIndex(char* filename)
+{
+    char buffer[JOURNAL_LINE_SIZE];
+    char indexName[13];
+    
+    strncpy(this->crcFilename, filename, sizeof(this->crcFilename) - 1);
+    this->crcFilename[sizeof(this->crcFilename) - 1] = '\0';
+    this->crcTracking = false;
+    this->crcValue = 0;
+    this->crcLength = 0;
+    this->crcBlocks = 0;
+    
+    if (!this->crcIndexName(filename, indexName)) {
+        this->crcFilename[0] = '\0';
+        
+        return false;
+    }
+    
+    uint32_t indexed = this->fileSize(indexName) / CRC_RECORD_SIZE;
+    
+    if (!this->openForUpdate(filename, true)) {
+        // Nothing written yet
+        return true;
+    }
+    
+    uint32_t size = this->getOpenFileSize();
+    
+    this->crcBlocks = min(indexed, size / CRC_BLOCK_SIZE);
+    
+    for (uint32_t offset = this->crcBlocks * CRC_BLOCK_SIZE; offset < size;) {
+        int length = this->readAt(offset, buffer, min(size - offset, (uint32_t)sizeof(buffer)));
+        
+        if (length <= 0) {
+            this->closeUpdate();
+            this->crcFilename[0] = '\0';
+            
+            return false;
+        }
+        
+        this->feedCrcIndex(buffer, length);
+        offset += length;
+    }
+    
+    this->closeUpdate();
+    
+    return true;
+}
+
+// Write the CRC of the last, short block and stop keeping the index
+void AdafruitDataloggingShield::closeCrcIndex()
+{
+    if (this->crcFilename[0] != '\0' && this->crcLength > 0 && SD.begin(this->chipSelect)) {
+        this->writeCrcIndex(this->crcBlocks, this->crcValue);
+    }
+    
+    SD.end();
+    
+    this->crcFilename[0] = '\0';
+    this->crcTracking = false;
+}
+
+// The index of "H1261019.CSV" is "H1261019.CRC".  Only the .CSV day files are indexed, as
+// the burst file of the day, "H1261019.brs", would map to the same 8.3 name.
+bool AdafruitDataloggingShield::crcIndexName(char* filename, char* pIndexName)
+{
+    char* pExtension = strrchr(filename, '.');
+    
+    if (pExtension == nullptr || pExtension - filename > 8 || strcasecmp_P(pExtension, PSTR(".CSV")) != 0) {
+        pIndexName[0] = '\0';
+        
+        return false;
+    }
+    
+    strncpy(pIndexName, filename, pExtension - filename);
+    strcpy_P(pIndexName + (pExtension - filename), PSTR(".CRC"));
+    
+    return true;
+}
+
+// Table-driven CRC-32, one table lookup per 4 bits
+uint32_t AdafruitDataloggingShield::updateCrc32(uint32_t crc, const char* pData, int length)
+{
+    crc = ~crc;
+    
+    while (length-- > 0) {
+        crc ^= (byte)*pData++;
+        crc = pgm_read_dword(&CRC32_TABLE[crc & 0x0F]) ^ (crc >> 4);
+        crc = pgm_read_dword(&CRC32_TABLE[crc & 0x0F]) ^ (crc >> 4);
+    }
+    
+    return ~crc;
+}
+
+// Open an existing file to read or overwrite parts of it.  Every successful call must
+// be followed by closeUpdate().
+bool AdafruitDataloggingShield::openForUpdate(const char* filename, bool readOnly)
+{
+    if (!SD.begin(this->chipSelect)) {
+        
+        this->pSerial->print(F("\n      !!! Failed on open. !!!"));
+        SD.end();
+        
+        return false;
+    }
+    
+    if (!this->fileExists(filename) || !this->openFile(readOnly ? 'r' : 'u', filename)) {
+        SD.end();
+        
+        return false;
+    }
+    
+    return true;
+}
+
+// Open a file emptied, for writeAt() to fill in.  Every successful call must be followed
+// by closeUpdate().
+bool AdafruitDataloggingShield::openForRewrite(const char* filename)
+{
+    if (!SD.begin(this->chipSelect)) {
+        
+        this->pSerial->print(F("\n      !!! Failed on open. !!!"));
+        SD.end();
+        
+        return false;
+    }
+    
+    this->openedFile = SD.open(filename, O_READ | O_WRITE | O_CREAT | O_TRUNC);
+    
+    if (!this->openedFile) {
+        SD.end();
+        
+        return false;
+    }
+    
+    return true;
+}
+
+// Read from the file opened by openForUpdate(), returns the number of bytes read
+int AdafruitDataloggingShield::readAt(uint32_t offset, char* pBuffer, int length)
+{
+    if (!this->openedFile.seek(offset)) {
+        return 0;
+    }
+    
+    return this->openedFile.read(pBuffer, length);
+}
+
+// Overwrite bytes in the file opened by openForUpdate()
+bool AdafruitDataloggingShield::writeAt(uint32_t offset, char* pData, int length)
+{
+    if (!this->openedFile.seek(offset)) {
+        return false;
+    }
+    
+    return this->openedFile.write((uint8_t*)pData, length) == (size_t)length;
+}
+
+uint32_t AdafruitDataloggingShield::getOpenFileSize()
+{
+    return this->openedFile.size();
+}
+
+// Close the file opened by openForUpdate()
+void AdafruitDataloggingShield::closeUpdate()
+{
+    this->closeFile();
+    SD.end();
+}
+
+// The card is started to find the file and stopped again straight away.  Stopping it only
+// closes the root directory, the reader keeps its place in the file.
+bool AdafruitDataloggingShield::openReader(const char* filename)
+{
+    if (!SD.begin(this->chipSelect)) {
+        
+        this->pSerial->print(F("\n      !!! Failed on open. !!!"));
+        SD.end();
+        
+        return false;
+    }
+    
+    if (this->fileExists(filename)) {
+        this->readerFile = SD.open(filename);
+    }
+    
+    SD.end();
+    
+    return this->readerFile;
+}
+
+// Read from the file opened by openReader(), returns the number of bytes read
+int AdafruitDataloggingShield::readFrom(uint32_t offset, char* pBuffer, int length)
+{
+    if (!this->readerFile || !this->readerFile.seek(offset)) {
+        return 0;
+    }
+    
+    return this->readerFile.read(pBuffer, length);
+}
+
+void AdafruitDataloggingShield::closeReader()
+{
+    if (this->readerFile) {
+        this->readerFile.close();
+    }
+}
+
+// Size of a file in bytes
+uint32_t AdafruitDataloggingShield::fileSize(const char* filename)
+{
+    uint32_t size = 0;
+    
+    if (this->openForUpdate(filename, true)) {
+        size = this->getOpenFileSize();
+        this->closeUpdate();
+    }
+    
+    return size;
+}
+
+bool AdafruitDataloggingShield::removeFile(const char* filename)
+{
+    bool removed = false;
+    
+    if (SD.begin(this->chipSelect)) {
+        removed = SD.remove(filename);
+    }
+    
+    SD.end();
+    
+    return removed;
+}
+
+// Read a settings file a line at a time into a buffer on the stack.  Blank lines and
+// everything after a "#" are skipped, and spaces around the key and the value ignored.
+bool AdafruitDataloggingShield::readConfig(const char* filename, SiteConfig* pConfig)
+{
+    char line[CONFIG_LINE_SIZE];
+    byte length = 0;
+    bool overflow = false;
+    
+    if (!this->openForUpdate(filename, true)) {
+        return false;
+    }
+    
+    this->pSerial->print(F("\n      Reading settings from "));
+    this->pSerial->println(filename);
+    
+    for (;;) {
+        int c = this->openedFile.read();
+        
+        if (c >= 0 && c != '\n') {
+            if (length < CONFIG_LINE_SIZE - 1) {
+                line[length++] = c;
+            } else {
+                overflow = true;
+            }
+            
+            continue;
+        }
+        
+        // Lines written on a PC end in CR LF
+        if (length > 0 && line[length - 1] == '\r') {
+            length--;
+        }
+        
+        line[length] = '\0';
+        
+        char* pComment = strchr(line, '#');
+        
+        if (pComment != nullptr) {
+            *pComment = '\0';
+        }
+        
+        char* pKey = line;
+        char* pValue = strchr(line, '=');
+        
+        while (*pKey == ' ' || *pKey == '\t') {
+            pKey++;
+        }
+        
+        if (pValue != nullptr) {
+            char* pEnd = pValue;
+            
+            // Trim the end of the key, then the start and the end of the value
+            while (pEnd > pKey && (pEnd[-1] == ' ' || pEnd[-1] == '\t')) {
+                pEnd--;
+            }
+            
+            *pEnd = '\0';
+            pValue++;
+            
+            while (*pValue == ' ' || *pValue == '\t') {
+                pValue++;
+            }
+            
+            pEnd = pValue + strlen(pValue);
+            
+            while (pEnd > pValue && (pEnd[-1] == ' ' || pEnd[-1] == '\t')) {
+                pEnd--;
+            }
+            
+            *pEnd = '\0';
+        }
+        
+        if (overflow) {
+            this->pSerial->print(F("\n      !!! Setting line too long: "));
+            this->pSerial->println(pKey);
+        } else if (pValue != nullptr) {
+            pConfig->set(pKey, pValue);
+        } else if (*pKey != '\0') {
+            pConfig->set(pKey, pKey + strlen(pKey));
+        }
+        
+        if (c < 0) {
+            break;
+        }
+        
+        length = 0;
+        overflow = false;
+    }
+    
+    this->closeUpdate();
+    
+    return true;
+}
+
+// Find the last marker line ("#B", "#C" or "#R") that starts before *pPosition and at or
+// after floor, reading back a line-sized piece at a time.  The pieces overlap, as a marker
+// can straddle two of them.
+bool AdafruitDataloggingShield::findMarker(uint32_t floor, uint32_t* pPosition, char* pMarker, uint32_t* pScanned)
+{
+    char buffer[JOURNAL_LINE_SIZE];
+    uint32_t end = *pPosition;
+    
+    while (end > floor) {
+        uint32_t start = (end - floor > JOURNAL_LINE_SIZE - 1) ? end - (JOURNAL_LINE_SIZE - 1) : floor;
+        int length = this->readAt(start, buffer, end + 1 - start);
+        
+        if (length <= 0) {
+            return false;
+        }
+        
+        *pScanned += length;
+        
+        for (int i = end - start - 1; i >= 0; i--) {
+            bool lineStart = (i > 0) ? (buffer[i - 1] == '\n') : (start == 0);
+            
+            if (lineStart && buffer[i] == '#' && i + 1 < length &&
+                (buffer[i + 1] == 'B' || buffer[i + 1] == 'C' || buffer[i + 1] == 'R')) {
+                
+                *pPosition = start + i;
+                *pMarker = buffer[i + 1];
+                
+                return true;
+            }
+        }
+        
+        if (start == floor) {
+            break;
+        }
+        
+        end = start + 1;
+    }
+    
+    return false;
+}
+
+// Check the commit line at position against its block: the line is complete, the block
+// it closes starts with the matching "#B" line and the CRC agrees.  An "#R" line closes
+// off everything before it in the same way.
+bool AdafruitDataloggingShield::checkCommit(uint32_t position, uint32_t* pSequence, uint32_t* pScanned)
+{
+    char buffer[JOURNAL_LINE_SIZE];
+    char opening[16];
+    char* pEnd;
+    
+    int length = this->readAt(position, buffer, sizeof(buffer) - 1);
+    
+    if (length <= 0) {
+        return false;
+    }
+    
+    *pScanned += length;
+    buffer[length] = '\0';
+    
+    // A line cut short has no line end
+    if (buffer[2] != ',' || strchr(buffer, '\n') == nullptr) {
+        return false;
+    }
+    
+    uint32_t sequence = strtoul(buffer + 3, &pEnd, 10);
+    
+    if (buffer[1] == 'R') {
+        *pSequence = sequence;
+        
+        return *pEnd == ',';
+    }
+    
+    if (*pEnd != ',') {
+        return false;
+    }
+    
+    uint32_t blockLength = strtoul(pEnd + 1, &pEnd, 10);
+    
+    if (*pEnd != ',') {
+        return false;
+    }
+    
+    uint16_t crc = strtoul(pEnd + 1, &pEnd, 16);
+    
+    if (*pEnd != '\r' || blockLength > position) {
+        return false;
+    }
+    
+    uint32_t blockStart = position - blockLength;
+    int openingLength = snprintf_P(opening, sizeof(opening), PSTR("#B,%lu\r\n"), (unsigned long)sequence);
+    
+    if (blockStart < (uint32_t)openingLength ||
+        this->readAt(blockStart - openingLength, buffer, openingLength) != openingLength ||
+        memcmp(buffer, opening, openingLength) != 0) {
+        
+        return false;
+    }
+    
+    *pScanned += openingLength;
+    
+    uint16_t blockCrc = 0;
+    
+    for (uint32_t offset = blockStart; offset < position; offset += length) {
+        length = this->readAt(offset, buffer, min(position - offset, (uint32_t)sizeof(buffer)));
+        
+        if (length <= 0) {
+            return false;
+        }
+        
+        *pScanned += length;
+        blockCrc = updateCrc16(blockCrc, buffer, length);
+    }
+    
+    if (blockCrc != crc) {
+        return false;
+    }
+    
+    *pSequence = sequence;
+    
+    return true;
+}
+
+// Add bytes written to the end of the indexed file to the CRC of its block, and write the
+// CRC to the index each time a block is complete
+void AdafruitDataloggingShield::feedCrcIndex(const char* pData, int length)
+{
+    while (length > 0) {
+        int part = min((uint32_t)length, (uint32_t)(CRC_BLOCK_SIZE - this->crcLength));
+        
+        this->crcValue = this->updateCrc32(this->crcValue, pData, part);
+        this->crcLength += part;
+        pData += part;
+        length -= part;
+        
+        if (this->crcLength == CRC_BLOCK_SIZE) {
+            this->writeCrcIndex(this->crcBlocks++, this->crcValue);
+            this->crcValue = 0;
+            this->crcLength = 0;
+        }
+    }
+}
+
+// Write the CRC of a block to its line of the index, through a second file as the indexed
+// one is usually open.  The card must already have been started with SD.begin().
+bool AdafruitDataloggingShield::writeCrcIndex(uint32_t block, uint32_t crc)
+{
+    char record[CRC_RECORD_SIZE + 1];
+    char indexName[13];
+    
+    if (!this->crcIndexName(this->crcFilename, indexName)) {
+        return false;
+    }
+    
+    File index = SD.open(indexName, O_READ | O_WRITE | O_CREAT);
+    
+    if (!index) {
+        return false;
+    }
+    
+    snprintf_P(record, sizeof(record), PSTR("%08lX\r\n"), (unsigned long)crc);
+    
+    bool written = index.seek(block * CRC_RECORD_SIZE) &&
+                   index.write((uint8_t*)record, CRC_RECORD_SIZE) == CRC_RECORD_SIZE;
+    
+    index.close();
+    
+    return written;
+}
+
 // Open the file with an access type.
 // r - read
-// w - write
-bool AdafruitDataloggingShield::openFile(char accessType, char* filename)
+// w - write (append)
+// u - update (read and write anywhere in the file)
+bool AdafruitDataloggingShield::openFile(char accessType, const char* filename)
 {
     switch (accessType)
     {
         case 'r':            
-            this->pOpenedFile = &(SD.open(filename));
+            this->openedFile = SD.open(filename);
             
-            return true;
+            return this->openedFile;
         case 'w':
-            this->pOpenedFile = &(SD.open(filename, FILE_WRITE));
+            this->openedFile = SD.open(filename, FILE_WRITE);
+            this->crcTracking = strcasecmp(filename, this->crcFilename) == 0;
+        
+            return this->openedFile;
+        case 'u':
+            this->openedFile = SD.open(filename, O_READ | O_WRITE);
         
-            return true;
+            return this->openedFile;
         default:
             return false;
     }
 }
 
 // Create an empty file
-void AdafruitDataloggingShield::createFile(char* filename)
+void AdafruitDataloggingShield::createFile(const char* filename, bool withHeading)
 {    
     this->pSerial->print(F("\n      File does not exist, creating "));
     this->pSerial->print(filename);
-    this->pSerial->println("\n");
+    this->pSerial->println(F("\n"));
     delay(5000);
 
-    this->pOpenedFile = &(SD.open(filename, FILE_WRITE));
-    this->pOpenedFile->println(this->pHeadingString);
-    this->pOpenedFile->close();
+    this->openedFile = SD.open(filename, FILE_WRITE);
+    this->crcTracking = strcasecmp(filename, this->crcFilename) == 0;
+    
+    // The sketch writes its own headings, so there may be none set
+    if (withHeading && this->pHeadingString != nullptr) {
+        this->putLine(this->pHeadingString);
+    }
+    
+    this->openedFile.close();
 }
 
 // Test if the file exists
-bool AdafruitDataloggingShield::fileExists(char* filename)
+bool AdafruitDataloggingShield::fileExists(const char* filename)
 {
     if (SD.exists(filename)) {
         return true;
@@ -202,10 +886,21 @@ bool AdafruitDataloggingShield::fileExists(char* filename)
     }
 }
 
+// Write a line to the open file, adding it to the CRC index if the file has one
+void AdafruitDataloggingShield::putLine(char* data)
+{
+    this->openedFile.println(data);
+    
+    if (this->crcTracking) {
+        this->feedCrcIndex(data, strlen(data));
+        this->feedCrcIndex("\r\n", 2);
+    }
+}
+
 // Close the open file
 void AdafruitDataloggingShield::closeFile()
 {
-    this->pOpenedFile->close();
+    this->openedFile.close();
 }
 
 // Ask if the clock has been set since startup
@@ -11,7 +11,7 @@
     Authors : Benjamin Kleynhans
 
     Last Modified By : Benjamin Kleynhans
-    Last Modified Date : June 24, 2020
+    Last Modified Date : October 19, 2026
     Filename : AdafruitDataloggingShield.h
 */
 
@@ -22,17 +22,101 @@
 #include <RTClib.h>
 #include <SPI.h>
 #include <SD.h>
+#include "SiteConfig.h"
+#include "Crc16.h"
+
+// Journaled records are written in blocks, each framed by a "#B,sequence" line and a
+// "#C,sequence,length,crc" commit line.  The length is the bytes of records between the
+// two lines and the CRC is their CRC-16/XMODEM in hex.  Recovery at boot reads back from
+// the end of the file no further than JOURNAL_SCAN_LIMIT, two of the largest blocks, and
+// marks records that were never committed with a "#R,sequence,bytes" line after them.
+#define JOURNAL_SCAN_LIMIT 16384
+#define JOURNAL_LINE_SIZE 32
+
+// Day files are checked in blocks of CRC_BLOCK_SIZE bytes.  The CRC-32 of each block is kept
+// in an index next to the file, with the same name and the extension .CRC, as one "%08lX"
+// line per block, so an upload can be compared block by block with the copy on the server.
+#define CRC_BLOCK_SIZE 4096
+#define CRC_RECORD_SIZE 10
+
+// What the recovery scan found
+struct JournalRecovery
+{
+    // Last block committed, 0 if there is none
+    uint32_t sequence;
+    
+    // Bytes after it that were never committed
+    uint32_t discarded;
+    
+    // Bytes read to find out
+    uint32_t scanned;
+};
 
 class AdafruitDataloggingShield
 {
 public:
-    AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, int* baud, char* pHeadingString);
-    AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, int* baud);
+    AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, const int* baud, char* pHeadingString);
+    AdafruitDataloggingShield(char* pSiteName, HardwareSerial* pSerial, const int* baud);
     ~AdafruitDataloggingShield();
 
     //// Data Management
     //// Methods
     bool write(char* filename, char* data);
+    
+    // Write several lines to a file without re-opening it for every line.  A new file
+    // starts with the heading unless withHeading is false.
+    bool openForAppend(const char* filename, bool withHeading = true);
+    void append(char* data);
+    void closeAppend();
+    
+    // Write lines to a file in a journal block, which is only valid once it is committed.
+    // Committing closes the file.
+    bool openBlock(char* filename);
+    void appendToBlock(char* data);
+    void commitBlock();
+    
+    // Find the last committed block of a file and mark anything after it as discarded.
+    // Blocks written to the file next carry on from its sequence.  Returns false if there
+    // is no file, in which case the sequence starts again.
+    bool recoverJournal(char* filename, JournalRecovery* pRecovery);
+    
+    // Keep the CRC index of a file up to date as lines are written to it.  Blocks written
+    // before the index was opened are read back and indexed first.  Closing the index adds
+    // the CRC of the last, short block, once nothing more will be written to the file.
+    bool openCrcIndex(char* filename);
+    void closeCrcIndex();
+    
+    // Name of the CRC index of a file, pIndexName must hold 13 characters.  Returns false
+    // for a file that has no index.
+    bool crcIndexName(char* filename, char* pIndexName);
+    
+    // CRC-32 as zlib computes it, carried on from crc.  Start with 0.
+    uint32_t updateCrc32(uint32_t crc, const char* pData, int length);
+    
+    // Read and overwrite bytes anywhere in an existing file.  openForRewrite() starts a file
+    // over empty instead, creating it if need be.
+    bool openForUpdate(const char* filename, bool readOnly = false);
+    bool openForRewrite(const char* filename);
+    int readAt(uint32_t offset, char* pBuffer, int length);
+    bool writeAt(uint32_t offset, char* pData, int length);
+    uint32_t getOpenFileSize();
+    void closeUpdate();
+    
+    // Read a file through a handle of its own, which stays open while other files are
+    // opened, written and closed.  Only one file can be open for reading at a time.
+    bool openReader(const char* filename);
+    int readFrom(uint32_t offset, char* pBuffer, int length);
+    void closeReader();
+    
+    // Size of a file in bytes, 0 if it does not exist
+    uint32_t fileSize(const char* filename);
+    
+    // Delete a file from the card
+    bool removeFile(const char* filename);
+    
+    // Apply every "key=value" line of a settings file.  Returns false if there is no file.
+    bool readConfig(const char* filename, SiteConfig* pConfig);
+    
     void setHeading(char* pHeadingString);
     char* getHeading();
     void setSiteName(char* pSiteName);
@@ -40,11 +124,14 @@ public:
     
     //// Hardware Management
     // Realtime clock object
-    const RTC_PCF8523 rtc;
+    RTC_PCF8523 rtc;
     
     // Display a directory of the sd-card contents
     void dir();
     
+    // Write one "NAME SIZE" line for every file on the card
+    void list(Print* pOutput);
+    
     // Return true or false based on whether the clock has been set since device startup
     bool clockSet();
     
@@ -60,7 +147,7 @@ private:
     const byte chipSelect = 2;
     
     // Define the baud rate from constructor
-    int* pBaud = nullptr;
+    const int* pBaud = nullptr;
     
     // Pointer to the site and heading strings
     char* pSiteName = nullptr;
@@ -81,7 +168,21 @@ private:
     SdVolume sdVolume;
     SdFile sdRoot;
     
-    File* pOpenedFile = nullptr;    
+    File openedFile;    
+    File readerFile;
+    
+    // Sequence of the last journal block, and the bytes and CRC of the one being written
+    uint32_t journalSequence = 0;
+    uint16_t blockLength = 0;
+    uint16_t blockCrc = 0;
+    
+    // File with a CRC index, whether it is the one open, and the CRC and bytes of its block
+    // being written after the blocks already indexed
+    char crcFilename[13] = "";
+    bool crcTracking = false;
+    uint32_t crcValue = 0;
+    uint16_t crcLength = 0;
+    uint32_t crcBlocks = 0;
 
     //// METHODS
     // Hardware management
@@ -89,9 +190,18 @@ private:
     void initializeSdCard();
     
     // Data management
-    bool openFile(char accessType, char* filename);
-    void createFile(char* filename);
-    bool fileExists(char* filename);
+    bool openFile(char accessType, const char* filename);
+    void createFile(const char* filename, bool withHeading = true);
+    bool fileExists(const char* filename);
     void closeFile();    
+    void putLine(char* data);
+    
+    // Journal recovery
+    bool findMarker(uint32_t floor, uint32_t* pPosition, char* pMarker, uint32_t* pScanned);
+    bool checkCommit(uint32_t position, uint32_t* pSequence, uint32_t* pScanned);
+    
+    // CRC index
+    void feedCrcIndex(const char* pData, int length);
+    bool writeCrcIndex(uint32_t block, uint32_t crc);
 };
 #endif // AdafruitDataloggingShield_h
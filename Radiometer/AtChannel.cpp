@@ -0,0 +1,294 @@
+/*
+    AT command channel to the SIM7000 on the Botletics LTE/GPS shield.
+
+    Program Description : Commands are queued and each one is sent the moment
+        the one before it has completed, instead of after a fixed delay.  Every
+        line the modem sends is read into one buffer.  Final results (OK,
+        ERROR and the like) complete the command in flight.  Any other line,
+        whether it answers the command or is an unsolicited result code
+        (URC), is handed to the caller, who picks the fields out of the buffer
+        in place.  Nothing is copied on the way.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : AtChannel.cpp
+*/
+
+#include "AtChannel.h"
+
+AtChannel::AtChannel(Stream* pStream)
+{
+    this->pStream = pStream;
+}
+
+AtChannel::~AtChannel() {}
+
+bool AtChannel::queue(const __FlashStringHelper* pCommand, unsigned long timeout)
+{
+    return this->add((const char*)pCommand, true, timeout);
+}
+
+bool AtChannel::queue(char* pCommand, unsigned long timeout)
+{
+    return this->add(pCommand, false, timeout);
+}
+
+bool AtChannel::add(const char* pText, bool inFlash, unsigned long timeout)
+{
+    if (this->queued == AT_QUEUE_SIZE) {
+        return false;
+    }
+
+    Command* pNext = &this->commands[(this->first + this->queued) % AT_QUEUE_SIZE];
+
+    pNext->pText = pText;
+    pNext->inFlash = inFlash;
+    pNext->timeout = timeout;
+
+    this->queued++;
+    this->sendNext();
+
+    return true;
+}
+
+void AtChannel::write(char* pData, int length)
+{
+    this->pStream->write((uint8_t*)pData, length);
+}
+
+// Send the command at the front of the queue if nothing is in flight
+void AtChannel::sendNext()
+{
+    if (this->inFlight || this->queued == 0) {
+        return;
+    }
+
+    Command* pCommand = &this->commands[this->first];
+
+    if (pCommand->inFlash) {
+        this->pStream->print((const __FlashStringHelper*)pCommand->pText);
+    } else {
+        this->pStream->print(pCommand->pText);
+    }
+
+    this->pStream->write('\r');
+
+    this->inFlight = true;
+    this->sentAt = millis();
+}
+
+// The command in flight has finished.  A failed command takes the rest of the queue with
+// it, as later commands in a sequence depend on the earlier ones.
+void AtChannel::complete(byte result)
+{
+    this->result = result;
+    this->inFlight = false;
+
+    if (result == AT_OK) {
+        this->first = (this->first + 1) % AT_QUEUE_SIZE;
+        this->queued--;
+    } else {
+        this->failures++;
+        this->first = 0;
+        this->queued = 0;
+    }
+
+    this->sendNext();
+}
+
+// Check the line in the buffer for a final result and complete the command in flight
+bool AtChannel::finalResult()
+{
+    byte result;
+
+    if (strcmp_P(this->buffer, PSTR("OK")) == 0 ||
+        strcmp_P(this->buffer, PSTR("SHUT OK")) == 0 ||
+        strcmp_P(this->buffer, PSTR("NORMAL POWER DOWN")) == 0) {
+
+        result = AT_OK;
+    } else if (strcmp_P(this->buffer, PSTR("ERROR")) == 0 ||
+               strncmp_P(this->buffer, PSTR("+CME ERROR"), 10) == 0) {
+
+        result = AT_ERROR;
+    } else {
+        return false;
+    }
+
+    if (this->inFlight) {
+        this->complete(result);
+    }
+
+    return true;
+}
+
+bool AtChannel::poll()
+{
+    // The previous line has been dealt with
+    if (this->lineReady) {
+        this->lineReady = false;
+        this->length = 0;
+        this->fieldCount = 0;
+    }
+
+    this->sendNext();
+
+    if (this->inFlight && millis() - this->sentAt > this->commands[this->first].timeout) {
+        this->complete(AT_TIMEOUT);
+    }
+
+    while (this->pStream->available()) {
+        char c = this->pStream->read();
+
+        if (c == '\n') {
+            if (this->length == 0) {
+                continue;
+            }
+
+            this->buffer[this->length] = '\0';
+
+            // Final results and the echo of a command are not passed on
+            if (this->finalResult() || strncmp_P(this->buffer, PSTR("AT"), 2) == 0) {
+                this->length = 0;
+
+                continue;
+            }
+
+            this->lineReady = true;
+
+            return true;
+        }
+
+        if (c != '\r' && this->length < AT_BUFFER_SIZE - 1) {
+            this->buffer[this->length++] = c;
+        }
+    }
+
+    return false;
+}
+
+byte AtChannel::run()
+{
+    while (this->inFlight || this->queued > 0) {
+        this->poll();
+    }
+
+    return this->result;
+}
+
+bool AtChannel::waitFor(const __FlashStringHelper* pPrefix, unsigned long timeout)
+{
+    unsigned long failures = this->failures;
+    unsigned long startTime = millis();
+
+    while (millis() - startTime < timeout && this->failures == failures) {
+        if (this->poll() && this->match(pPrefix)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+byte AtChannel::check()
+{
+    while (this->poll()) {}
+
+    return this->getResult();
+}
+
+bool AtChannel::lookFor(const __FlashStringHelper* pPrefix)
+{
+    while (this->poll()) {
+        if (this->match(pPrefix)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+byte AtChannel::getResult()
+{
+    return this->isBusy() ? AT_BUSY : this->result;
+}
+
+void AtChannel::clear()
+{
+    this->first = 0;
+    this->queued = 0;
+    this->inFlight = false;
+    this->result = AT_OK;
+
+    this->length = 0;
+    this->lineReady = false;
+    this->fieldCount = 0;
+}
+
+bool AtChannel::isBusy()
+{
+    return this->inFlight || this->queued > 0;
+}
+
+char* AtChannel::getLine()
+{
+    return this->buffer;
+}
+
+bool AtChannel::match(const __FlashStringHelper* pPrefix)
+{
+    byte prefixLength = strlen_P((PGM_P)pPrefix);
+    bool quoted = false;
+
+    if (!this->lineReady || strncmp_P(this->buffer, (PGM_P)pPrefix, prefixLength) != 0) {
+        return false;
+    }
+
+    // The line has already been split
+    if (this->fieldCount > 0) {
+        this->fields[0] = prefixLength;
+
+        return true;
+    }
+
+    this->fields[0] = prefixLength;
+    this->fieldCount = 1;
+
+    for (byte i = prefixLength; i < this->length; i++) {
+        if (this->buffer[i] == '"') {
+            quoted = !quoted;
+        } else if (this->buffer[i] == ',' && !quoted && this->fieldCount < AT_MAX_FIELDS) {
+            this->buffer[i] = '\0';
+            this->fields[this->fieldCount++] = i + 1;
+        }
+    }
+
+    return true;
+}
+
+byte AtChannel::getFieldCount()
+{
+    return this->fieldCount;
+}
+
+// Fields that are missing from the line are empty
+char* AtChannel::getField(byte index)
+{
+    if (index >= this->fieldCount) {
+        return this->buffer + this->length;
+    }
+
+    return this->buffer + this->fields[index];
+}
+
+long AtChannel::getLong(byte index)
+{
+    return atol(this->getField(index));
+}
+
+float AtChannel::getFloat(byte index)
+{
+    return atof(this->getField(index));
+}
@@ -0,0 +1,140 @@
+/*
+    AT command channel to the SIM7000 on the Botletics LTE/GPS shield.
+
+    Program Description : Commands are queued and each one is sent the moment
+        the one before it has completed, instead of after a fixed delay.  Every
+        line the modem sends is read into one buffer.  Final results (OK,
+        ERROR and the like) complete the command in flight.  Any other line,
+        whether it answers the command or is an unsolicited result code
+        (URC), is handed to the caller, who picks the fields out of the buffer
+        in place.  Nothing is copied on the way.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : AtChannel.h
+*/
+
+#ifndef AtChannel_h
+#define AtChannel_h
+
+#include <Arduino.h>
+
+// Longest line kept from the modem.  +UGNSINF is the longest line the sketch reads.
+#define AT_BUFFER_SIZE 120
+
+// Most commands that can wait in the queue
+#define AT_QUEUE_SIZE 8
+
+// Most comma separated fields a line is split into
+#define AT_MAX_FIELDS 22
+
+// Time a command has to complete, unless it is queued with its own timeout (ms)
+#define AT_DEFAULT_TIMEOUT 1000
+
+// Command results
+#define AT_OK 0
+#define AT_ERROR 1
+#define AT_TIMEOUT 2
+
+// Returned by check() and getResult() while commands are still queued
+#define AT_BUSY 3
+
+class AtChannel
+{
+public:
+    AtChannel(Stream* pStream);
+    ~AtChannel();
+
+    //// Commands
+    //// Methods
+    // Queue a command.  The command is sent from where it is stored, so a command in RAM
+    // must not change until it has completed.  Returns false if the queue is full.
+    bool queue(const __FlashStringHelper* pCommand, unsigned long timeout=AT_DEFAULT_TIMEOUT);
+    bool queue(char* pCommand, unsigned long timeout=AT_DEFAULT_TIMEOUT);
+
+    // Send data the command in flight has asked for, such as an FTP chunk
+    void write(char* pData, int length);
+
+    // Read what the modem has sent, and send the next command once the one in flight has
+    // completed.  Returns true when a line is waiting in the buffer.
+    bool poll();
+
+    // Poll until every queued command has completed.  Returns AT_OK, or the result of the
+    // command that failed, in which case the commands queued after it are dropped.
+    byte run();
+
+    // Poll until a line starting with pPrefix arrives, and split it into fields.  Gives
+    // up early if a queued command fails.
+    bool waitFor(const __FlashStringHelper* pPrefix, unsigned long timeout);
+
+    // Read what the modem has sent so far without waiting for more, passing over any lines.
+    // Returns AT_BUSY while commands are queued, otherwise the result of the last one.
+    byte check();
+
+    // Read what the modem has sent so far without waiting for more, until a line starting
+    // with pPrefix is found and split into fields.  Returns false if none has arrived yet.
+    bool lookFor(const __FlashStringHelper* pPrefix);
+
+    // AT_BUSY while commands are queued, otherwise the result of the last one, without
+    // reading anything
+    byte getResult();
+
+    // Drop the queued commands and any partly read line
+    void clear();
+
+    // True until every queued command has completed
+    bool isBusy();
+
+    //// Current Line
+    // Valid until the next poll()
+    char* getLine();
+
+    // True if the line starts with pPrefix.  The text after the prefix is then split at
+    // the commas outside quotes, in place.
+    bool match(const __FlashStringHelper* pPrefix);
+
+    //// Getters
+    byte getFieldCount();
+    char* getField(byte index);
+    long getLong(byte index);
+    float getFloat(byte index);
+
+private:
+    //// VARIABLES
+    Stream* pStream = nullptr;
+
+    // Queued commands, the first one is the one in flight once it has been sent
+    struct Command
+    {
+        const char* pText;
+        bool inFlash;
+        unsigned long timeout;
+    };
+
+    Command commands[AT_QUEUE_SIZE];
+    byte first = 0;
+    byte queued = 0;
+    bool inFlight = false;
+    unsigned long sentAt = 0;
+
+    // Result of the last command that completed, and how many have failed
+    byte result = AT_OK;
+    unsigned long failures = 0;
+
+    // The line being read, and where each of its fields starts
+    char buffer[AT_BUFFER_SIZE];
+    byte length = 0;
+    bool lineReady = false;
+    byte fields[AT_MAX_FIELDS];
+    byte fieldCount = 0;
+
+    //// METHODS
+    bool add(const char* pText, bool inFlash, unsigned long timeout);
+    void sendNext();
+    void complete(byte result);
+    bool finalResult();
+};
+#endif // AtChannel_h
@@ -0,0 +1,557 @@
+/*
+    Upload of the files in the manifest, with block verification.
+
+    Program Description : Sends a file to the FTP server in chunks read from
+        the SD card, carrying on from the end of the server's copy when an
+        earlier upload was cut short.  A day file is followed by its CRC index
+        (NAME.CRC on the server), which lets the server compare its copy with
+        the logger's block by block.  The server lists the blocks that do not
+        match in NAME.BAD.  A later session reads that report and sends each
+        of those blocks again as a patch file, NAME.Bnnnnn, instead of the
+        whole file.  The file is done once the report lists no blocks.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : BlockUploader.cpp
+*/
+
+#include "BlockUploader.h"
+
+// Steps of an upload
+#define STEP_UPLOAD 0
+#define STEP_SIZE 1
+#define STEP_OPEN 2
+#define STEP_CLOSE 3
+#define STEP_INDEX_OPEN 4
+#define STEP_INDEX_CLOSE 5
+
+// Steps of a verification
+#define STEP_VERIFY 6
+#define STEP_REPORT_OPEN 7
+#define STEP_REPORT_READ 8
+#define STEP_PATCH_SIZE 9
+#define STEP_PATCH_OPEN 10
+#define STEP_PATCH_CLOSE 11
+
+// Sending a file, for all three
+#define STEP_SEND 12
+
+// Steps of sending a chunk
+#define SEND_CHUNK 0
+#define SEND_READY 1
+#define SEND_DATA 2
+#define SEND_WRITTEN 3
+
+BlockUploader::BlockUploader(AdafruitDataloggingShield* pDataloggingShield, Botletics_LTE_GPS_Shield* pModem, UploadManifest* pUploadManifest)
+{
+    this->pDataloggingShield = pDataloggingShield;
+    this->pModem = pModem;
+    this->pUploadManifest = pUploadManifest;
+}
+
+BlockUploader::~BlockUploader() {}
+
+void BlockUploader::startSession(int chunkSize, unsigned long checkpoint, unsigned long budgetBytes, unsigned long budgetTime)
+{
+    this->chunkSize = chunkSize;
+    this->checkpoint = checkpoint;
+    this->budgetBytes = budgetBytes;
+    this->budgetTime = budgetTime;
+    this->startTime = millis();
+    this->uploaded = 0;
+    this->resent = 0;
+}
+
+bool BlockUploader::budgetLeft()
+{
+    return this->uploaded < this->budgetBytes && millis() - this->startTime < this->budgetTime;
+}
+
+void BlockUploader::endSession()
+{
+    this->closeSource();
+}
+
+unsigned long BlockUploader::getUploaded()
+{
+    return this->uploaded;
+}
+
+unsigned long BlockUploader::getResent()
+{
+    return this->resent;
+}
+
+
+void BlockUploader::startUpload(int index, ManifestEntry* pEntry)
+{
+    this->index = index;
+    this->pEntry = pEntry;
+    this->step = STEP_UPLOAD;
+}
+
+void BlockUploader::startVerify(int index, ManifestEntry* pEntry)
+{
+    this->index = index;
+    this->pEntry = pEntry;
+    this->step = STEP_VERIFY;
+}
+
+byte BlockUploader::service()
+{
+    if (this->step == STEP_SEND) {
+        byte result = this->send();
+
+        if (result != BLOCK_BUSY) {
+            this->sent = (result == BLOCK_SENT);
+            this->closeUpload();
+        }
+
+        return BLOCK_BUSY;
+    }
+
+    return (this->step < STEP_VERIFY) ? this->serviceUpload() : this->serviceVerify();
+}
+
+bool BlockUploader::upload(int index, ManifestEntry* pEntry)
+{
+    byte result;
+
+    this->startUpload(index, pEntry);
+
+    while ((result = this->service()) == BLOCK_BUSY) {}
+
+    return result == BLOCK_SENT;
+}
+
+byte BlockUploader::verify(int index, ManifestEntry* pEntry)
+{
+    byte result;
+
+    this->startVerify(index, pEntry);
+
+    while ((result = this->service()) == BLOCK_BUSY) {}
+
+    return result;
+}
+
+// The manifest's position can be behind the server's copy by the chunks sent since the
+// last checkpoint, so a resumed upload asks the server where its copy ends.  Appending
+// from the manifest's position would repeat those chunks, and move every block after them.
+byte BlockUploader::serviceUpload()
+{
+    char indexName[13];
+    long serverSize;
+    byte result = MODEM_DONE;
+
+    // Every step after the first waits on the modem
+    if (this->step != STEP_UPLOAD) {
+        result = this->pModem->service();
+
+        if (result == MODEM_BUSY) {
+            return BLOCK_BUSY;
+        }
+    }
+
+    switch (this->step) {
+        case STEP_UPLOAD:
+            if (this->pEntry->offset > 0 && this->pEntry->offset < this->pEntry->size) {
+                this->pModem->startFtpSize(this->pEntry->name);
+                this->step = STEP_SIZE;
+
+                return BLOCK_BUSY;
+            }
+
+            return this->openFile();
+        case STEP_SIZE:
+            serverSize = this->pModem->getFtpSize();
+
+            if (serverSize >= 0 && (unsigned long)serverSize <= this->pEntry->size) {
+                this->pEntry->offset = serverSize;
+            }
+
+            return this->openFile();
+        case STEP_OPEN:
+            if (result != MODEM_DONE) {
+                return BLOCK_FAILED;
+            }
+
+            this->startSend(this->pEntry->name, &this->pEntry->offset, this->pEntry->size, this->index, STEP_CLOSE);
+
+            return BLOCK_BUSY;
+        case STEP_CLOSE:
+            this->pUploadManifest->update(this->index, this->pEntry->offset, MANIFEST_PENDING);
+
+            if (!this->sent || this->pEntry->offset < this->pEntry->size) {
+                this->pEntry->status = MANIFEST_PENDING;
+
+                return this->sent ? BLOCK_SENT : BLOCK_FAILED;
+            }
+
+            return this->openIndex();
+        case STEP_INDEX_OPEN:
+            if (result != MODEM_DONE) {
+                return BLOCK_FAILED;
+            }
+
+            this->pDataloggingShield->crcIndexName(this->pEntry->name, indexName);
+            this->startSend(indexName, &this->offset, this->pDataloggingShield->fileSize(indexName), -1, STEP_INDEX_CLOSE);
+
+            return BLOCK_BUSY;
+        default:
+            if (result != MODEM_DONE || !this->sent) {
+                return BLOCK_FAILED;
+            }
+
+            // Out of budget part way through, the index is sent again next time
+            if (this->offset < this->end) {
+                this->pEntry->status = MANIFEST_PENDING;
+
+                return BLOCK_SENT;
+            }
+
+            this->pEntry->status = MANIFEST_VERIFY;
+
+            return this->pUploadManifest->update(this->index, this->pEntry->size, MANIFEST_VERIFY) ? BLOCK_SENT : BLOCK_FAILED;
+    }
+}
+
+// Open what the server does not have of the file for appending, or go on to the index
+byte BlockUploader::openFile()
+{
+    if (this->pEntry->offset < this->pEntry->size) {
+        this->pModem->startFtpOpen(this->pEntry->name, this->pEntry->offset > 0);
+        this->step = STEP_OPEN;
+
+        return BLOCK_BUSY;
+    }
+
+    return this->openIndex();
+}
+
+// Files without an index, such as the burst captures, are done once they are uploaded
+byte BlockUploader::openIndex()
+{
+    char remoteName[20];
+    char indexName[13];
+    unsigned long indexSize = 0;
+
+    if (this->pDataloggingShield->crcIndexName(this->pEntry->name, indexName)) {
+        indexSize = this->pDataloggingShield->fileSize(indexName);
+    }
+
+    if (indexSize == 0) {
+        this->pEntry->status = MANIFEST_DONE;
+
+        return this->pUploadManifest->update(this->index, this->pEntry->size) ? BLOCK_SENT : BLOCK_FAILED;
+    }
+
+    snprintf_P(remoteName, sizeof(remoteName), PSTR("%s.CRC"), this->pEntry->name);
+
+    this->offset = 0;
+    this->pModem->startFtpOpen(remoteName, false);
+    this->step = STEP_INDEX_OPEN;
+
+    return BLOCK_BUSY;
+}
+
+// The server writes its report each time it checks the file, after applying the patches
+// it has been sent.  A patch that is still on the server has not been applied yet, so its
+// block is not sent again until the next report.  A report on an index with fewer blocks
+// than the logger's was written while the index was still being sent, and is ignored.
+byte BlockUploader::serviceVerify()
+{
+    char remoteName[20];
+    char indexName[13];
+    byte result;
+
+    switch (this->step) {
+        case STEP_VERIFY:
+            // Only the day files are indexed, anything else has nothing to check
+            if (!this->pDataloggingShield->crcIndexName(this->pEntry->name, indexName)) {
+                this->pEntry->status = MANIFEST_DONE;
+                this->pUploadManifest->update(this->index, this->pEntry->size);
+
+                return VERIFY_PASSED;
+            }
+
+            // The file is marked done once it has been waited on too long
+            result = this->pUploadManifest->addCheck(this->index);
+
+            if (result == 0) {
+                return VERIFY_FAILED;
+            }
+
+            if (result > VERIFY_MAX_CHECKS) {
+                this->pEntry->status = MANIFEST_DONE;
+                this->pUploadManifest->update(this->index, this->pEntry->size);
+
+                return VERIFY_ABANDONED;
+            }
+
+            snprintf_P(remoteName, sizeof(remoteName), PSTR("%s.BAD"), this->pEntry->name);
+
+            this->checked = 0;
+            this->count = 0;
+            this->header = true;
+            this->patched = false;
+            this->pModem->startFtpGetOpen(remoteName, VERIFY_MAX_BLOCKS * VERIFY_LINE_SIZE);
+            this->step = STEP_REPORT_OPEN;
+
+            return BLOCK_BUSY;
+        case STEP_REPORT_OPEN:
+            result = this->pModem->service();
+
+            if (result == MODEM_BUSY) {
+                return BLOCK_BUSY;
+            }
+
+            // No report yet
+            if (result != MODEM_DONE) {
+                return VERIFY_WAITING;
+            }
+
+            this->pModem->startFtpGetLine();
+            this->step = STEP_REPORT_READ;
+
+            return BLOCK_BUSY;
+        case STEP_REPORT_READ:
+            // The whole report is read, as the download cannot be stopped part way
+            while ((result = this->pModem->service()) == MODEM_LINE) {
+                char* pLine = this->pModem->getLine();
+
+                if (this->header) {
+                    this->checked = strtoul(pLine, nullptr, 10);
+                    this->header = false;
+                } else if (this->count < VERIFY_MAX_BLOCKS) {
+                    this->blocks[this->count++] = strtoul(pLine, nullptr, 10);
+                }
+            }
+
+            if (result == MODEM_BUSY) {
+                return BLOCK_BUSY;
+            }
+
+            if (!this->pModem->ftpGetFinished()) {
+                return VERIFY_FAILED;
+            }
+
+            this->pDataloggingShield->crcIndexName(this->pEntry->name, indexName);
+
+            if (this->header || this->checked != this->pDataloggingShield->fileSize(indexName) / CRC_RECORD_SIZE) {
+                return VERIFY_WAITING;
+            }
+
+            if (this->count == 0) {
+                this->pEntry->status = MANIFEST_DONE;
+                this->pUploadManifest->update(this->index, this->pEntry->size);
+
+                return VERIFY_PASSED;
+            }
+
+            this->block = 0;
+
+            return this->nextPatch();
+        case STEP_PATCH_SIZE:
+            if (this->pModem->service() == MODEM_BUSY) {
+                return BLOCK_BUSY;
+            }
+
+            if (this->pModem->getFtpSize() >= 0) {
+                this->block++;
+
+                return this->nextPatch();
+            }
+
+            snprintf_P(remoteName, sizeof(remoteName), PSTR("%s.B%05lu"), this->pEntry->name, this->blocks[this->block]);
+
+            this->pModem->startFtpOpen(remoteName, false);
+            this->step = STEP_PATCH_OPEN;
+
+            return BLOCK_BUSY;
+        case STEP_PATCH_OPEN:
+            result = this->pModem->service();
+
+            if (result == MODEM_BUSY) {
+                return BLOCK_BUSY;
+            }
+
+            if (result != MODEM_DONE) {
+                return VERIFY_FAILED;
+            }
+
+            this->startSend(this->pEntry->name, &this->offset, min(this->offset + CRC_BLOCK_SIZE, this->pEntry->size), -1, STEP_PATCH_CLOSE);
+
+            return BLOCK_BUSY;
+        default:
+            result = this->pModem->service();
+
+            if (result == MODEM_BUSY) {
+                return BLOCK_BUSY;
+            }
+
+            this->resent += this->offset - this->blocks[this->block] * CRC_BLOCK_SIZE;
+
+            if (result != MODEM_DONE || !this->sent) {
+                return VERIFY_FAILED;
+            }
+
+            this->patched = true;
+            this->block++;
+
+            return this->nextPatch();
+    }
+}
+
+// Send the next block the report lists again, if it is in the file and the budget allows.
+// The server is asked first whether the block is still waiting there as a patch.
+byte BlockUploader::nextPatch()
+{
+    char remoteName[20];
+
+    while (this->block < this->count && this->budgetLeft()) {
+        this->offset = this->blocks[this->block] * CRC_BLOCK_SIZE;
+
+        if (this->offset < this->pEntry->size) {
+            snprintf_P(remoteName, sizeof(remoteName), PSTR("%s.B%05lu"), this->pEntry->name, this->blocks[this->block]);
+
+            this->pModem->startFtpSize(remoteName);
+            this->step = STEP_PATCH_SIZE;
+
+            return BLOCK_BUSY;
+        }
+
+        this->block++;
+    }
+
+    return this->patched ? VERIFY_RESENT : VERIFY_WAITING;
+}
+
+// Send a file from *pOffset up to end over the FTP upload that has just been opened, and
+// go to closeStep once it stops, with the upload closed.  The position is saved to the
+// manifest entry at index every checkpoint bytes, unless index is -1.
+void BlockUploader::startSend(char* filename, unsigned long* pOffset, unsigned long end, int index, byte closeStep)
+{
+    this->pOffset = pOffset;
+    this->end = end;
+    this->saved = *pOffset;
+    this->checkpointIndex = index;
+    this->closeStep = closeStep;
+    this->sendStep = SEND_CHUNK;
+    this->step = STEP_SEND;
+
+    if (strcmp(this->sourceName, filename) != 0) {
+        this->closeSource();
+
+        if (!this->pDataloggingShield->openReader(filename)) {
+            this->sent = false;
+            this->closeUpload();
+
+            return;
+        }
+
+        strcpy(this->sourceName, filename);
+    }
+}
+
+void BlockUploader::closeUpload()
+{
+    this->pModem->startFtpClose();
+    this->step = this->closeStep;
+}
+
+// Send the file a chunk at a time, until it is sent or the budget runs out.  Returns
+// BLOCK_BUSY until then, BLOCK_SENT once it stops and BLOCK_FAILED if a chunk could not be
+// read or sent.  The file is left open for the next send, unless this one failed.
+byte BlockUploader::send()
+{
+    char piece[BLOCK_PIECE_SIZE];
+    unsigned long startTime = millis();
+    byte result;
+
+    switch (this->sendStep) {
+        case SEND_CHUNK:
+            if (*this->pOffset >= this->end || !this->budgetLeft()) {
+                return BLOCK_SENT;
+            }
+
+            this->pModem->startFtpWrite((int)min((unsigned long)this->chunkSize, this->end - *this->pOffset));
+            this->sendStep = SEND_READY;
+
+            break;
+        case SEND_READY:
+            result = this->pModem->service();
+
+            if (result == MODEM_FAILED) {
+                return this->sendFailed();
+            }
+
+            // The modem may take less than was asked for
+            if (result == MODEM_DONE) {
+                this->length = this->pModem->getFtpWriteLength();
+                this->written = 0;
+                this->sendStep = SEND_DATA;
+            }
+
+            break;
+        case SEND_DATA:
+            while (this->written < this->length && millis() - startTime < BLOCK_STEP_TIME) {
+                int size = min(BLOCK_PIECE_SIZE, this->length - this->written);
+
+                if (this->pDataloggingShield->readFrom(*this->pOffset + this->written, piece, size) != size) {
+                    return this->sendFailed();
+                }
+
+                this->pModem->ftpWriteData(piece, size);
+                this->written += size;
+            }
+
+            if (this->written == this->length) {
+                this->pModem->startFtpWritten();
+                this->sendStep = SEND_WRITTEN;
+            }
+
+            break;
+        default:
+            result = this->pModem->service();
+
+            if (result == MODEM_FAILED) {
+                return this->sendFailed();
+            }
+
+            if (result == MODEM_DONE) {
+                *this->pOffset += this->length;
+                this->uploaded += this->length;
+
+                // Save the position now and again, so a power cut does not restart the file
+                if (this->checkpointIndex >= 0 && *this->pOffset - this->saved >= this->checkpoint) {
+                    this->pUploadManifest->update(this->checkpointIndex, *this->pOffset, MANIFEST_PENDING);
+                    this->saved = *this->pOffset;
+                }
+
+                this->sendStep = SEND_CHUNK;
+            }
+
+            break;
+    }
+
+    return BLOCK_BUSY;
+}
+
+byte BlockUploader::sendFailed()
+{
+    this->closeSource();
+
+    return BLOCK_FAILED;
+}
+
+void BlockUploader::closeSource()
+{
+    if (this->sourceName[0] != '\0') {
+        this->pDataloggingShield->closeReader();
+        this->sourceName[0] = '\0';
+    }
+}
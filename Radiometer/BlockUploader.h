@@ -0,0 +1,159 @@
+/*
+    Upload of the files in the manifest, with block verification.
+
+    Program Description : Sends a file to the FTP server in chunks read from
+        the SD card, carrying on from the end of the server's copy when an
+        earlier upload was cut short.  A day file is followed by its CRC index
+        (NAME.CRC on the server), which lets the server compare its copy with
+        the logger's block by block.  The server lists the blocks that do not
+        match in NAME.BAD.  A later session reads that report and sends each
+        of those blocks again as a patch file, NAME.Bnnnnn, instead of the
+        whole file.  The file is done once the report lists no blocks.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : BlockUploader.h
+*/
+
+#ifndef BlockUploader_h
+#define BlockUploader_h
+
+#include <Arduino.h>
+#include "AdafruitDataloggingShield.h"
+#include "Botletics_LTE_GPS_Shield.h"
+#include "UploadManifest.h"
+
+// Most blocks one verification sends again.  The server's report has one "%08lu" line with
+// the number of blocks in the index it checked the file against, then one per bad block,
+// and is read VERIFY_MAX_BLOCKS lines at a time.
+#define VERIFY_MAX_BLOCKS 8
+#define VERIFY_LINE_SIZE 10
+
+// Verifications of a file before it is given up on.  A server that does not check the
+// files never writes a report, so the file would otherwise be waited on for ever.
+#define VERIFY_MAX_CHECKS 24
+
+// Results of a verification
+#define VERIFY_PASSED 0
+#define VERIFY_WAITING 1
+#define VERIFY_RESENT 2
+#define VERIFY_FAILED 3
+#define VERIFY_ABANDONED 4
+
+// Results of an upload, and of service() while a transfer is still going
+#define BLOCK_SENT 5
+#define BLOCK_FAILED 6
+#define BLOCK_BUSY 7
+
+// The chunk being sent is read from the card and written to the modem BLOCK_PIECE_SIZE bytes
+// at a time, for up to BLOCK_STEP_TIME (ms) a step
+#define BLOCK_PIECE_SIZE 16
+#define BLOCK_STEP_TIME 20
+
+class BlockUploader
+{
+public:
+    BlockUploader(AdafruitDataloggingShield* pDataloggingShield, Botletics_LTE_GPS_Shield* pModem, UploadManifest* pUploadManifest);
+    ~BlockUploader();
+
+    //// Session
+    // Start a session with a budget of bytes and time (ms).  Files are sent in chunks of
+    // chunkSize bytes, and the upload position is saved to the manifest every checkpoint
+    // bytes.
+    void startSession(int chunkSize, unsigned long checkpoint, unsigned long budgetBytes, unsigned long budgetTime);
+    bool budgetLeft();
+    
+    // Close the file being sent.  Call before the connection is closed.
+    void endSession();
+
+    // Bytes sent this session, and how many of them were blocks sent again
+    unsigned long getUploaded();
+    unsigned long getResent();
+
+    //// Transfers
+    // A start method begins a transfer, and service() takes it as far as it can go in a
+    // step without waiting on the modem.  service() returns BLOCK_BUSY until the transfer
+    // ends.  The entry must stay in place until then.
+    byte service();
+
+    // Upload what the server does not have of a file, and then its CRC index.  Ends with
+    // BLOCK_SENT, and the entry's status tells whether the file still has to be uploaded
+    // (the budget ran out), verified or is done.  Ends with BLOCK_FAILED if a transfer
+    // failed.
+    void startUpload(int index, ManifestEntry* pEntry);
+
+    // Read the server's report on an uploaded file and send the blocks it lists again.
+    // Ends with one of the VERIFY_ results, VERIFY_ABANDONED when the file has been verified
+    // VERIFY_MAX_CHECKS times already and has been marked done.
+    void startVerify(int index, ManifestEntry* pEntry);
+
+    //// Methods
+    // Run a transfer to the end.  upload() returns false if it failed.
+    bool upload(int index, ManifestEntry* pEntry);
+    byte verify(int index, ManifestEntry* pEntry);
+
+private:
+    //// VARIABLES
+    AdafruitDataloggingShield* pDataloggingShield = nullptr;
+    Botletics_LTE_GPS_Shield* pModem = nullptr;
+    UploadManifest* pUploadManifest = nullptr;
+
+    // Session
+    int chunkSize = 0;
+    unsigned long checkpoint = 0;
+    unsigned long budgetBytes = 0;
+    unsigned long budgetTime = 0;
+    unsigned long startTime = 0;
+    unsigned long uploaded = 0;
+    unsigned long resent = 0;
+    
+    // Transfer in progress, the entry it is for and the step it is at
+    byte step = 0;
+    int index = -1;
+    ManifestEntry* pEntry = nullptr;
+
+    // File being sent, from *pOffset up to end, the step to go to once it is, and whether
+    // it went through.  The position is saved to the manifest entry at checkpointIndex.
+    unsigned long* pOffset = nullptr;
+    unsigned long end = 0;
+    unsigned long saved = 0;
+    int checkpointIndex = -1;
+    byte closeStep = 0;
+    bool sent = false;
+
+    // Chunk being written to the modem, and the bytes of it written so far
+    byte sendStep = 0;
+    int length = 0;
+    int written = 0;
+
+    // Position in the CRC index or the block being sent
+    unsigned long offset = 0;
+
+    // Blocks the server's report lists, the number of blocks it was checked against, and
+    // the block being sent again
+    unsigned long blocks[VERIFY_MAX_BLOCKS];
+    unsigned long checked = 0;
+    byte count = 0;
+    byte block = 0;
+    bool header = true;
+    bool patched = false;
+
+    // File open for reading, kept open from one send to the next
+    char sourceName[13] = "";
+
+    //// METHODS
+    byte serviceUpload();
+    byte serviceVerify();
+    byte openFile();
+    byte openIndex();
+    byte nextPatch();
+    void startSend(char* filename, unsigned long* pOffset, unsigned long end, int index, byte closeStep);
+    void closeUpload();
+    byte send();
+    byte sendFailed();
+    void closeSource();
+};
+#endif // BlockUploader_h
@@ -12,22 +12,77 @@
             is being used on.
 
     Last Modified By : Benjamin Kleynhans
-    Last Modified Date : June 26, 2020
+    Last Modified Date : October 19, 2026
     Filename : Botletics_LTE_GPS_Shield.cpp
 */
 
 #include "Botletics_LTE_GPS_Shield.h"
 
-Botletics_LTE_GPS_Shield::Botletics_LTE_GPS_Shield(HardwareSerial* pSerial, int* pBaud, uint8_t* pPWRKEY, uint8_t* pRST, uint8_t* pTX, uint8_t* pRX)
+// Jobs run by service()
+#define JOB_NONE 0
+#define JOB_POWER_ON 1
+#define JOB_POWER_OFF 2
+#define JOB_SIGNAL 3
+#define JOB_GEO_DATA 4
+#define JOB_FTP_CONNECT 5
+#define JOB_FTP_OPEN 6
+#define JOB_FTP_WRITE 7
+#define JOB_FTP_CLOSE 8
+#define JOB_FTP_QUIT 9
+#define JOB_FTP_SIZE 10
+#define JOB_FTP_GET_OPEN 11
+#define JOB_FTP_GET_LINE 12
+
+// Steps of a power on
+#define POWER_KEY_DOWN 0
+#define POWER_BOOT 1
+#define POWER_BAUD 2
+#define POWER_PROBE 3
+#define POWER_ECHO 4
+#define POWER_CONFIGURE 5
+#define POWER_QUERY 6
+#define POWER_REGISTER 7
+#define POWER_RESET 8
+#define POWER_RESET_WAIT 9
+
+// Steps of a power off
+#define OFF_COMMAND 0
+#define OFF_WAIT 1
+
+// Steps of a GPS fix
+#define GPS_ON 0
+#define GPS_FIX 1
+#define GPS_OFF 2
+
+// Steps of an FTP login, each one waits for the commands queued by the one before
+#define CONNECT_SHUT 0
+#define CONNECT_BEARER 1
+#define CONNECT_SERVER 2
+#define CONNECT_PORT 3
+#define CONNECT_USER 4
+#define CONNECT_PASSWORD 5
+
+// Steps shared by the FTP jobs: waiting for the status line, then for the commands to
+// complete
+#define FTP_STATUS 0
+#define FTP_RESULT 1
+#define WRITE_READY 2
+
+// Steps of an FTP download
+#define GET_LINES 0
+#define GET_REQUEST 1
+#define GET_EMPTY 2
+#define GET_MORE 3
+
+Botletics_LTE_GPS_Shield::Botletics_LTE_GPS_Shield(HardwareSerial* pSerial, const int* pBaud, const uint8_t* pPWRKEY, const uint8_t* pRST, ModemTransport* pTransport)
 {
     this->pBaud = pBaud;
     this->pSerial = pSerial;
     
     this->pPWRKEY = pPWRKEY;
     this->pRST = pRST;
-    this->pTX = pTX;
-    this->pRX = pRX;
-       
+    this->pTransport = pTransport;
+    
     this->initializeDevice();
     //~ this->updateGeoData();
 }
@@ -39,9 +94,8 @@ void Botletics_LTE_GPS_Shield::initializeDevice()
 {    
     this->pSerial->println(F("Initializing Device"));
     delay(100);
-
-    //Instantiate the Software Serial interface
-    this->pFonaSS = new SoftwareSerial(*this->pRX, *this->pTX);
+    
+    this->pChannel = new AtChannel(this->pTransport);
     
     // Configure reset 
     pinMode(*this->pRST, OUTPUT);
@@ -57,65 +111,372 @@ void Botletics_LTE_GPS_Shield::initializeDevice()
     //~ this->getNetworkStatus();
 }
 
-// Turn the Botletics_LTE_GPS_Shield on
-void Botletics_LTE_GPS_Shield::powerOn()
+// Take the job in progress as far as it can go without waiting
+byte Botletics_LTE_GPS_Shield::service()
 {
-    this->pSerial->println(F("\n        --- Turning on Botletics LTE/GPS shield ---"));
-    delay(100);
+    switch (this->job) {
+        case JOB_POWER_ON:
+            return this->servicePowerOn();
+        case JOB_POWER_OFF:
+            return this->servicePowerOff();
+        case JOB_SIGNAL:
+            return this->serviceSignal();
+        case JOB_GEO_DATA:
+            return this->serviceGeoData();
+        case JOB_FTP_CONNECT:
+            return this->serviceFtpConnect();
+        case JOB_FTP_OPEN:
+            return this->serviceFtpOpen();
+        case JOB_FTP_WRITE:
+            return this->serviceFtpWrite();
+        case JOB_FTP_CLOSE:
+            return this->serviceFtpClose();
+        case JOB_FTP_QUIT:
+            return this->serviceFtpQuit();
+        case JOB_FTP_SIZE:
+            return this->serviceFtpSize();
+        case JOB_FTP_GET_OPEN:
+            return this->serviceFtpGetOpen();
+        case JOB_FTP_GET_LINE:
+            return this->serviceFtpGetLine();
+        default:
+            return MODEM_DONE;
+    }
+}
+
+void Botletics_LTE_GPS_Shield::startJob(byte job, byte step)
+{
+    this->job = job;
+    this->jobStart = millis();
+    this->nextStep(step);
+}
+
+void Botletics_LTE_GPS_Shield::nextStep(byte step)
+{
+    this->step = step;
+    this->stepStart = millis();
+}
+
+// True once the current step has gone on for time (ms)
+bool Botletics_LTE_GPS_Shield::waited(unsigned long time)
+{
+    return millis() - this->stepStart >= time;
+}
+
+byte Botletics_LTE_GPS_Shield::endJob(byte result)
+{
+    this->job = JOB_NONE;
     
-    // The module is powered on by pulsing the PWRKEY low for a few milliseconds.  The
-    // amount of time depends on the module being used (Reference documentation for details).
-    digitalWrite(*this->pPWRKEY, LOW);
-    delay(100);
+    return result;
+}
+
+// Drop whatever the failed job left queued
+byte Botletics_LTE_GPS_Shield::failJob()
+{
+    this->pChannel->clear();
     
-    digitalWrite(*this->pPWRKEY, HIGH);
-    delay(3000);    // SIM7000 takes about 3 seconds to turn on
+    return this->endJob(MODEM_FAILED);
+}
+
+// Run the job to the end
+byte Botletics_LTE_GPS_Shield::finishJob()
+{
+    byte result;
     
-    this->pSerial->println(F("\n        --- Powered On ---"));
+    while ((result = this->service()) == MODEM_BUSY) {}
     
-    // According to maker, the SIM7000 baud seems to reset after being power cycled
-    // (SIMCom firmware related).
-    this->updateBaud();
+    return result;
+}
+
+// Turn the Botletics_LTE_GPS_Shield on and wait for it to register on the network.  A modem
+// that has not registered in time is power cycled, up to MODEM_REGISTRATION_ATTEMPTS times.
+bool Botletics_LTE_GPS_Shield::powerOn()
+{
+    this->startPowerOn();
+    this->finishJob();
     
-    // Set modem to FULL functionality (AT+CFUN=1)
-    this->fona.setFunctionality(1);
+    return this->connected;
+}
+
+void Botletics_LTE_GPS_Shield::startPowerOn()
+{
+    this->registrationResets = 0;
+    this->startJob(JOB_POWER_ON, POWER_KEY_DOWN);
+    this->pressPowerKey();
+}
+
+// The module is powered on by pulsing the PWRKEY low for a few milliseconds.  The amount
+// of time depends on the module being used (Reference documentation for details).
+void Botletics_LTE_GPS_Shield::pressPowerKey()
+{
+    this->pSerial->println(F("\n        --- Turning on Botletics LTE/GPS shield ---"));
     
-    // Configure the network settings (APN)
-    this->fona.setNetworkSettings(F("hologram"));
+    digitalWrite(*this->pPWRKEY, LOW);
+    this->nextStep(POWER_KEY_DOWN);
+}
+
+byte Botletics_LTE_GPS_Shield::servicePowerOn()
+{
+    unsigned long baud = this->pTransport->getMaxBaud();
+    byte result;
     
-    // Get network status after power-on
-    this->getNetworkStatus();
+    switch (this->step) {
+        case POWER_KEY_DOWN:
+            if (this->waited(100)) {
+                digitalWrite(*this->pPWRKEY, HIGH);
+                this->nextStep(POWER_BOOT);
+            }
+            
+            break;
+        case POWER_BOOT:
+            // SIM7000 takes about 3 seconds to turn on
+            if (!this->waited(3000)) {
+                break;
+            }
+            
+            this->poweredOn = true;
+            
+            this->pSerial->println(F("\n        --- Powered On ---"));
+            
+            // According to maker, the SIM7000 baud seems to reset after being power cycled
+            // (SIMCom firmware related), so it is set to the fastest rate the link can
+            // take.  The OK still comes back at the old rate, so the timeout is only a limit.
+            this->pTransport->begin(MODEM_DEFAULT_BAUD);
+            
+            snprintf_P(this->command, sizeof(this->command), PSTR("AT+IPR=%lu"), baud);
+            this->pChannel->clear();
+            this->queueCommand(100);
+            this->nextStep(POWER_BAUD);
+            
+            break;
+        case POWER_BAUD:
+            if (this->pChannel->check() == AT_BUSY) {
+                break;
+            }
+            
+            this->pTransport->begin(baud);
+            
+            this->pSerial->println(F("\n        --- Baud Set ---\n"));
+            
+            // Test if the device is reachable after changing the baud rate
+            this->attempts = 0;
+            this->pChannel->queue(F("AT"), 500);
+            this->nextStep(POWER_PROBE);
+            
+            break;
+        case POWER_PROBE:
+            result = this->pChannel->check();
+            
+            if (result == AT_OK) {
+                // Turn the command echo off
+                this->pChannel->queue(F("ATE0"));
+                this->nextStep(POWER_ECHO);
+            } else if (result != AT_BUSY) {
+                if (++this->attempts == 7) {
+                    this->pSerial->println(F("\n        !!! Couldn't find FONA !!!\n"));
+                    while(1);
+                }
+                
+                this->pChannel->queue(F("AT"), 500);
+            }
+            
+            break;
+        case POWER_ECHO:
+            result = this->pChannel->check();
+            
+            if (result == AT_BUSY) {
+                break;
+            }
+            
+            if (result != AT_OK) {
+                this->pSerial->println(F("\n        !!! Couldn't find FONA !!!\n"));
+                while(1);
+            }
+            
+            // Set modem to FULL functionality, configure the network settings (APN), and
+            // have the modem report changes in the registration
+            this->pChannel->queue(F("AT+CFUN=1"), 10000);
+            this->pChannel->queue(F("AT+CGDCONT=1,\"IP\",\"" MODEM_APN "\""), 10000);
+            this->pChannel->queue(F("AT+CREG=1"));
+            this->nextStep(POWER_CONFIGURE);
+            
+            break;
+        case POWER_CONFIGURE:
+            // The status is asked for once, after that the modem reports every change
+            if (this->pChannel->check() != AT_BUSY) {
+                this->netStatus = 0;
+                this->pChannel->queue(F("AT+CREG?"));
+                this->nextStep(POWER_QUERY);
+            }
+            
+            break;
+        case POWER_QUERY:
+            // The reply to the query has the URC mode in front of the status
+            if (this->pChannel->lookFor(F("+CREG: "))) {
+                this->netStatus = this->pChannel->getLong(1);
+            }
+            
+            // The registration time runs from the query
+            if (this->pChannel->getResult() != AT_BUSY) {
+                this->printNetworkStatus();
+                this->step = POWER_REGISTER;
+            }
+            
+            break;
+        case POWER_REGISTER:
+            if (this->netStatus == 1 || this->netStatus == 5) {
+                this->connected = true;
+                this->registrationTime = millis() - this->jobStart;
+                
+                return this->endJob(MODEM_DONE);
+            }
+            
+            if (this->waited(MODEM_REGISTRATION_TIMEOUT)) {
+                if (this->registrationResets + 1 >= MODEM_REGISTRATION_ATTEMPTS) {
+                    this->registrationTime = millis() - this->jobStart;
+                    
+                    return this->endJob(MODEM_DONE);
+                }
+                
+                this->pSerial->println(F("The device has not connected in time. Performing reset"));
+                this->pChannel->queue(F("AT+CPOWD=1"));
+                this->nextStep(POWER_RESET);
+                
+                break;
+            }
+            
+            // The URC only has the status
+            if (this->pChannel->lookFor(F("+CREG: "))) {
+                this->netStatus = this->pChannel->getLong(this->pChannel->getFieldCount() - 1);
+                this->printNetworkStatus();
+            }
+            
+            break;
+        case POWER_RESET:
+            if (this->pChannel->check() != AT_BUSY) {
+                this->nextStep(POWER_RESET_WAIT);
+            }
+            
+            break;
+        case POWER_RESET_WAIT:
+            // 5 s for the modem to power down, and 5 s more before it is turned on again
+            if (this->waited(10000)) {
+                this->poweredDown();
+                this->registrationResets++;
+                this->pressPowerKey();
+            }
+            
+            break;
+    }
     
-    // Update the geographic data
-    this->updateGeoData();
+    return MODEM_BUSY;
 }
 
-// Update the baud and set to 9600
-void Botletics_LTE_GPS_Shield::updateBaud()
-{    
-    this->pFonaSS->begin(115200);
-    this->pFonaSS->println("AT+IPR=9600");      // Set baud rate to 9600
-    delay(100);
-    this->pFonaSS->begin(9600);
-    
-    this->pSerial->println(F("\n        --- Baud Set ---\n"));
+void Botletics_LTE_GPS_Shield::printNetworkStatus()
+{
+    this->pSerial->print(F("Network status "));
+    this->pSerial->print(this->netStatus);
+    this->pSerial->print(F(": "));
     
-    // Test if the device is reachable after changing the baud rate
-    if (!this->fona.begin(*this->pFonaSS)) {
-        this->pSerial->println(F("\n        !!! Couldn't find FONA !!!\n"));
-        while(1);
+    switch (this->netStatus) {
+        case 0:
+            this->pSerial->println(F("Not registered"));
+            
+            break;
+        case 1:
+            this->pSerial->println(F("Registered (home)"));
+            
+            break;
+        case 2:
+            this->pSerial->println(F("Not registered (searching)"));
+            
+            break;
+        case 3:
+            this->pSerial->println(F("Denied"));
+            
+            break;
+        case 4:
+            this->pSerial->println(F("Unknown"));
+            
+            break;
+        case 5:
+            this->pSerial->println(F("Registered roaming"));
+            
+            break;
+        default:
+            break;
     }
 }
 
 // Turn the Botletics_LTE_GPS_Shield off_type
 void Botletics_LTE_GPS_Shield::powerOff()
+{
+    this->startPowerOff();
+    this->finishJob();
+}
+
+void Botletics_LTE_GPS_Shield::startPowerOff()
 {
     this->pSerial->println(F("\n        --- Turning off Botletics LTE/GPS shield ---\n"));
     
-    this->fona.powerDown();
-    delay(5000);
+    this->pChannel->queue(F("AT+CPOWD=1"));
+    this->startJob(JOB_POWER_OFF, OFF_COMMAND);
+}
+
+byte Botletics_LTE_GPS_Shield::servicePowerOff()
+{
+    if (this->step == OFF_COMMAND) {
+        if (this->pChannel->check() != AT_BUSY) {
+            this->nextStep(OFF_WAIT);
+        }
+        
+        return MODEM_BUSY;
+    }
+    
+    if (!this->waited(5000)) {
+        return MODEM_BUSY;
+    }
+    
+    this->poweredDown();
     
     this->pSerial->println(F("\n      --> Botletics LTE/GPS shield is off"));
+    
+    return this->endJob(MODEM_DONE);
+}
+
+// Close the link, so the idle receive line can not wake the MCU while the modem is off.  The
+// registration goes with the power.
+void Botletics_LTE_GPS_Shield::poweredDown()
+{
+    this->pTransport->end();
+    
+    this->poweredOn = false;
+    this->connected = false;
+}
+
+bool Botletics_LTE_GPS_Shield::isPoweredOn()
+{
+    return this->poweredOn;
+}
+
+bool Botletics_LTE_GPS_Shield::isRegistered()
+{
+    return this->connected;
+}
+
+int8_t Botletics_LTE_GPS_Shield::getRssi()
+{
+    return this->rssi;
+}
+
+unsigned long Botletics_LTE_GPS_Shield::getRegistrationTime()
+{
+    return this->registrationTime;
+}
+
+uint8_t Botletics_LTE_GPS_Shield::getRegistrationResets()
+{
+    return this->registrationResets;
 }
 
 float Botletics_LTE_GPS_Shield::getLatitude()
@@ -123,9 +484,9 @@ float Botletics_LTE_GPS_Shield::getLatitude()
     return this->latitude;
 }
 
-char* Botletics_LTE_GPS_Shield::getLatitudeStr()
+char* Botletics_LTE_GPS_Shield::getLatitudeStr(char* pString)
 {
-    return this->latitudeStr;
+    return dtostrf(this->getLatitude(), 4, 6, pString);
 }
 
 float Botletics_LTE_GPS_Shield::getLongitude()
@@ -133,9 +494,9 @@ float Botletics_LTE_GPS_Shield::getLongitude()
     return this->longitude;
 }
 
-char* Botletics_LTE_GPS_Shield::getLongitudeStr()
+char* Botletics_LTE_GPS_Shield::getLongitudeStr(char* pString)
 {
-    return this->longitudeStr;
+    return dtostrf(this->getLongitude(), 4, 6, pString);
 }
 
 float Botletics_LTE_GPS_Shield::getAltitude()
@@ -143,9 +504,9 @@ float Botletics_LTE_GPS_Shield::getAltitude()
     return this->altitude;
 }
 
-char* Botletics_LTE_GPS_Shield::getAltitudeStr()
-{    
-    return this->altitudeStr;
+char* Botletics_LTE_GPS_Shield::getAltitudeStr(char* pString)
+{
+    return dtostrf(this->getAltitude(), 4, 6, pString);
 }
 
 float Botletics_LTE_GPS_Shield::getSpeedKph()
@@ -153,9 +514,9 @@ float Botletics_LTE_GPS_Shield::getSpeedKph()
     return this->speed_kph;
 }
 
-char* Botletics_LTE_GPS_Shield::getSpeedKphStr()
+char* Botletics_LTE_GPS_Shield::getSpeedKphStr(char* pString)
 {
-    return this->speedKphStr;
+    return dtostrf(this->getSpeedKph(), 4, 6, pString);
 }
 
 float Botletics_LTE_GPS_Shield::getHeading()
@@ -163,9 +524,9 @@ float Botletics_LTE_GPS_Shield::getHeading()
     return this->heading;
 }
 
-char* Botletics_LTE_GPS_Shield::getHeadingStr()
+char* Botletics_LTE_GPS_Shield::getHeadingStr(char* pString)
 {
-    return this->headingStr;
+    return dtostrf(this->getHeading(), 4, 6, pString);
 }
 
 void Botletics_LTE_GPS_Shield::setYear(uint16_t year)
@@ -228,181 +589,158 @@ float Botletics_LTE_GPS_Shield::getSeconds()
     return this->seconds;
 }
 
-// Turn the GPS on
-void Botletics_LTE_GPS_Shield::turnGpsOn()
+// Queue the commands that turn the GPS off
+void Botletics_LTE_GPS_Shield::turnGpsOff()
 {
-    this->pSerial->println(F("\n      --> Turning GPS on"));
-    this->fona.enableGPS(true);
-    delay(100);
+    this->pSerial->println(F("\n      --> Turning GPS off"));
+    this->pChannel->queue(F("AT+CGNSURC=0"));
+    this->pChannel->queue(F("AT+CGNSPWR=0"));
 }
 
-// Turn the GPS off
-void Botletics_LTE_GPS_Shield::turnGpsOff()
+// Queue the commands that turn the LTE off
+void Botletics_LTE_GPS_Shield::turnGprsOff()
 {
-    this->pSerial->println(F("\n      --> Turning GPS off"));
-    this->fona.enableGPS(false);
-    delay(100);
+    this->pSerial->println(F("\n      --> Turning GPRS off"));
+    this->pChannel->queue(F("AT+SAPBR=0,1"), 10000);
+    this->pChannel->queue(F("AT+CGATT=0"), 10000);
 }
 
-// Turn the LTE on
-void Botletics_LTE_GPS_Shield::turnGprsOn()
+// Read the current signal strength and convert it to dBm
+int8_t Botletics_LTE_GPS_Shield::updateSignalStrength()
 {
-    this->pSerial->println(F("\n      --> Turning GPRS on"));
-    this->fona.enableGPRS(true);
-    delay(100);
+    this->startSignalStrength();
+    this->finishJob();
+    
+    return this->rssi;
 }
 
-// Turn the LTE off
-void Botletics_LTE_GPS_Shield::turnGprsOff()
+void Botletics_LTE_GPS_Shield::startSignalStrength()
 {
-    this->pSerial->println(F("\n      --> Turning GPRS off"));
-    this->fona.enableGPRS(false);
-    delay(100);
+    this->csq = 99;
+    this->pChannel->queue(F("AT+CSQ"));
+    this->startJob(JOB_SIGNAL, 0);
 }
 
-// Get the current signal strength
-void Botletics_LTE_GPS_Shield::getSignalStrength()
+byte Botletics_LTE_GPS_Shield::serviceSignal()
 {
-    uint8_t n = this->fona.getRSSI();
-    int8_t r;
+    if (this->pChannel->lookFor(F("+CSQ: "))) {
+        this->csq = this->pChannel->getLong(0);
+    }
+    
+    if (this->pChannel->getResult() == AT_BUSY) {
+        return MODEM_BUSY;
+    }
     
     this->pSerial->print(F("RSSI = "));
-    this->pSerial->print(n);
+    this->pSerial->print(this->csq);
     this->pSerial->print(F(": "));
     
-    switch (n) {
+    switch (this->csq) {
         case 0:
-            r = -115;
+            this->rssi = -115;
             
             break;
         case 1:
-            r = -111;
+            this->rssi = -111;
             
             break;
         case 31:
-            r = -52;
+            this->rssi = -52;
+            
+            break;
+        case 99:
+            this->rssi = MODEM_RSSI_UNKNOWN;
             
             break;
         default:
-            r = map(n, 2, 30, -110, -54);
+            this->rssi = map(this->csq, 2, 30, -110, -54);
     }
     
-    this->pSerial->print(r);
+    this->pSerial->print(this->rssi);
     this->pSerial->println(F(" dBm"));
+    
+    return this->endJob(MODEM_DONE);
 }
 
-// Check whether the device has successfully connected and registered to the cellular network
-void Botletics_LTE_GPS_Shield::getNetworkStatus()
+// Get the current latitude, longitude and altitude
+bool Botletics_LTE_GPS_Shield::updateGeoData()
 {
-    byte resetCounter = 0;
+    this->startGeoData(MODEM_GPS_TIMEOUT);
     
-    // Wait for the network to connect before continuing
-    while (!this->connected) {
-        // read the network/cellular status
-        this->netStatus = fona.getNetworkStatus();
-        
-        this->pSerial->print(F("Network status "));
-        this->pSerial->print(this->netStatus);
-        this->pSerial->print(F(": "));
-        
-        switch (this->netStatus) {
-            case 0:
-                this->pSerial->println(F("Not registered"));
-                
-                break;
-            case 1:
-                this->pSerial->println(F("Registered (home)"));
-                
-                break;
-            case 2:
-                this->pSerial->println(F("Not registered (searching)"));
-                
-                break;
-            case 3:
-                this->pSerial->println(F("Denied"));
-                
-                break;
-            case 4:
-                this->pSerial->println(F("Unknown"));
-                
-                break;
-            case 5:
-                this->pSerial->println(F("Registered roaming"));
-                
-                break;
-            default:
-                break;
-        }
-        
-        // Set the connected status to true
-        if (this->netStatus == 1 || this->netStatus == 5) {
-            this->connected = true;
-        } else {
-            resetCounter++;
-        }
-        
-        if (resetCounter == 10) {
-            this->pSerial->println(F("The device has not connected after 10 attempts. Performing reset"));
-            
-            this->powerOff();
-            delay(5000);
-            
-            this->powerOn();
-            delay(5000);
-            
-            resetCounter = 0;
-        }
-        
-        delay(1000);
-    }
+    return this->finishJob() == MODEM_DONE;
 }
 
-// Get the current latitude, longitude and altitude
-void Botletics_LTE_GPS_Shield::updateGeoData()
+void Botletics_LTE_GPS_Shield::startGeoData(unsigned long timeout)
 {
     // Provide user feedback
     this->pSerial->println(F("\n --- Updating location ---\n"));
     
     // Reset the variables
     this->resetVariables();
+    this->fixTimeout = timeout;
+    this->fixed = false;
     
-    // Turn GPS on
-    this->turnGpsOn();
-    
-    // This variable is used to ensure the GPS has connected before leaving the function
-    bool validLocation = false;
-    
-    // Get the location data
-    while (!validLocation) {
-        this->fona.getGPS(
-            &this->latitude,
-            &this->longitude,
-            &this->speed_kph,
-            &this->heading,
-            &this->altitude,
-            &this->year,
-            &this->month,
-            &this->day,
-            &this->hours,
-            &this->minutes,
-            &this->seconds
-        );
-        
-        if (this->latitude != 0 && this->longitude != 0 && this->altitude != 0) {
-            validLocation = true;
-        }
-        
-        delay(1000);
+    // Turn the GPS on, with a +UGNSINF report after every fix
+    this->pSerial->println(F("\n      --> Turning GPS on"));
+    this->pChannel->queue(F("AT+CGNSPWR=1"));
+    this->pChannel->queue(F("AT+CGNSURC=1"));
+    this->startJob(JOB_GEO_DATA, GPS_ON);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceGeoData()
+{
+    switch (this->step) {
+        case GPS_ON:
+            if (this->pChannel->check() != AT_BUSY) {
+                this->overflows = this->pTransport->getOverflows();
+                this->nextStep(GPS_FIX);
+            }
+            
+            break;
+        case GPS_FIX:
+            // The GPS reports every fix once a second.  The report is sent as soon as the
+            // fix is made, so the first one with a position is fresh enough to set the clock
+            // from.  A report read after bytes were lost may be missing some of its own, so
+            // it is passed over.
+            while (this->pChannel->lookFor(F("+UGNSINF: "))) {
+                if (this->pTransport->getOverflows() != this->overflows) {
+                    this->overflows = this->pTransport->getOverflows();
+                    
+                    continue;
+                }
+                
+                if (this->readGnssInfo()) {
+                    this->fixed = true;
+                    this->printGeoData();
+                    
+                    break;
+                }
+            }
+            
+            if (this->fixed || this->waited(this->fixTimeout)) {
+                if (!this->fixed) {
+                    this->pSerial->println(F("\n      !!! No GPS fix !!!"));
+                }
+                
+                this->turnGpsOff();
+                this->nextStep(GPS_OFF);
+            }
+            
+            break;
+        case GPS_OFF:
+            if (this->pChannel->check() != AT_BUSY) {
+                return this->endJob(this->fixed ? MODEM_DONE : MODEM_FAILED);
+            }
+            
+            break;
     }
     
-    // Create char-based variable from float variable    
-    dtostrf(this->getLatitude(), 4, 6, this->latitudeStr);
-    dtostrf(this->getLongitude(), 4, 6, this->longitudeStr);
-    dtostrf(this->getAltitude(), 4, 6, this->altitudeStr);
-    dtostrf(this->getSpeedKph(), 4, 6, this->speedKphStr);
-    dtostrf(this->getHeading(), 4, 6, this->headingStr);
-    
-    // Print current location
+    return MODEM_BUSY;
+}
+
+// Print current location
+void Botletics_LTE_GPS_Shield::printGeoData()
+{
     this->pSerial->println(F("\n        --- Current Location ---\n"));
     this->pSerial->print(F("Latitude    : "));
     this->pSerial->println(this->getLatitude(), 6);
@@ -423,11 +761,628 @@ void Botletics_LTE_GPS_Shield::updateGeoData()
     this->pSerial->print(this->getMinutes());
     this->pSerial->print(F(":"));
     this->pSerial->println(this->getSeconds());
+}
+
+// Read the fix out of the +UGNSINF report in the channel's buffer.  Returns true if the
+// report has a position.
+bool Botletics_LTE_GPS_Shield::readGnssInfo()
+{
+    // Fields: run status, fix status, UTC time, latitude, longitude, altitude, speed, course
+    if (this->pChannel->getLong(1) != 1) {
+        return false;
+    }
+    
+    char* pTime = this->pChannel->getField(2);
+    
+    this->fixTime = millis();
+    
+    if (strlen(pTime) < 14) {
+        return false;
+    }
+    
+    this->latitude = this->pChannel->getFloat(3);
+    this->longitude = this->pChannel->getFloat(4);
+    this->altitude = this->pChannel->getFloat(5);
+    this->speed_kph = this->pChannel->getFloat(6);
+    this->heading = this->pChannel->getFloat(7);
     
-    delay(1000);
+    // yyyyMMddhhmmss.sss, read from the back so each part can be cut off in place
+    this->seconds = atof(pTime + 12);
+    pTime[12] = '\0';
+    this->minutes = atoi(pTime + 10);
+    pTime[10] = '\0';
+    this->hours = atoi(pTime + 8);
+    pTime[8] = '\0';
+    this->day = atoi(pTime + 6);
+    pTime[6] = '\0';
+    this->month = atoi(pTime + 4);
+    pTime[4] = '\0';
+    this->year = atoi(pTime);
     
-    // Turn GPS off
-    this->turnGpsOff();
+    return this->latitude != 0 && this->longitude != 0 && this->altitude != 0;
+}
+
+unsigned long Botletics_LTE_GPS_Shield::getFixTime()
+{
+    return this->fixTime;
+}
+
+// Bring up the data connection and log in to the FTP server
+bool Botletics_LTE_GPS_Shield::ftpConnect(char* server, uint16_t port, char* username, char* password)
+{
+    this->startFtpConnect(server, port, username, password);
+    
+    return this->finishJob() == MODEM_DONE;
+}
+
+void Botletics_LTE_GPS_Shield::startFtpConnect(char* server, uint16_t port, char* username, char* password)
+{
+    this->pServer = server;
+    this->port = port;
+    this->pUsername = username;
+    this->pPassword = password;
+    
+    this->pSerial->println(F("\n      --> Turning GPRS on"));
+    
+    // Disconnect all sockets
+    this->pChannel->queue(F("AT+CIPSHUT"), 20000);
+    this->startJob(JOB_FTP_CONNECT, CONNECT_SHUT);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpConnect()
+{
+    byte result = this->pChannel->check();
+    
+    if (result == AT_BUSY) {
+        return MODEM_BUSY;
+    }
+    
+    // Sockets that were not open do not matter, everything after that does
+    if (result != AT_OK && this->step != CONNECT_SHUT) {
+        this->pSerial->println(F("\n      !!! FTP connection failed !!!"));
+        
+        return this->failJob();
+    }
+    
+    switch (this->step) {
+        case CONNECT_SHUT:
+            // Attach, set up the bearer profile and open it
+            this->pChannel->queue(F("AT+CGATT=1"), 10000);
+            this->pChannel->queue(F("AT+SAPBR=3,1,\"CONTYPE\",\"GPRS\""), 10000);
+            this->pChannel->queue(F("AT+SAPBR=3,1,\"APN\",\"" MODEM_APN "\""), 10000);
+            this->pChannel->queue(F("AT+CSTT=\"" MODEM_APN "\""), 10000);
+            this->pChannel->queue(F("AT+SAPBR=1,1"), 30000);
+            this->pChannel->queue(F("AT+CNACT=1,\"" MODEM_APN "\""), 10000);
+            this->nextStep(CONNECT_BEARER);
+            
+            break;
+        case CONNECT_BEARER:
+            this->pChannel->queue(F("AT+FTPCID=1"), 10000);
+            
+            snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPSERV=\"%s\""), this->pServer);
+            this->queueCommand(10000);
+            
+            // The default port needs no command
+            this->nextStep((this->port != 21) ? CONNECT_SERVER : CONNECT_PORT);
+            
+            break;
+        case CONNECT_SERVER:
+            snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPPORT=%u"), this->port);
+            this->queueCommand(10000);
+            this->nextStep(CONNECT_PORT);
+            
+            break;
+        case CONNECT_PORT:
+            snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPUN=\"%s\""), this->pUsername);
+            this->queueCommand(10000);
+            this->nextStep(CONNECT_USER);
+            
+            break;
+        case CONNECT_USER:
+            snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPPW=\"%s\""), this->pPassword);
+            this->queueCommand(10000);
+            this->nextStep(CONNECT_PASSWORD);
+            
+            break;
+        default:
+            return this->endJob(MODEM_DONE);
+    }
+    
+    return MODEM_BUSY;
+}
+
+// Open a file on the server root for writing.  Appending adds to the end of an existing
+// file (FTP APPE), otherwise the file is replaced (FTP STOR).
+bool Botletics_LTE_GPS_Shield::ftpOpen(char* filename, bool append)
+{
+    this->startFtpOpen(filename, append);
+    
+    return this->finishJob() == MODEM_DONE;
+}
+
+void Botletics_LTE_GPS_Shield::startFtpOpen(char* filename, bool append)
+{
+    snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPPUTNAME=\"%s\""), filename);
+    
+    this->pChannel->queue(this->command);
+    this->pChannel->queue(F("AT+FTPPUTPATH=\"/\""));
+    this->pChannel->queue(append ? F("AT+FTPPUTOPT=\"APPE\"") : F("AT+FTPPUTOPT=\"STOR\""));
+    this->pChannel->queue(F("AT+FTPPUT=1"));
+    
+    this->ftpChunkSize = 0;
+    this->startJob(JOB_FTP_OPEN, FTP_STATUS);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpOpen()
+{
+    int mode;
+    int status;
+    
+    if (this->step == FTP_RESULT) {
+        return this->awaitResult();
+    }
+    
+    byte result = this->awaitLine(F("+FTPPUT: "), 75000);
+    
+    if (result == MODEM_BUSY) {
+        return MODEM_BUSY;
+    }
+    
+    // The session is open once the modem reports the largest chunk it will take
+    this->readFtpStatus(&mode, &status);
+    
+    if (result == MODEM_FAILED || mode != 1 || status != 1) {
+        return this->failJob();
+    }
+    
+    this->ftpChunkSize = this->pChannel->getLong(2);
+    this->nextStep(FTP_RESULT);
+    
+    return MODEM_BUSY;
+}
+
+// Send a chunk of the open file.  Returns the number of bytes the server has taken, or 0
+// if the transfer failed.
+int Botletics_LTE_GPS_Shield::ftpWrite(char* pData, int length)
+{
+    this->startFtpWrite(length);
+    
+    if (this->finishJob() != MODEM_DONE) {
+        return 0;
+    }
+    
+    length = this->ftpWriteLength;
+    
+    this->ftpWriteData(pData, length);
+    this->startFtpWritten();
+    
+    return (this->finishJob() == MODEM_DONE) ? length : 0;
+}
+
+// Ask the modem to take a chunk of at most the largest size it reported
+void Botletics_LTE_GPS_Shield::startFtpWrite(int length)
+{
+    this->ftpWriteLength = min(length, this->ftpChunkSize);
+    this->startJob(JOB_FTP_WRITE, WRITE_READY);
+    
+    if (this->ftpWriteLength > 0) {
+        snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPPUT=2,%d"), this->ftpWriteLength);
+        this->queueCommand(10000);
+    }
+}
+
+int Botletics_LTE_GPS_Shield::getFtpWriteLength()
+{
+    return this->ftpWriteLength;
+}
+
+void Botletics_LTE_GPS_Shield::ftpWriteData(char* pData, int length)
+{
+    this->pChannel->write(pData, length);
+}
+
+// The data is answered with OK, and the modem asks for the next chunk once this one has
+// reached the server
+void Botletics_LTE_GPS_Shield::startFtpWritten()
+{
+    this->startJob(JOB_FTP_WRITE, FTP_STATUS);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpWrite()
+{
+    int mode;
+    int status;
+    byte result;
+    
+    switch (this->step) {
+        case WRITE_READY:
+            if (this->ftpWriteLength <= 0) {
+                return this->endJob(MODEM_FAILED);
+            }
+            
+            result = this->awaitLine(F("+FTPPUT: "), 10000);
+            
+            if (result == MODEM_BUSY) {
+                break;
+            }
+            
+            this->readFtpStatus(&mode, &status);
+            
+            if (result == MODEM_FAILED || mode != 2 || status <= 0) {
+                return this->failJob();
+            }
+            
+            // The modem may take less than was asked for
+            if (status < this->ftpWriteLength) {
+                this->ftpWriteLength = status;
+            }
+            
+            return this->endJob(MODEM_DONE);
+        case FTP_STATUS:
+            result = this->awaitLine(F("+FTPPUT: "), 75000);
+            
+            if (result == MODEM_BUSY) {
+                break;
+            }
+            
+            this->readFtpStatus(&mode, &status);
+            
+            if (result == MODEM_FAILED || mode != 1 || status != 1) {
+                return this->failJob();
+            }
+            
+            this->nextStep(FTP_RESULT);
+            
+            break;
+        default:
+            return this->awaitResult();
+    }
+    
+    return MODEM_BUSY;
+}
+
+// Finish the file on the server
+bool Botletics_LTE_GPS_Shield::ftpClose()
+{
+    this->startFtpClose();
+    
+    return this->finishJob() == MODEM_DONE;
+}
+
+void Botletics_LTE_GPS_Shield::startFtpClose()
+{
+    this->pChannel->queue(F("AT+FTPPUT=2,0"));
+    this->startJob(JOB_FTP_CLOSE, FTP_STATUS);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpClose()
+{
+    int mode;
+    int status;
+    
+    if (this->step == FTP_RESULT) {
+        return this->awaitResult();
+    }
+    
+    byte result = this->awaitLine(F("+FTPPUT: "), 75000);
+    
+    if (result == MODEM_BUSY) {
+        return MODEM_BUSY;
+    }
+    
+    this->readFtpStatus(&mode, &status);
+    
+    if (result == MODEM_FAILED || mode != 1 || status != 0) {
+        return this->failJob();
+    }
+    
+    this->nextStep(FTP_RESULT);
+    
+    return MODEM_BUSY;
+}
+
+// Log out of the FTP server and drop the data connection
+void Botletics_LTE_GPS_Shield::ftpQuit()
+{
+    this->startFtpQuit();
+    this->finishJob();
+}
+
+void Botletics_LTE_GPS_Shield::startFtpQuit()
+{
+    this->pChannel->queue(F("AT+FTPQUIT"), 10000);
+    this->startJob(JOB_FTP_QUIT, FTP_STATUS);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpQuit()
+{
+    if (this->pChannel->check() == AT_BUSY) {
+        return MODEM_BUSY;
+    }
+    
+    if (this->step == FTP_RESULT) {
+        return this->endJob(MODEM_DONE);
+    }
+    
+    this->ftpChunkSize = 0;
+    
+    this->turnGprsOff();
+    this->nextStep(FTP_RESULT);
+    
+    return MODEM_BUSY;
+}
+
+int Botletics_LTE_GPS_Shield::getFtpChunkSize()
+{
+    return this->ftpChunkSize;
+}
+
+// Ask the server for the size of a file.  The name is set the same way as for a download.
+long Botletics_LTE_GPS_Shield::ftpSize(char* filename)
+{
+    this->startFtpSize(filename);
+    this->finishJob();
+    
+    return this->ftpSizeResult;
+}
+
+void Botletics_LTE_GPS_Shield::startFtpSize(char* filename)
+{
+    snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPGETNAME=\"%s\""), filename);
+    
+    this->pChannel->queue(this->command);
+    this->pChannel->queue(F("AT+FTPGETPATH=\"/\""));
+    this->pChannel->queue(F("AT+FTPSIZE"));
+    
+    this->ftpSizeResult = -1;
+    this->startJob(JOB_FTP_SIZE, FTP_STATUS);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpSize()
+{
+    if (this->step == FTP_RESULT) {
+        return (this->pChannel->check() == AT_BUSY) ? MODEM_BUSY : this->endJob(MODEM_DONE);
+    }
+    
+    byte result = this->awaitLine(F("+FTPSIZE: "), 75000);
+    
+    if (result == MODEM_FAILED) {
+        return this->failJob();
+    }
+    
+    // "+FTPSIZE: 1,<error>,<size>", where the error is 0 for a file that is there
+    if (result == MODEM_LINE) {
+        if (this->pChannel->getLong(1) == 0) {
+            this->ftpSizeResult = this->pChannel->getLong(2);
+        }
+        
+        this->nextStep(FTP_RESULT);
+    }
+    
+    return MODEM_BUSY;
+}
+
+// Size found by the last size job, or -1
+long Botletics_LTE_GPS_Shield::getFtpSize()
+{
+    return this->ftpSizeResult;
+}
+
+// Open a file on the server root for reading.  The modem reports "+FTPGET: 1,1" once there
+// is data to read, or "+FTPGET: 1,0" straight away for an empty file.
+bool Botletics_LTE_GPS_Shield::ftpGetOpen(char* filename, int chunkSize)
+{
+    this->startFtpGetOpen(filename, chunkSize);
+    
+    return this->finishJob() == MODEM_DONE;
+}
+
+void Botletics_LTE_GPS_Shield::startFtpGetOpen(char* filename, int chunkSize)
+{
+    snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPGETNAME=\"%s\""), filename);
+    
+    this->pChannel->queue(this->command);
+    this->pChannel->queue(F("AT+FTPGETPATH=\"/\""));
+    this->pChannel->queue(F("AT+FTPGET=1"));
+    
+    this->ftpGetChunk = chunkSize;
+    this->ftpGetting = false;
+    this->startJob(JOB_FTP_GET_OPEN, FTP_STATUS);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpGetOpen()
+{
+    int mode;
+    int status;
+    
+    if (this->step == FTP_RESULT) {
+        return this->awaitResult();
+    }
+    
+    byte result = this->awaitLine(F("+FTPGET: "), 75000);
+    
+    if (result == MODEM_BUSY) {
+        return MODEM_BUSY;
+    }
+    
+    this->readFtpStatus(&mode, &status);
+    
+    if (result == MODEM_FAILED || mode != 1 || (status != 0 && status != 1)) {
+        return this->failJob();
+    }
+    
+    // Lines lost from here on would go unnoticed in the report
+    this->overflows = this->pTransport->getOverflows();
+    this->ftpGetting = true;
+    this->ftpGetEnded = (status == 0);
+    this->nextStep(FTP_RESULT);
+    
+    return MODEM_BUSY;
+}
+
+// Return the next line of the open download, asking for another chunk once the one before
+// it has been read.  The lines of a chunk arrive between "+FTPGET: 2,<length>" and the OK
+// that completes the request.
+char* Botletics_LTE_GPS_Shield::ftpGetLine()
+{
+    this->startFtpGetLine();
+    
+    return (this->finishJob() == MODEM_LINE) ? this->getLine() : nullptr;
+}
+
+void Botletics_LTE_GPS_Shield::startFtpGetLine()
+{
+    this->startJob(JOB_FTP_GET_LINE, GET_LINES);
+}
+
+byte Botletics_LTE_GPS_Shield::serviceFtpGetLine()
+{
+    int mode;
+    int status;
+    byte result;
+    
+    if (!this->ftpGetting) {
+        return this->endJob(this->ftpGetFinished() ? MODEM_DONE : MODEM_FAILED);
+    }
+    
+    switch (this->step) {
+        case GET_LINES:
+            if (this->pChannel->isBusy()) {
+                while (this->pChannel->poll()) {
+                    if (this->pTransport->getOverflows() != this->overflows) {
+                        this->ftpGetting = false;
+                        
+                        return this->failJob();
+                    }
+                    
+                    // The end of the file can be reported before the OK of the last request
+                    if (this->pChannel->match(F("+FTPGET: "))) {
+                        if (this->pChannel->getLong(0) == 1) {
+                            this->ftpGetEnded = true;
+                        }
+                        
+                        continue;
+                    }
+                    
+                    return MODEM_LINE;
+                }
+                
+                break;
+            }
+            
+            if (this->ftpGetEnded) {
+                this->ftpGetting = false;
+                
+                return this->endJob(MODEM_DONE);
+            }
+            
+            snprintf_P(this->command, sizeof(this->command), PSTR("AT+FTPGET=2,%d"), this->ftpGetChunk);
+            this->queueCommand(10000);
+            this->nextStep(GET_REQUEST);
+            
+            break;
+        case GET_EMPTY:
+            if (this->pChannel->check() != AT_BUSY) {
+                this->nextStep(GET_MORE);
+            }
+            
+            break;
+        default:
+            result = this->awaitLine(F("+FTPGET: "), 75000);
+            
+            if (result == MODEM_BUSY) {
+                break;
+            }
+            
+            if (result == MODEM_FAILED) {
+                this->ftpGetting = false;
+                
+                return this->failJob();
+            }
+            
+            this->readFtpStatus(&mode, &status);
+            
+            // Nothing has come in from the server yet, so wait for it to report more data
+            if (this->step == GET_REQUEST && mode == 2 && status == 0) {
+                this->nextStep(GET_EMPTY);
+                
+                break;
+            }
+            
+            // "+FTPGET: 1,0" is the end of the file, any other status an error
+            if (mode == 1 && status != 1) {
+                this->ftpGetEnded = true;
+                
+                if (status != 0) {
+                    this->ftpGetting = false;
+                    
+                    return this->failJob();
+                }
+            }
+            
+            this->nextStep(GET_LINES);
+            
+            break;
+    }
+    
+    return MODEM_BUSY;
+}
+
+// The line the download job returned MODEM_LINE for
+char* Botletics_LTE_GPS_Shield::getLine()
+{
+    return this->pChannel->getLine();
+}
+
+// True if the last download ran to the end of the file
+bool Botletics_LTE_GPS_Shield::ftpGetFinished()
+{
+    return !this->ftpGetting && this->ftpGetEnded && !this->pChannel->isBusy();
+}
+
+// Queue the command that has been built in the command buffer
+void Botletics_LTE_GPS_Shield::queueCommand(unsigned long timeout)
+{
+    this->pChannel->queue(this->command, timeout);
+}
+
+// Look for a line starting with pPrefix, which has to arrive within timeout of the start
+// of the step.  Returns MODEM_LINE once it has, and MODEM_FAILED if a queued command failed
+// or the time ran out.
+byte Botletics_LTE_GPS_Shield::awaitLine(const __FlashStringHelper* pPrefix, unsigned long timeout)
+{
+    if (this->pChannel->lookFor(pPrefix)) {
+        return MODEM_LINE;
+    }
+    
+    byte result = this->pChannel->getResult();
+    
+    if ((result != AT_BUSY && result != AT_OK) || this->waited(timeout)) {
+        return MODEM_FAILED;
+    }
+    
+    return MODEM_BUSY;
+}
+
+// Wait for the queued commands to complete, and end the job with their result
+byte Botletics_LTE_GPS_Shield::awaitResult()
+{
+    byte result = this->pChannel->check();
+    
+    if (result == AT_BUSY) {
+        return MODEM_BUSY;
+    }
+    
+    return (result == AT_OK) ? this->endJob(MODEM_DONE) : this->failJob();
+}
+
+// Read "+FTPPUT: <mode>,<status>[,<length>]" or "+FTPGET: <mode>,<status>" from the line
+// awaitLine() found.  For mode 2 the status is the number of bytes the modem is ready to
+// take, or that follow.  Anything else the line has stays in the channel's buffer.
+void Botletics_LTE_GPS_Shield::readFtpStatus(int* pMode, int* pStatus)
+{
+    *pMode = (int)this->pChannel->getLong(0);
+    *pStatus = (this->pChannel->getFieldCount() > 1) ? (int)this->pChannel->getLong(1) : -1;
 }
 
 void Botletics_LTE_GPS_Shield::resetVariables()
@@ -8,7 +8,7 @@
     Authors : Benjamin Kleynhans
 
     Last Modified By : Benjamin Kleynhans
-    Last Modified Date : June 26, 2020
+    Last Modified Date : October 19, 2026
     Filename : Botletics_LTE_GPS_Shield.h
 */
 
@@ -16,13 +16,37 @@
 #define Botletics_LTE_GPS_Shield_h
 
 #include <Arduino.h>
-#include <SoftwareSerial.h>
-#include <Adafruit_FONA.h>
+#include "ModemTransport.h"
+#include "AtChannel.h"
+
+// Access point name of the cellular data service
+#define MODEM_APN "hologram"
+
+// Time allowed for network registration before the modem is power cycled (ms), and how
+// many times the modem is powered on before powerOn() gives up
+#define MODEM_REGISTRATION_TIMEOUT 120000
+#define MODEM_REGISTRATION_ATTEMPTS 2
+
+// Signal strength reported when the modem could not measure it (AT+CSQ 99)
+#define MODEM_RSSI_UNKNOWN 0
+
+// Time allowed for the first GPS fix after the GPS is turned on (ms)
+#define MODEM_GPS_TIMEOUT 600000
+
+// Results of service()
+#define MODEM_BUSY 0
+#define MODEM_DONE 1
+#define MODEM_FAILED 2
+#define MODEM_LINE 3
+
+// Room for a GPS value written out as text with 6 decimals, such as an altitude of
+// "-1234.567890"
+#define GPS_STRING_SIZE 14
 
 class Botletics_LTE_GPS_Shield
 {
 public:
-    Botletics_LTE_GPS_Shield(HardwareSerial* pSerial, int* pBaud, uint8_t* pPWRKEY, uint8_t* pRST, uint8_t* pTX, uint8_t* pRX);
+    Botletics_LTE_GPS_Shield(HardwareSerial* pSerial, const int* pBaud, const uint8_t* pPWRKEY, const uint8_t* pRST, ModemTransport* pTransport);
     ~Botletics_LTE_GPS_Shield();
     
     
@@ -32,17 +56,19 @@ public:
     //// Data Management
     //// Getters and Setters
     // Geo location
-    // We don't set these values as they are populated via memory reference
+    // We don't set these values as they are populated via memory reference.  The text
+    // versions are written into pString, GPS_STRING_SIZE characters, when they are asked
+    // for, and pString is returned.
     float getLatitude();
-    char* getLatitudeStr();
+    char* getLatitudeStr(char* pString);
     float getLongitude();
-    char* getLongitudeStr();
+    char* getLongitudeStr(char* pString);
     float getSpeedKph();
-    char* getSpeedKphStr();
+    char* getSpeedKphStr(char* pString);
     float getHeading();
-    char* getHeadingStr();
+    char* getHeadingStr(char* pString);
     float getAltitude();
-    char* getAltitudeStr();
+    char* getAltitudeStr(char* pString);
     
     // Date and Time
     void setYear(uint16_t year);
@@ -58,36 +84,130 @@ public:
     void setSeconds(float seconds);
     float getSeconds();
     
+    // millis() when the date and time were read from the GPS
+    unsigned long getFixTime();
+    
     //// Variables    
+    //// Jobs
+    // Methods
+    // Every modem operation below can also be run a step at a time, so the sketch keeps
+    // sampling while the modem works.  A start method begins the job, and service() takes
+    // it as far as it can without waiting for the modem, each time it is called.  service()
+    // returns MODEM_BUSY until the job is over, then MODEM_DONE or MODEM_FAILED.  The
+    // methods that wait for the result run the same job to the end.  Only one job runs at
+    // a time.
+    byte service();
+    
     //// Hardware Management
     // Methods
-    void powerOn();
+    // Returns true once the modem has registered on the network.  The GPS works either way.
+    bool powerOn();
+    void startPowerOn();
     void powerOff();
+    void startPowerOff();
+    bool isPoweredOn();
+    bool isRegistered();
+    
+    // Read the signal strength from the modem.  Returns it in dBm, or MODEM_RSSI_UNKNOWN.
+    int8_t updateSignalStrength();
+    void startSignalStrength();
+    
+    // Last signal strength read (dBm)
+    int8_t getRssi();
+    
+    // Time the last powerOn() took to register, or spent trying (ms), and the number of
+    // times the modem was power cycled to get there
+    unsigned long getRegistrationTime();
+    uint8_t getRegistrationResets();
+    
+    // Wait for a GPS fix and update the location, date and time.  The job fails if there
+    // is no fix within timeout (ms).
+    bool updateGeoData();
+    void startGeoData(unsigned long timeout);
+    
+    // FTP upload session.  A file is opened on the server, written in chunks of at most
+    // getFtpChunkSize() bytes and closed.  Appending resumes a partly uploaded file.  The
+    // server, username and password are read as the job goes, so they must not change
+    // until it is over.
+    bool ftpConnect(char* server, uint16_t port, char* username, char* password);
+    void startFtpConnect(char* server, uint16_t port, char* username, char* password);
+    bool ftpOpen(char* filename, bool append);
+    void startFtpOpen(char* filename, bool append);
+    int ftpWrite(char* pData, int length);
+    bool ftpClose();
+    void startFtpClose();
+    void ftpQuit();
+    void startFtpQuit();
+    int getFtpChunkSize();
+    
+    // A chunk written a step at a time.  The job started by startFtpWrite() is done once
+    // the modem is ready for getFtpWriteLength() bytes, which may be fewer than were asked
+    // for.  They are handed over with ftpWriteData(), in as many pieces as suits the
+    // caller, and the job started by startFtpWritten() is done once they reached the server.
+    void startFtpWrite(int length);
+    int getFtpWriteLength();
+    void ftpWriteData(char* pData, int length);
+    void startFtpWritten();
+    
+    // Size of a file on the server root, or -1 if there is no such file
+    long ftpSize(char* filename);
+    void startFtpSize(char* filename);
+    long getFtpSize();
+    
+    // FTP download session for a file of short lines.  The file is read in chunks of
+    // chunkSize bytes, which must be a multiple of the line length so that no line is split
+    // between two chunks.  ftpGetLine() returns nullptr at the end of the file, or if the
+    // transfer failed, and ftpGetFinished() tells which.  The job started by
+    // startFtpGetLine() returns MODEM_LINE from service() each time a line is waiting in
+    // getLine(), and is done at the end of the file.  A line lost to a full receive buffer
+    // fails the download.
+    bool ftpGetOpen(char* filename, int chunkSize);
+    void startFtpGetOpen(char* filename, int chunkSize);
+    char* ftpGetLine();
+    void startFtpGetLine();
+    char* getLine();
+    bool ftpGetFinished();
     
     // Variables
 
 private:
     //// VARIABLES
     // Define the baud rate from constructor
-    int* pBaud = nullptr;
+    const int* pBaud = nullptr;
     
     // Define a hardware serial for constructor parameter
     HardwareSerial* pSerial = nullptr;
     
     // Define the communication variables
-    uint8_t* pPWRKEY = nullptr;
-    uint8_t* pRST = nullptr;
-    uint8_t* pTX = nullptr;
-    uint8_t* pRX = nullptr;
+    const uint8_t* pPWRKEY = nullptr;
+    const uint8_t* pRST = nullptr;
+    
+    // Serial link to the modem, and the AT command channel that runs over it
+    ModemTransport* pTransport = nullptr;
+    AtChannel* pChannel = nullptr;
     
-    // Define Software Serial
-    // Conversions from example:
-    //      fonaSS      --> *this->pFonaSS
-    //      fonaSerial  --> this->pFonaSerial
-    //      fona        --> fona
+    // Commands with parameters are built here.  Only one can be queued at a time.
+    char command[48];
     
-    SoftwareSerial* pFonaSS = nullptr;
-    Adafruit_FONA_LTE fona = Adafruit_FONA_LTE();
+    // Job in progress, the step it is at and when that step started
+    byte job = 0;
+    byte step = 0;
+    unsigned long stepStart = 0;
+    
+    // Job parameters, kept until the job needs them.  The attempts count the AT probes
+    // after a baud change, and the power cycles while waiting for registration.
+    char* pServer = nullptr;
+    uint16_t port = 0;
+    char* pUsername = nullptr;
+    char* pPassword = nullptr;
+    unsigned long jobStart = 0;
+    unsigned long fixTimeout = 0;
+    uint8_t attempts = 0;
+    uint8_t csq = 99;
+    unsigned long overflows = 0;
+    bool fixed = false;
+    int ftpWriteLength = 0;
+    long ftpSizeResult = -1;
     
     // Define variables for GPS information
     float latitude = 0.0f;
@@ -96,13 +216,6 @@ private:
     float heading = 0.0f;
     float altitude = 0.0f;
     
-    // Latitude, Longitude and Altitude converted from float to char
-    char latitudeStr[11];
-    char longitudeStr[11];
-    char altitudeStr[11];
-    char speedKphStr[11];
-    char headingStr[11];
-    
     // Define variables for time information    
     uint16_t year = 0;
     uint8_t month = 0;
@@ -110,26 +223,63 @@ private:
     uint8_t hours = 0;
     uint8_t minutes = 0;
     float seconds = 0.0f;
+    unsigned long fixTime = 0;
+    
+    // Largest chunk the modem accepts in one FTP write
+    int ftpChunkSize = 0;
+    
+    // Chunk asked for in an FTP download, and whether the download is open and the server
+    // has sent the end of the file
+    int ftpGetChunk = 0;
+    bool ftpGetting = false;
+    bool ftpGetEnded = false;
     
     // Variable to monitor network connectivity
+    bool poweredOn = false;
     bool connected = false;
     uint8_t netStatus = 0;
+    int8_t rssi = MODEM_RSSI_UNKNOWN;
+    unsigned long registrationTime = 0;
+    uint8_t registrationResets = 0;
         
     //// METHODS
     // Hardware management
     void resetDevice();
     void initializeDevice();    
-    void turnGpsOn();
+    void pressPowerKey();
     void turnGpsOff();
-    void turnGprsOn();
     void turnGprsOff();
+    void poweredDown();
+    
+    // Jobs
+    void startJob(byte job, byte step);
+    void nextStep(byte step);
+    bool waited(unsigned long time);
+    byte endJob(byte result);
+    byte failJob();
+    byte awaitResult();
+    byte finishJob();
+    byte servicePowerOn();
+    byte servicePowerOff();
+    byte serviceSignal();
+    byte serviceGeoData();
+    byte serviceFtpConnect();
+    byte serviceFtpOpen();
+    byte serviceFtpWrite();
+    byte serviceFtpClose();
+    byte serviceFtpQuit();
+    byte serviceFtpSize();
+    byte serviceFtpGetOpen();
+    byte serviceFtpGetLine();
     
     // Software management
-    void updateBaud();
-    void getSignalStrength();
-    void getNetworkStatus();
-    void updateGeoData();
+    bool readGnssInfo();
+    void printNetworkStatus();
+    void printGeoData();
     void uploadDataFile();
+    void queueCommand(unsigned long timeout);
+    byte awaitLine(const __FlashStringHelper* pPrefix, unsigned long timeout);
+    void readFtpStatus(int* pMode, int* pStatus);
     void resetVariables();    
     
 };
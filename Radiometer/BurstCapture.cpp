@@ -0,0 +1,244 @@
+/*
+    Event-triggered burst capture for the Extended ADC Shields.
+
+    Program Description : Between the regular 1 Hz samples the selected channels
+        are watched by a cheap detector working on the raw ADC codes (a rising
+        threshold or a rate of change between consecutive codes).  Every code the
+        detector looks at is kept in a circular pre-trigger buffer.  When the
+        detector fires, the triggering channel is sampled back to back until the
+        post-trigger window is full, and the capture is held until it has been
+        written to the burst file on the SD-card.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : BurstCapture.cpp
+*/
+
+#include "BurstCapture.h"
+
+BurstCapture::BurstCapture(ExtendedADCShieldStack* pAdcStack, const byte* pChannels, byte numberChannels, byte mode, word level, byte preTrigger, byte postTrigger)
+{
+    this->pAdcStack = pAdcStack;
+    this->pChannels = pChannels;
+    this->numberChannels = numberChannels;
+    this->mode = mode;
+    this->level = level;
+
+    // The pre-trigger window always holds at least the triggering sample, and
+    // both windows have to fit in the buffer together
+    this->preTrigger = constrain(preTrigger, 1, BURST_BUFFER_SIZE);
+    this->postTrigger = min(postTrigger, BURST_BUFFER_SIZE - this->preTrigger);
+
+    this->pLastCodes = new word[numberChannels];
+}
+
+BurstCapture::~BurstCapture()
+{
+    delete[] this->pLastCodes;
+}
+
+// Sample the next watched channel and run the detector on it
+void BurstCapture::poll()
+{
+    byte index = this->nextChannel;
+    byte channel = pgm_read_byte(&this->pChannels[index]);
+
+    this->nextChannel = (index + 1) % this->numberChannels;
+
+    word code = this->pAdcStack->sampleRaw(channel);
+    unsigned long time = micros();
+    bool fired = this->detect(index, code);
+
+    // The buffer is frozen until the previous capture has been written
+    if (this->ready) {
+        if (fired) {
+            this->overruns++;
+        }
+
+        return;
+    }
+
+    this->push(channel, code, time);
+
+    if (fired) {
+        this->triggerChannel = channel;
+        this->triggerTime = time;
+
+        this->capture(channel);
+    }
+}
+
+// Compare a code against the last code seen on the same channel.  The codes are
+// compared as unsigned values, which suits the unipolar inputs.
+bool BurstCapture::detect(byte index, word code)
+{
+    bool fired = false;
+    word lastCode = this->pLastCodes[index];
+
+    if (this->lastCodesValid) {
+        switch (this->mode) {
+            case BURST_THRESHOLD:
+                fired = (lastCode < this->level) && (code >= this->level);
+
+                break;
+            case BURST_RATE_OF_CHANGE:
+                fired = ((code > lastCode) ? (code - lastCode) : (lastCode - code)) >= this->level;
+
+                break;
+            default:
+                break;
+        }
+    }
+
+    this->pLastCodes[index] = code;
+
+    // Every channel has been seen once
+    if (index == this->numberChannels - 1) {
+        this->lastCodesValid = true;
+    }
+
+    return fired;
+}
+
+// Add a sample to the pre-trigger window, overwriting the oldest sample once it is full
+void BurstCapture::push(byte channel, word code, unsigned long time)
+{
+    this->samples[this->head].channel = channel;
+    this->samples[this->head].code = code;
+    this->samples[this->head].time = time;
+
+    this->head = (this->head + 1) % this->preTrigger;
+
+    if (this->count < this->preTrigger) {
+        this->count++;
+    }
+}
+
+// Sample the triggering channel back to back until the post-trigger window is full.
+// The post-trigger samples go in the buffer after the pre-trigger window.
+void BurstCapture::capture(byte channel)
+{
+    BurstSample* pPost = this->samples + this->preTrigger;
+
+    for (byte i = 0; i < this->postTrigger; i++) {
+        pPost[i].channel = channel;
+        pPost[i].code = this->pAdcStack->sampleRaw(channel);
+        pPost[i].time = micros();
+    }
+
+    if (this->postTrigger > 0) {
+        this->triggerLatency = pPost[0].time - this->triggerTime;
+    } else {
+        this->triggerLatency = 0;
+    }
+
+    if (this->postTrigger > 1) {
+        unsigned long elapsed = pPost[this->postTrigger - 1].time - pPost[0].time;
+
+        this->captureRate = elapsed ? ((this->postTrigger - 1) * 1000000UL) / elapsed : 0;
+    } else {
+        this->captureRate = 0;
+    }
+
+    this->captures++;
+    this->ready = true;
+}
+
+bool BurstCapture::captureReady()
+{
+    return this->ready;
+}
+
+// Append the capture to a burst file.  Each capture starts with a description line
+// followed by one line per sample: channel, time relative to the trigger and raw code.
+bool BurstCapture::write(AdafruitDataloggingShield* pDataloggingShield, char* filename)
+{
+    char line[96];
+
+    if (!pDataloggingShield->openForAppend(filename)) {
+        this->rearm();
+
+        return false;
+    }
+
+    DateTime now = pDataloggingShield->rtc.now();
+
+    snprintf_P(
+        line,
+        sizeof(line),
+        PSTR("Burst Channel: ch%d, Time: %d/%d/%d %d:%d:%d, Latency: %lu us, Rate: %lu Hz, Overruns: %lu"),
+        (this->triggerChannel + 1),
+        now.year(),
+        now.month(),
+        now.day(),
+        now.hour(),
+        now.minute(),
+        now.second(),
+        this->triggerLatency,
+        this->captureRate,
+        this->overruns
+    );
+
+    pDataloggingShield->append(line);
+
+    // Oldest pre-trigger sample first, followed by the post-trigger window
+    byte oldest = (this->count == this->preTrigger) ? this->head : 0;
+
+    for (byte i = 0; i < this->count + this->postTrigger; i++) {
+        BurstSample* pSample;
+
+        if (i < this->count) {
+            pSample = &this->samples[(oldest + i) % this->preTrigger];
+        } else {
+            pSample = &this->samples[this->preTrigger + (i - this->count)];
+        }
+
+        snprintf_P(
+            line,
+            sizeof(line),
+            PSTR("ch%d,%ld,%u"),
+            (pSample->channel + 1),
+            (long)(pSample->time - this->triggerTime),
+            pSample->code
+        );
+
+        pDataloggingShield->append(line);
+    }
+
+    pDataloggingShield->closeAppend();
+    this->rearm();
+
+    return true;
+}
+
+// Start filling the pre-trigger window again, with the last codes seen forgotten
+void BurstCapture::rearm()
+{
+    this->head = 0;
+    this->count = 0;
+    this->lastCodesValid = false;
+    this->ready = false;
+}
+
+unsigned long BurstCapture::getTriggerLatency()
+{
+    return this->triggerLatency;
+}
+
+unsigned long BurstCapture::getCaptureRate()
+{
+    return this->captureRate;
+}
+
+unsigned long BurstCapture::getOverruns()
+{
+    return this->overruns;
+}
+
+unsigned long BurstCapture::getCaptures()
+{
+    return this->captures;
+}
@@ -0,0 +1,108 @@
+/*
+    Event-triggered burst capture for the Extended ADC Shields.
+
+    Program Description : Between the regular 1 Hz samples the selected channels
+        are watched by a cheap detector working on the raw ADC codes (a rising
+        threshold or a rate of change between consecutive codes).  Every code the
+        detector looks at is kept in a circular pre-trigger buffer.  When the
+        detector fires, the triggering channel is sampled back to back until the
+        post-trigger window is full, and the capture is held until it has been
+        written to the burst file on the SD-card.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : BurstCapture.h
+*/
+
+#ifndef BurstCapture_h
+#define BurstCapture_h
+
+#include <Arduino.h>
+#include "ExtendedADCShieldStack.h"
+#include "AdafruitDataloggingShield.h"
+
+// Number of samples held for a capture, pre-trigger and post-trigger combined
+#define BURST_BUFFER_SIZE 32
+
+// Detector modes
+#define BURST_THRESHOLD 0
+#define BURST_RATE_OF_CHANGE 1
+
+class BurstCapture
+{
+public:
+    // pChannels is a table in flash (PROGMEM) of the numberChannels channels watched
+    BurstCapture(ExtendedADCShieldStack* pAdcStack, const byte* pChannels, byte numberChannels, byte mode, word level, byte preTrigger, byte postTrigger);
+    ~BurstCapture();
+
+    //// Data Management
+    //// Methods
+    // Run the detector on the next selected channel, capturing a burst if it fires
+    void poll();
+
+    // A capture is complete and waiting to be written
+    bool captureReady();
+
+    // Write the waiting capture to a file and re-arm the detector.  A capture that cannot
+    // be written is dropped, so the detector is re-armed either way.
+    bool write(AdafruitDataloggingShield* pDataloggingShield, char* filename);
+
+    //// Getters
+    // Time from the triggering sample to the first post-trigger sample (microseconds)
+    unsigned long getTriggerLatency();
+    // Post-trigger sample rate achieved by the last capture (Hz)
+    unsigned long getCaptureRate();
+    // Triggers lost because the previous capture had not been written yet
+    unsigned long getOverruns();
+    unsigned long getCaptures();
+
+private:
+    //// VARIABLES
+    struct BurstSample
+    {
+        byte channel;
+        word code;
+        unsigned long time;
+    };
+
+    ExtendedADCShieldStack* pAdcStack = nullptr;
+
+    // Channels watched by the detector and the last code seen on each
+    const byte* pChannels = nullptr;
+    byte numberChannels = 0;
+    byte nextChannel = 0;
+    word* pLastCodes = nullptr;
+    bool lastCodesValid = false;
+
+    // Detector settings
+    byte mode = BURST_THRESHOLD;
+    word level = 0;
+    byte preTrigger = 0;
+    byte postTrigger = 0;
+
+    // Circular buffer, head is the next slot to be written
+    BurstSample samples[BURST_BUFFER_SIZE];
+    byte head = 0;
+    byte count = 0;
+
+    // Set once a capture is complete, cleared after it has been written
+    bool ready = false;
+
+    // Capture statistics
+    byte triggerChannel = 0;
+    unsigned long triggerTime = 0;
+    unsigned long triggerLatency = 0;
+    unsigned long captureRate = 0;
+    unsigned long overruns = 0;
+    unsigned long captures = 0;
+
+    //// METHODS
+    bool detect(byte index, word code);
+    void push(byte channel, word code, unsigned long time);
+    void capture(byte channel);
+    void rearm();
+};
+#endif // BurstCapture_h
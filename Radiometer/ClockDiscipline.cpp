@@ -0,0 +1,206 @@
+/*
+    GPS discipline for the PCF8523 realtime clock on the datalogging shield.
+
+    Program Description : The RTC only counts whole seconds.  The moment its
+        seconds change (the second edge) is found by reading it every few
+        milliseconds in a short window around the expected edge, and millis()
+        is used to interpolate between edges.  At every GPS sync the RTC is
+        compared against the GPS time, the drift since the previous sync is
+        turned into a ppm rate, and that rate is used to correct the time
+        stamped on every record until the next sync.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : ClockDiscipline.cpp
+*/
+
+#include "ClockDiscipline.h"
+
+ClockDiscipline::ClockDiscipline() {}
+
+ClockDiscipline::~ClockDiscipline() {}
+
+// Outside the window around the expected edge there is no need to read the RTC
+bool ClockDiscipline::probeDue(unsigned long now)
+{
+    if (!this->edgeLocked) {
+        return true;
+    }
+
+    return (long)(now - (this->edgeMillis + 1000 - CLOCK_PROBE_WINDOW)) >= 0;
+}
+
+unsigned long ClockDiscipline::timeToProbe(unsigned long now)
+{
+    if (this->probeDue(now)) {
+        return 0;
+    }
+
+    return (this->edgeMillis + 1000 - CLOCK_PROBE_WINDOW) - now;
+}
+
+// Look for a change in the RTC seconds between two readings
+void ClockDiscipline::observe(unsigned long rtcTime, unsigned long now)
+{
+    if (this->observed && rtcTime != this->lastRtcTime) {
+        // The edge can only be placed if the readings were close together
+        if (now - this->lastProbe <= 2 * CLOCK_PROBE_PERIOD) {
+            this->edgeMillis = now - ((now - this->lastProbe) / 2);
+            this->edgeTime = rtcTime;
+            this->edgeLocked = true;
+        } else if (this->edgeLocked && rtcTime == this->edgeTime + 1 &&
+                   (long)(this->edgeMillis + 1000 - this->lastProbe) > 0 &&
+                   (long)(now - (this->edgeMillis + 1000)) >= 0) {
+            // A probe held up by another task missed the edge, but the expected edge falls
+            // between the readings, so the lock is carried on to it
+            this->edgeMillis += 1000;
+            this->edgeTime = rtcTime;
+        } else {
+            this->edgeLocked = false;
+        }
+    }
+
+    // The seconds did not change anywhere in the window, so the edge has been lost
+    if (this->edgeLocked && rtcTime == this->edgeTime &&
+        (long)(now - (this->edgeMillis + 1000 + CLOCK_PROBE_WINDOW)) > 0) {
+
+        this->edgeLocked = false;
+    }
+
+    this->observed = true;
+    this->lastRtcTime = rtcTime;
+    this->lastProbe = now;
+}
+
+bool ClockDiscipline::locked()
+{
+    return this->edgeLocked;
+}
+
+void ClockDiscipline::resetEdge()
+{
+    this->edgeLocked = false;
+    this->observed = false;
+}
+
+// Compare the RTC against GPS at millis() now.  The RTC was set on a whole GPS second at
+// the previous sync, so the offset that has built up since then is the drift.
+long ClockDiscipline::measure(unsigned long gpsTime, int gpsMillis, unsigned long fixTime, unsigned long now)
+{
+    // GPS time now
+    unsigned long gpsMs = gpsMillis + (now - fixTime);
+    unsigned long gpsSeconds = gpsTime + (gpsMs / 1000);
+    gpsMs %= 1000;
+
+    // RTC time now, interpolated from the last edge
+    unsigned long rtcMs = now - this->edgeMillis;
+    unsigned long rtcSeconds = this->edgeTime + (rtcMs / 1000);
+    rtcMs %= 1000;
+
+    long seconds = (long)(gpsSeconds - rtcSeconds);
+
+    // The RTC was not keeping time (first start or a dead battery), so there is
+    // nothing to learn from it
+    if (!this->edgeLocked || seconds > 86400L || seconds < -86400L) {
+        this->offset = 0;
+        this->residual = 0;
+
+        return 0;
+    }
+
+    this->offset = (seconds * 1000L) + (long)gpsMs - (long)rtcMs;
+
+    if (this->referenceSet) {
+        long elapsed = (long)(rtcSeconds - this->referenceTime);
+
+        // Part of the offset the current drift rate did not account for
+        this->residual = this->offset + this->correction(rtcSeconds);
+
+        if (elapsed >= CLOCK_MIN_DRIFT_INTERVAL) {
+            float measured = -((float)this->offset * 1000.0f) / (float)elapsed;
+
+            // Average with the previous rate to smooth out the edge and GPS read errors
+            this->drift = this->driftValid ? ((this->drift + measured) / 2.0f) : measured;
+            this->driftValid = true;
+        }
+    } else {
+        this->residual = this->offset;
+    }
+
+    return this->offset;
+}
+
+// The RTC was set on a whole second, which is also a second edge
+void ClockDiscipline::setReference(unsigned long time, unsigned long now)
+{
+    this->referenceSet = true;
+    this->referenceTime = time;
+
+    this->edgeTime = time;
+    this->edgeMillis = now;
+    this->edgeLocked = true;
+
+    this->observed = true;
+    this->lastRtcTime = time;
+    this->lastProbe = now;
+}
+
+// Milliseconds the RTC has gained since the reference, at the learned drift rate
+long ClockDiscipline::correction(unsigned long time)
+{
+    if (!this->referenceSet || !this->driftValid) {
+        return 0;
+    }
+
+    return (long)((this->drift * (float)(long)(time - this->referenceTime)) / 1000.0f);
+}
+
+// Work out the corrected time of a record taken at millis() now
+void ClockDiscipline::stamp(unsigned long rtcTime, unsigned long now, unsigned long* pTime, int* pMillis)
+{
+    unsigned long time;
+    long ms;
+
+    if (this->edgeLocked) {
+        unsigned long sinceEdge = now - this->edgeMillis;
+
+        time = this->edgeTime + (sinceEdge / 1000);
+        ms = sinceEdge % 1000;
+    } else {
+        time = rtcTime;
+        ms = 0;
+    }
+
+    ms -= this->correction(time);
+
+    // Carry whole seconds out of the millisecond part
+    if (ms < 0) {
+        unsigned long borrow = (unsigned long)((-ms + 999) / 1000);
+
+        time -= borrow;
+        ms += (long)borrow * 1000L;
+    }
+
+    time += ms / 1000;
+
+    *pTime = time;
+    *pMillis = (int)(ms % 1000);
+}
+
+float ClockDiscipline::getDrift()
+{
+    return this->drift;
+}
+
+long ClockDiscipline::getOffset()
+{
+    return this->offset;
+}
+
+long ClockDiscipline::getResidual()
+{
+    return this->residual;
+}
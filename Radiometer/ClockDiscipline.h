@@ -0,0 +1,102 @@
+/*
+    GPS discipline for the PCF8523 realtime clock on the datalogging shield.
+
+    Program Description : The RTC only counts whole seconds.  The moment its
+        seconds change (the second edge) is found by reading it every few
+        milliseconds in a short window around the expected edge, and millis()
+        is used to interpolate between edges.  At every GPS sync the RTC is
+        compared against the GPS time, the drift since the previous sync is
+        turned into a ppm rate, and that rate is used to correct the time
+        stamped on every record until the next sync.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : ClockDiscipline.h
+*/
+
+#ifndef ClockDiscipline_h
+#define ClockDiscipline_h
+
+#include <Arduino.h>
+
+// How often the RTC is read while looking for a second edge (ms)
+#define CLOCK_PROBE_PERIOD 10
+
+// How far either side of the expected edge the RTC is read (ms)
+#define CLOCK_PROBE_WINDOW 30
+
+// Shortest time between syncs that is used to learn the drift rate (s)
+#define CLOCK_MIN_DRIFT_INTERVAL 3600
+
+class ClockDiscipline
+{
+public:
+    ClockDiscipline();
+    ~ClockDiscipline();
+
+    //// Second Edge Tracking
+    //// Methods
+    // True when the RTC should be read to look for the next second edge
+    bool probeDue(unsigned long now);
+
+    // Time until the RTC next needs to be read (ms), 0 when it is due now
+    unsigned long timeToProbe(unsigned long now);
+
+    // Report an RTC reading (unix time) taken at millis() now
+    void observe(unsigned long rtcTime, unsigned long now);
+
+    // The last second edge has been found to within CLOCK_PROBE_PERIOD
+    bool locked();
+
+    // Forget the last edge, so the next change in the seconds is taken as the edge
+    void resetEdge();
+
+    //// GPS Sync
+    // Compare the RTC against a GPS time read at fixTime, and learn the drift rate.
+    // Needs a locked edge.  Returns the offset GPS - RTC in milliseconds.
+    long measure(unsigned long gpsTime, int gpsMillis, unsigned long fixTime, unsigned long now);
+
+    // The RTC was set to time on a whole second at millis() now
+    void setReference(unsigned long time, unsigned long now);
+
+    //// Record Time Stamps
+    // Corrected time at millis() now, as unix time and milliseconds.  rtcTime is used
+    // when the edge is not locked.
+    void stamp(unsigned long rtcTime, unsigned long now, unsigned long* pTime, int* pMillis);
+
+    //// Getters
+    // Drift rate of the RTC, positive when it runs fast (ppm)
+    float getDrift();
+    // Offset GPS - RTC at the last sync, and the part of it the drift rate did not predict (ms)
+    long getOffset();
+    long getResidual();
+
+private:
+    //// VARIABLES
+    // Last RTC reading and when it was taken
+    bool observed = false;
+    unsigned long lastRtcTime = 0;
+    unsigned long lastProbe = 0;
+
+    // Last second edge
+    bool edgeLocked = false;
+    unsigned long edgeTime = 0;
+    unsigned long edgeMillis = 0;
+
+    // Time the RTC was last set from GPS
+    bool referenceSet = false;
+    unsigned long referenceTime = 0;
+
+    // Learned drift
+    bool driftValid = false;
+    float drift = 0.0f;
+    long offset = 0;
+    long residual = 0;
+
+    //// METHODS
+    long correction(unsigned long time);
+};
+#endif // ClockDiscipline_h
@@ -0,0 +1,272 @@
+/*
+    A small cooperative scheduler for the radiometer sketch.
+
+    Program Description : Tasks are plain functions that run to completion.
+        Periodic tasks are released every period, one-shot tasks are released
+        when they are scheduled by another task.  Whenever the scheduler runs it
+        starts the highest priority task that has been released.  A task that
+        has not finished within its deadline (measured from its release) counts
+        as a deadline miss, and the execution time of every task is tracked.
+        Time spent with no task released is recorded as idle time.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : CooperativeScheduler.cpp
+*/
+
+#include "CooperativeScheduler.h"
+
+CooperativeScheduler::CooperativeScheduler()
+{
+    this->statisticsStart = millis();
+}
+
+CooperativeScheduler::~CooperativeScheduler() {}
+
+// Register a periodic task, first released one period from now
+byte CooperativeScheduler::addPeriodicTask(const __FlashStringHelper* pName, TaskFunction pFunction, unsigned long period, unsigned long deadline, byte priority)
+{
+    byte task = this->addTask(pName, pFunction, period, deadline, priority);
+
+    if (task != NO_TASK) {
+        this->runTaskIn(task, period);
+    }
+
+    return task;
+}
+
+// Register a one-shot task, which waits until it is scheduled
+byte CooperativeScheduler::addOneShotTask(const __FlashStringHelper* pName, TaskFunction pFunction, unsigned long deadline, byte priority)
+{
+    return this->addTask(pName, pFunction, 0, deadline, priority);
+}
+
+byte CooperativeScheduler::addTask(const __FlashStringHelper* pName, TaskFunction pFunction, unsigned long period, unsigned long deadline, byte priority)
+{
+    if (this->numberTasks == SCHEDULER_MAX_TASKS) {
+        return NO_TASK;
+    }
+
+    Task* pTask = &this->tasks[this->numberTasks];
+
+    memset(pTask, 0, sizeof(Task));
+
+    pTask->pName = pName;
+    pTask->pFunction = pFunction;
+    pTask->period = period;
+    pTask->deadline = deadline;
+    pTask->priority = priority;
+
+    return this->numberTasks++;
+}
+
+// Release a task after a delay.  Scheduling a periodic task moves its phase.
+void CooperativeScheduler::runTaskIn(byte task, unsigned long delay)
+{
+    if (task < this->numberTasks) {
+        this->tasks[task].releaseTime = millis() + delay;
+        this->tasks[task].released = true;
+    }
+}
+
+// Find the highest priority task whose release time has passed.  Between tasks of
+// the same priority, the one released first runs first.
+byte CooperativeScheduler::nextTask(unsigned long now)
+{
+    byte next = NO_TASK;
+
+    for (byte i = 0; i < this->numberTasks; i++) {
+        Task* pTask = &this->tasks[i];
+
+        if (!pTask->released || (long)(now - pTask->releaseTime) < 0) {
+            continue;
+        }
+
+        if (next == NO_TASK ||
+            pTask->priority > this->tasks[next].priority ||
+            (pTask->priority == this->tasks[next].priority &&
+                (long)(pTask->releaseTime - this->tasks[next].releaseTime) < 0)) {
+
+            next = i;
+        }
+    }
+
+    return next;
+}
+
+// Find the earliest time a released task becomes due.  Returns false if no task has
+// been released.
+bool CooperativeScheduler::nextRelease(unsigned long* pReleaseTime)
+{
+    bool found = false;
+
+    for (byte i = 0; i < this->numberTasks; i++) {
+        Task* pTask = &this->tasks[i];
+
+        if (!pTask->released) {
+            continue;
+        }
+
+        if (!found || (long)(pTask->releaseTime - *pReleaseTime) < 0) {
+            *pReleaseTime = pTask->releaseTime;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+void CooperativeScheduler::setIdleFunction(IdleFunction pFunction)
+{
+    this->pIdleFunction = pFunction;
+}
+
+// Run the highest priority released task
+void CooperativeScheduler::run()
+{
+    unsigned long startMicros = micros();
+    unsigned long now = millis();
+
+    // The time since the scheduler last found nothing to do was idle
+    if (this->idle) {
+        this->idleMicros += startMicros - this->idleStart;
+        this->idleTime += this->idleMicros / 1000;
+        this->idleMicros %= 1000;
+        this->idle = false;
+    }
+
+    byte next = this->nextTask(now);
+
+    if (next == NO_TASK) {
+        unsigned long wakeTime = 0;
+
+        this->idle = true;
+        this->idleStart = startMicros;
+
+        if (this->pIdleFunction != nullptr && this->nextRelease(&wakeTime)) {
+            this->pIdleFunction(wakeTime);
+        }
+
+        return;
+    }
+
+    Task* pTask = &this->tasks[next];
+#if SCHEDULER_STATISTICS
+    unsigned long releaseTime = pTask->releaseTime;
+#endif
+
+    // Work out the next release before running, so a task can re-schedule itself
+    if (pTask->period > 0) {
+        pTask->releaseTime += pTask->period;
+
+        // Skip releases that were missed entirely instead of running them back to back
+        if ((long)(now - pTask->releaseTime) >= 0) {
+            pTask->releaseTime = now + pTask->period;
+        }
+    } else {
+        pTask->released = false;
+    }
+
+    pTask->pFunction();
+
+#if SCHEDULER_STATISTICS
+    unsigned long executionTime = micros() - startMicros;
+
+    pTask->runs++;
+    pTask->totalExecutionTime += executionTime;
+
+    if (executionTime > pTask->maxExecutionTime) {
+        pTask->maxExecutionTime = executionTime;
+    }
+
+    if (millis() - releaseTime > pTask->deadline) {
+        pTask->deadlineMisses++;
+    }
+#endif
+}
+
+#if SCHEDULER_STATISTICS
+unsigned long CooperativeScheduler::getRuns(byte task)
+{
+    return this->tasks[task].runs;
+}
+
+unsigned long CooperativeScheduler::getDeadlineMisses(byte task)
+{
+    return this->tasks[task].deadlineMisses;
+}
+
+unsigned long CooperativeScheduler::getMaxExecutionTime(byte task)
+{
+    return this->tasks[task].maxExecutionTime;
+}
+
+unsigned long CooperativeScheduler::getTotalExecutionTime(byte task)
+{
+    return this->tasks[task].totalExecutionTime;
+}
+#else
+unsigned long CooperativeScheduler::getRuns(byte) { return 0; }
+unsigned long CooperativeScheduler::getDeadlineMisses(byte) { return 0; }
+unsigned long CooperativeScheduler::getMaxExecutionTime(byte) { return 0; }
+unsigned long CooperativeScheduler::getTotalExecutionTime(byte) { return 0; }
+#endif
+
+unsigned long CooperativeScheduler::getIdleTime()
+{
+    return this->idleTime;
+}
+
+unsigned long CooperativeScheduler::getElapsedTime()
+{
+    return millis() - this->statisticsStart;
+}
+
+// Print one line per task followed by the idle time
+void CooperativeScheduler::printStatistics(Print* pPrint)
+{
+    pPrint->println(F("\n --- Task Statistics ---"));
+
+#if SCHEDULER_STATISTICS
+    for (byte i = 0; i < this->numberTasks; i++) {
+        Task* pTask = &this->tasks[i];
+
+        pPrint->print(pTask->pName);
+        pPrint->print(F(" : runs "));
+        pPrint->print(pTask->runs);
+        pPrint->print(F(", deadline misses "));
+        pPrint->print(pTask->deadlineMisses);
+        pPrint->print(F(", max "));
+        pPrint->print(pTask->maxExecutionTime);
+        pPrint->print(F(" us, avg "));
+        pPrint->print(pTask->runs ? (pTask->totalExecutionTime / pTask->runs) : 0);
+        pPrint->println(F(" us"));
+    }
+#endif
+
+    pPrint->print(F("Idle : "));
+    pPrint->print(this->getIdleTime());
+    pPrint->print(F(" ms of "));
+    pPrint->print(this->getElapsedTime());
+    pPrint->println(F(" ms"));
+}
+
+// Clear the counters, normally once a day so the totals do not overflow
+void CooperativeScheduler::resetStatistics()
+{
+#if SCHEDULER_STATISTICS
+    for (byte i = 0; i < this->numberTasks; i++) {
+        this->tasks[i].runs = 0;
+        this->tasks[i].deadlineMisses = 0;
+        this->tasks[i].maxExecutionTime = 0;
+        this->tasks[i].totalExecutionTime = 0;
+    }
+#endif
+
+    this->idleMicros = 0;
+    this->idleTime = 0;
+    this->statisticsStart = millis();
+}
@@ -0,0 +1,122 @@
+/*
+    A small cooperative scheduler for the radiometer sketch.
+
+    Program Description : Tasks are plain functions that run to completion.
+        Periodic tasks are released every period, one-shot tasks are released
+        when they are scheduled by another task.  Whenever the scheduler runs it
+        starts the highest priority task that has been released.  A task that
+        has not finished within its deadline (measured from its release) counts
+        as a deadline miss, and the execution time of every task is tracked.
+        Time spent with no task released is recorded as idle time, and can be
+        handed to an idle function that sleeps until the next release.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : CooperativeScheduler.h
+*/
+
+#ifndef CooperativeScheduler_h
+#define CooperativeScheduler_h
+
+#include <Arduino.h>
+
+// Maximum number of tasks that can be registered
+#define SCHEDULER_MAX_TASKS 8
+
+// Returned when a task could not be registered
+#define NO_TASK 0xFF
+
+// The run counts, deadline misses and execution times of the tasks take 16 bytes a task.
+// They are kept on boards with RAM to spare, or when the build defines
+// SCHEDULER_STATISTICS as 1.  Without them only the idle time is reported.
+#ifndef SCHEDULER_STATISTICS
+#if RAMEND > 0x1000
+#define SCHEDULER_STATISTICS 1
+#else
+#define SCHEDULER_STATISTICS 0
+#endif
+#endif
+
+class CooperativeScheduler
+{
+public:
+    typedef void (*TaskFunction)();
+    typedef void (*IdleFunction)(unsigned long wakeTime);
+
+    CooperativeScheduler();
+    ~CooperativeScheduler();
+
+    //// Task Management
+    //// Methods
+    // Register a task released every period milliseconds.  A higher priority runs first.
+    byte addPeriodicTask(const __FlashStringHelper* pName, TaskFunction pFunction, unsigned long period, unsigned long deadline, byte priority);
+
+    // Register a task that only runs when it is scheduled with runTaskIn()
+    byte addOneShotTask(const __FlashStringHelper* pName, TaskFunction pFunction, unsigned long deadline, byte priority);
+
+    // Release a task after the given delay in milliseconds
+    void runTaskIn(byte task, unsigned long delay);
+
+    // Run the highest priority released task, if any
+    void run();
+
+    // Called when no task is due, with the millis() at which the next one is released
+    void setIdleFunction(IdleFunction pFunction);
+
+    //// Statistics
+    // The task figures are 0 without SCHEDULER_STATISTICS
+    unsigned long getRuns(byte task);
+    unsigned long getDeadlineMisses(byte task);
+    // Longest and total execution time in microseconds
+    unsigned long getMaxExecutionTime(byte task);
+    unsigned long getTotalExecutionTime(byte task);
+    // Time spent with no task released, and time since the statistics were reset (ms)
+    unsigned long getIdleTime();
+    unsigned long getElapsedTime();
+
+    void printStatistics(Print* pPrint);
+    void resetStatistics();
+
+private:
+    //// VARIABLES
+    struct Task
+    {
+        const __FlashStringHelper* pName;
+        TaskFunction pFunction;
+
+        // Period of 0 marks a one-shot task
+        unsigned long period;
+        unsigned long deadline;
+        byte priority;
+
+        bool released;
+        unsigned long releaseTime;
+
+#if SCHEDULER_STATISTICS
+        unsigned long runs;
+        unsigned long deadlineMisses;
+        unsigned long maxExecutionTime;
+        unsigned long totalExecutionTime;
+#endif
+    };
+
+    Task tasks[SCHEDULER_MAX_TASKS];
+    byte numberTasks = 0;
+    IdleFunction pIdleFunction = nullptr;
+
+    // Idle time is accumulated in microseconds and carried into milliseconds
+    bool idle = false;
+    unsigned long idleStart = 0;
+    unsigned long idleMicros = 0;
+    unsigned long idleTime = 0;
+    unsigned long statisticsStart = 0;
+
+    //// METHODS
+    byte addTask(const __FlashStringHelper* pName, TaskFunction pFunction, unsigned long period, unsigned long deadline, byte priority);
+    byte nextTask(unsigned long now);
+    bool nextRelease(unsigned long* pReleaseTime);
+};
+#endif // CooperativeScheduler_h
@@ -0,0 +1,38 @@
+/*
+    CRC-16/XMODEM shared by the sketch modules.
+
+    Program Description : XMODEM-CRC checks the blocks the serial
+        maintenance mode sends, and the journal's commit lines check the
+        block of samples before them.  Both use this bitwise CRC-16, which
+        needs no table in flash.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : Crc16.h
+*/
+
+#ifndef Crc16_h
+#define Crc16_h
+
+#include <Arduino.h>
+
+// CRC-16/XMODEM, polynomial 0x1021, carried on from crc (0 to start)
+inline uint16_t updateCrc16(uint16_t crc, const void* pData, int length)
+{
+    const byte* pByte = (const byte*)pData;
+    
+    while (length-- > 0) {
+        crc ^= (uint16_t)*pByte++ << 8;
+        
+        for (byte i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    
+    return crc;
+}
+
+#endif // Crc16_h
@@ -4,6 +4,8 @@
  Released into the public domain.
  Modified by Benjamin Kleynhans, June 11, 2020.
  Removed duplicate import of Arduino.h and moved import of SPI.h to ExtendedADCShield.h
+ Modified by Benjamin Kleynhans, October 19, 2026.
+ Split the conversion trigger from the read-back so that stacked shields can convert simultaneously
  */
 
 #include "ExtendedADCShield.h"
@@ -63,14 +65,48 @@ ExtendedADCShield::ExtendedADCShield(byte number_bits)
 }
 
 float ExtendedADCShield::analogReadConfigNext(byte channel, byte sgl_diff, byte uni_bipolar, byte range)
+{
+    startConversion();
+    
+    return readConfigNext(channel, sgl_diff, uni_bipolar, range);
+}
+
+//Read the conversion started by startConversion() and set up the next channel.
+//Used when several shields are triggered together and read back one after the other.
+float ExtendedADCShield::readConfigNext(byte channel, byte sgl_diff, byte uni_bipolar, byte range)
 {
     byte command = 0;
     word adc_code = 0;
     float voltage = 0;
-    float sign = 1;
     
     command = buildCommand(channel,sgl_diff,uni_bipolar,range);
-    adc_code = sendSetupGetData(command);
+    adc_code = transferSetupGetData(command);
+    voltage = codeToVoltage(adc_code);
+    
+    _LAST_UNI_BIPOLAR = uni_bipolar;
+    _LAST_RANGE = range;
+
+    return voltage;
+}
+
+//Same as analogReadConfigNext, but return the raw ADC code without converting it to a voltage
+word ExtendedADCShield::analogReadRawConfigNext(byte channel, byte sgl_diff, byte uni_bipolar, byte range)
+{
+    word adc_code = 0;
+    
+    adc_code = sendSetupGetData(buildCommand(channel,sgl_diff,uni_bipolar,range));
+    
+    _LAST_UNI_BIPOLAR = uni_bipolar;
+    _LAST_RANGE = range;
+    
+    return adc_code;
+}
+
+float ExtendedADCShield::codeToVoltage(word adc_code)
+{
+    float voltage = 0;
+    float sign = 1;
+    
     //TODO deal with adding 1 in the right place
     if(_LAST_UNI_BIPOLAR == BIPOLAR) {
         if ((adc_code & 0x8000) == 0x8000) {    //adc code is < 0
@@ -98,9 +134,6 @@ float ExtendedADCShield::analogReadConfigNext(byte channel, byte sgl_diff, byte
             break;
     }        
     
-    _LAST_UNI_BIPOLAR = uni_bipolar;
-    _LAST_RANGE = range;
-
     return voltage;
 }
     
@@ -151,11 +184,21 @@ byte ExtendedADCShield::buildCommand(byte channel, byte sgl_diff, byte uni_bipol
 }    
 word ExtendedADCShield::sendSetupGetData(byte command)    
 {
-    word conv_result = 0;
+    startConversion();
     
+    return transferSetupGetData(command);
+}
+
+void ExtendedADCShield::startConversion()
+{
     //Trigger a conversion
     digitalWrite(_CONVST,HIGH);
     digitalWrite(_CONVST,LOW);
+}
+
+word ExtendedADCShield::transferSetupGetData(byte command)
+{
+    word conv_result = 0;
     
     //Wait for BUSY to go high 
     // while(digitalRead(_BUSY)==LOW);
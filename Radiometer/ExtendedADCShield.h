@@ -23,10 +23,15 @@ public:
     ExtendedADCShield(byte number_bits);
     ExtendedADCShield(byte CONVST, byte RD, byte BUSY, byte number_bits);
     float analogReadConfigNext(byte channel, byte sgl_diff, byte uni_bipolar, byte range);
+    void startConversion();
+    float readConfigNext(byte channel, byte sgl_diff, byte uni_bipolar, byte range);
+    word analogReadRawConfigNext(byte channel, byte sgl_diff, byte uni_bipolar, byte range);
    
 private:
     byte buildCommand(byte channel, byte sgl_diff, byte uni_bipolar, byte range);
     word sendSetupGetData(byte command);
+    word transferSetupGetData(byte command);
+    float codeToVoltage(word adc_code);
     byte _BUSY, _CONVST, _RD, _NUMBER_BITS;
     byte _LAST_UNI_BIPOLAR, _LAST_RANGE;  
 };
@@ -0,0 +1,159 @@
+/*
+    A stack of Mayhew Labs Extended ADC Shields that is scanned as one logical
+    channel space.  Channel 0-7 belong to the first shield, 8-15 to the second
+    and so on.
+
+    Program Description : Each shield has its own RD (chip select) and CONVST
+        lines.  Shields that share a CONVST line are triggered with a single
+        pulse, and all conversions for a channel slot are started before any of
+        the results are read back, so the conversion time is paid once per slot
+        rather than once per shield.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : ExtendedADCShieldStack.cpp
+*/
+
+#include "ExtendedADCShieldStack.h"
+
+ExtendedADCShieldStack::ExtendedADCShieldStack(byte numberShields, const byte* pCONVST, const byte* pRD, byte BUSY, byte numberBits)
+{
+    this->numberShields = numberShields;
+    this->pCONVST = pCONVST;
+
+    this->pShields = new ExtendedADCShield*[numberShields];
+    this->pNextChannel = new byte[numberShields];
+
+    for (byte i = 0; i < numberShields; i++) {
+        this->pShields[i] = new ExtendedADCShield(pgm_read_byte(&pCONVST[i]), pgm_read_byte(&pRD[i]), BUSY, numberBits);
+        this->pNextChannel[i] = 0;
+    }
+}
+
+ExtendedADCShieldStack::~ExtendedADCShieldStack()
+{
+    for (byte i = 0; i < this->numberShields; i++) {
+        delete this->pShields[i];
+    }
+
+    delete[] this->pShields;
+    delete[] this->pNextChannel;
+}
+
+// Set up the first channel for sampling on every shield
+void ExtendedADCShieldStack::begin(byte sglDiff, byte uniBipolar, byte range)
+{
+    this->sglDiff = sglDiff;
+    this->uniBipolar = uniBipolar;
+    this->range = range;
+
+    for (byte i = 0; i < this->numberShields; i++) {
+        this->pShields[i]->analogReadConfigNext(0, sglDiff, uniBipolar, range);
+        this->pNextChannel[i] = 0;
+    }
+}
+
+// Read all the channels of all the shields
+void ExtendedADCShieldStack::scan(float* pValues)
+{
+    unsigned long startTime = micros();
+
+    // A single channel may have been sampled since the last scan
+    for (byte i = 0; i < this->numberShields; i++) {
+        this->setUpChannel(i, 0);
+    }
+
+    /* The measurement of the Mayhew works by setting up one channel, and reading another.
+
+        Every shield is set up for channel 0 by the time the first slot is read, so
+        for each slot the conversions are started on all the shields, then each shield
+        is read back while it is set up for the next slot.  The last slot sets the
+        shields up for channel 0 again, ready for the next scan.
+    */
+    for (byte slot = 0; slot < CHANNELS_PER_SHIELD; slot++) {
+        byte nextChannel = (slot + 1) % CHANNELS_PER_SHIELD;
+
+        this->startConversions();
+
+        for (byte i = 0; i < this->numberShields; i++) {
+            pValues[(i * CHANNELS_PER_SHIELD) + slot] = this->pShields[i]->readConfigNext(
+                nextChannel,
+                this->sglDiff,
+                this->uniBipolar,
+                this->range
+            );
+        }
+    }
+
+    this->scanTime = micros() - startTime;
+}
+
+// Read one logical channel.  The shield is left set up for the same channel so that
+// repeated calls convert back to back.
+word ExtendedADCShieldStack::sampleRaw(byte channel)
+{
+    byte shield = channel / CHANNELS_PER_SHIELD;
+    byte shieldChannel = channel % CHANNELS_PER_SHIELD;
+
+    this->setUpChannel(shield, shieldChannel);
+
+    return this->pShields[shield]->analogReadRawConfigNext(
+        shieldChannel,
+        this->sglDiff,
+        this->uniBipolar,
+        this->range
+    );
+}
+
+// Make sure the next conversion on a shield is for the given channel, discarding one
+// conversion if the shield was set up for a different channel
+void ExtendedADCShieldStack::setUpChannel(byte shield, byte channel)
+{
+    if (this->pNextChannel[shield] != channel) {
+        this->pShields[shield]->analogReadConfigNext(channel, this->sglDiff, this->uniBipolar, this->range);
+        this->pNextChannel[shield] = channel;
+    }
+}
+
+// Pulse each distinct CONVST line once
+void ExtendedADCShieldStack::startConversions()
+{
+    for (byte i = 0; i < this->numberShields; i++) {
+        bool shared = false;
+
+        for (byte j = 0; j < i; j++) {
+            if (pgm_read_byte(&this->pCONVST[j]) == pgm_read_byte(&this->pCONVST[i])) {
+                shared = true;
+
+                break;
+            }
+        }
+
+        if (!shared) {
+            this->pShields[i]->startConversion();
+        }
+    }
+}
+
+byte ExtendedADCShieldStack::getNumberShields()
+{
+    return this->numberShields;
+}
+
+byte ExtendedADCShieldStack::getNumberChannels()
+{
+    return this->numberShields * CHANNELS_PER_SHIELD;
+}
+
+ExtendedADCShield* ExtendedADCShieldStack::getShield(byte shield)
+{
+    return this->pShields[shield];
+}
+
+unsigned long ExtendedADCShieldStack::getScanTime()
+{
+    return this->scanTime;
+}
@@ -0,0 +1,75 @@
+/*
+    A stack of Mayhew Labs Extended ADC Shields that is scanned as one logical
+    channel space.  Channel 0-7 belong to the first shield, 8-15 to the second
+    and so on.
+
+    Program Description : Each shield has its own RD (chip select) and CONVST
+        lines.  Shields that share a CONVST line are triggered with a single
+        pulse, and all conversions for a channel slot are started before any of
+        the results are read back, so the conversion time is paid once per slot
+        rather than once per shield.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : ExtendedADCShieldStack.h
+*/
+
+#ifndef ExtendedADCShieldStack_h
+#define ExtendedADCShieldStack_h
+
+#include <Arduino.h>
+#include "ExtendedADCShield.h"
+
+// Number of channels on a single Extended ADC Shield
+#define CHANNELS_PER_SHIELD 8
+
+class ExtendedADCShieldStack
+{
+public:
+    // pCONVST and pRD are tables in flash (PROGMEM), one pin per shield
+    ExtendedADCShieldStack(byte numberShields, const byte* pCONVST, const byte* pRD, byte BUSY, byte numberBits);
+    ~ExtendedADCShieldStack();
+
+    //// Data Management
+    //// Methods
+    // Configure every shield and prime it with the first channel of the scan
+    void begin(byte sglDiff, byte uniBipolar, byte range);
+
+    // Read every channel of every shield into pValues (getNumberChannels() entries)
+    void scan(float* pValues);
+
+    // Convert and read a single logical channel, returning the raw ADC code
+    word sampleRaw(byte channel);
+
+    //// Getters
+    byte getNumberShields();
+    byte getNumberChannels();
+    ExtendedADCShield* getShield(byte shield);
+
+    // Duration of the last scan in microseconds
+    unsigned long getScanTime();
+
+private:
+    //// VARIABLES
+    ExtendedADCShield** pShields = nullptr;
+    const byte* pCONVST = nullptr;
+    byte numberShields = 0;
+
+    // Channel each shield is set up to convert next
+    byte* pNextChannel = nullptr;
+
+    // Input configuration applied to every channel
+    byte sglDiff = SINGLE_ENDED;
+    byte uniBipolar = UNIPOLAR;
+    byte range = RANGE5V;
+
+    unsigned long scanTime = 0;
+
+    //// METHODS
+    void startConversions();
+    void setUpChannel(byte shield, byte channel);
+};
+#endif // ExtendedADCShieldStack_h
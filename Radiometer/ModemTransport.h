@@ -0,0 +1,43 @@
+/*
+    Serial link between the sketch and the SIM7000 modem.
+
+    Program Description : The modem driver talks to the modem through this
+        interface, so the link can be bit-banged SoftwareSerial on the Uno, a
+        hardware UART with interrupt-driven ring buffers on boards that have a
+        spare one, or the emulated line in the host simulation.  Each link
+        reports the fastest baud rate it can run at reliably, and the modem is
+        switched to that rate after power on.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : ModemTransport.h
+*/
+
+#ifndef ModemTransport_h
+#define ModemTransport_h
+
+#include <Arduino.h>
+
+// Baud rate the SIM7000 runs at after a power cycle
+#define MODEM_DEFAULT_BAUD 115200
+
+class ModemTransport : public Stream
+{
+public:
+    virtual ~ModemTransport() {}
+
+    //// Methods
+    virtual void begin(unsigned long baud) = 0;
+    virtual void end() = 0;
+
+    //// Getters
+    // Fastest rate the link can receive at without losing bytes
+    virtual unsigned long getMaxBaud() = 0;
+
+    // Bytes lost because the receive buffer was full
+    virtual unsigned long getOverflows() = 0;
+};
+#endif // ModemTransport_h
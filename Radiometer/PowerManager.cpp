@@ -0,0 +1,354 @@
+/*
+    Sleep between tasks for the radiometer sketch.
+
+    Program Description : When the scheduler has nothing to run, the MCU is
+        put to sleep until the next task is due instead of spinning on
+        millis().  In idle mode Timer0 keeps running and wakes the MCU every
+        millisecond, so millis() and the sample timing are exactly as they
+        were.  If the PCF8523 square wave is wired to an external interrupt
+        pin, longer waits power the MCU down between square wave edges and
+        wind millis() and micros() forward by the time that passed.  The ADC
+        is turned off while asleep.  The time spent asleep, the latency from
+        waking to the sample and the share of the time awake are tracked.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : PowerManager.cpp
+*/
+
+#include "PowerManager.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+// Timer0 counters of the Arduino core, wound forward after a power-down
+extern volatile unsigned long timer0_millis;
+extern volatile unsigned long timer0_overflow_count;
+
+static byte squareWavePin = POWER_NO_SQW;
+static volatile bool squareWaveFell = false;
+
+// Only a low level wakes the MCU from power-down, so the interrupt turns itself off until
+// it is armed again while the square wave is high
+static void onSquareWave()
+{
+    squareWaveFell = true;
+    detachInterrupt(digitalPinToInterrupt(squareWavePin));
+}
+#endif
+
+PowerManager::PowerManager(HardwareSerial* pSerial, byte sqwPin)
+{
+    this->pSerial = pSerial;
+
+#if defined(__AVR__)
+    // The PCF8523 square wave output is open drain
+    if (sqwPin != POWER_NO_SQW && digitalPinToInterrupt(sqwPin) != NOT_AN_INTERRUPT) {
+        this->sqwPin = sqwPin;
+        squareWavePin = sqwPin;
+
+        pinMode(sqwPin, INPUT_PULLUP);
+    }
+#else
+    (void)sqwPin;
+#endif
+
+    this->statisticsStart = millis();
+}
+
+PowerManager::~PowerManager() {}
+
+void PowerManager::sleepUntil(unsigned long wakeTime, bool allowPowerDown)
+{
+    unsigned long startMicros = micros();
+    long remaining = (long)(wakeTime - millis());
+
+    if (remaining < POWER_MIN_SLEEP) {
+        return;
+    }
+
+#if defined(__AVR__)
+    // The ADC draws current for as long as it is enabled
+    byte adcState = ADCSRA;
+
+    ADCSRA &= ~_BV(ADEN);
+
+    // Serial output stops while powered down, so only go down once it has all gone out
+    if (allowPowerDown &&
+        this->sqwPin != POWER_NO_SQW &&
+        remaining >= POWER_DOWN_MIN_SLEEP &&
+        this->pSerial->availableForWrite() >= SERIAL_TX_BUFFER_SIZE - 1) {
+
+        this->pSerial->flush();
+        this->powerDown(wakeTime);
+    }
+
+    this->idle(wakeTime);
+
+    ADCSRA = adcState;
+#else
+    // The host simulation never powers down, and nothing else happens until the task is due
+    (void)allowPowerDown;
+    delay(remaining);
+    this->wakeups++;
+#endif
+
+    this->wakeMicros = micros();
+    this->woken = true;
+
+    this->sleepMicros += this->wakeMicros - startMicros;
+    this->sleepTime += this->sleepMicros / 1000;
+    this->sleepMicros %= 1000;
+}
+
+// Measured from the end of the last sleep, so it includes any task that ran first
+void PowerManager::sampleStarted()
+{
+    if (!this->woken) {
+        return;
+    }
+
+    unsigned long latency = micros() - this->wakeMicros;
+
+    this->woken = false;
+    this->latencySamples++;
+    this->totalWakeLatency += latency;
+
+    if (latency > this->maxWakeLatency) {
+        this->maxWakeLatency = latency;
+    }
+}
+
+#if defined(__AVR__)
+// Timer0 wakes the MCU every millisecond.  Interrupts stay off from the check to the sleep
+// instruction, so a tick can not slip in between and leave the MCU asleep past the wake time.
+void PowerManager::idle(unsigned long wakeTime)
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+
+    for (;;) {
+        cli();
+
+        if ((long)(millis() - wakeTime) >= 0) {
+            sei();
+
+            break;
+        }
+
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+
+        this->wakeups++;
+    }
+}
+
+// Power down for whole square wave periods.  Timer0 stops while powered down, so the time
+// is counted from a falling edge seen with the clock running, and millis() and micros()
+// are set from that edge after the last period.  The last part period is left to idle mode.
+void PowerManager::powerDown(unsigned long wakeTime)
+{
+    unsigned long startMillis;
+    unsigned long startCount;
+    unsigned long periods;
+    unsigned long slept = 0;
+
+    if (!this->waitForEdge(SLEEP_MODE_IDLE)) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        startMillis = timer0_millis;
+        startCount = (timer0_overflow_count << 8) + TCNT0;
+    }
+
+    periods = (wakeTime - startMillis) * POWER_SQW_FREQUENCY / 1000;
+
+    while (slept + 1 < periods) {
+        // A square wave that stops while the wave is low is noticed, one that stops while
+        // powered down is not, and the RTC has failed with it
+        if (!this->waitForEdge(SLEEP_MODE_PWR_DOWN)) {
+            this->sqwPin = POWER_NO_SQW;
+
+            break;
+        }
+
+        slept++;
+    }
+
+    if (slept == 0) {
+        return;
+    }
+
+    // Timer0 counts every 64 clock cycles
+    unsigned long elapsed = slept * (1000000UL / POWER_SQW_FREQUENCY) + POWER_DOWN_STARTUP;
+    unsigned long count = startCount + elapsed / clockCyclesToMicroseconds(64);
+
+    this->millisCarry += elapsed % 1000;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        timer0_overflow_count = count >> 8;
+        TCNT0 = count & 0xFF;
+        timer0_millis = startMillis + elapsed / 1000 + this->millisCarry / 1000;
+    }
+
+    this->millisCarry %= 1000;
+
+    // Only the high half of every period was spent powered down
+    this->powerDownMicros += slept * (500000UL / POWER_SQW_FREQUENCY);
+    this->powerDownTime += this->powerDownMicros / 1000;
+    this->powerDownMicros %= 1000;
+}
+
+// Arm the square wave interrupt once the wave is high, and sleep until it falls.  Returns
+// false if the wave does not move for two periods while Timer0 is there to tell.
+bool PowerManager::waitForEdge(byte mode)
+{
+    unsigned long startTime = millis();
+    unsigned long timeout = 2000 / POWER_SQW_FREQUENCY;
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+
+    while (digitalRead(this->sqwPin) == LOW) {
+        if (millis() - startTime > timeout) {
+            return false;
+        }
+
+        sleep_mode();
+        this->wakeups++;
+    }
+
+    squareWaveFell = false;
+    attachInterrupt(digitalPinToInterrupt(this->sqwPin), onSquareWave, LOW);
+    set_sleep_mode(mode);
+
+    for (;;) {
+        cli();
+
+        if (squareWaveFell) {
+            sei();
+
+            return true;
+        }
+
+        if (mode == SLEEP_MODE_IDLE && millis() - startTime > timeout) {
+            sei();
+            detachInterrupt(digitalPinToInterrupt(this->sqwPin));
+
+            return false;
+        }
+
+        sleep_enable();
+#ifdef sleep_bod_disable
+        if (mode == SLEEP_MODE_PWR_DOWN) {
+            sleep_bod_disable();
+        }
+#endif
+        sei();
+        sleep_cpu();
+        sleep_disable();
+
+        this->wakeups++;
+    }
+}
+#endif // __AVR__
+
+unsigned long PowerManager::getSleepTime()
+{
+    return this->sleepTime;
+}
+
+unsigned long PowerManager::getPowerDownTime()
+{
+    return this->powerDownTime;
+}
+
+unsigned long PowerManager::getWakeups()
+{
+    return this->wakeups;
+}
+
+unsigned long PowerManager::getMaxWakeLatency()
+{
+    return this->maxWakeLatency;
+}
+
+unsigned long PowerManager::getMeanWakeLatency()
+{
+    return this->latencySamples ? (this->totalWakeLatency / this->latencySamples) : 0;
+}
+
+unsigned int PowerManager::getDutyCycle()
+{
+    unsigned long elapsed = this->getElapsedTime();
+
+    if (elapsed == 0 || this->sleepTime >= elapsed) {
+        return 0;
+    }
+
+    return (unsigned int)((float)(elapsed - this->sleepTime) * 1000.0f / elapsed);
+}
+
+// Weighted by the time spent awake, idle and powered down
+unsigned long PowerManager::getEstimatedCurrent()
+{
+    unsigned long elapsed = this->getElapsedTime();
+    unsigned long sleepTime = min(this->sleepTime, elapsed);
+    unsigned long powerDownTime = min(this->powerDownTime, sleepTime);
+
+    if (elapsed == 0) {
+        return POWER_ACTIVE_CURRENT;
+    }
+
+    float charge = (float)(elapsed - sleepTime) * POWER_ACTIVE_CURRENT +
+                   (float)(sleepTime - powerDownTime) * POWER_IDLE_CURRENT +
+                   (float)powerDownTime * POWER_DOWN_CURRENT;
+
+    return (unsigned long)(charge / elapsed);
+}
+
+unsigned long PowerManager::getElapsedTime()
+{
+    return millis() - this->statisticsStart;
+}
+
+void PowerManager::printStatistics(Print* pPrint)
+{
+    pPrint->print(F("Sleep : "));
+    pPrint->print(this->getSleepTime());
+    pPrint->print(F(" ms of "));
+    pPrint->print(this->getElapsedTime());
+    pPrint->print(F(" ms, powered down "));
+    pPrint->print(this->getPowerDownTime());
+    pPrint->print(F(" ms, wakeups "));
+    pPrint->println(this->getWakeups());
+
+    pPrint->print(F("Awake : "));
+    pPrint->print(this->getDutyCycle() / 10.0f, 1);
+    pPrint->print(F(" %, est. "));
+    pPrint->print(this->getEstimatedCurrent());
+    pPrint->print(F(" uA, wake to sample max "));
+    pPrint->print(this->getMaxWakeLatency());
+    pPrint->print(F(" us, avg "));
+    pPrint->print(this->getMeanWakeLatency());
+    pPrint->println(F(" us"));
+}
+
+// Clear the counters, normally once a day so the totals do not overflow
+void PowerManager::resetStatistics()
+{
+    this->sleepMicros = 0;
+    this->sleepTime = 0;
+    this->powerDownMicros = 0;
+    this->powerDownTime = 0;
+    this->wakeups = 0;
+    this->latencySamples = 0;
+    this->maxWakeLatency = 0;
+    this->totalWakeLatency = 0;
+    this->statisticsStart = millis();
+}
@@ -0,0 +1,107 @@
+/*
+    Sleep between tasks for the radiometer sketch.
+
+    Program Description : When the scheduler has nothing to run, the MCU is
+        put to sleep until the next task is due instead of spinning on
+        millis().  In idle mode Timer0 keeps running and wakes the MCU every
+        millisecond, so millis() and the sample timing are exactly as they
+        were.  If the PCF8523 square wave is wired to an external interrupt
+        pin, longer waits power the MCU down between square wave edges and
+        wind millis() and micros() forward by the time that passed.  The ADC
+        is turned off while asleep.  The time spent asleep, the latency from
+        waking to the sample and the share of the time awake are tracked.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : PowerManager.h
+*/
+
+#ifndef PowerManager_h
+#define PowerManager_h
+
+#include <Arduino.h>
+
+// No square wave pin wired
+#define POWER_NO_SQW 0xFF
+
+// Shortest wait that is worth going to sleep for (ms)
+#define POWER_MIN_SLEEP 2
+
+// PCF8523 square wave frequency (Hz), and the shortest wait it is used to power down for
+// (ms).  The MCU is powered down while the square wave is high, and idles while it is low.
+#define POWER_SQW_FREQUENCY 32
+#define POWER_DOWN_MIN_SLEEP 100
+
+// Time the crystal takes to start after a power-down wake, 16K clock cycles at 16 MHz (us)
+#define POWER_DOWN_STARTUP 1024
+
+// Typical ATmega328P supply current at 16 MHz and 5 V, for the estimate (uA)
+#define POWER_ACTIVE_CURRENT 9000
+#define POWER_IDLE_CURRENT 3000
+#define POWER_DOWN_CURRENT 10
+
+class PowerManager
+{
+public:
+    PowerManager(HardwareSerial* pSerial, byte sqwPin);
+    ~PowerManager();
+
+    //// Sleep
+    //// Methods
+    // Sleep until millis() reaches wakeTime.  Powering down is only allowed when nothing
+    // needs the MCU's clock in the meantime (such as a powered modem link).
+    void sleepUntil(unsigned long wakeTime, bool allowPowerDown);
+
+    // Called at the start of a sample, to measure the latency from the last wake
+    void sampleStarted();
+
+    //// Statistics
+    // Time spent asleep, and the part of it powered down (ms)
+    unsigned long getSleepTime();
+    unsigned long getPowerDownTime();
+    unsigned long getWakeups();
+    // Longest and average latency from waking to the start of a sample (us)
+    unsigned long getMaxWakeLatency();
+    unsigned long getMeanWakeLatency();
+    // Share of the time awake, in tenths of a percent
+    unsigned int getDutyCycle();
+    // Estimated average MCU supply current (uA)
+    unsigned long getEstimatedCurrent();
+    unsigned long getElapsedTime();
+
+    void printStatistics(Print* pPrint);
+    void resetStatistics();
+
+private:
+    //// VARIABLES
+    HardwareSerial* pSerial = nullptr;
+    byte sqwPin = POWER_NO_SQW;
+
+    // micros() when the last sleep ended
+    bool woken = false;
+    unsigned long wakeMicros = 0;
+
+    // Sleep time is accumulated in microseconds and carried into milliseconds
+    unsigned long sleepMicros = 0;
+    unsigned long sleepTime = 0;
+    unsigned long powerDownMicros = 0;
+    unsigned long powerDownTime = 0;
+    unsigned long wakeups = 0;
+
+    // Part of a millisecond not yet added to millis() after powering down (us)
+    unsigned long millisCarry = 0;
+
+    unsigned long latencySamples = 0;
+    unsigned long maxWakeLatency = 0;
+    unsigned long totalWakeLatency = 0;
+    unsigned long statisticsStart = 0;
+
+    //// METHODS
+    void idle(unsigned long wakeTime);
+    void powerDown(unsigned long wakeTime);
+    bool waitForEdge(byte mode);
+};
+#endif // PowerManager_h
@@ -9,7 +9,7 @@
     Authors : Benjamin Kleynhans
 
     Last Modified By : Benjamin Kleynhans
-    Last Modified Date : July 1, 2020
+    Last Modified Date : October 19, 2026
     Filename : Radiometer.ino
 */
 
@@ -17,9 +17,21 @@
 #include <stdio.h>
 #include <string.h>
 
-#include "ExtendedADCShield.h"
+#include "ExtendedADCShieldStack.h"
 #include "AdafruitDataloggingShield.h"
 #include "Botletics_LTE_GPS_Shield.h"
+#include "SoftwareSerialTransport.h"
+#include "UartTransport.h"
+#include "BurstCapture.h"
+#include "CooperativeScheduler.h"
+#include "ClockDiscipline.h"
+#include "SampleAccounting.h"
+#include "UploadManifest.h"
+#include "BlockUploader.h"
+#include "UploadScheduler.h"
+#include "SerialMaintenance.h"
+#include "PowerManager.h"
+#include "SiteConfig.h"
 
 //// ---> MEMORY CHECKING
 #ifdef __arm__
@@ -31,78 +43,241 @@ extern char *__brkval;
 //// ---> MEMORY CHECKING
 
 // Define constants
-// Provide the site name
-const char* pSITE_NAME = "Henrietta 1";
+const byte NO_PIN = CONFIG_NO_PIN;
 
-// The site code is a unique, 2-digit code
-const char* pSITE_CODE = "H1";
+// Built-in site settings, used for anything CONFIG.TXT on the SD card does not set.  See
+// SiteConfig.h for what each one is.
+const SiteSettings DEFAULT_SETTINGS PROGMEM = {
+    "Henrietta 1",                               // Site name
+    "H1",                                        // Unique 2 character site code
+    1000,                                        // Sample period (ms)
+    50,                                          // Sample tolerance (ms)
+    1,                                           // Scans averaged per sample
+    10,                                          // Samples per SD card write
+    false,                                       // Journal the writes
+    8,                                           // Channels recorded
+    {                                            // Temperature pin after each channel
+        NO_PIN, A0, NO_PIN, A1, NO_PIN, NO_PIN, NO_PIN, A2,
+        NO_PIN, NO_PIN, NO_PIN, NO_PIN, NO_PIN, NO_PIN, NO_PIN, NO_PIN
+    },
+    "",                                          // FTP server
+    21,                                          // FTP port
+    "anonymous",                                 // FTP username
+    "",                                          // FTP password
+    UPLOAD_OLDEST_FIRST,                         // Order the backlog is sent in after an outage
+    500000,                                      // Bytes one upload session may send
+    300000,                                      // Time one upload session may take (ms)
+    -100,                                        // Weakest signal an upload goes ahead at (dBm)
+    6                                            // Uploads put off in a row before one is forced
+};
 
-// Thermobile internal temperature pins
-const char* pins[8] = {"","A0", "", "A1", "", "", "", "A2"};
+// Settings in use, read at boot
+SiteSettings settings;
 
-// Array containing data headings
-const char* pHEADING_STRING = "ch1,ch2,tp1,ch3,ch4,tp2,ch5,ch6,ch7,ch8,tp3,Year,Month,Day,Hour,Minutes,Seconds";
+// Bytes sent per FTP write, and how often the upload position is saved to the manifest.
+// Boards with a hardware UART for the modem (the Mega) send bigger chunks, as the modem's
+// reply to every chunk costs a round trip.  The chunk is read from the card a few bytes at
+// a time while it is written, so its size costs no RAM.
+#if defined(UBRR1H) && (RAMEND > 0x1000)
+const int UPLOAD_CHUNK_SIZE = 1024;
+#else
+const int UPLOAD_CHUNK_SIZE = 128;
+#endif
+const unsigned long UPLOAD_CHECKPOINT = 4096;
 
-// Define FTP server connection properties
-const char* serverIP = "";
-const byte serverPort = 21;
-const char* username = "anonymous";
-const char* password = "";
+// Below the weakest signal in the settings, an upload is tried again after a backoff that
+// doubles from the shortest to the longest wait (ms)
+const unsigned long UPLOAD_MIN_BACKOFF = 300000;
+const unsigned long UPLOAD_MAX_BACKOFF = 14400000;
+
+// A session that used up its budget is followed by another one after the backoff, until
+// the backlog is uploaded.  Files waiting for the server's check are asked about again
+// after UPLOAD_VERIFY_DELAY (ms).
+const unsigned long UPLOAD_VERIFY_DELAY = 900000;
+
+// How an upload session ended
+const byte UPLOAD_FAILED = 0;
+const byte UPLOAD_MORE_PENDING = 1;
+const byte UPLOAD_VERIFY_WAITING = 2;
+const byte UPLOAD_COMPLETE = 3;
+
+// The GPS refresh and the upload drive the modem a step at a time.  A step only does what
+// can be done without waiting on the modem, and the task runs again MODEM_STEP_PERIOD (ms)
+// later, so the sample task keeps its slot while the modem works.  Either one waits
+// MODEM_BUSY_WAIT (ms) at a time for the other to be done with the modem.
+const unsigned long MODEM_STEP_PERIOD = 10;
+const unsigned long MODEM_BUSY_WAIT = 1000;
+
+// Steps of the GPS refresh
+const byte GPS_IDLE = 0;
+const byte GPS_POWER_ON = 1;
+const byte GPS_FIX = 2;
+const byte GPS_EDGE = 3;
+const byte GPS_CLOCK = 4;
+const byte GPS_POWER_OFF = 5;
+
+// Steps of an upload attempt
+const byte UPLOAD_IDLE = 0;
+const byte UPLOAD_POWER_ON = 1;
+const byte UPLOAD_SIGNAL = 2;
+const byte UPLOAD_CONNECT = 3;
+const byte UPLOAD_FILES = 4;
+const byte UPLOAD_VERIFY = 5;
+const byte UPLOAD_QUIT = 6;
+const byte UPLOAD_POWER_OFF = 7;
+
+// The RTC is set on a whole GPS second.  The GPS refresh is released CLOCK_SET_LEAD (ms)
+// before it, longer than a sample takes, and waits out the rest.  The RTC's second edge is
+// looked for for up to CLOCK_EDGE_TIMEOUT (ms) before the drift is measured.
+const unsigned long CLOCK_SET_LEAD = 80;
+const unsigned long CLOCK_EDGE_TIMEOUT = 2000;
 
 // Create instances of all required componenets
-const ExtendedADCShield* pExtendedADCShield = nullptr;
-const AdafruitDataloggingShield* pDataloggingShield = nullptr;
-const Botletics_LTE_GPS_Shield* pBotletics_LTEGPS = nullptr;
+ExtendedADCShieldStack* pExtendedADCShieldStack = nullptr;
+AdafruitDataloggingShield* pDataloggingShield = nullptr;
+Botletics_LTE_GPS_Shield* pBotletics_LTEGPS = nullptr;
+BurstCapture* pBurstCapture = nullptr;
+CooperativeScheduler* pScheduler = nullptr;
+ClockDiscipline* pClockDiscipline = nullptr;
+SampleAccounting* pSampleAccounting = nullptr;
+UploadManifest* pUploadManifest = nullptr;
+BlockUploader* pBlockUploader = nullptr;
+UploadScheduler* pUploadScheduler = nullptr;
+PowerManager* pPowerManager = nullptr;
 
-// Extended ADC shield interface pins
-const byte CONVST = 5;
-const byte RD = 4;
+// Scheduler tasks
+byte sampleTask = NO_TASK;
+byte clockTask = NO_TASK;
+byte rtcCheckTask = NO_TASK;
+byte burstTask = NO_TASK;
+byte flushTask = NO_TASK;
+byte rolloverTask = NO_TASK;
+byte gpsRefreshTask = NO_TASK;
+byte uploadTask = NO_TASK;
+
+// Extended ADC shield interface pins, one CONVST and RD entry per stacked shield, kept in
+// flash.  Shields that share a CONVST line are triggered together.
+const byte NUMBER_ADC_SHIELDS = 1;
+const byte CONVST[NUMBER_ADC_SHIELDS] PROGMEM = {5};
+const byte RD[NUMBER_ADC_SHIELDS] PROGMEM = {4};
 const byte BUSY = 3;
 const byte NUMBER_BITS = 16;
+const byte NUMBER_CHANNELS = NUMBER_ADC_SHIELDS * CHANNELS_PER_SHIELD;
+
+static_assert(NUMBER_CHANNELS <= CONFIG_MAX_CHANNELS, "the settings can not map this many channels");
+
+// The channels recorded and the Thermobile internal temperature pins paired with them come
+// from the settings.  A temperature is recorded in the column following its channel.  The
+// record buffers are sized for every channel and the most temperatures the settings allow.
+const byte NUMBER_COLUMNS = NUMBER_CHANNELS + CONFIG_MAX_TEMPERATURES;
 
-// Botletics LTE/GPS shield interface pins
+// Burst capture settings.  Between samples the burst channels are watched for a
+// rising threshold or a rate of change in the raw ADC code (0 - 65535).  When the
+// detector fires, the triggering channel is captured at full rate and written to the
+// burst file with the pre-trigger samples leading up to it.  The capture buffer takes
+// about 200 bytes of RAM, so it is only built in on boards with RAM to spare, unless the
+// build defines BURST_CAPTURE as 1.
+#ifndef BURST_CAPTURE
+#if RAMEND > 0x1000
+#define BURST_CAPTURE 1
+#else
+#define BURST_CAPTURE 0
+#endif
+#endif
+
+const bool BURST_ENABLED = BURST_CAPTURE;
+const byte BURST_NUMBER_CHANNELS = 1;
+const byte BURST_CHANNELS[BURST_NUMBER_CHANNELS] PROGMEM = {0};
+const byte BURST_MODE = BURST_RATE_OF_CHANGE;
+const word BURST_LEVEL = 3000;
+const byte BURST_PRE_TRIGGER = 8;
+const byte BURST_POST_TRIGGER = 24;
+const unsigned long BURST_POLL_PERIOD = 10;
+
+// Botletics LTE/GPS shield interface pins.  RX and TX are only used on boards without a
+// second hardware UART, see UartTransport.h.
 const uint8_t FONA_PWRKEY = 6;
 const uint8_t FONA_RST = 7;
 const uint8_t FONA_RX = 10;
 const uint8_t FONA_TX = 11;
 
+// PCF8523 square wave output, if it is wired to an external interrupt pin.  It lets the
+// MCU power down between samples instead of idling.  On the Uno both external interrupt
+// pins are taken (pin 2 by the SD card chip select, pin 3 by BUSY), so it is not wired.
+const byte RTC_SQW_PIN = NO_PIN;
+
 // Define variables
 // Keeps track of whether the device was just switched on
 bool initialStartup = true;
 
-// Define sizes of variables used for collection
+// Define sizes of variables used for collection.  The heading lines are built one at a
+// time in a buffer of headingSize on the stack, when a day file is started.
 const int collectionSize = 7;
-const int titleSize = 20;
-const int positionSize = 66;
-const int stringSize = 100;
+const int dateSize = 24;
+const int accountingSize = 22;
+const int trailerSize = 192;
+const int stringSize = (NUMBER_COLUMNS * collectionSize) + dateSize + accountingSize;
+const int headingSize = (NUMBER_COLUMNS * 5) + 54;
+
+static_assert(headingSize >= CONFIG_NAME_SIZE + 11 && headingSize >= 3 * GPS_STRING_SIZE + 35, "the heading lines do not fit");
 
 // Define the variable used for data collection
 long chX;
-float tempVal;
+float channelValues[NUMBER_CHANNELS];
 char chValue[collectionSize];
-char titleString[titleSize];
-char positionString[positionSize];
 char collectionString[stringSize];
 
-// Define the sample timer variables
-unsigned long currentTime;
-unsigned long previousTime;
+// millis() when the current sample was taken
+unsigned long sampleTime;
+
+// Samples appended to the day file since it was last closed, which flushes them
+byte unflushedSamples = 0;
 
 // Define the baud rate
 const int baud = 9600;
 
+// How long the sketch listens for a maintenance mode request at boot (ms)
+const unsigned long MAINTENANCE_WINDOW = 3000;
+
 // Current day, used for data upload
 uint8_t currentDay;
 
 // Current minute used for testing
 uint8_t currentMinute;
 
-// Define the filename used to store the data
+// Define the filename used to store the data, and the burst captures for the same day
 char filename[13];
+char burstFilename[13];
+
+// Define the filenames used to log the clock syncs and the upload attempts
+char clockFilename[13];
+char linkFilename[13];
 
 // Define whether data needs to be uploaded during this cycle
 bool dataUpload = false;
 
+// Steps the GPS refresh and the upload are at
+byte gpsStep = GPS_IDLE;
+byte uploadStep = UPLOAD_IDLE;
+
+// When the GPS refresh step started, and when the RTC is set (millis()) to which GPS time
+unsigned long gpsStepStart;
+unsigned long clockSetAt;
+uint32_t clockSetTime;
+
+// Upload attempt in progress: when it was made, the signal it found, when the session
+// started and what it sent, the manifest entry being sent or verified, whether every
+// transfer went through, and when the next attempt is
+uint32_t attemptTime;
+int8_t attemptRssi;
+unsigned long uploadStart;
+unsigned long uploadTime;
+unsigned long uploaded;
+int uploadIndex;
+ManifestEntry uploadEntry;
+bool uploadComplete;
+unsigned long retryDelay;
+
 // the setup function runs once when you press reset or power the board
 void setup()
 {
@@ -114,41 +289,107 @@ void setup()
     //// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
     setUpAdcShield();
     setUpDataloggingShield();
+    setUpSerialMaintenance();
     setUpBotleticsShield();
+    setUpBurstCapture();
+    setUpScheduler();
 }
 
 // the loop function runs over and over again until power down or reset
 void loop()
 {    
-    // Check if this is the initial boot of the device, and pre-set some values
-    if (!pDataloggingShield->clockSet() || initialStartup) {
+    pScheduler->run();
+}
+
+// Read the sensor data once a second
+void sample()
+{
+    pPowerManager->sampleStarted();
+    
+    if (initialStartup == false) {
+        Serial.print(F("Free Memory : "));
+        Serial.print(freeMemory());
+        Serial.print(F("  <|>  "));
         
-        Serial.println(F("\n --- Running startup configuration checks ---"));
+        readExtendedADCShield();
         
-        // Turn on the Botletics LTE/GPS shield
-        pBotletics_LTEGPS->powerOn();
+        pSampleAccounting->beginActivity(CAUSE_SD);
+        appendSample();
+        pSampleAccounting->endActivity();
+    }
+}
+
+// Write the sample to the day file.  With a flush policy of more than one sample the file
+// stays open between samples, and closing it is what flushes them to the card.  With the
+// journal on, the samples written at a time form a block that only counts once it is
+// committed, so a power cut leaves no half-written records behind.
+void appendSample()
+{
+    if (settings.flushEvery <= 1 && !settings.journal) {
+        pDataloggingShield->write(filename, collectionString);
         
-        // If we need to upload a data file, upload it
-        if (dataUpload)
-        {
-            uploadData();
-        }
-                
-        // Update the clock from the Cellular service
-        setClock();
+        return;
+    }
+    
+    if (unflushedSamples == 0) {
+        bool opened = settings.journal ? pDataloggingShield->openBlock(filename) : pDataloggingShield->openForAppend(filename);
         
-        // Create the filename for data to append to
-        buildFilename();
+        if (!opened) {
+            return;
+        }
+    }
+    
+    if (settings.journal) {
+        pDataloggingShield->appendToBlock(collectionString);
+    } else {
+        pDataloggingShield->append(collectionString);
+    }
+    
+    if (++unflushedSamples >= settings.flushEvery) {
+        closeDayFile();
+    }
+}
+
+// Flush the samples held in the open day file.  Nothing else can use the card while it is
+// open.
+void closeDayFile()
+{
+    if (unflushedSamples > 0) {
+        if (settings.journal) {
+            pDataloggingShield->commitBlock();
+        } else {
+            pDataloggingShield->closeAppend();
+        }
         
-        // Set the headings for the new file
-        buildHeading();
+        unflushedSamples = 0;
+    }
+}
+
+// After a restart, carry on the day file's journal from its last committed block.  Records
+// the power cut off before they were committed are marked as discarded.
+void recoverDayFile()
+{
+    JournalRecovery recovery;
+    unsigned long startTime = millis();
     
-        initialStartup = false;
-                
-        // Turn off the Botletics LTE/GPS shield
-        pBotletics_LTEGPS->powerOff();
+    if (!settings.journal || !pDataloggingShield->recoverJournal(filename, &recovery)) {
+        return;
     }
     
+    Serial.print(F("\n      Journal recovered at block "));
+    Serial.print(recovery.sequence);
+    Serial.print(F(", discarded "));
+    Serial.print(recovery.discarded);
+    Serial.print(F(" B, read "));
+    Serial.print(recovery.scanned);
+    Serial.print(F(" B in "));
+    Serial.print(millis() - startTime);
+    Serial.println(F(" ms"));
+}
+
+// Check whether the day has changed
+void checkRtc()
+{
     if (currentDay != pDataloggingShield->rtc.now().day()) {
     //~ if (pDataloggingShield->rtc.now().minute() >= currentMinute + 11) {
         
@@ -161,24 +402,551 @@ void loop()
         // Upload the data files to the online storage service
         dataUpload = true;
         
-        // Set initial startup to true, which will force a re-sync of the clock and create a new file for the new day.
-        initialStartup = true;
+        // Re-sync the clock and start the file for the new day
+        pScheduler->runTaskIn(rolloverTask, 0);
     }
+}
+
+// Watch for transients between samples
+void pollBurstCapture()
+{
+    if (BURST_ENABLED && initialStartup == false) {
+        pBurstCapture->poll();
+        
+        if (pBurstCapture->captureReady()) {
+            pScheduler->runTaskIn(flushTask, 0);
+        }
+    }
+}
+
+// Start of the startup/day change sequence: rollover, GPS refresh and upload
+void rollover()
+{
+    pSampleAccounting->beginActivity(CAUSE_ROLLOVER);
     
-    // Used to check for 1 second time intervals
-    currentTime = millis();
+    closeDayFile();
     
-    // If a second has passed, read the sensor data
-    if (currentTime >= previousTime + 1000 && initialStartup == false) {
-        Serial.print(F("Free Memory : "));
-        Serial.print(freeMemory());
-        Serial.print(F("  <|>  "));
+    Serial.println(F("\n --- Running startup configuration checks ---"));
+    
+    // Report on the day that has just ended
+    pScheduler->printStatistics(&Serial);
+    pScheduler->resetStatistics();
+    pPowerManager->printStatistics(&Serial);
+    pPowerManager->resetStatistics();
+    writeTrailer();
+    
+    // Nothing more is written to the day file, so its CRC index can be finished
+    pDataloggingShield->closeCrcIndex();
+    queueUpload();
+    
+    // Sampling carries on in the file for the new day, with the last position in its
+    // heading.  At boot the file waits for the clock to be set.
+    if (!initialStartup) {
+        startDayFile();
+    }
+    
+    pScheduler->runTaskIn(gpsRefreshTask, 0);
+    
+    pSampleAccounting->endActivity();
+}
+
+// Close off the day file with the sample-loss and jitter counters for the day
+void writeTrailer()
+{
+    char trailerString[trailerSize];
+    
+    pSampleAccounting->buildTrailer(trailerString, trailerSize);
+    pSampleAccounting->reset();
+    
+    Serial.println(trailerString);
+    
+    // There is no day file yet when the device has just been switched on
+    if (filename[0] != '\0') {
+        pDataloggingShield->write(filename, trailerString);
+    }
+}
+
+// Add the files for the day that has just ended to the upload manifest
+void queueUpload()
+{
+    unsigned long size;
+    
+    // Drop the files that are done first, so the upload scans stay short.  At boot this
+    // also finishes a compaction that a power cut interrupted.
+    pUploadManifest->compact();
+    
+    if (filename[0] == '\0') {
+        return;
+    }
+    
+    pUploadManifest->add(filename, pDataloggingShield->fileSize(filename));
+    
+    // Most days have no burst captures
+    size = pDataloggingShield->fileSize(burstFilename);
+    
+    if (size > 0) {
+        pUploadManifest->add(burstFilename, size);
+    }
+}
+
+// Start the file for the day on the RTC
+void startDayFile()
+{
+    // Create the filename for data to append to
+    buildFilename();
+    
+    // A restart during the day finds the file already there
+    recoverDayFile();
+    pDataloggingShield->openCrcIndex(filename);
+    
+    // Set the headings for the new file
+    buildHeading();
+    
+    // Sampling resumes from here
+    initialStartup = false;
+}
+
+// Update the location and the clock, a step at a time
+void refreshGps()
+{
+    unsigned long wait = MODEM_STEP_PERIOD;
+    byte result;
+    
+    pSampleAccounting->beginActivity(CAUSE_ROLLOVER);
+    
+    switch (gpsStep) {
+        case GPS_IDLE:
+            // An upload that is still going keeps the modem until it is done
+            if (uploadStep != UPLOAD_IDLE) {
+                pScheduler->runTaskIn(gpsRefreshTask, MODEM_BUSY_WAIT);
+                
+                break;
+            }
+            
+            // Turn on the Botletics LTE/GPS shield
+            pBotletics_LTEGPS->startPowerOn();
+            gpsStep = GPS_POWER_ON;
+            
+            break;
+        case GPS_POWER_ON:
+            if (pBotletics_LTEGPS->service() != MODEM_BUSY) {
+                pBotletics_LTEGPS->startGeoData(MODEM_GPS_TIMEOUT);
+                gpsStep = GPS_FIX;
+            }
+            
+            break;
+        case GPS_FIX:
+            result = pBotletics_LTEGPS->service();
+            
+            // The clock task looks for the next second edge of the RTC, which the drift is
+            // measured from
+            if (result == MODEM_DONE) {
+                pClockDiscipline->resetEdge();
+                gpsStepStart = millis();
+                gpsStep = GPS_EDGE;
+            } else if (result == MODEM_FAILED) {
+                Serial.println(F("\n !!! No GPS fix, the clock is left as it is !!! \n"));
+                endGpsRefresh();
+            }
+            
+            break;
+        case GPS_EDGE:
+            if (!pClockDiscipline->locked() && millis() - gpsStepStart < CLOCK_EDGE_TIMEOUT) {
+                break;
+            }
+            
+            measureClock();
+            wait = timeToClockSet();
+            gpsStep = GPS_CLOCK;
+            
+            break;
+        case GPS_CLOCK:
+            // Released too late for this second, so the clock is set on the next one
+            if ((long)(millis() - clockSetAt) > 0) {
+                clockSetAt += 1000;
+                clockSetTime++;
+                wait = timeToClockSet();
+                
+                break;
+            }
+            
+            // Update the clock from the Cellular service
+            setClock();
+            endGpsRefresh();
+            
+            break;
+        case GPS_POWER_OFF:
+            if (pBotletics_LTEGPS->service() != MODEM_BUSY) {
+                gpsStep = GPS_IDLE;
+            }
+            
+            break;
+    }
+    
+    if (gpsStep != GPS_IDLE) {
+        pScheduler->runTaskIn(gpsRefreshTask, wait);
+    }
+    
+    pSampleAccounting->endActivity();
+}
+
+// At boot the day file is started once the clock has been set, or has failed to be.  The
+// modem then goes on to the upload, or is turned off.
+void endGpsRefresh()
+{
+    if (initialStartup) {
+        startDayFile();
+    }
+    
+    // If we need to upload a data file, upload it
+    if (dataUpload) {
+        gpsStep = GPS_IDLE;
+        pScheduler->runTaskIn(uploadTask, 0);
+    } else {
+        // Turn off the Botletics LTE/GPS shield
+        pBotletics_LTEGPS->startPowerOff();
+        gpsStep = GPS_POWER_OFF;
+    }
+}
+
+// Upload the backlog if the signal is good enough, otherwise try again later.  Either way
+// the modem is turned off until the next attempt, which is scheduled once it is off.
+void upload()
+{
+    byte result;
+    
+    pSampleAccounting->beginActivity(CAUSE_MODEM);
+    
+    // Samples are written between the steps, and nothing else can use the card while the
+    // day file is open
+    closeDayFile();
+    
+    switch (uploadStep) {
+        case UPLOAD_IDLE:
+            // The GPS refresh has the modem
+            if (gpsStep != GPS_IDLE) {
+                pScheduler->runTaskIn(uploadTask, MODEM_BUSY_WAIT);
+                
+                break;
+            }
+            
+            attemptTime = pDataloggingShield->rtc.now().unixtime();
+            uploadTime = 0;
+            uploaded = 0;
+            retryDelay = 0;
+            
+            // A retry finds the modem off
+            if (!pBotletics_LTEGPS->isPoweredOn()) {
+                pBotletics_LTEGPS->startPowerOn();
+            }
+            
+            uploadStep = UPLOAD_POWER_ON;
+            
+            break;
+        case UPLOAD_POWER_ON:
+            if (pBotletics_LTEGPS->service() != MODEM_BUSY) {
+                pBotletics_LTEGPS->startSignalStrength();
+                uploadStep = UPLOAD_SIGNAL;
+            }
+            
+            break;
+        case UPLOAD_SIGNAL:
+            if (pBotletics_LTEGPS->service() != MODEM_BUSY) {
+                checkSignal();
+            }
+            
+            break;
+        case UPLOAD_CONNECT:
+            result = pBotletics_LTEGPS->service();
+            
+            if (result == MODEM_FAILED) {
+                endUploadSession(UPLOAD_FAILED);
+            } else if (result == MODEM_DONE) {
+                pBlockUploader->startSession(UPLOAD_CHUNK_SIZE, UPLOAD_CHECKPOINT, settings.uploadBudgetBytes, settings.uploadBudgetTime);
+                uploadComplete = true;
+                uploadNext();
+            }
+            
+            break;
+        case UPLOAD_FILES:
+            result = pBlockUploader->service();
+            
+            if (result == BLOCK_FAILED) {
+                uploadComplete = false;
+                quitUploadSession();
+            } else if (result == BLOCK_SENT && uploadEntry.status == MANIFEST_PENDING) {
+                // The budget ran out part way through the file
+                verifyNext(0);
+            } else if (result == BLOCK_SENT) {
+                uploadIndex = pUploadManifest->next(settings.uploadPolicy, &uploadEntry);
+                uploadNext();
+            }
+            
+            break;
+        case UPLOAD_VERIFY:
+            result = pBlockUploader->service();
+            
+            if (result == BLOCK_BUSY) {
+                break;
+            }
+            
+            Serial.print(F("\n      --> Verifying "));
+            Serial.print(uploadEntry.name);
+            
+            if (result == VERIFY_PASSED) {
+                Serial.println(F(": passed"));
+            } else if (result == VERIFY_RESENT) {
+                Serial.println(F(": blocks sent again"));
+            } else if (result == VERIFY_WAITING) {
+                Serial.println(F(": waiting for the server"));
+            } else if (result == VERIFY_ABANDONED) {
+                Serial.println(F(": given up on"));
+                logAbandonedVerify(uploadEntry.name);
+            } else {
+                Serial.println(F(": failed"));
+                uploadComplete = false;
+            }
+            
+            verifyNext(uploadIndex + 1);
+            
+            break;
+        case UPLOAD_QUIT:
+            if (pBotletics_LTEGPS->service() != MODEM_BUSY) {
+                endUploadSession(uploadResult());
+            }
+            
+            break;
+        case UPLOAD_POWER_OFF:
+            if (pBotletics_LTEGPS->service() == MODEM_BUSY) {
+                break;
+            }
+            
+            // Keep going until every file is uploaded and has passed the server's check
+            uploadStep = UPLOAD_IDLE;
+            
+            if (dataUpload) {
+                pScheduler->runTaskIn(uploadTask, retryDelay);
+            }
+            
+            break;
+    }
+    
+    if (uploadStep != UPLOAD_IDLE) {
+        pScheduler->runTaskIn(uploadTask, MODEM_STEP_PERIOD);
+    }
+    
+    pSampleAccounting->endActivity();
+}
+
+// Upload only if the modem has registered and the signal is good enough
+void checkSignal()
+{
+    DateTime now(attemptTime);
+    bool registered = pBotletics_LTEGPS->isRegistered();
+    
+    attemptRssi = pBotletics_LTEGPS->getRssi();
+    pUploadScheduler->record(now.hour(), attemptRssi, registered);
+    
+    if (!registered) {
+        endUploadAttempt(PSTR("No network"));
+    } else if (!pUploadScheduler->clear(attemptRssi, registered)) {
+        endUploadAttempt(PSTR("Weak signal"));
+    } else {
+        startUploadSession();
+    }
+}
+
+// Upload the backlog in the manifest until it is empty or the session budget is used
+// up.  Files are appended to on the server from where its copy ends.  Whatever is left of
+// the budget goes to verifying the day files already uploaded, which sends again only the
+// blocks the server found wrong.
+void startUploadSession()
+{
+    uploadStart = millis();
+    uploadIndex = pUploadManifest->next(settings.uploadPolicy, &uploadEntry);
+    
+    // Nothing to upload or verify, so there is no need to connect
+    if (uploadIndex < 0 && pUploadManifest->find(MANIFEST_VERIFY, 0, &uploadEntry) < 0) {
+        endUploadSession(UPLOAD_COMPLETE);
         
-        readExtendedADCShield();
-        pDataloggingShield->write(filename, collectionString);
+        return;
+    }
+    
+    pBotletics_LTEGPS->startFtpConnect(settings.server, settings.serverPort, settings.username, settings.password);
+    uploadStep = UPLOAD_CONNECT;
+}
+
+// Upload the file at uploadIndex, or go on to the verification once there are no more
+// files or the budget has run out
+void uploadNext()
+{
+    if (uploadIndex < 0 || !pBlockUploader->budgetLeft()) {
+        verifyNext(0);
         
-        previousTime = currentTime;
+        return;
     }
+    
+    Serial.print(F("\n      --> Uploading "));
+    Serial.print(uploadEntry.name);
+    Serial.print(F(" from byte "));
+    Serial.println(uploadEntry.offset);
+    
+    pBlockUploader->startUpload(uploadIndex, &uploadEntry);
+    uploadStep = UPLOAD_FILES;
+}
+
+// Verify the next file waiting for the server's check, from index on.  Once there are no
+// more, a transfer has failed or the budget has run out, the session ends.
+void verifyNext(int index)
+{
+    uploadIndex = pUploadManifest->find(MANIFEST_VERIFY, index, &uploadEntry);
+    
+    if (uploadIndex < 0 || !uploadComplete || !pBlockUploader->budgetLeft()) {
+        quitUploadSession();
+        
+        return;
+    }
+    
+    pBlockUploader->startVerify(uploadIndex, &uploadEntry);
+    uploadStep = UPLOAD_VERIFY;
+}
+
+void quitUploadSession()
+{
+    pBlockUploader->endSession();
+    pBotletics_LTEGPS->startFtpQuit();
+    uploadStep = UPLOAD_QUIT;
+}
+
+// How the session went.  Returns UPLOAD_FAILED if a transfer failed, UPLOAD_MORE_PENDING
+// if files are left to upload, UPLOAD_VERIFY_WAITING if every file is uploaded but some
+// have not passed the server's check yet, and otherwise UPLOAD_COMPLETE.
+byte uploadResult()
+{
+    ManifestEntry entry;
+    
+    Serial.print(F("\n      --> Uploaded "));
+    Serial.print(pBlockUploader->getUploaded());
+    Serial.print(F(" bytes, "));
+    Serial.print(pBlockUploader->getResent());
+    Serial.println(F(" of them blocks sent again"));
+    
+    uploaded = pBlockUploader->getUploaded();
+    
+    if (!uploadComplete) {
+        return UPLOAD_FAILED;
+    }
+    
+    if (pUploadManifest->next(settings.uploadPolicy, &entry) >= 0) {
+        return UPLOAD_MORE_PENDING;
+    }
+    
+    if (pUploadManifest->find(MANIFEST_VERIFY, 0, &entry) >= 0) {
+        return UPLOAD_VERIFY_WAITING;
+    }
+    
+    return UPLOAD_COMPLETE;
+}
+
+// Log the session and turn the modem off
+void endUploadSession(byte session)
+{
+    PGM_P pResult;
+    
+    uploadTime = millis() - uploadStart;
+    
+    if (session == UPLOAD_FAILED) {
+        pResult = PSTR("Failed");
+    } else {
+        pUploadScheduler->succeeded();
+        
+        if (session == UPLOAD_COMPLETE) {
+            pResult = PSTR("Uploaded");
+            dataUpload = false;
+        } else if (session == UPLOAD_MORE_PENDING) {
+            pResult = PSTR("Partial");
+        } else {
+            pResult = PSTR("Verifying");
+            retryDelay = UPLOAD_VERIFY_DELAY;
+        }
+    }
+    
+    endUploadAttempt(pResult);
+}
+
+// Log the attempt and turn the modem off.  An attempt that did not get anywhere, or a
+// session that left files to upload, is tried again after the backoff.
+void endUploadAttempt(PGM_P pResult)
+{
+    DateTime now(attemptTime);
+    
+    if (dataUpload && retryDelay == 0) {
+        retryDelay = pUploadScheduler->backOff(now.hour(), now.minute());
+    }
+    
+    logUploadAttempt(now, attemptRssi, uploaded, uploadTime, pResult, retryDelay);
+    
+    // Turn off the Botletics LTE/GPS shield
+    pBotletics_LTEGPS->startPowerOff();
+    uploadStep = UPLOAD_POWER_OFF;
+}
+
+// Log the signal, registration and throughput of an upload attempt, so the threshold and
+// the backoff can be tuned for the site
+void logUploadAttempt(DateTime attemptTime, int8_t rssi, unsigned long uploaded, unsigned long uploadTime, PGM_P pResult, unsigned long retryDelay)
+{
+    char linkString[144];
+    char result[12];
+    
+    strncpy_P(result, pResult, sizeof(result) - 1);
+    result[sizeof(result) - 1] = '\0';
+    
+    snprintf_P(
+        linkString,
+        sizeof(linkString),
+        PSTR("Upload: %d/%d/%d %d:%d:%d, RSSI: %d dBm, Registration: %lu ms, Resets: %d, Sent: %lu B in %lu ms, %lu B/s, %s, Retry: %lu s"),
+        attemptTime.year(),
+        attemptTime.month(),
+        attemptTime.day(),
+        attemptTime.hour(),
+        attemptTime.minute(),
+        attemptTime.second(),
+        rssi,
+        pBotletics_LTEGPS->getRegistrationTime(),
+        pBotletics_LTEGPS->getRegistrationResets(),
+        uploaded,
+        uploadTime,
+        (uploadTime > 0) ? (uploaded * 1000UL / uploadTime) : 0UL,
+        result,
+        retryDelay / 1000
+    );
+    
+    Serial.println(linkString);
+    pDataloggingShield->write(linkFilename, linkString);
+}
+
+// A file the server never reported on is logged, so it can be checked by hand
+void logAbandonedVerify(char* name)
+{
+    char linkString[80];
+    DateTime now = pDataloggingShield->rtc.now();
+    
+    snprintf_P(
+        linkString,
+        sizeof(linkString),
+        PSTR("Verify: %d/%d/%d %d:%d:%d, %s, Abandoned, Checks: %d"),
+        now.year(),
+        now.month(),
+        now.day(),
+        now.hour(),
+        now.minute(),
+        now.second(),
+        name,
+        VERIFY_MAX_CHECKS
+    );
+    
+    Serial.println(linkString);
+    pDataloggingShield->write(linkFilename, linkString);
 }
 
 void setUpAdcShield()
@@ -186,9 +954,9 @@ void setUpAdcShield()
     Serial.print(F("\n --- Initializing Mayhew ---"));
     delay(100);
     
-    // Create an ADC Shield instance and set up first channel for sampling
-    pExtendedADCShield = new ExtendedADCShield(CONVST, RD, BUSY, NUMBER_BITS);
-    pExtendedADCShield->analogReadConfigNext(0, SINGLE_ENDED, UNIPOLAR, RANGE5V);
+    // Create the ADC Shield instances and set up first channel for sampling
+    pExtendedADCShieldStack = new ExtendedADCShieldStack(NUMBER_ADC_SHIELDS, CONVST, RD, BUSY, NUMBER_BITS);
+    pExtendedADCShieldStack->begin(SINGLE_ENDED, UNIPOLAR, RANGE5V);
 }
 
 void setUpDataloggingShield()
@@ -199,7 +967,10 @@ void setUpDataloggingShield()
     // buildHeading();
     
     // Create a Datalogging Shield instance for writing to SD card and RTC
-    pDataloggingShield = new AdafruitDataloggingShield(pSITE_NAME, &Serial, &baud);
+    pDataloggingShield = new AdafruitDataloggingShield(settings.siteName, &Serial, &baud);
+    
+    // Everything below runs on the site settings
+    loadSettings();
     
     // Test and activate the realtime clock
     if (!pDataloggingShield->rtc.begin()) {
@@ -208,13 +979,50 @@ void setUpDataloggingShield()
         abort();
     }
     
-    // Assign the starting time for sample interval measurement
-    currentTime = millis();
-    previousTime = currentTime;
-    
     // Save the current day
     currentDay = pDataloggingShield->rtc.now().day();
     //~ currentMinute = pDataloggingShield->rtc.now().minute();
+    
+    // Track the RTC second edges and learn its drift at every GPS sync
+    pClockDiscipline = new ClockDiscipline();
+    snprintf_P(clockFilename, 13, PSTR("%sCLOCK.csv"), settings.siteCode);
+    
+    // Files waiting to be uploaded.  Anything left over from before a restart is sent
+    // once the clock has been set.
+    pUploadManifest = new UploadManifest(pDataloggingShield);
+    dataUpload = true;
+    
+    // Uploads wait for a good signal, and every attempt is logged
+    pUploadScheduler = new UploadScheduler(settings.uploadMinRssi, UPLOAD_MIN_BACKOFF, UPLOAD_MAX_BACKOFF, settings.uploadMaxDeferrals);
+    snprintf_P(linkFilename, 13, PSTR("%sLINK.csv"), settings.siteCode);
+}
+
+// Start from the built-in settings and apply CONFIG.TXT over them.  A missing file, bad
+// lines and settings that do not fit together all leave the defaults in place.
+void loadSettings()
+{
+    SiteConfig config(&settings, &Serial, NUMBER_CHANNELS);
+    
+    config.loadDefaults(&DEFAULT_SETTINGS);
+    
+    if (!pDataloggingShield->readConfig(CONFIG_FILENAME, &config)) {
+        Serial.println(F("\n      No settings file, using the built-in settings"));
+    }
+    
+    config.validate(&DEFAULT_SETTINGS);
+    
+    Serial.println(F("\n --- Site settings ---"));
+    config.print(&Serial);
+}
+
+// Give a technician the chance to pull the files off the card before logging starts
+void setUpSerialMaintenance()
+{
+    SerialMaintenance maintenance(&Serial, &baud, pDataloggingShield);
+    
+    if (maintenance.requested(MAINTENANCE_WINDOW)) {
+        maintenance.run();
+    }
 }
 
 void setUpBotleticsShield()
@@ -222,81 +1030,206 @@ void setUpBotleticsShield()
     Serial.print(F("\n --- Initializing Botletics LTE/GPS ---"));
     delay(100);
     
-    // Create a Software Serial instance for the Botletics FONA LTE/GPS
-    pBotletics_LTEGPS = new Botletics_LTE_GPS_Shield(&Serial, &baud, &FONA_PWRKEY, &FONA_RST, &FONA_TX, &FONA_RX);
+    // Use the second hardware UART for the modem where the board has one, otherwise
+    // SoftwareSerial on the shield's pins
+#if defined(UBRR1H)
+    ModemTransport* pModemTransport = new UartTransport();
+#else
+    ModemTransport* pModemTransport = new SoftwareSerialTransport(FONA_RX, FONA_TX);
+#endif
+    
+    pBotletics_LTEGPS = new Botletics_LTE_GPS_Shield(&Serial, &baud, &FONA_PWRKEY, &FONA_RST, pModemTransport);
+    
+    // The files in the manifest go up through the modem
+    pBlockUploader = new BlockUploader(pDataloggingShield, pBotletics_LTEGPS, pUploadManifest);
 }
 
-// Update the RTC on the datalogging shield from GPS UTC time
-void setClock()
+void setUpBurstCapture()
+{
+    if (BURST_ENABLED) {
+        pBurstCapture = new BurstCapture(
+            pExtendedADCShieldStack,
+            BURST_CHANNELS,
+            BURST_NUMBER_CHANNELS,
+            BURST_MODE,
+            BURST_LEVEL,
+            BURST_PRE_TRIGGER,
+            BURST_POST_TRIGGER
+        );
+    }
+}
+
+// Register the sketch functions with the scheduler.  Deadlines are in milliseconds from
+// the time a task is released, and a higher priority runs first.
+void setUpScheduler()
+{
+    pScheduler = new CooperativeScheduler();
+    pSampleAccounting = new SampleAccounting(settings.samplePeriod, settings.sampleTolerance);
+    
+    // Sleep whenever no task is due.  The RTC square wave is only turned on if it can wake
+    // the MCU.
+    pPowerManager = new PowerManager(&Serial, RTC_SQW_PIN);
+    pDataloggingShield->rtc.writeSqwPinMode(RTC_SQW_PIN != NO_PIN ? PCF8523_SquareWave32HZ : PCF8523_OFF);
+    pScheduler->setIdleFunction(sleepUntil);
+    
+    clockTask = pScheduler->addPeriodicTask(F("RTC edge"), probeRtc, CLOCK_PROBE_PERIOD, CLOCK_PROBE_PERIOD, 7);
+    sampleTask = pScheduler->addPeriodicTask(F("Sample"), sample, settings.samplePeriod, 100, 6);
+    rtcCheckTask = pScheduler->addPeriodicTask(F("RTC check"), checkRtc, 1000, 500, 5);
+    burstTask = pScheduler->addPeriodicTask(F("Burst"), pollBurstCapture, BURST_POLL_PERIOD, BURST_POLL_PERIOD, 4);
+    flushTask = pScheduler->addOneShotTask(F("Flush"), writeBurstCapture, 1000, 3);
+    rolloverTask = pScheduler->addOneShotTask(F("Rollover"), rollover, 30000, 2);
+    gpsRefreshTask = pScheduler->addOneShotTask(F("GPS refresh"), refreshGps, 120000, 2);
+    uploadTask = pScheduler->addOneShotTask(F("Upload"), upload, 600000, 1);
+    
+    // A task left out would silently never run, so stop instead
+    if (clockTask == NO_TASK || sampleTask == NO_TASK || rtcCheckTask == NO_TASK || burstTask == NO_TASK ||
+        flushTask == NO_TASK || rolloverTask == NO_TASK || gpsRefreshTask == NO_TASK || uploadTask == NO_TASK) {
+        
+        Serial.println(F("\n !!! Too many tasks, raise SCHEDULER_MAX_TASKS !!! \n"));
+        Serial.flush();
+        abort();
+    }
+    
+    // The device was just switched on, so run the startup checks straight away
+    pScheduler->runTaskIn(rolloverTask, 0);
+}
+
+// Read the RTC when the clock discipline is looking for a second edge.  Until the window
+// around the next edge there is nothing to look for, so the task waits for it.
+void probeRtc()
+{
+    unsigned long now = millis();
+    unsigned long wait = pClockDiscipline->timeToProbe(now);
+    
+    if (wait == 0) {
+        pClockDiscipline->observe(pDataloggingShield->rtc.now().unixtime(), now);
+    } else {
+        pScheduler->runTaskIn(clockTask, wait);
+    }
+}
+
+// Sleep until the next task is due.  Powering down would stop the clock the modem link
+// runs on, so it is only allowed while the modem is off.
+void sleepUntil(unsigned long wakeTime)
+{
+    pPowerManager->sleepUntil(wakeTime, !pBotletics_LTEGPS->isPoweredOn());
+}
+
+// Measure the drift of the RTC against the GPS fix, and work out when the next whole GPS
+// second is, to set the RTC on
+void measureClock()
 {
     Serial.println(F("\n --- Setting Clock ---"));
-    delay(100);
     
-    //                             yyyy, mo, dd, hh, mm, ss
-    // pDataloggingShield->setClock(2020, 06, 11, 11, 07, 00);
-    pDataloggingShield->setClock(
+    float gpsSeconds = pBotletics_LTEGPS->getSeconds();
+    int gpsMillis = (int)((gpsSeconds - (int)gpsSeconds) * 1000.0f);
+    unsigned long fixTime = pBotletics_LTEGPS->getFixTime();
+    unsigned long now = millis();
+    
+    DateTime gpsTime(
         pBotletics_LTEGPS->getYear(),                // Year
         pBotletics_LTEGPS->getMonth(),               // Month
         pBotletics_LTEGPS->getDay(),                 // Day
         pBotletics_LTEGPS->getHours(),               // Hour
         pBotletics_LTEGPS->getMinutes(),             // Minute
-        pBotletics_LTEGPS->getSeconds()              // Second
+        (uint8_t)gpsSeconds                          // Second
     );
+    
+    // Measure the drift against GPS before the RTC is set
+    pClockDiscipline->measure(gpsTime.unixtime(), gpsMillis, fixTime, now);
+    
+    // Set the RTC on the next whole GPS second
+    unsigned long gpsMs = gpsMillis + (now - fixTime);
+    
+    clockSetTime = gpsTime.unixtime() + (gpsMs / 1000) + 1;
+    clockSetAt = now + 1000 - (gpsMs % 1000);
 }
 
-// Upload the data file to the cloud
-void uploadData()
+// Time until the GPS refresh has to be released to set the RTC at clockSetAt
+unsigned long timeToClockSet()
 {
-    return 0;
+    unsigned long remaining = clockSetAt - millis();
+    
+    return (remaining > CLOCK_SET_LEAD) ? remaining - CLOCK_SET_LEAD : 0;
+}
+
+// Update the RTC on the datalogging shield from GPS UTC time, at clockSetAt
+void setClock()
+{
+    DateTime setTime(clockSetTime);
+    
+    while ((long)(millis() - clockSetAt) < 0) {}
+    
+    //                             yyyy, mo, dd, hh, mm, ss
+    // pDataloggingShield->setClock(2020, 06, 11, 11, 07, 00);
+    pDataloggingShield->setClock(
+        setTime.year(),
+        setTime.month(),
+        setTime.day(),
+        setTime.hour(),
+        setTime.minute(),
+        setTime.second()
+    );
+    
+    pClockDiscipline->setReference(setTime.unixtime(), millis());
+    
+    // Sampling goes on through a day change, so the day file may be open
+    closeDayFile();
+    logClockSync(setTime);
 }
 
-// Read the analog inputs from the Mayhew Extended ADC Shield
+// Log the estimated drift and the residual error of the last sync
+void logClockSync(DateTime syncTime)
+{
+    char clockString[96];
+    char driftValue[10];
+    
+    dtostrf(pClockDiscipline->getDrift(), 4, 2, driftValue);
+    
+    snprintf_P(
+        clockString,
+        sizeof(clockString),
+        PSTR("Sync: %d/%d/%d %d:%d:%d, Offset: %ld ms, Drift: %s ppm, Residual: %ld ms"),
+        syncTime.year(),
+        syncTime.month(),
+        syncTime.day(),
+        syncTime.hour(),
+        syncTime.minute(),
+        syncTime.second(),
+        pClockDiscipline->getOffset(),
+        driftValue,
+        pClockDiscipline->getResidual()
+    );
+    
+    Serial.println(clockString);
+    pDataloggingShield->write(clockFilename, clockString);
+}
+
+// Read the analog inputs from the Mayhew Extended ADC Shields
 void readExtendedADCShield()
 {
     // Clean the collection string variable
     memset(collectionString, 0, sizeof(collectionString));
-                
-    for (byte i = 0; i < 8; i++) {
-        // Clean the channel variable
-        chX = 0;
-        tempVal = 0;
-        
-        /* The measurement of the Mayhew works by setting up one channel, and reading another.
-            
-            I'll use the following commands to explain:
-            
-            1 --> analogReadConfigNext(1, SINGLE_ENDED, UNIPOLAR, RANGE5V);
-            2 --> analogReadConfigNext(0, SINGLE_ENDED, UNIPOLAR, RANGE5V);
-            
-            Command 1 sets up channel 1 for reading, and reads the value of channel 0
-            Command 2 sets up channel 0 for reading, and reads the value of channel 7
-        */ 
-        
+    
+    // Sample every channel on every shield in one pass
+    sampleTime = millis();
+    pSampleAccounting->sample(sampleTime);
+    scanChannels();
+    
+    for (byte i = 0; i < settings.channels; i++) {
         // Multiply value by 100 000 to convert from float to long
-        if (i != collectionSize) {
-            tempVal = pExtendedADCShield->analogReadConfigNext((i + 1), SINGLE_ENDED, UNIPOLAR, RANGE5V);
-        } else {
-            tempVal = pExtendedADCShield->analogReadConfigNext(0, SINGLE_ENDED, UNIPOLAR, RANGE5V);
-        }
-        
-        chX = tempVal * 100000.0f;
+        chX = channelValues[i] * 100000.0f;
         
         // Convert int/char to string
         dtostrf(chX, 6, 0, chValue);
         
-        if (i == 0) {
-            // Copy the value into the collection string
-            strcpy(collectionString, chValue);
-        } else {
-            // Append the value to the current collection string
-            strcat(collectionString, chValue);
-        }        
-        
+        // Append the value to the current collection string
+        strcat(collectionString, chValue);
         strcat(collectionString, ",");
         
-        if (i == 1 || i == 3 || i == 7) {
+        if (settings.temperaturePins[i] != NO_PIN) {
             // Read the value from the associated analog pin
-            chX = analogRead(pins[i]);
+            chX = analogRead(settings.temperaturePins[i]);
             
             // Convert int/char to string
             dtostrf(chX, 6, 0, chValue);
@@ -309,93 +1242,190 @@ void readExtendedADCShield()
     }
     
     addDate();
+    addSequence();
     
     Serial.println(collectionString);
 }
 
+// Scan every channel, averaging as many scans as the oversampling setting asks for
+void scanChannels()
+{
+    float scanValues[NUMBER_CHANNELS];
+    
+    pExtendedADCShieldStack->scan(channelValues);
+    
+    if (settings.oversampling <= 1) {
+        return;
+    }
+    
+    for (byte n = 1; n < settings.oversampling; n++) {
+        pExtendedADCShieldStack->scan(scanValues);
+        
+        for (byte i = 0; i < NUMBER_CHANNELS; i++) {
+            channelValues[i] += scanValues[i];
+        }
+    }
+    
+    for (byte i = 0; i < NUMBER_CHANNELS; i++) {
+        channelValues[i] /= settings.oversampling;
+    }
+}
+
+// Write a completed burst capture to the burst file and report it
+void writeBurstCapture()
+{
+    Serial.print(F("--> Burst captured, latency "));
+    Serial.print(pBurstCapture->getTriggerLatency());
+    Serial.print(F(" us, rate "));
+    Serial.print(pBurstCapture->getCaptureRate());
+    Serial.print(F(" Hz, overruns "));
+    Serial.println(pBurstCapture->getOverruns());
+    
+    pSampleAccounting->beginActivity(CAUSE_SD);
+    closeDayFile();
+    
+    // The detector is armed again either way, the capture is counted in the trailer
+    if (!pBurstCapture->write(pDataloggingShield, burstFilename)) {
+        Serial.println(F("\n !!! Burst capture could not be written, dropped !!! \n"));
+        pSampleAccounting->captureDropped();
+    }
+    
+    pSampleAccounting->endActivity();
+}
+
 // Build the filename to be used for data upload
 void buildFilename()
 {
     Serial.println(F("\n --- Building Filename ---"));
-    delay(100);
     
     // Clean the filename variable
     memset(filename, 0, sizeof(filename));
     
-    snprintf(filename + strlen(filename),
+    snprintf_P(filename + strlen(filename),
         13 - strlen(filename),
-        "%s%02d%02d%02d.csv",
-        pSITE_CODE,
+        PSTR("%s%02d%02d%02d.csv"),
+        settings.siteCode,
         (pDataloggingShield->rtc.now().year() % 100),
         pDataloggingShield->rtc.now().month(),
         pDataloggingShield->rtc.now().day()
         //~ pDataloggingShield->rtc.now().minute()
     );
+    
+    // Burst captures go in a file with the same name and a different extension
+    strcpy(burstFilename, filename);
+    strcpy_P(strrchr(burstFilename, '.'), PSTR(".brs"));
 }
 
-// Build the heading to be used in each new file
+// Build the heading to be used in each new file.  The lines are built one at a time and
+// written straight to the file, so none of them is kept in memory between files.
 void buildHeading()
 {    
+    char line[headingSize];
+    
     Serial.println(F("\n --- Building Heading ---\n"));
-    delay(100);
     
-    buildTitleString();    
-    buildPositionString();
+    buildTitleString(line);
+    buildPositionString(line);
+    buildHeadingString(line);
+}
+
+// Build the column headings from the channel map
+void buildHeadingString(char* pLine)
+{
+    byte temperature = 0;
     
-    Serial.println(titleString);
-    Serial.println(positionString);
-    Serial.println(pHEADING_STRING);
+    // Clean the line
+    memset(pLine, 0, headingSize);
     
-    pDataloggingShield->write(filename, pHEADING_STRING);
+    for (byte i = 0; i < settings.channels; i++) {
+        snprintf_P(
+            pLine + strlen(pLine),
+            headingSize - strlen(pLine),
+            PSTR("ch%d,"),
+            (i + 1)
+        );
+        
+        if (settings.temperaturePins[i] != NO_PIN) {
+            temperature++;
+            
+            snprintf_P(
+                pLine + strlen(pLine),
+                headingSize - strlen(pLine),
+                PSTR("tp%d,"),
+                temperature
+            );
+        }
+    }
+    
+    strncat_P(pLine, PSTR("Year,Month,Day,Hour,Minutes,Seconds,Sequence,Interval"), headingSize - strlen(pLine) - 1);
+    
+    Serial.println(pLine);
+    pDataloggingShield->write(filename, pLine);
 }
 
-// Build the titleString
-void buildTitleString()
+// Build the site name heading
+void buildTitleString(char* pLine)
 {
-    // Clean the current titleString
-    memset(titleString, 0, sizeof(titleString));
-    
-    snprintf(
-        titleString + strlen(titleString),
-        50 - strlen(titleString),
-        "Site Name: %s",
-        pSITE_NAME
+    snprintf_P(
+        pLine,
+        headingSize,
+        PSTR("Site Name: %s"),
+        settings.siteName
     );
     
-    pDataloggingShield->write(filename, titleString);    
+    Serial.println(pLine);
+    pDataloggingShield->write(filename, pLine);    
 }
 
-// Build the Geo coordinates heading
-void buildPositionString()
+// Build the Geo coordinates heading.  The coordinates are written out as text straight
+// into the line, which has room for them (see headingSize).
+void buildPositionString(char* pLine)
 {    
-    // Clean the current positionString
-    memset(positionString, 0, sizeof(positionString));
-    
-    snprintf(
-        positionString,
-        positionSize - strlen(positionString),
-        "Latitude: %s, Longitude: %s, Altitude %s",
-        pBotletics_LTEGPS->getLatitudeStr(),
-        pBotletics_LTEGPS->getLongitudeStr(),
-        pBotletics_LTEGPS->getAltitudeStr()
-    );
+    strcpy_P(pLine, PSTR("Latitude: "));
+    pBotletics_LTEGPS->getLatitudeStr(pLine + strlen(pLine));
+    strcat_P(pLine, PSTR(", Longitude: "));
+    pBotletics_LTEGPS->getLongitudeStr(pLine + strlen(pLine));
+    strcat_P(pLine, PSTR(", Altitude "));
+    pBotletics_LTEGPS->getAltitudeStr(pLine + strlen(pLine));
     
-    pDataloggingShield->write(filename, positionString);
+    Serial.println(pLine);
+    pDataloggingShield->write(filename, pLine);
 }
 
-// Add the date to the measurement data
+// Add the date to the measurement data, corrected for the RTC drift and with the
+// milliseconds interpolated from the last RTC second edge
 void addDate()
 {    
-    snprintf(
+    unsigned long time;
+    int milliseconds;
+    
+    pClockDiscipline->stamp(pDataloggingShield->rtc.now().unixtime(), sampleTime, &time, &milliseconds);
+    
+    DateTime now(time);
+    
+    snprintf_P(
         collectionString + strlen(collectionString),
         stringSize - strlen(collectionString),
-        "%d,%d,%d,%d,%d,%d",
-        pDataloggingShield->rtc.now().year(),
-        pDataloggingShield->rtc.now().month(),
-        pDataloggingShield->rtc.now().day(),
-        pDataloggingShield->rtc.now().hour(),
-        pDataloggingShield->rtc.now().minute(),
-        pDataloggingShield->rtc.now().second()
+        PSTR("%d,%d,%d,%d,%d,%d.%03d"),
+        now.year(),
+        now.month(),
+        now.day(),
+        now.hour(),
+        now.minute(),
+        now.second(),
+        milliseconds
+    );
+}
+
+// Add the sequence number and the interval since the previous sample (ms)
+void addSequence()
+{
+    snprintf_P(
+        collectionString + strlen(collectionString),
+        stringSize - strlen(collectionString),
+        PSTR(",%lu,%lu"),
+        pSampleAccounting->getSequence(),
+        pSampleAccounting->getInterval()
     );
 }
 
@@ -0,0 +1,205 @@
+/*
+    Sample-loss and timing-jitter accounting for the radiometer sketch.
+
+    Program Description : Every sample gets a sequence number and the measured
+        interval since the previous sample.  Intervals that span more than one
+        sample slot count as missed slots, and intervals longer than the period
+        plus a tolerance count as late samples.  Work that can hold up sampling
+        (SD-card writes, modem sessions and the day rollover) is wrapped in
+        beginActivity()/endActivity(), and a missed slot or late sample is
+        blamed on whichever cause blocked the longest since the previous sample.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SampleAccounting.cpp
+*/
+
+#include "SampleAccounting.h"
+
+SampleAccounting::SampleAccounting(unsigned long period, unsigned long tolerance)
+{
+    this->period = period;
+    this->tolerance = tolerance;
+
+    memset(this->blocked, 0, sizeof(this->blocked));
+    this->reset();
+}
+
+SampleAccounting::~SampleAccounting() {}
+
+void SampleAccounting::beginActivity(byte cause)
+{
+    if (this->depth++ == 0) {
+        this->activeCause = cause;
+        this->activityStart = millis();
+    }
+}
+
+void SampleAccounting::endActivity()
+{
+    if (this->depth > 0 && --this->depth == 0) {
+        this->blocked[this->activeCause] += millis() - this->activityStart;
+    }
+}
+
+// The cause that blocked the longest since the last sample
+byte SampleAccounting::blame()
+{
+    byte cause = CAUSE_OTHER;
+
+    for (byte i = 1; i < NUMBER_CAUSES; i++) {
+        if (this->blocked[i] > this->blocked[cause]) {
+            cause = i;
+        }
+    }
+
+    return cause;
+}
+
+// Measure the interval since the last sample and count any slots it missed
+unsigned long SampleAccounting::sample(unsigned long now)
+{
+    this->sequence++;
+    this->samples++;
+
+    if (this->sampled) {
+        this->interval = now - this->lastSample;
+
+        // Number of sample slots the interval spans, to the nearest slot
+        unsigned long slots = (this->interval + (this->period / 2)) / this->period;
+        byte cause = this->blame();
+
+        if (slots > 1) {
+            this->missedSlots[cause] += slots - 1;
+        }
+
+        if (this->interval > this->period + this->tolerance) {
+            this->lateSamples[cause]++;
+        }
+
+        // Jitter is only meaningful between consecutive slots
+        if (slots <= 1) {
+            unsigned long jitter = (this->interval > this->period) ?
+                (this->interval - this->period) : (this->period - this->interval);
+
+            if (jitter > this->maxJitter) {
+                this->maxJitter = jitter;
+            }
+
+            this->totalJitter += jitter;
+            this->jitterSamples++;
+        }
+    } else {
+        this->interval = 0;
+        this->sampled = true;
+    }
+
+    this->lastSample = now;
+    memset(this->blocked, 0, sizeof(this->blocked));
+
+    return this->sequence;
+}
+
+void SampleAccounting::captureDropped()
+{
+    this->droppedCaptures++;
+}
+
+// Summary line written at the end of each day file
+void SampleAccounting::buildTrailer(char* pBuffer, int size)
+{
+    snprintf_P(
+        pBuffer,
+        size,
+        PSTR("Samples: %lu, Missed: %lu (SD %lu, Modem %lu, Rollover %lu, Other %lu), Late: %lu (SD %lu, Modem %lu, Rollover %lu, Other %lu), Jitter: %lu ms max, %lu ms mean, Bursts dropped: %lu"),
+        this->samples,
+        this->getMissedSlots(),
+        this->missedSlots[CAUSE_SD],
+        this->missedSlots[CAUSE_MODEM],
+        this->missedSlots[CAUSE_ROLLOVER],
+        this->missedSlots[CAUSE_OTHER],
+        this->getLateSamples(),
+        this->lateSamples[CAUSE_SD],
+        this->lateSamples[CAUSE_MODEM],
+        this->lateSamples[CAUSE_ROLLOVER],
+        this->lateSamples[CAUSE_OTHER],
+        this->maxJitter,
+        this->getMeanJitter(),
+        this->droppedCaptures
+    );
+}
+
+void SampleAccounting::reset()
+{
+    this->samples = 0;
+    memset(this->missedSlots, 0, sizeof(this->missedSlots));
+    memset(this->lateSamples, 0, sizeof(this->lateSamples));
+    this->maxJitter = 0;
+    this->totalJitter = 0;
+    this->jitterSamples = 0;
+    this->droppedCaptures = 0;
+}
+
+unsigned long SampleAccounting::total(unsigned long* pCounters)
+{
+    unsigned long sum = 0;
+
+    for (byte i = 0; i < NUMBER_CAUSES; i++) {
+        sum += pCounters[i];
+    }
+
+    return sum;
+}
+
+unsigned long SampleAccounting::getSequence()
+{
+    return this->sequence;
+}
+
+unsigned long SampleAccounting::getInterval()
+{
+    return this->interval;
+}
+
+unsigned long SampleAccounting::getSamples()
+{
+    return this->samples;
+}
+
+unsigned long SampleAccounting::getMissedSlots()
+{
+    return this->total(this->missedSlots);
+}
+
+unsigned long SampleAccounting::getMissedSlots(byte cause)
+{
+    return this->missedSlots[cause];
+}
+
+unsigned long SampleAccounting::getLateSamples()
+{
+    return this->total(this->lateSamples);
+}
+
+unsigned long SampleAccounting::getLateSamples(byte cause)
+{
+    return this->lateSamples[cause];
+}
+
+unsigned long SampleAccounting::getMaxJitter()
+{
+    return this->maxJitter;
+}
+
+unsigned long SampleAccounting::getMeanJitter()
+{
+    return this->jitterSamples ? (this->totalJitter / this->jitterSamples) : 0;
+}
+
+unsigned long SampleAccounting::getDroppedCaptures()
+{
+    return this->droppedCaptures;
+}
@@ -0,0 +1,102 @@
+/*
+    Sample-loss and timing-jitter accounting for the radiometer sketch.
+
+    Program Description : Every sample gets a sequence number and the measured
+        interval since the previous sample.  Intervals that span more than one
+        sample slot count as missed slots, and intervals longer than the period
+        plus a tolerance count as late samples.  Work that can hold up sampling
+        (SD-card writes, modem sessions and the day rollover) is wrapped in
+        beginActivity()/endActivity(), and a missed slot or late sample is
+        blamed on whichever cause blocked the longest since the previous sample.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SampleAccounting.h
+*/
+
+#ifndef SampleAccounting_h
+#define SampleAccounting_h
+
+#include <Arduino.h>
+
+// Causes a sample can be held up by
+#define CAUSE_OTHER 0
+#define CAUSE_SD 1
+#define CAUSE_MODEM 2
+#define CAUSE_ROLLOVER 3
+#define NUMBER_CAUSES 4
+
+class SampleAccounting
+{
+public:
+    SampleAccounting(unsigned long period, unsigned long tolerance);
+    ~SampleAccounting();
+
+    //// Activity Tracking
+    //// Methods
+    // Mark blocking work.  Nested activities are counted against the outer cause.
+    void beginActivity(byte cause);
+    void endActivity();
+
+    //// Sample Tracking
+    // Account for a sample taken at millis() now.  Returns its sequence number.
+    unsigned long sample(unsigned long now);
+
+    // A burst capture could not be written and was lost
+    void captureDropped();
+
+    // Write a one line summary of the counters to pBuffer
+    void buildTrailer(char* pBuffer, int size);
+
+    // Clear the counters, the sequence number keeps counting
+    void reset();
+
+    //// Getters
+    unsigned long getSequence();
+    unsigned long getInterval();
+    unsigned long getSamples();
+    unsigned long getMissedSlots();
+    unsigned long getMissedSlots(byte cause);
+    unsigned long getLateSamples();
+    unsigned long getLateSamples(byte cause);
+    // Largest and average difference between an interval and the period (ms)
+    unsigned long getMaxJitter();
+    unsigned long getMeanJitter();
+    unsigned long getDroppedCaptures();
+
+private:
+    //// VARIABLES
+    unsigned long period = 1000;
+    unsigned long tolerance = 0;
+
+    // Last sample
+    bool sampled = false;
+    unsigned long sequence = 0;
+    unsigned long lastSample = 0;
+    unsigned long interval = 0;
+
+    // Current activity
+    byte depth = 0;
+    byte activeCause = CAUSE_OTHER;
+    unsigned long activityStart = 0;
+
+    // Time each cause has blocked since the last sample (ms)
+    unsigned long blocked[NUMBER_CAUSES];
+
+    // Counters since the last reset
+    unsigned long samples = 0;
+    unsigned long missedSlots[NUMBER_CAUSES];
+    unsigned long lateSamples[NUMBER_CAUSES];
+    unsigned long maxJitter = 0;
+    unsigned long totalJitter = 0;
+    unsigned long jitterSamples = 0;
+    unsigned long droppedCaptures = 0;
+
+    //// METHODS
+    byte blame();
+    unsigned long total(unsigned long* pCounters);
+};
+#endif // SampleAccounting_h
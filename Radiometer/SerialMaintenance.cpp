@@ -0,0 +1,219 @@
+/*
+    Serial maintenance mode for pulling files off the SD card over USB.
+
+    Program Description : At boot the sketch listens on the serial port for a
+        short window.  A host that sends "MAINT" puts the logger into
+        maintenance mode, where the baud rate is raised and the host can list
+        the files on the card and fetch them.  Files are sent in 128 byte
+        blocks, each with a block number and a CRC-16, and a block is sent
+        again until the host acknowledges it (XMODEM-CRC).  tools/radiodump is
+        the host side.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SerialMaintenance.cpp
+*/
+
+#include "SerialMaintenance.h"
+
+SerialMaintenance::SerialMaintenance(HardwareSerial* pSerial, const int* pBaud, AdafruitDataloggingShield* pDataloggingShield)
+{
+    this->pSerial = pSerial;
+    this->pBaud = pBaud;
+    this->pDataloggingShield = pDataloggingShield;
+}
+
+SerialMaintenance::~SerialMaintenance() {}
+
+bool SerialMaintenance::requested(unsigned long window)
+{
+    char command[8];
+    unsigned long startTime = millis();
+    unsigned long elapsed;
+    
+    this->pSerial->println(F("\n --- Send MAINT for maintenance mode ---"));
+    
+    while ((elapsed = millis() - startTime) < window) {
+        if (this->readLine(command, sizeof(command), window - elapsed) &&
+            strcmp_P(command, PSTR("MAINT")) == 0) {
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void SerialMaintenance::run()
+{
+    char command[24];
+    
+    // Tell the host the new rate before switching to it
+    this->pSerial->print(F("MAINT "));
+    this->pSerial->println((unsigned long)MAINTENANCE_BAUD);
+    this->pSerial->flush();
+    this->pSerial->begin(MAINTENANCE_BAUD);
+    
+    while (this->readLine(command, sizeof(command), MAINTENANCE_IDLE_TIMEOUT)) {
+        if (strcmp_P(command, PSTR("LIST")) == 0) {
+            this->pDataloggingShield->list(this->pSerial);
+            this->pSerial->println(F("END"));
+        } else if (strncmp_P(command, PSTR("GET "), 4) == 0) {
+            this->send(command + 4);
+        } else if (strcmp_P(command, PSTR("EXIT")) == 0) {
+            break;
+        } else if (command[0] != '\0') {
+            this->pSerial->println(F("ERR"));
+        }
+    }
+    
+    this->pSerial->println(F("BYE"));
+    this->pSerial->flush();
+    this->pSerial->begin(*this->pBaud);
+}
+
+// Read a line, without the line ending
+bool SerialMaintenance::readLine(char* pBuffer, byte size, unsigned long timeout)
+{
+    byte length = 0;
+    int c;
+    
+    while ((c = this->readByte(timeout)) >= 0) {
+        if (c == '\n') {
+            pBuffer[length] = '\0';
+            
+            return true;
+        }
+        
+        if (c != '\r' && length < size - 1) {
+            pBuffer[length++] = (char)c;
+        }
+    }
+    
+    pBuffer[length] = '\0';
+    
+    return false;
+}
+
+int SerialMaintenance::readByte(unsigned long timeout)
+{
+    unsigned long startTime = millis();
+    
+    while (!this->pSerial->available()) {
+        if (millis() - startTime >= timeout) {
+            return -1;
+        }
+    }
+    
+    return this->pSerial->read();
+}
+
+// Send a file once the host asks for it with a 'C'
+bool SerialMaintenance::send(char* filename)
+{
+    byte block[XMODEM_BLOCK_SIZE];
+    byte number = 1;
+    uint32_t offset = 0;
+    
+    if (!this->pDataloggingShield->openForUpdate(filename, true)) {
+        this->pSerial->println(F("ERR"));
+        
+        return false;
+    }
+    
+    uint32_t size = this->pDataloggingShield->getOpenFileSize();
+    
+    this->pSerial->print(F("OK "));
+    this->pSerial->println((unsigned long)size);
+    
+    // The host is ready once it asks for CRC blocks
+    int c;
+    
+    do {
+        c = this->readByte(MAINTENANCE_BLOCK_TIMEOUT * MAINTENANCE_RETRIES);
+    } while (c >= 0 && c != XMODEM_CRC && c != XMODEM_CAN);
+    
+    bool sent = (c == XMODEM_CRC);
+    
+    while (sent && offset < size) {
+        int length = this->pDataloggingShield->readAt(offset, (char*)block, XMODEM_BLOCK_SIZE);
+        
+        if (length <= 0) {
+            sent = false;
+            
+            break;
+        }
+        
+        // The last block is padded out to full size, the host cuts it back using the size
+        memset(block + length, XMODEM_PAD, XMODEM_BLOCK_SIZE - length);
+        
+        sent = this->sendBlock(number++, block);
+        offset += length;
+    }
+    
+    this->pDataloggingShield->closeUpdate();
+    
+    if (!sent) {
+        this->pSerial->write(XMODEM_CAN);
+        this->pSerial->write(XMODEM_CAN);
+        
+        return false;
+    }
+    
+    for (byte retry = 0; retry < MAINTENANCE_RETRIES; retry++) {
+        this->pSerial->write(XMODEM_EOT);
+        
+        if (this->readByte(MAINTENANCE_BLOCK_TIMEOUT) == XMODEM_ACK) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Send a block until the host acknowledges it
+bool SerialMaintenance::sendBlock(byte number, byte* pBlock)
+{
+    uint16_t crc = updateCrc16(0, pBlock, XMODEM_BLOCK_SIZE);
+    
+    for (byte retry = 0; retry < MAINTENANCE_RETRIES; retry++) {
+        this->pSerial->write(XMODEM_SOH);
+        this->pSerial->write(number);
+        this->pSerial->write((byte)~number);
+        this->pSerial->write(pBlock, XMODEM_BLOCK_SIZE);
+        this->pSerial->write((byte)(crc >> 8));
+        this->pSerial->write((byte)(crc & 0xFF));
+        
+        // Anything other than an answer (a 'C' sent before the first block arrived, line
+        // noise) is skipped until the block times out.  The elapsed time is checked before
+        // the time left is worked out, so it can not wrap round to a huge timeout.
+        unsigned long startTime = millis();
+        
+        for (;;) {
+            unsigned long elapsed = millis() - startTime;
+            
+            if (elapsed >= MAINTENANCE_BLOCK_TIMEOUT) {
+                break;
+            }
+            
+            int c = this->readByte(MAINTENANCE_BLOCK_TIMEOUT - elapsed);
+            
+            if (c < 0 || c == XMODEM_NAK) {
+                break;
+            }
+            
+            if (c == XMODEM_ACK) {
+                return true;
+            }
+            
+            if (c == XMODEM_CAN) {
+                return false;
+            }
+        }
+    }
+    
+    return false;
+}
@@ -0,0 +1,77 @@
+/*
+    Serial maintenance mode for pulling files off the SD card over USB.
+
+    Program Description : At boot the sketch listens on the serial port for a
+        short window.  A host that sends "MAINT" puts the logger into
+        maintenance mode, where the baud rate is raised and the host can list
+        the files on the card and fetch them.  Files are sent in 128 byte
+        blocks, each with a block number and a CRC-16, and a block is sent
+        again until the host acknowledges it (XMODEM-CRC).  tools/radiodump is
+        the host side.
+
+        Commands, one per line:
+            LIST        "NAME SIZE" for every file, then "END"
+            GET NAME    "OK SIZE" and the file, or "ERR"
+            EXIT        "BYE", then logging starts
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SerialMaintenance.h
+*/
+
+#ifndef SerialMaintenance_h
+#define SerialMaintenance_h
+
+#include <Arduino.h>
+#include "AdafruitDataloggingShield.h"
+#include "Crc16.h"
+
+// Baud rate used while in maintenance mode
+#define MAINTENANCE_BAUD 115200
+
+// How long a block can wait for an answer, and how often it is sent before giving up
+#define MAINTENANCE_BLOCK_TIMEOUT 2000
+#define MAINTENANCE_RETRIES 10
+
+// Maintenance mode ends if the host goes quiet for this long (ms)
+#define MAINTENANCE_IDLE_TIMEOUT 300000
+
+// Block framing
+#define XMODEM_BLOCK_SIZE 128
+#define XMODEM_SOH 0x01
+#define XMODEM_EOT 0x04
+#define XMODEM_ACK 0x06
+#define XMODEM_NAK 0x15
+#define XMODEM_CAN 0x18
+#define XMODEM_CRC 'C'
+#define XMODEM_PAD 0x1A
+
+class SerialMaintenance
+{
+public:
+    SerialMaintenance(HardwareSerial* pSerial, const int* pBaud, AdafruitDataloggingShield* pDataloggingShield);
+    ~SerialMaintenance();
+
+    //// Methods
+    // Listen for "MAINT" for window milliseconds
+    bool requested(unsigned long window);
+
+    // Answer commands at the maintenance baud rate until the host sends EXIT
+    void run();
+
+private:
+    //// VARIABLES
+    HardwareSerial* pSerial = nullptr;
+    const int* pBaud = nullptr;
+    AdafruitDataloggingShield* pDataloggingShield = nullptr;
+
+    //// METHODS
+    bool readLine(char* pBuffer, byte size, unsigned long timeout);
+    int readByte(unsigned long timeout);
+    bool send(char* filename);
+    bool sendBlock(byte number, byte* pBlock);
+};
+#endif // SerialMaintenance_h
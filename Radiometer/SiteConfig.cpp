@@ -0,0 +1,329 @@
+/*
+    Site settings read from the SD card at boot.
+
+    Program Description : CONFIG.TXT holds one "key=value" setting per line,
+        with "#" starting a comment.  It is read once at boot into a static
+        SiteSettings struct, with no heap, so a campaign can change the sample
+        rate, the channel map, the oversampling, the flush policy or the
+        upload settings by swapping a file instead of reflashing every unit.
+        Every setting starts from the built-in default.  A setting with an
+        unknown key or a value out of range is reported and keeps its
+        default, and settings that do not fit together fall back to theirs.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SiteConfig.cpp
+*/
+
+#include "SiteConfig.h"
+#include "UploadManifest.h"
+
+SiteConfig::SiteConfig(SiteSettings* pSettings, HardwareSerial* pSerial, byte numberChannels)
+{
+    this->pSettings = pSettings;
+    this->pSerial = pSerial;
+    this->numberChannels = min(numberChannels, (byte)CONFIG_MAX_CHANNELS);
+}
+
+SiteConfig::~SiteConfig() {}
+
+void SiteConfig::loadDefaults(const SiteSettings* pDefaults)
+{
+    memcpy_P(this->pSettings, pDefaults, sizeof(SiteSettings));
+}
+
+bool SiteConfig::set(char* pKey, char* pValue)
+{
+    SiteSettings* pSettings = this->pSettings;
+    long number;
+    bool valid;
+
+    if (strcmp_P(pKey, PSTR("site")) == 0) {
+        valid = this->copyString(pValue, pSettings->siteName, CONFIG_NAME_SIZE);
+    } else if (strcmp_P(pKey, PSTR("code")) == 0) {
+        // The code is the start of every 8.3 file name
+        valid = strlen(pValue) == CONFIG_CODE_SIZE - 1 && isalnum(pValue[0]) && isalnum(pValue[1]);
+
+        if (valid) {
+            strcpy(pSettings->siteCode, pValue);
+        }
+    } else if (strcmp_P(pKey, PSTR("period")) == 0) {
+        valid = this->parseNumber(pValue, CONFIG_MIN_PERIOD, CONFIG_MAX_PERIOD, &number);
+
+        if (valid) {
+            pSettings->samplePeriod = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("tolerance")) == 0) {
+        valid = this->parseNumber(pValue, 1, CONFIG_MAX_PERIOD, &number);
+
+        if (valid) {
+            pSettings->sampleTolerance = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("oversample")) == 0) {
+        valid = this->parseNumber(pValue, 1, CONFIG_MAX_OVERSAMPLING, &number);
+
+        if (valid) {
+            pSettings->oversampling = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("flush")) == 0) {
+        valid = this->parseNumber(pValue, 1, CONFIG_MAX_FLUSH, &number);
+
+        if (valid) {
+            pSettings->flushEvery = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("journal")) == 0) {
+        valid = true;
+
+        if (strcmp_P(pValue, PSTR("on")) == 0) {
+            pSettings->journal = true;
+        } else if (strcmp_P(pValue, PSTR("off")) == 0) {
+            pSettings->journal = false;
+        } else {
+            valid = false;
+        }
+    } else if (strcmp_P(pKey, PSTR("channels")) == 0) {
+        valid = this->parseNumber(pValue, 1, this->numberChannels, &number);
+
+        if (valid) {
+            pSettings->channels = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("temperature")) == 0) {
+        valid = this->parsePins(pValue);
+    } else if (strcmp_P(pKey, PSTR("server")) == 0) {
+        valid = this->copyString(pValue, pSettings->server, CONFIG_SERVER_SIZE);
+    } else if (strcmp_P(pKey, PSTR("port")) == 0) {
+        valid = this->parseNumber(pValue, 1, 65535, &number);
+
+        if (valid) {
+            pSettings->serverPort = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("user")) == 0) {
+        valid = this->copyString(pValue, pSettings->username, CONFIG_LOGIN_SIZE);
+    } else if (strcmp_P(pKey, PSTR("password")) == 0) {
+        valid = this->copyString(pValue, pSettings->password, CONFIG_LOGIN_SIZE);
+    } else if (strcmp_P(pKey, PSTR("policy")) == 0) {
+        valid = true;
+
+        if (strcmp_P(pValue, PSTR("oldest")) == 0) {
+            pSettings->uploadPolicy = UPLOAD_OLDEST_FIRST;
+        } else if (strcmp_P(pValue, PSTR("newest")) == 0) {
+            pSettings->uploadPolicy = UPLOAD_NEWEST_FIRST;
+        } else {
+            valid = false;
+        }
+    } else if (strcmp_P(pKey, PSTR("budget")) == 0) {
+        valid = this->parseNumber(pValue, 1, 0x7FFFFFFF, &number);
+
+        if (valid) {
+            pSettings->uploadBudgetBytes = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("budgettime")) == 0) {
+        valid = this->parseNumber(pValue, 1000, 0x7FFFFFFF, &number);
+
+        if (valid) {
+            pSettings->uploadBudgetTime = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("minrssi")) == 0) {
+        valid = this->parseNumber(pValue, -115, -52, &number);
+
+        if (valid) {
+            pSettings->uploadMinRssi = number;
+        }
+    } else if (strcmp_P(pKey, PSTR("deferrals")) == 0) {
+        valid = this->parseNumber(pValue, 0, 255, &number);
+
+        if (valid) {
+            pSettings->uploadMaxDeferrals = number;
+        }
+    } else {
+        valid = false;
+    }
+
+    if (!valid) {
+        this->reject(pKey, pValue);
+    }
+
+    return valid;
+}
+
+byte SiteConfig::validate(const SiteSettings* pDefaults)
+{
+    SiteSettings* pSettings = this->pSettings;
+    byte fixed = 0;
+
+    // A sample can not be late by more than the time to the next one
+    if (pSettings->sampleTolerance >= pSettings->samplePeriod) {
+        pSettings->sampleTolerance = pSettings->samplePeriod / 20;
+        fixed++;
+    }
+
+    // Records held back from the card are lost with the power, so hold a minute at most
+    if ((unsigned long)pSettings->flushEvery * pSettings->samplePeriod > 60000) {
+        pSettings->flushEvery = max(60000 / pSettings->samplePeriod, 1UL);
+        fixed++;
+    }
+
+    // The record buffers only have room for so many temperatures
+    if (this->countTemperatures() > CONFIG_MAX_TEMPERATURES) {
+        memcpy_P(pSettings->temperaturePins, pDefaults->temperaturePins, CONFIG_MAX_CHANNELS);
+        fixed++;
+    }
+
+    if (fixed > 0) {
+        this->pSerial->print(F("\n      Settings that did not fit together were adjusted: "));
+        this->pSerial->println(fixed);
+    }
+
+    this->errors += fixed;
+
+    return fixed;
+}
+
+byte SiteConfig::getErrors()
+{
+    return this->errors;
+}
+
+// Written in the same form as the file, so it can be copied into one
+void SiteConfig::print(Print* pPrint)
+{
+    SiteSettings* pSettings = this->pSettings;
+
+    pPrint->print(F("site="));
+    pPrint->println(pSettings->siteName);
+    pPrint->print(F("code="));
+    pPrint->println(pSettings->siteCode);
+    pPrint->print(F("period="));
+    pPrint->println(pSettings->samplePeriod);
+    pPrint->print(F("tolerance="));
+    pPrint->println(pSettings->sampleTolerance);
+    pPrint->print(F("oversample="));
+    pPrint->println(pSettings->oversampling);
+    pPrint->print(F("flush="));
+    pPrint->println(pSettings->flushEvery);
+    pPrint->print(F("journal="));
+    pPrint->println(pSettings->journal ? F("on") : F("off"));
+    pPrint->print(F("channels="));
+    pPrint->println(pSettings->channels);
+    pPrint->print(F("temperature="));
+
+    for (byte i = 0; i < pSettings->channels; i++) {
+        if (i > 0) {
+            pPrint->print(',');
+        }
+
+        if (pSettings->temperaturePins[i] == CONFIG_NO_PIN) {
+            pPrint->print('-');
+        } else {
+            pPrint->print('A');
+            pPrint->print(pSettings->temperaturePins[i] - A0);
+        }
+    }
+
+    pPrint->println();
+    pPrint->print(F("server="));
+    pPrint->println(pSettings->server);
+    pPrint->print(F("port="));
+    pPrint->println(pSettings->serverPort);
+    pPrint->print(F("user="));
+    pPrint->println(pSettings->username);
+    pPrint->print(F("policy="));
+    pPrint->println(pSettings->uploadPolicy == UPLOAD_NEWEST_FIRST ? F("newest") : F("oldest"));
+    pPrint->print(F("budget="));
+    pPrint->println(pSettings->uploadBudgetBytes);
+    pPrint->print(F("budgettime="));
+    pPrint->println(pSettings->uploadBudgetTime);
+    pPrint->print(F("minrssi="));
+    pPrint->println(pSettings->uploadMinRssi);
+    pPrint->print(F("deferrals="));
+    pPrint->println(pSettings->uploadMaxDeferrals);
+}
+
+// A whole decimal number in range, nothing else on the line
+bool SiteConfig::parseNumber(char* pValue, long minimum, long maximum, long* pNumber)
+{
+    char* pEnd;
+
+    if (*pValue == '\0') {
+        return false;
+    }
+
+    *pNumber = strtol(pValue, &pEnd, 10);
+
+    return *pEnd == '\0' && *pNumber >= minimum && *pNumber <= maximum;
+}
+
+// Strings that do not fit are rejected rather than cut short
+bool SiteConfig::copyString(char* pValue, char* pDestination, byte size)
+{
+    if (strlen(pValue) >= size) {
+        return false;
+    }
+
+    strcpy(pDestination, pValue);
+
+    return true;
+}
+
+// One entry per channel, "-" for none or the analog pin, such as "-,A0,-,A1".  Channels
+// left off the end have no temperature.
+bool SiteConfig::parsePins(char* pValue)
+{
+    byte pins[CONFIG_MAX_CHANNELS];
+    byte count = 0;
+    char* pEntry = pValue;
+
+    memset(pins, CONFIG_NO_PIN, sizeof(pins));
+
+    while (*pEntry != '\0') {
+        char* pComma = strchr(pEntry, ',');
+        byte length = pComma ? (pComma - pEntry) : strlen(pEntry);
+
+        if (count >= this->numberChannels) {
+            return false;
+        }
+
+        if (length == 1 && pEntry[0] == '-') {
+            pins[count] = CONFIG_NO_PIN;
+        } else if (length == 2 && pEntry[0] == 'A' && isdigit(pEntry[1])) {
+            pins[count] = A0 + (pEntry[1] - '0');
+        } else {
+            return false;
+        }
+
+        count++;
+        pEntry += pComma ? length + 1 : length;
+    }
+
+    memcpy(this->pSettings->temperaturePins, pins, sizeof(pins));
+
+    return true;
+}
+
+// Temperatures paired with the channels that are recorded
+byte SiteConfig::countTemperatures()
+{
+    byte count = 0;
+
+    for (byte i = 0; i < this->pSettings->channels; i++) {
+        if (this->pSettings->temperaturePins[i] != CONFIG_NO_PIN) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void SiteConfig::reject(char* pKey, char* pValue)
+{
+    this->errors++;
+
+    this->pSerial->print(F("\n      !!! Ignoring setting "));
+    this->pSerial->print(pKey);
+    this->pSerial->print('=');
+    this->pSerial->print(pValue);
+    this->pSerial->println(F(" !!!"));
+}
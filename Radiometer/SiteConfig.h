@@ -0,0 +1,127 @@
+/*
+    Site settings read from the SD card at boot.
+
+    Program Description : CONFIG.TXT holds one "key=value" setting per line,
+        with "#" starting a comment.  It is read once at boot into a static
+        SiteSettings struct, with no heap, so a campaign can change the sample
+        rate, the channel map, the oversampling, the flush policy or the
+        upload settings by swapping a file instead of reflashing every unit.
+        Every setting starts from the built-in default.  A setting with an
+        unknown key or a value out of range is reported and keeps its
+        default, and settings that do not fit together fall back to theirs.
+        The keys are the ones print() writes at boot: site, code, period,
+        tolerance, oversample, flush, journal, channels, temperature, server,
+        port, user, password, policy, budget, budgettime, minrssi and
+        deferrals.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SiteConfig.h
+*/
+
+#ifndef SiteConfig_h
+#define SiteConfig_h
+
+#include <Arduino.h>
+
+// Name of the settings file on the SD card, and the longest line read from it
+#define CONFIG_FILENAME "CONFIG.TXT"
+#define CONFIG_LINE_SIZE 64
+
+// String sizes, including the terminator
+#define CONFIG_NAME_SIZE 21
+#define CONFIG_CODE_SIZE 3
+#define CONFIG_SERVER_SIZE 24
+#define CONFIG_LOGIN_SIZE 17
+
+// Channels the map can describe (two stacked ADC shields), and temperature columns the
+// record buffers are sized for
+#define CONFIG_MAX_CHANNELS 16
+#define CONFIG_MAX_TEMPERATURES 4
+#define CONFIG_NO_PIN 0xFF
+
+// Limits of the sample settings
+#define CONFIG_MIN_PERIOD 250
+#define CONFIG_MAX_PERIOD 3600000
+#define CONFIG_MAX_OVERSAMPLING 16
+#define CONFIG_MAX_FLUSH 60
+
+struct SiteSettings
+{
+    // Site name for the day file heading, and the 2 character code the file names start with
+    char siteName[CONFIG_NAME_SIZE];
+    char siteCode[CONFIG_CODE_SIZE];
+
+    // Sample interval, and how late a sample can be before it is counted as late (ms)
+    unsigned long samplePeriod;
+    unsigned long sampleTolerance;
+
+    // ADC scans averaged into every sample, and samples written to the SD card at a time
+    byte oversampling;
+    byte flushEvery;
+
+    // Whether the samples written at a time go in a journal block that survives a power cut.
+    // The journal adds #B, #C and #R lines to the day file, which plain CSV readers do not
+    // expect, so it is off unless CONFIG.TXT turns it on.
+    byte journal;
+
+    // Channels recorded, and the analog pin of the temperature that follows each one
+    byte channels;
+    byte temperaturePins[CONFIG_MAX_CHANNELS];
+
+    // FTP server
+    char server[CONFIG_SERVER_SIZE];
+    uint16_t serverPort;
+    char username[CONFIG_LOGIN_SIZE];
+    char password[CONFIG_LOGIN_SIZE];
+
+    // Upload order and session budget, the weakest signal an upload goes ahead at (dBm)
+    // and the attempts that can be put off in a row
+    byte uploadPolicy;
+    unsigned long uploadBudgetBytes;
+    unsigned long uploadBudgetTime;
+    int8_t uploadMinRssi;
+    byte uploadMaxDeferrals;
+};
+
+class SiteConfig
+{
+public:
+    SiteConfig(SiteSettings* pSettings, HardwareSerial* pSerial, byte numberChannels);
+    ~SiteConfig();
+
+    //// Methods
+    // Start from the built-in settings, held in program memory
+    void loadDefaults(const SiteSettings* pDefaults);
+
+    // Apply one setting.  Returns false if the key is unknown or the value is out of range,
+    // in which case the setting is left as it was.
+    bool set(char* pKey, char* pValue);
+
+    // Put back the defaults of settings that do not fit together.  Returns the number of
+    // settings put back.
+    byte validate(const SiteSettings* pDefaults);
+
+    // Settings rejected by set() and validate()
+    byte getErrors();
+
+    void print(Print* pPrint);
+
+private:
+    //// VARIABLES
+    SiteSettings* pSettings = nullptr;
+    HardwareSerial* pSerial = nullptr;
+    byte numberChannels = 0;
+    byte errors = 0;
+
+    //// METHODS
+    bool parseNumber(char* pValue, long minimum, long maximum, long* pNumber);
+    bool copyString(char* pValue, char* pDestination, byte size);
+    bool parsePins(char* pValue);
+    byte countTemperatures();
+    void reject(char* pKey, char* pValue);
+};
+#endif // SiteConfig_h
@@ -0,0 +1,70 @@
+/*
+    Modem link over SoftwareSerial, for boards without a spare hardware UART.
+
+    Program Description : SoftwareSerial samples the receive pin in a pin
+        change interrupt with interrupts disabled for the whole byte, so it
+        only keeps up with the modem at 9600 baud and holds up every other
+        interrupt while a byte comes in.  This is the link used on the Uno,
+        where the only hardware UART is taken by USB.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SoftwareSerialTransport.cpp
+*/
+
+#include "SoftwareSerialTransport.h"
+
+SoftwareSerialTransport::SoftwareSerialTransport(uint8_t receivePin, uint8_t transmitPin)
+{
+    this->pSerial = new SoftwareSerial(receivePin, transmitPin);
+}
+
+SoftwareSerialTransport::~SoftwareSerialTransport() {}
+
+void SoftwareSerialTransport::begin(unsigned long baud)
+{
+    this->pSerial->begin(baud);
+}
+
+void SoftwareSerialTransport::end()
+{
+    this->pSerial->end();
+}
+
+// SoftwareSerial only keeps a flag, so count each time it is found set
+int SoftwareSerialTransport::available()
+{
+    if (this->pSerial->overflow()) {
+        this->overflows++;
+    }
+
+    return this->pSerial->available();
+}
+
+int SoftwareSerialTransport::read()
+{
+    return this->pSerial->read();
+}
+
+int SoftwareSerialTransport::peek()
+{
+    return this->pSerial->peek();
+}
+
+size_t SoftwareSerialTransport::write(uint8_t c)
+{
+    return this->pSerial->write(c);
+}
+
+unsigned long SoftwareSerialTransport::getMaxBaud()
+{
+    return SOFTWARE_SERIAL_MAX_BAUD;
+}
+
+unsigned long SoftwareSerialTransport::getOverflows()
+{
+    return this->overflows;
+}
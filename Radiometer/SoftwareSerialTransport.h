@@ -0,0 +1,53 @@
+/*
+    Modem link over SoftwareSerial, for boards without a spare hardware UART.
+
+    Program Description : SoftwareSerial samples the receive pin in a pin
+        change interrupt with interrupts disabled for the whole byte, so it
+        only keeps up with the modem at 9600 baud and holds up every other
+        interrupt while a byte comes in.  This is the link used on the Uno,
+        where the only hardware UART is taken by USB.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SoftwareSerialTransport.h
+*/
+
+#ifndef SoftwareSerialTransport_h
+#define SoftwareSerialTransport_h
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+#include "ModemTransport.h"
+
+// Fastest rate SoftwareSerial receives reliably at on a 16 MHz AVR
+#define SOFTWARE_SERIAL_MAX_BAUD 9600
+
+class SoftwareSerialTransport : public ModemTransport
+{
+public:
+    SoftwareSerialTransport(uint8_t receivePin, uint8_t transmitPin);
+    ~SoftwareSerialTransport();
+
+    //// Methods
+    void begin(unsigned long baud);
+    void end();
+
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t c);
+    using Print::write;
+
+    //// Getters
+    unsigned long getMaxBaud();
+    unsigned long getOverflows();
+
+private:
+    //// VARIABLES
+    SoftwareSerial* pSerial = nullptr;
+    unsigned long overflows = 0;
+};
+#endif // SoftwareSerialTransport_h
@@ -0,0 +1,159 @@
+/*
+    Modem link over the second hardware UART (USART1).
+
+    Program Description : On boards with a spare hardware UART (the Mega's
+        Serial1 on pins 18/19, or the 32U4's on pins 0/1) the modem is wired
+        to it and runs at 115200 baud.  The receive and transmit interrupts
+        move bytes through ring buffers, so nothing waits on the line and no
+        other interrupt is held up.  The shield's TX/RX jumpers have to be
+        wired to the UART pins instead of pins 10/11.  These interrupts take
+        the place of the Arduino core's, so the sketch must not use Serial1.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : UartTransport.cpp
+*/
+
+#include "UartTransport.h"
+
+#if defined(UBRR1H)
+
+#include <util/atomic.h>
+
+// Ring buffers shared with the interrupts.  The interrupt only moves its own end.
+static volatile uint8_t rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8_t rxHead = 0;
+static volatile uint8_t rxTail = 0;
+static volatile unsigned long rxOverflows = 0;
+
+static volatile uint8_t txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint8_t txHead = 0;
+static volatile uint8_t txTail = 0;
+
+// A byte has arrived.  Reading UDR1 clears the interrupt, even if the byte is dropped.
+ISR(USART1_RX_vect)
+{
+    uint8_t c = UDR1;
+    uint8_t next = (rxHead + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+    if (next == rxTail) {
+        rxOverflows++;
+
+        return;
+    }
+
+    rxBuffer[rxHead] = c;
+    rxHead = next;
+}
+
+// The transmitter can take the next byte
+ISR(USART1_UDRE_vect)
+{
+    if (txHead == txTail) {
+        UCSR1B &= ~_BV(UDRIE1);
+
+        return;
+    }
+
+    UDR1 = txBuffer[txTail];
+    txTail = (txTail + 1) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+UartTransport::UartTransport() {}
+
+UartTransport::~UartTransport() {}
+
+void UartTransport::begin(unsigned long baud)
+{
+    // Double speed mode, as HardwareSerial uses: 2.1% error at 115200 from 16 MHz
+    uint16_t setting = (F_CPU / 4 / baud - 1) / 2;
+
+    this->end();
+
+    rxHead = 0;
+    rxTail = 0;
+    txHead = 0;
+    txTail = 0;
+
+    UCSR1A = _BV(U2X1);
+    UBRR1H = setting >> 8;
+    UBRR1L = setting;
+    UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);     // 8 data bits, no parity, 1 stop bit
+    UCSR1B = _BV(RXEN1) | _BV(TXEN1) | _BV(RXCIE1);
+}
+
+// Let the last bytes out before the UART is turned off
+void UartTransport::end()
+{
+    if (UCSR1B & _BV(TXEN1)) {
+        while (txHead != txTail) {}
+        while (!(UCSR1A & _BV(UDRE1))) {}
+    }
+
+    UCSR1B = 0;
+}
+
+int UartTransport::available()
+{
+    return (rxHead - rxTail) & (UART_RX_BUFFER_SIZE - 1);
+}
+
+int UartTransport::read()
+{
+    if (rxHead == rxTail) {
+        return -1;
+    }
+
+    uint8_t c = rxBuffer[rxTail];
+
+    rxTail = (rxTail + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+    return c;
+}
+
+int UartTransport::peek()
+{
+    if (rxHead == rxTail) {
+        return -1;
+    }
+
+    return rxBuffer[rxTail];
+}
+
+// Waits only while the transmit buffer is full
+size_t UartTransport::write(uint8_t c)
+{
+    uint8_t next = (txHead + 1) & (UART_TX_BUFFER_SIZE - 1);
+
+    while (next == txTail) {}
+
+    txBuffer[txHead] = c;
+    txHead = next;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        UCSR1B |= _BV(UDRIE1);
+    }
+
+    return 1;
+}
+
+unsigned long UartTransport::getMaxBaud()
+{
+    return UART_MAX_BAUD;
+}
+
+unsigned long UartTransport::getOverflows()
+{
+    unsigned long overflows;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        overflows = rxOverflows;
+    }
+
+    return overflows;
+}
+
+#endif // UBRR1H
@@ -0,0 +1,57 @@
+/*
+    Modem link over the second hardware UART (USART1).
+
+    Program Description : On boards with a spare hardware UART (the Mega's
+        Serial1 on pins 18/19, or the 32U4's on pins 0/1) the modem is wired
+        to it and runs at 115200 baud.  The receive and transmit interrupts
+        move bytes through ring buffers, so nothing waits on the line and no
+        other interrupt is held up.  The shield's TX/RX jumpers have to be
+        wired to the UART pins instead of pins 10/11.  These interrupts take
+        the place of the Arduino core's, so the sketch must not use Serial1.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : UartTransport.h
+*/
+
+#ifndef UartTransport_h
+#define UartTransport_h
+
+#include <Arduino.h>
+#include "ModemTransport.h"
+
+// Only boards with a USART1 have the UART to spare
+#if defined(UBRR1H)
+
+// Ring buffer sizes, powers of two.  A +UGNSINF report fits in the receive buffer.
+#define UART_RX_BUFFER_SIZE 128
+#define UART_TX_BUFFER_SIZE 64
+
+#define UART_MAX_BAUD 115200
+
+class UartTransport : public ModemTransport
+{
+public:
+    UartTransport();
+    ~UartTransport();
+
+    //// Methods
+    void begin(unsigned long baud);
+    void end();
+
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t c);
+    using Print::write;
+
+    //// Getters
+    unsigned long getMaxBaud();
+    unsigned long getOverflows();
+};
+
+#endif // UBRR1H
+#endif // UartTransport_h
@@ -0,0 +1,291 @@
+/*
+    Upload queue for the day files on the SD card.
+
+    Program Description : The manifest is a file on the SD card with one
+        fixed-width line per file waiting to be uploaded, holding the file
+        name, its size, how much of it has already reached the server and
+        whether it is done.  Files are added when they are closed off at the
+        day rollover, so the manifest is the only thing that has to be read to
+        find the next file to upload, and an interrupted upload carries on
+        from the last confirmed byte instead of starting over.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : UploadManifest.cpp
+*/
+
+#include "UploadManifest.h"
+
+UploadManifest::UploadManifest(AdafruitDataloggingShield* pDataloggingShield)
+{
+    this->pDataloggingShield = pDataloggingShield;
+}
+
+UploadManifest::~UploadManifest() {}
+
+// Append a line for the file.  The line ending is added by the datalogging shield.
+bool UploadManifest::add(char* filename, unsigned long size)
+{
+    ManifestEntry entry;
+    char record[MANIFEST_RECORD_SIZE + 1];
+
+    strncpy(entry.name, filename, sizeof(entry.name) - 1);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    entry.size = size;
+    entry.offset = 0;
+    entry.status = MANIFEST_PENDING;
+    entry.checks = 0;
+
+    this->format(&entry, record);
+
+    // The manifest has no heading, every line is a record
+    if (!this->pDataloggingShield->openForAppend(MANIFEST_FILENAME, false)) {
+        return false;
+    }
+
+    this->pDataloggingShield->append(record);
+    this->pDataloggingShield->closeAppend();
+
+    return true;
+}
+
+int UploadManifest::next(byte policy, ManifestEntry* pEntry)
+{
+    char record[MANIFEST_RECORD_SIZE];
+    int found = -1;
+
+    if (!this->pDataloggingShield->openForUpdate(MANIFEST_FILENAME, true)) {
+        return -1;
+    }
+
+    int entries = this->pDataloggingShield->getOpenFileSize() / MANIFEST_RECORD_SIZE;
+
+    for (int i = 0; i < entries - this->firstPending && found < 0; i++) {
+        int index = (policy == UPLOAD_NEWEST_FIRST) ? (entries - 1 - i) : (this->firstPending + i);
+
+        if (this->pDataloggingShield->readAt(
+                (unsigned long)index * MANIFEST_RECORD_SIZE, record, MANIFEST_RECORD_SIZE) != MANIFEST_RECORD_SIZE) {
+            break;
+        }
+
+        if (this->parse(record, pEntry) && pEntry->status == MANIFEST_PENDING) {
+            found = index;
+        } else if (policy == UPLOAD_OLDEST_FIRST) {
+            // Skip the uploaded entries at the start of the manifest on the next scan
+            this->firstPending = index + 1;
+        }
+    }
+
+    this->pDataloggingShield->closeUpdate();
+
+    return found;
+}
+
+// Overwrite the line in place, it keeps the same length
+bool UploadManifest::update(int index, unsigned long offset, char doneStatus)
+{
+    ManifestEntry entry;
+    char record[MANIFEST_RECORD_SIZE + 1];
+    bool written = false;
+
+    if (!this->pDataloggingShield->openForUpdate(MANIFEST_FILENAME)) {
+        return false;
+    }
+
+    unsigned long position = (unsigned long)index * MANIFEST_RECORD_SIZE;
+
+    if (this->pDataloggingShield->readAt(position, record, MANIFEST_RECORD_SIZE) == MANIFEST_RECORD_SIZE &&
+        this->parse(record, &entry)) {
+
+        entry.offset = offset;
+        entry.status = (offset >= entry.size) ? doneStatus : MANIFEST_PENDING;
+
+        this->format(&entry, record);
+        written = this->pDataloggingShield->writeAt(position, record, strlen(record));
+    }
+
+    this->pDataloggingShield->closeUpdate();
+
+    return written;
+}
+
+byte UploadManifest::addCheck(int index)
+{
+    ManifestEntry entry;
+    char record[MANIFEST_RECORD_SIZE + 1];
+    byte checks = 0;
+
+    if (!this->pDataloggingShield->openForUpdate(MANIFEST_FILENAME)) {
+        return 0;
+    }
+
+    unsigned long position = (unsigned long)index * MANIFEST_RECORD_SIZE;
+
+    if (this->pDataloggingShield->readAt(position, record, MANIFEST_RECORD_SIZE) == MANIFEST_RECORD_SIZE &&
+        this->parse(record, &entry)) {
+
+        if (entry.checks < MANIFEST_MAX_CHECKS) {
+            entry.checks++;
+        }
+
+        this->format(&entry, record);
+
+        if (this->pDataloggingShield->writeAt(position, record, strlen(record))) {
+            checks = entry.checks;
+        }
+    }
+
+    this->pDataloggingShield->closeUpdate();
+
+    return checks;
+}
+
+int UploadManifest::find(char status, int from, ManifestEntry* pEntry)
+{
+    char record[MANIFEST_RECORD_SIZE];
+    int found = -1;
+    
+    if (!this->pDataloggingShield->openForUpdate(MANIFEST_FILENAME, true)) {
+        return -1;
+    }
+    
+    int entries = this->pDataloggingShield->getOpenFileSize() / MANIFEST_RECORD_SIZE;
+    
+    for (int index = from; index < entries && found < 0; index++) {
+        if (this->pDataloggingShield->readAt(
+                (unsigned long)index * MANIFEST_RECORD_SIZE, record, MANIFEST_RECORD_SIZE) != MANIFEST_RECORD_SIZE) {
+            break;
+        }
+        
+        if (this->parse(record, pEntry) && pEntry->status == status) {
+            found = index;
+        }
+    }
+    
+    this->pDataloggingShield->closeUpdate();
+    
+    return found;
+}
+
+int UploadManifest::count()
+{
+    return this->pDataloggingShield->fileSize(MANIFEST_FILENAME) / MANIFEST_RECORD_SIZE;
+}
+
+// The entries kept are copied to the temporary file, which is then copied back over the
+// manifest.  A power cut part way leaves one of the two complete.  The temporary copy
+// drops at least one entry, so it is always shorter than the manifest it was made from:
+// a manifest no longer than it is one cut short while being copied back.
+bool UploadManifest::compact()
+{
+    ManifestEntry entry;
+    unsigned long size = this->pDataloggingShield->fileSize(MANIFEST_FILENAME);
+    unsigned long tempSize = this->pDataloggingShield->fileSize(MANIFEST_TEMP_FILENAME);
+
+    if (tempSize > 0 && size <= tempSize) {
+        if (!this->copy(MANIFEST_TEMP_FILENAME, MANIFEST_FILENAME, false)) {
+            return false;
+        }
+    } else {
+        if (this->find(MANIFEST_DONE, 0, &entry) < 0) {
+            return true;
+        }
+
+        if (!this->copy(MANIFEST_FILENAME, MANIFEST_TEMP_FILENAME, true) ||
+            !this->copy(MANIFEST_TEMP_FILENAME, MANIFEST_FILENAME, false)) {
+            return false;
+        }
+    }
+
+    this->firstPending = 0;
+
+    return this->pDataloggingShield->removeFile(MANIFEST_TEMP_FILENAME);
+}
+
+// Copy the records of one file over another a record at a time, as only one file can be
+// open, leaving out the entries that are done if dropDone is set
+bool UploadManifest::copy(const char* source, const char* destination, bool dropDone)
+{
+    ManifestEntry entry;
+    char record[MANIFEST_RECORD_SIZE];
+    unsigned long written = 0;
+
+    if (!this->pDataloggingShield->openForRewrite(destination)) {
+        return false;
+    }
+
+    this->pDataloggingShield->closeUpdate();
+
+    for (unsigned long position = 0;; position += MANIFEST_RECORD_SIZE) {
+        if (!this->pDataloggingShield->openForUpdate(source, true)) {
+            return false;
+        }
+
+        int length = this->pDataloggingShield->readAt(position, record, MANIFEST_RECORD_SIZE);
+
+        this->pDataloggingShield->closeUpdate();
+
+        if (length != MANIFEST_RECORD_SIZE) {
+            return true;
+        }
+
+        if (dropDone && (!this->parse(record, &entry) || entry.status == MANIFEST_DONE)) {
+            continue;
+        }
+
+        if (!this->pDataloggingShield->openForUpdate(destination)) {
+            return false;
+        }
+
+        bool copied = this->pDataloggingShield->writeAt(written, record, MANIFEST_RECORD_SIZE);
+
+        this->pDataloggingShield->closeUpdate();
+
+        if (!copied) {
+            return false;
+        }
+
+        written += MANIFEST_RECORD_SIZE;
+    }
+}
+
+// Split a manifest line into its fields
+bool UploadManifest::parse(char* pRecord, ManifestEntry* pEntry)
+{
+    if (pRecord[12] != ',' || pRecord[23] != ',' || pRecord[34] != ',' || pRecord[36] != ',') {
+        return false;
+    }
+
+    byte length = 0;
+
+    while (length < 12 && pRecord[length] != ' ') {
+        pEntry->name[length] = pRecord[length];
+        length++;
+    }
+
+    pEntry->name[length] = '\0';
+    pEntry->size = strtoul(pRecord + 13, nullptr, 10);
+    pEntry->offset = strtoul(pRecord + 24, nullptr, 10);
+    pEntry->status = pRecord[35];
+    pEntry->checks = (byte)strtoul(pRecord + 37, nullptr, 10);
+
+    return true;
+}
+
+// Build a manifest line without the line ending
+void UploadManifest::format(ManifestEntry* pEntry, char* pRecord)
+{
+    snprintf_P(
+        pRecord,
+        MANIFEST_RECORD_SIZE - 1,
+        PSTR("%-12s,%010lu,%010lu,%c,%02u"),
+        pEntry->name,
+        pEntry->size,
+        pEntry->offset,
+        pEntry->status,
+        pEntry->checks
+    );
+}
@@ -0,0 +1,101 @@
+/*
+    Upload queue for the day files on the SD card.
+
+    Program Description : The manifest is a file on the SD card with one
+        fixed-width line per file waiting to be uploaded, holding the file
+        name, its size, how much of it has already reached the server,
+        whether it is done and how many times it has been verified.  Files are added when they are closed off at the
+        day rollover, so the manifest is the only thing that has to be read to
+        find the next file to upload, and an interrupted upload carries on
+        from the last confirmed byte instead of starting over.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : UploadManifest.h
+*/
+
+#ifndef UploadManifest_h
+#define UploadManifest_h
+
+#include <Arduino.h>
+#include "AdafruitDataloggingShield.h"
+
+// Name of the manifest file on the SD card, and of the copy made while it is compacted
+#define MANIFEST_FILENAME "MANIFEST.TXT"
+#define MANIFEST_TEMP_FILENAME "MANIFEST.TMP"
+
+// Length of a manifest line including the line ending, "NAME.EXT    ,SIZE,OFFSET,S,CK"
+#define MANIFEST_RECORD_SIZE 41
+
+// Most checks against the server's report counted for a file, the width of its field
+#define MANIFEST_MAX_CHECKS 99
+
+// Upload status of a file.  A file with a CRC index is uploaded in full first, then kept
+// for verification until the server reports that every block of it checks out.
+#define MANIFEST_PENDING 'P'
+#define MANIFEST_VERIFY 'V'
+#define MANIFEST_DONE 'D'
+
+// Order the backlog is uploaded in
+#define UPLOAD_OLDEST_FIRST 0
+#define UPLOAD_NEWEST_FIRST 1
+
+struct ManifestEntry
+{
+    char name[13];
+    unsigned long size;
+    unsigned long offset;
+    char status;
+    byte checks;
+};
+
+class UploadManifest
+{
+public:
+    UploadManifest(AdafruitDataloggingShield* pDataloggingShield);
+    ~UploadManifest();
+
+    //// Data Management
+    //// Methods
+    // Queue a file of size bytes for upload
+    bool add(char* filename, unsigned long size);
+
+    // Find the next pending file in the order of the policy.  Returns its index in the
+    // manifest, or -1 when there is nothing left to upload.
+    int next(byte policy, ManifestEntry* pEntry);
+
+    // Record how far the upload of an entry has got, and give it doneStatus at the end
+    bool update(int index, unsigned long offset, char doneStatus = MANIFEST_DONE);
+
+    // Count a check of an entry against the server's report.  Returns the number of checks
+    // it has had, or 0 if the card failed.
+    byte addCheck(int index);
+
+    // Find the first entry with a status, from index from on.  Returns its index, or -1.
+    int find(char status, int from, ManifestEntry* pEntry);
+
+    // Number of files in the manifest, uploaded or not
+    int count();
+
+    // Drop the entries of the files that are done, so the manifest only holds the backlog.
+    // Finishes a compaction that a power cut interrupted.  The indices of the entries
+    // change.  Returns false if the card failed part way, leaving it for the next call.
+    bool compact();
+
+private:
+    //// VARIABLES
+    AdafruitDataloggingShield* pDataloggingShield = nullptr;
+
+    // Every entry before this index has been uploaded, so oldest-first scans start here.
+    // It is lost at a reboot, but compact() keeps the entries before it few.
+    int firstPending = 0;
+
+    //// METHODS
+    bool copy(const char* source, const char* destination, bool dropDone);
+    bool parse(char* pRecord, ManifestEntry* pEntry);
+    void format(ManifestEntry* pEntry, char* pRecord);
+};
+#endif // UploadManifest_h
@@ -0,0 +1,125 @@
+/*
+    Signal-aware timing of the daily upload.
+
+    Program Description : Every time the modem is on, the signal strength is
+        recorded against the hour of the day, so the logger learns when the
+        site has coverage.  An upload only goes ahead when the signal is above
+        a threshold.  Otherwise, or when the transfer fails, it is tried again
+        after a backoff that doubles with every attempt up to a limit, pushed
+        on to the next hour that has not been weak before.  After a number of
+        attempts in a row have been put off, the upload goes ahead whatever
+        the signal, so data is never held back for good.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : UploadScheduler.cpp
+*/
+
+#include "UploadScheduler.h"
+
+UploadScheduler::UploadScheduler(int8_t threshold, unsigned long minBackoff, unsigned long maxBackoff, byte maxDeferrals)
+{
+    this->threshold = threshold;
+    this->minBackoff = minBackoff;
+    this->maxBackoff = maxBackoff;
+    this->maxDeferrals = maxDeferrals;
+
+    for (byte i = 0; i < 24; i++) {
+        this->hourlyRssi[i] = UPLOAD_NO_HISTORY;
+    }
+}
+
+UploadScheduler::~UploadScheduler() {}
+
+// The first reading of an hour is taken as it is, later ones move the average a quarter
+// of the way, so one odd day does not write an hour off
+void UploadScheduler::record(byte hour, int8_t rssi, bool registered)
+{
+    if (hour >= 24) {
+        return;
+    }
+
+    if (!registered || rssi == 0) {
+        rssi = UPLOAD_WEAKEST_RSSI;
+    }
+
+    if (this->hourlyRssi[hour] == UPLOAD_NO_HISTORY) {
+        this->hourlyRssi[hour] = rssi;
+    } else {
+        this->hourlyRssi[hour] = (3 * (int)this->hourlyRssi[hour] + rssi) / 4;
+    }
+}
+
+// Nothing can be sent without a registration.  Past the deferral limit a weak signal is
+// no longer a reason to wait.
+bool UploadScheduler::clear(int8_t rssi, bool registered)
+{
+    if (!registered) {
+        return false;
+    }
+
+    if (this->failures >= this->maxDeferrals) {
+        return true;
+    }
+
+    return rssi != 0 && rssi >= this->threshold;
+}
+
+unsigned long UploadScheduler::backOff(byte hour, byte minute)
+{
+    unsigned long wait = this->minBackoff;
+    unsigned long now = hour * 60UL + minute;
+
+    if (this->failures < 0xFF) {
+        this->failures++;
+    }
+
+    for (byte i = 1; i < this->failures && wait < this->maxBackoff; i++) {
+        wait *= 2;
+    }
+
+    if (wait > this->maxBackoff) {
+        wait = this->maxBackoff;
+    }
+
+    // Move the retry on to the start of the next hour that has not been weak before.  If
+    // every hour has been weak, the backoff is all there is to go on.  Either way the
+    // wait stops at the longest backoff, even if that ends in a weak hour.
+    unsigned long retryHour = (now + wait / 60000) / 60;
+
+    for (byte i = 0; i < 24; i++) {
+        if (!this->weak((retryHour + i) % 24)) {
+            if (i > 0) {
+                wait = ((retryHour + i) * 60 - now) * 60000;
+            }
+
+            break;
+        }
+    }
+
+    return min(wait, this->maxBackoff);
+}
+
+void UploadScheduler::succeeded()
+{
+    this->failures = 0;
+}
+
+int8_t UploadScheduler::getHourlyRssi(byte hour)
+{
+    return (hour < 24) ? this->hourlyRssi[hour] : UPLOAD_NO_HISTORY;
+}
+
+byte UploadScheduler::getFailures()
+{
+    return this->failures;
+}
+
+// An hour with no history is worth a try
+bool UploadScheduler::weak(byte hour)
+{
+    return this->hourlyRssi[hour] != UPLOAD_NO_HISTORY && this->hourlyRssi[hour] < this->threshold;
+}
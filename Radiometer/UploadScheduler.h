@@ -0,0 +1,76 @@
+/*
+    Signal-aware timing of the daily upload.
+
+    Program Description : Every time the modem is on, the signal strength is
+        recorded against the hour of the day, so the logger learns when the
+        site has coverage.  An upload only goes ahead when the signal is above
+        a threshold.  Otherwise, or when the transfer fails, it is tried again
+        after a backoff that doubles with every attempt up to a limit, pushed
+        on to the next hour that has not been weak before.  After a number of
+        attempts in a row have been put off, the upload goes ahead whatever
+        the signal, so data is never held back for good.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : UploadScheduler.h
+*/
+
+#ifndef UploadScheduler_h
+#define UploadScheduler_h
+
+#include <Arduino.h>
+
+// Signal strength recorded when the modem could not measure it or did not register (dBm)
+#define UPLOAD_WEAKEST_RSSI -115
+
+// An hour of the day that has never been recorded
+#define UPLOAD_NO_HISTORY 0
+
+class UploadScheduler
+{
+public:
+    UploadScheduler(int8_t threshold, unsigned long minBackoff, unsigned long maxBackoff, byte maxDeferrals);
+    ~UploadScheduler();
+
+    //// Signal History
+    //// Methods
+    // Record the signal strength (dBm) read at an hour of the day.  A reading of 0, or a
+    // modem that did not register, counts as the weakest signal.
+    void record(byte hour, int8_t rssi, bool registered);
+
+    //// Upload Decisions
+    // True when an upload should go ahead at this signal strength
+    bool clear(int8_t rssi, bool registered);
+
+    // The attempt was put off or failed at the given time of day.  Returns how long to
+    // wait before the next one (ms), never more than maxBackoff.
+    unsigned long backOff(byte hour, byte minute);
+
+    // The upload went through, so the backoff starts over
+    void succeeded();
+
+    //// Getters
+    // Average signal strength at an hour of the day (dBm), or UPLOAD_NO_HISTORY
+    int8_t getHourlyRssi(byte hour);
+    // Attempts in a row that were put off or failed
+    byte getFailures();
+
+private:
+    //// VARIABLES
+    int8_t threshold = 0;
+    unsigned long minBackoff = 0;
+    unsigned long maxBackoff = 0;
+    byte maxDeferrals = 0;
+
+    // Running average of the signal strength for every hour of the day (UTC)
+    int8_t hourlyRssi[24];
+
+    byte failures = 0;
+
+    //// METHODS
+    bool weak(byte hour);
+};
+#endif // UploadScheduler_h
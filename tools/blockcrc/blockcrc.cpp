@@ -0,0 +1,254 @@
+/*
+    Block CRC index, verifier and patcher for the radiometer day files.
+
+    Program Description : Runs on the FTP server the loggers upload to, after
+        every upload session or from cron.  For each day file whose CRC index
+        (NAME.CRC) has arrived, "check" applies the patch files (NAME.Bnnnnn)
+        the logger has sent for blocks that were wrong, deletes them, compares
+        the file with the index block by block and writes the NAME.BAD report
+        the logger reads in its next session.  A report that lists no blocks
+        means the file is complete and intact.  "verify" compares any file with an index and
+        lists the blocks that do not match, and "index" writes the index of a
+        file, for a day file copied off the card by hand.
+
+        blockcrc check DIRECTORY ...
+        blockcrc verify FILE INDEX
+        blockcrc index FILE [INDEX]
+
+        "check" exits with status 1 if any file still has bad blocks, and
+        "verify" if the file does not match.  Errors exit with status 2.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : blockcrc.cpp
+*/
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "blockcrc.h"
+
+static bool readFile(const std::string& path, std::string* pData)
+{
+    FILE* pFile = fopen(path.c_str(), "rb");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    char buffer[65536];
+    size_t length;
+
+    pData->clear();
+
+    while ((length = fread(buffer, 1, sizeof(buffer), pFile)) > 0) {
+        pData->append(buffer, length);
+    }
+
+    bool read = !ferror(pFile);
+
+    fclose(pFile);
+
+    return read;
+}
+
+// Write through a temporary file, so the logger never reads half a report
+static bool writeFile(const std::string& path, const std::string& data)
+{
+    std::string temporary = path + ".tmp";
+    FILE* pFile = fopen(temporary.c_str(), "wb");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    bool written = fwrite(data.data(), 1, data.size(), pFile) == data.size();
+
+    if (fclose(pFile) != 0 || !written || rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool readIndex(const std::string& path, std::vector<uint32_t>* pCrcs)
+{
+    std::string text;
+
+    if (!readFile(path, &text) || !blockcrc::parseIndex(text, pCrcs)) {
+        fprintf(stderr, "%s: not a CRC index\n", path.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+static void printBlocks(const std::vector<uint32_t>& blocks)
+{
+    for (uint32_t block : blocks) {
+        printf(" %u", block);
+    }
+}
+
+// Check every day file in a directory that has an index
+static int checkDirectory(const std::string& directory)
+{
+    DIR* pDirectory = opendir(directory.c_str());
+    std::vector<std::string> names;
+    int status = 0;
+
+    if (pDirectory == nullptr) {
+        perror(directory.c_str());
+
+        return 2;
+    }
+
+    for (struct dirent* pEntry; (pEntry = readdir(pDirectory)) != nullptr;) {
+        names.push_back(pEntry->d_name);
+    }
+
+    closedir(pDirectory);
+    std::sort(names.begin(), names.end());
+
+    for (const std::string& indexName : names) {
+        if (indexName.size() <= 4 || indexName.compare(indexName.size() - 4, 4, ".CRC") != 0) {
+            continue;
+        }
+
+        std::string name = indexName.substr(0, indexName.size() - 4);
+        std::string path = directory + "/" + name;
+        std::string data;
+        std::vector<uint32_t> crcs;
+        std::map<uint32_t, std::string> patches;
+        std::vector<std::string> patchPaths;
+
+        if (!readIndex(directory + "/" + indexName, &crcs)) {
+            status = 2;
+
+            continue;
+        }
+
+        // A file that is not there at all is all bad blocks
+        readFile(path, &data);
+
+        for (const std::string& patchName : names) {
+            if (patchName.size() == name.size() + 7 && patchName.compare(0, name.size() + 2, name + ".B") == 0 &&
+                strspn(patchName.c_str() + name.size() + 2, "0123456789") == 5) {
+
+                std::string contents;
+
+                patchPaths.push_back(directory + "/" + patchName);
+
+                if (readFile(patchPaths.back(), &contents)) {
+                    patches[strtoul(patchName.c_str() + name.size() + 2, nullptr, 10)] = contents;
+                }
+            }
+        }
+
+        std::string before = data;
+        blockcrc::Check result = blockcrc::check(&data, crcs, patches);
+
+        if ((data != before && !writeFile(path, data)) ||
+            !writeFile(path + ".BAD", blockcrc::formatReport(crcs.size(), result.bad))) {
+
+            perror(path.c_str());
+            status = 2;
+
+            continue;
+        }
+
+        // Rejected patches go too, so that the logger sends those blocks again
+        for (const std::string& patchPath : patchPaths) {
+            unlink(patchPath.c_str());
+        }
+
+        printf("%s: %zu blocks, %zu patched, %zu rejected, %zu bad",
+               name.c_str(), crcs.size(), result.patched, result.rejected, result.bad.size());
+        printBlocks(result.bad);
+        printf("%s\n", result.longer ? ", longer than the logger's file" : "");
+
+        if (!result.bad.empty() && status == 0) {
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+static void usage(const char* pProgram)
+{
+    fprintf(stderr,
+            "usage: %s check DIRECTORY ...\n"
+            "       %s verify FILE INDEX\n"
+            "       %s index FILE [INDEX]\n",
+            pProgram, pProgram, pProgram);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "check") == 0) {
+        int status = 0;
+
+        for (int i = 2; i < argc; i++) {
+            status = (std::max)(status, checkDirectory(argv[i]));
+        }
+
+        return status;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "verify") == 0) {
+        std::string data;
+        std::vector<uint32_t> crcs;
+
+        if (!readFile(argv[2], &data)) {
+            perror(argv[2]);
+
+            return 2;
+        }
+
+        if (!readIndex(argv[3], &crcs)) {
+            return 2;
+        }
+
+        blockcrc::Check result = blockcrc::check(&data, crcs, std::map<uint32_t, std::string>());
+
+        printf("%s: %zu blocks, %zu bad", argv[2], crcs.size(), result.bad.size());
+        printBlocks(result.bad);
+        printf("%s\n", result.longer ? ", longer than the logger's file" : "");
+
+        return result.bad.empty() ? 0 : 1;
+    }
+
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "index") == 0) {
+        std::string data;
+        std::string indexPath = (argc == 4) ? argv[3] : std::string(argv[2]) + ".CRC";
+
+        if (!readFile(argv[2], &data)) {
+            perror(argv[2]);
+
+            return 2;
+        }
+
+        if (!writeFile(indexPath, blockcrc::formatIndex(blockcrc::index(data)))) {
+            perror(indexPath.c_str());
+
+            return 2;
+        }
+
+        return 0;
+    }
+
+    usage(argv[0]);
+
+    return 2;
+}
@@ -0,0 +1,211 @@
+/*
+    Block CRCs of the radiometer day files, for the server side.
+
+    Program Description : The logger keeps the CRC-32 of every 4096 byte block
+        of a day file in an index, one "%08lX" line per block, and uploads it
+        after the file as NAME.CRC.  These functions compare a file on the
+        server with that index, apply the NAME.Bnnnnn patch files the logger
+        sends for the blocks that did not match, and build the NAME.BAD report
+        the logger reads back.  The report's first "%08lu" line is the number
+        of blocks in the index the file was checked against, so that the
+        logger can tell a report on a partly uploaded index from one on its
+        own.  One line follows for each block that is still wrong.  The last
+        block is shorter than the others, and its length is found from its
+        CRC.  A copy with bytes past the end of the logger's file has its last
+        block listed, and the patch for it sets the length.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : blockcrc.h
+*/
+
+#ifndef blockcrc_h
+#define blockcrc_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace blockcrc
+{
+    // Same as CRC_BLOCK_SIZE and CRC_RECORD_SIZE in AdafruitDataloggingShield.h
+    const size_t BLOCK_SIZE = 4096;
+    const size_t RECORD_SIZE = 10;
+
+    // What a check did to a file
+    struct Check
+    {
+        std::vector<uint32_t> bad;
+        size_t patched = 0;
+        size_t rejected = 0;
+        bool longer = false;
+    };
+
+    // CRC-32 as zlib computes it, carried on from crc
+    inline uint32_t crc32(const char* pData, size_t length, uint32_t crc = 0)
+    {
+        static uint32_t table[256];
+
+        if (table[1] == 0) {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+
+                for (int bit = 0; bit < 8; bit++) {
+                    c = (c & 1) ? (c >> 1) ^ 0xEDB88320UL : c >> 1;
+                }
+
+                table[i] = c;
+            }
+        }
+
+        crc = ~crc;
+
+        while (length-- > 0) {
+            crc = table[(crc ^ (uint8_t)*pData++) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+    // The CRC of every block of a file, the last one short
+    inline std::vector<uint32_t> index(const std::string& data)
+    {
+        std::vector<uint32_t> crcs;
+
+        for (size_t start = 0; start < data.size(); start += BLOCK_SIZE) {
+            crcs.push_back(crc32(data.data() + start, (std::min)(BLOCK_SIZE, data.size() - start)));
+        }
+
+        return crcs;
+    }
+
+    inline std::string formatIndex(const std::vector<uint32_t>& crcs)
+    {
+        std::string text;
+        char record[RECORD_SIZE + 1];
+
+        for (uint32_t crc : crcs) {
+            snprintf(record, sizeof(record), "%08lX\r\n", (unsigned long)crc);
+            text += record;
+        }
+
+        return text;
+    }
+
+    // Returns false if a line is not a CRC
+    inline bool parseIndex(const std::string& text, std::vector<uint32_t>* pCrcs)
+    {
+        pCrcs->clear();
+
+        for (size_t start = 0; start + RECORD_SIZE <= text.size(); start += RECORD_SIZE) {
+            char* pEnd;
+            uint32_t crc = strtoul(text.c_str() + start, &pEnd, 16);
+
+            if (pEnd != text.c_str() + start + 8 || text.compare(start + 8, 2, "\r\n") != 0) {
+                return false;
+            }
+
+            pCrcs->push_back(crc);
+        }
+
+        return text.size() % RECORD_SIZE == 0;
+    }
+
+    inline std::string formatReport(size_t blocks, const std::vector<uint32_t>& bad)
+    {
+        char record[16];
+
+        snprintf(record, sizeof(record), "%08lu\r\n", (unsigned long)blocks);
+
+        std::string text = record;
+
+        for (uint32_t block : bad) {
+            snprintf(record, sizeof(record), "%08lu\r\n", (unsigned long)block);
+            text += record;
+        }
+
+        return text;
+    }
+
+    // Apply the patches, block number to contents, then compare the file with the index.
+    // A patch is only taken if its CRC is the one in the index, as it may have been cut
+    // short.  Patching the last block also sets the length of the file.
+    inline Check check(std::string* pData, const std::vector<uint32_t>& crcs, const std::map<uint32_t, std::string>& patches)
+    {
+        Check result;
+        size_t blocks = crcs.size();
+
+        for (const auto& patch : patches) {
+            uint32_t block = patch.first;
+            const std::string& contents = patch.second;
+            bool last = block + 1 == blocks;
+
+            if (block >= blocks || contents.empty() || contents.size() > BLOCK_SIZE ||
+                (!last && contents.size() != BLOCK_SIZE) ||
+                crc32(contents.data(), contents.size()) != crcs[block]) {
+
+                result.rejected++;
+
+                continue;
+            }
+
+            size_t start = block * BLOCK_SIZE;
+
+            if (pData->size() < start + contents.size()) {
+                pData->resize(start + contents.size(), '\0');
+            }
+
+            pData->replace(start, contents.size(), contents);
+
+            if (last) {
+                pData->resize(start + contents.size());
+            }
+
+            result.patched++;
+        }
+
+        for (size_t block = 0; block + 1 < blocks; block++) {
+            size_t start = block * BLOCK_SIZE;
+
+            if (pData->size() < start + BLOCK_SIZE || crc32(pData->data() + start, BLOCK_SIZE) != crcs[block]) {
+                result.bad.push_back(block);
+            }
+        }
+
+        // The last block is as long as the first length whose CRC matches
+        if (blocks > 0) {
+            size_t start = (blocks - 1) * BLOCK_SIZE;
+            size_t length = 0;
+            uint32_t crc = 0;
+
+            for (size_t i = start; i < pData->size() && i < start + BLOCK_SIZE; i++) {
+                crc = crc32(pData->data() + i, 1, crc);
+
+                if (crc == crcs[blocks - 1]) {
+                    length = i + 1 - start;
+
+                    break;
+                }
+            }
+
+            // The copy is not cut back here, as the index may be one the logger has
+            // not finished sending
+            result.longer = length > 0 && pData->size() > start + length;
+
+            if (length == 0 || result.longer) {
+                result.bad.push_back(blocks - 1);
+            }
+        }
+
+        return result;
+    }
+}
+
+#endif // blockcrc_h
@@ -0,0 +1,199 @@
+/*
+    Host simulation of the Arduino core.
+
+    Program Description : Just enough of the Arduino core for the radiometer
+        sources to be compiled and run on a Linux PC.  Serial is connected to
+        a file descriptor (a pty for the host tools), and time comes from the
+        host clock.  Host-only controls are in hostsim.h.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : Arduino.h
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define DEC 10
+#define HEX 16
+
+#define MSBFIRST 1
+#define LSBFIRST 0
+
+// The binary constants of binary.h that the sketch uses
+#define B00000000 0x00
+#define B00000100 0x04
+#define B00001000 0x08
+#define B00010000 0x10
+#define B00100000 0x20
+#define B00110000 0x30
+#define B01000000 0x40
+#define B01010000 0x50
+#define B01100000 0x60
+#define B01110000 0x70
+#define B10000000 0x80
+
+// Start of the avr-libc heap, for the sketch's free memory check.  The host has no such
+// thing, so it is null.
+extern char* __malloc_heap_start;
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p) (*(void* const*)(p))
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcat_P strcat
+#define strncat_P strncat
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strcasecmp_P strcasecmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+
+// snprintf(), counted for the cycle ledger in hostsim.h
+int snprintf_P(char* pBuffer, size_t size, const char* pFormat, ...) __attribute__((format(printf, 3, 4)));
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+// Digital, analog and interrupt pins do nothing
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*pHandler)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts();
+void interrupts();
+
+// Time
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh);
+char* dtostrf(double value, signed char width, unsigned char precision, char* pBuffer);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* pBuffer, size_t size);
+    size_t write(const char* pString);
+    size_t write(const char* pBuffer, size_t size);
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper* pString);
+    size_t print(const char* pString);
+    size_t print(char c);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println();
+
+    template <typename T> size_t println(T value)
+    {
+        size_t n = this->print(value);
+
+        return n + this->println();
+    }
+
+    template <typename T> size_t println(T value, int format)
+    {
+        size_t n = this->print(value, format);
+
+        return n + this->println();
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout);
+    size_t readBytes(char* pBuffer, size_t length);
+    size_t readBytesUntil(char terminator, char* pBuffer, size_t length);
+
+protected:
+    unsigned long timeout = 1000;
+
+    int timedRead();
+};
+
+// The USB serial port, connected to a pair of host file descriptors
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud);
+    void end();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* pBuffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // Arduino_h
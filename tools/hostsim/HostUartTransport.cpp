@@ -0,0 +1,136 @@
+/*
+    Host simulation of the modem link over a hardware UART.
+
+    Program Description : See HostUartTransport.h.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : HostUartTransport.cpp
+*/
+
+#include <algorithm>
+
+#include "HostUartTransport.h"
+
+static const size_t TX_BUFFER_SIZE = 64;
+
+HostUartTransport::HostUartTransport(hostsim::SerialPeer* pPeer, unsigned long maxBaud)
+{
+    this->pPeer = pPeer;
+    this->maxBaud = maxBaud;
+}
+
+void HostUartTransport::begin(unsigned long baud)
+{
+    this->end();
+
+    this->baud = baud;
+    this->rxHead = 0;
+    this->rxCount = 0;
+}
+
+// Let the last bytes out before the UART is turned off
+void HostUartTransport::end()
+{
+    if (this->baud != 0 && !this->txBuffer.empty()) {
+        uint64_t now = hostsim::clock();
+
+        if (this->txFree > now) {
+            hostsim::advance(this->txFree - now);
+        }
+
+        this->update();
+    }
+
+    this->baud = 0;
+}
+
+// Hand the peer every byte that has finished sending, then take every byte it has sent.
+// Sending first keeps the times the peer sees in order.
+void HostUartTransport::update()
+{
+    uint64_t now = hostsim::clock();
+    uint8_t c;
+
+    if (!this->pPeer || this->baud == 0) {
+        return;
+    }
+
+    while (!this->txBuffer.empty() && this->txBuffer.front().time <= now) {
+        this->pPeer->receive(this->txBuffer.front().c, this->baud, this->txBuffer.front().time);
+        this->txBuffer.pop_front();
+    }
+
+    while (this->pPeer->transmit(now, this->baud, &c)) {
+        if (this->rxCount < sizeof(this->rxBuffer)) {
+            this->rxBuffer[(this->rxHead + this->rxCount++) % sizeof(this->rxBuffer)] = c;
+        } else {
+            this->overflows++;
+        }
+    }
+}
+
+int HostUartTransport::available()
+{
+    this->update();
+
+    return (int)this->rxCount;
+}
+
+int HostUartTransport::read()
+{
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    uint8_t c = this->rxBuffer[this->rxHead];
+
+    this->rxHead = (this->rxHead + 1) % sizeof(this->rxBuffer);
+    this->rxCount--;
+
+    return c;
+}
+
+int HostUartTransport::peek()
+{
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    return this->rxBuffer[this->rxHead];
+}
+
+// Queue the byte behind the ones already waiting, and wait only if the ring is full
+size_t HostUartTransport::write(uint8_t c)
+{
+    if (this->baud == 0) {
+        return 0;
+    }
+
+    this->update();
+
+    if (this->txBuffer.size() == TX_BUFFER_SIZE) {
+        hostsim::advance(this->txBuffer.front().time - hostsim::clock());
+        this->update();
+    }
+
+    uint64_t start = (std::max)(this->txFree, hostsim::clock());
+
+    this->txFree = start + 10000000ULL / this->baud;
+    this->txBuffer.push_back({this->txFree, c});
+
+    return 1;
+}
+
+unsigned long HostUartTransport::getMaxBaud()
+{
+    return this->maxBaud;
+}
+
+unsigned long HostUartTransport::getOverflows()
+{
+    return this->overflows;
+}
@@ -0,0 +1,67 @@
+/*
+    Host simulation of the modem link over a hardware UART.
+
+    Program Description : Stands in for UartTransport, which needs a USART1.
+        Bytes from the peer land in a 128 byte receive ring as they arrive,
+        as the receive interrupt would put them there, and are only lost when
+        the ring is full.  Bytes to the peer go into a 64 byte transmit ring
+        and leave at the line rate while the sketch carries on; writing only
+        waits when the ring is full.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : HostUartTransport.h
+*/
+
+#ifndef HostUartTransport_h
+#define HostUartTransport_h
+
+#include <deque>
+
+#include "hostsim.h"
+#include "ModemTransport.h"
+
+class HostUartTransport : public ModemTransport
+{
+public:
+    HostUartTransport(hostsim::SerialPeer* pPeer, unsigned long maxBaud = 115200);
+
+    void begin(unsigned long baud) override;
+    void end() override;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    unsigned long getMaxBaud() override;
+    unsigned long getOverflows() override;
+
+private:
+    hostsim::SerialPeer* pPeer = nullptr;
+    unsigned long maxBaud = 115200;
+    unsigned long baud = 0;
+
+    uint8_t rxBuffer[128];
+    size_t rxHead = 0;
+    size_t rxCount = 0;
+    unsigned long overflows = 0;
+
+    // Bytes waiting to go out, with the time their stop bit leaves (us)
+    struct OutputByte
+    {
+        uint64_t time;
+        uint8_t c;
+    };
+
+    std::deque<OutputByte> txBuffer;
+    uint64_t txFree = 0;
+
+    void update();
+};
+
+#endif // HostUartTransport_h
@@ -0,0 +1,65 @@
+/*
+    Host simulation of the Adafruit RTClib.
+
+    Program Description : DateTime works the same way as in RTClib, and the
+        PCF8523 keeps time as an offset from the host clock.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : RTClib.h
+*/
+
+#ifndef RTClib_h
+#define RTClib_h
+
+#include <Arduino.h>
+
+class DateTime
+{
+public:
+    DateTime(uint32_t t = 0);
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0);
+
+    uint16_t year() const { return this->y; }
+    uint8_t month() const { return this->m; }
+    uint8_t day() const { return this->d; }
+    uint8_t hour() const { return this->hh; }
+    uint8_t minute() const { return this->mm; }
+    uint8_t second() const { return this->ss; }
+    uint8_t dayOfTheWeek() const;
+    uint32_t unixtime() const;
+
+private:
+    uint16_t y;
+    uint8_t m;
+    uint8_t d;
+    uint8_t hh;
+    uint8_t mm;
+    uint8_t ss;
+};
+
+enum Pcf8523SqwPinMode
+{
+    PCF8523_OFF = 7,
+    PCF8523_SquareWave1HZ = 6,
+    PCF8523_SquareWave32HZ = 5,
+    PCF8523_SquareWave1kHz = 1,
+    PCF8523_SquareWave32kHz = 0
+};
+
+class RTC_PCF8523
+{
+public:
+    bool begin() { return true; }
+    void adjust(const DateTime& dt);
+    DateTime now();
+    bool initialized() { return true; }
+    bool lostPower() { return false; }
+    void start() {}
+    void writeSqwPinMode(Pcf8523SqwPinMode) {}
+};
+
+#endif // RTClib_h
@@ -0,0 +1,113 @@
+/*
+    Host simulation of the Arduino SD library.
+
+    Program Description : The card is a directory on the host, set with
+        hostsim::setSdRoot().  Names are upper-cased the way the FAT 8.3
+        names on the card are.  Only the root directory is used.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SD.h
+*/
+
+#ifndef SD_h
+#define SD_h
+
+#include <Arduino.h>
+
+// Open flags, as in SdFat.  These replace the POSIX flags of the same name, so host
+// code that calls open() has to include SD.h after it is done with them.
+#undef O_APPEND
+#undef O_CREAT
+#undef O_TRUNC
+#define O_READ 0x01
+#define O_WRITE 0x02
+#define O_APPEND 0x04
+#define O_CREAT 0x10
+#define O_TRUNC 0x40
+
+#define FILE_READ O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT | O_APPEND)
+
+// Sd2Card speeds and SdFile::ls() flags
+#define SPI_FULL_SPEED 0
+#define SPI_HALF_SPEED 1
+#define SPI_QUARTER_SPEED 2
+#define LS_DATE 1
+#define LS_SIZE 2
+#define LS_R 4
+
+struct HostFile;
+
+class File : public Stream
+{
+public:
+    File();
+    File(HostFile* pHostFile);
+    File(const File& other);
+    File& operator=(const File& other);
+    ~File();
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* pBuffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+
+    int read(void* pBuffer, uint16_t length);
+    bool seek(uint32_t position);
+    uint32_t position();
+    uint32_t size();
+    void close();
+    operator bool();
+    char* name();
+    bool isDirectory();
+    File openNextFile(uint8_t mode = O_READ);
+    void rewindDirectory();
+
+private:
+    HostFile* pHostFile;
+
+    void sync();
+    void release();
+};
+
+class SDClass
+{
+public:
+    bool begin(uint8_t chipSelect = 10);
+    void end();
+    File open(const char* filename, uint8_t mode = FILE_READ);
+    bool exists(const char* filename);
+    bool remove(const char* filename);
+    bool mkdir(const char* filename);
+};
+
+extern SDClass SD;
+
+// Low level classes used to check the card at startup
+class Sd2Card
+{
+public:
+    bool init(uint8_t, uint8_t) { return true; }
+};
+
+class SdVolume
+{
+public:
+    bool init(Sd2Card&) { return true; }
+};
+
+class SdFile
+{
+public:
+    bool openRoot(SdVolume&) { return true; }
+    void ls(uint8_t flags);
+};
+
+#endif // SD_h
@@ -0,0 +1,37 @@
+/*
+    Host simulation of the Arduino SPI library.
+
+    Program Description : The SPI bus does nothing on the host.  Transfers
+        return 0.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SPI.h
+*/
+
+#ifndef SPI_h
+#define SPI_h
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPIClass
+{
+public:
+    void begin() {}
+    void end() {}
+    void setBitOrder(uint8_t) {}
+    void setDataMode(uint8_t) {}
+    uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
+
+#endif // SPI_h
@@ -0,0 +1,563 @@
+/*
+    Emulator of the SIM7000 LTE/GPS modem on the Botletics shield.
+
+    Program Description : Answers the AT commands the radiometer sends, with
+        the timing set in a ModemProfile.  See Sim7000Emulator.h.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : Sim7000Emulator.cpp
+*/
+
+#include "Sim7000Emulator.h"
+
+#include <algorithm>
+
+#include "Arduino.h"
+#include "RTClib.h"
+
+// Largest FTP chunk the modem takes at once
+static const size_t FTP_MAX_LENGTH = 1360;
+
+Sim7000Emulator::Sim7000Emulator(const ModemProfile& profile)
+{
+    this->profile = profile;
+    this->random.seed(profile.seed);
+}
+
+//// Power
+// A short PWRKEY pulse turns the modem on, a long one turns it off
+void Sim7000Emulator::pinChanged(uint8_t pin, uint8_t value)
+{
+    uint64_t time = hostsim::clock();
+
+    if (pin != this->profile.pwrkeyPin) {
+        return;
+    }
+
+    if (value == LOW) {
+        this->pwrkeyPressed = true;
+        this->pwrkeyLow = time;
+
+        return;
+    }
+
+    if (!this->pwrkeyPressed) {
+        return;
+    }
+
+    uint64_t pulse = time - this->pwrkeyLow;
+
+    this->pwrkeyPressed = false;
+
+    if (!this->powered && pulse >= this->ms(50)) {
+        // The baud rate goes back to the default after a power cycle
+        this->powered = true;
+        this->readyAt = time + this->ms(this->profile.bootTime);
+        this->baud = 115200;
+        this->echo = true;
+        this->line.clear();
+
+        this->functionality = 1;
+        this->registeredAt = time + this->ms(this->profile.registrationDelay);
+        this->registrationReported = false;
+        this->cregMode = 0;
+        this->bearer = false;
+
+        this->gnssOn = false;
+        this->gnssUrcPeriod = 0;
+
+        this->ftpOpen = false;
+        this->ftpExpected = 0;
+        this->ftpGetting = false;
+    } else if (this->powered && pulse >= this->ms(1200)) {
+        this->powered = false;
+    }
+}
+
+//// UART
+void Sim7000Emulator::receive(uint8_t c, unsigned long baud, uint64_t time)
+{
+    this->update(time);
+
+    if (!this->powered || time < this->readyAt) {
+        return;
+    }
+
+    if (baud != this->baud) {
+        this->garbledBytes++;
+
+        return;
+    }
+
+    this->bytesIn++;
+
+    if (this->lineFeedDue) {
+        this->lineFeedDue = false;
+
+        if (c == '\n' && time - this->commandEnd <= 20000000ULL / baud) {
+            return;
+        }
+    }
+
+    // Raw FTP data
+    if (this->ftpExpected > 0) {
+        this->ftpChunk.push_back((char)c);
+
+        if (this->ftpChunk.size() == this->ftpExpected) {
+            this->finishChunk(time);
+        }
+
+        return;
+    }
+
+    if (c == '\r') {
+        std::string command = this->line;
+
+        this->line.clear();
+        this->lineFeedDue = true;
+        this->commandEnd = time;
+
+        if (command.empty()) {
+            return;
+        }
+
+        this->commands++;
+        this->trace(time, ">", command);
+
+        if (this->echo) {
+            this->schedule(time, command + "\r");
+        }
+
+        this->suppress = this->lost();
+
+        if (this->suppress) {
+            this->droppedReplies++;
+        }
+
+        this->handle(command, time);
+        this->suppress = false;
+    } else if (c != '\n' && this->line.size() < 560) {
+        this->line.push_back((char)c);
+    }
+}
+
+bool Sim7000Emulator::transmit(uint64_t time, unsigned long baud, uint8_t* pByte)
+{
+    this->update(time);
+
+    while (!this->output.empty() && this->output.front().time <= time) {
+        OutputByte next = this->output.front();
+
+        this->output.pop_front();
+
+        // Sent at another baud rate, the sketch only sees noise
+        if (next.baud != baud) {
+            this->garbledBytes++;
+
+            continue;
+        }
+
+        this->bytesOut++;
+        *pByte = next.c;
+
+        return true;
+    }
+
+    return false;
+}
+
+// Raise the URCs that are due and move the text that is due onto the UART
+void Sim7000Emulator::update(uint64_t time)
+{
+    if (this->powered && this->cregMode > 0 && !this->registrationReported && this->registered(time)) {
+        this->registrationReported = true;
+        this->schedule((std::max)(this->registeredAt, this->readyAt), "\r\n+CREG: 1\r\n");
+    }
+
+    while (this->powered && this->gnssOn && this->gnssUrcPeriod > 0 && this->nextGnssUrc <= time) {
+        this->schedule(this->nextGnssUrc, "\r\n+UGNSINF: " + this->gnssInfo(this->nextGnssUrc) + "\r\n");
+        this->nextGnssUrc += (uint64_t)this->gnssUrcPeriod * 1000000;
+    }
+
+    while (!this->events.empty() && this->events.front().time <= time) {
+        Event event = this->events.front();
+        uint64_t byteTime = 10000000ULL / event.baud;
+        uint64_t start = (std::max)(event.time, this->uartFree);
+
+        this->events.erase(this->events.begin());
+        this->trace(start, "<", event.text);
+
+        for (size_t i = 0; i < event.text.size(); i++) {
+            OutputByte next = { start + (i + 1) * byteTime, event.baud, (uint8_t)event.text[i] };
+
+            this->output.push_back(next);
+        }
+
+        this->uartFree = start + event.text.size() * byteTime;
+    }
+}
+
+void Sim7000Emulator::trace(uint64_t time, const char* pDirection, const std::string& text)
+{
+    if (!this->pTrace) {
+        return;
+    }
+
+    std::string printable;
+
+    for (char c : text) {
+        if (c == '\r') {
+            printable += "\\r";
+        } else if (c == '\n') {
+            printable += "\\n";
+        } else {
+            printable += c;
+        }
+    }
+
+    fprintf(this->pTrace, "%12.3f %s %s\n", time / 1e6, pDirection, printable.c_str());
+}
+
+// Queue text to go out at time, after anything already queued for the same time
+void Sim7000Emulator::schedule(uint64_t time, const std::string& text)
+{
+    Event event = { time, this->baud, text };
+    auto position = std::upper_bound(
+        this->events.begin(),
+        this->events.end(),
+        time,
+        [](uint64_t t, const Event& e) { return t < e.time; }
+    );
+
+    this->events.insert(position, event);
+}
+
+// A reply line, after the response latency
+void Sim7000Emulator::reply(uint64_t time, const std::string& text)
+{
+    if (!this->suppress) {
+        this->schedule(time + this->ms(this->profile.responseLatency), "\r\n" + text + "\r\n");
+    }
+}
+
+bool Sim7000Emulator::lost()
+{
+    return std::uniform_real_distribution<double>(0.0, 1.0)(this->random) < this->profile.dropProbability;
+}
+
+// Share of the uplink bandwidth left at the reported signal strength.  From CSQ 15
+// (-83 dBm) up the link runs at full rate, below it retransmissions eat into it.
+double Sim7000Emulator::signalQuality()
+{
+    if (this->profile.rssi >= 15 || this->profile.rssi == 99) {
+        return 1.0;
+    }
+
+    return (std::max)(this->profile.rssi, 1) / 15.0;
+}
+
+// Below CSQ 15 a chunk can also be lost to the signal, up to one in ten at CSQ 1
+bool Sim7000Emulator::weakSignalLoss()
+{
+    double probability = (1.0 - this->signalQuality()) * 0.1;
+
+    if (probability <= 0.0) {
+        return false;
+    }
+
+    return std::uniform_real_distribution<double>(0.0, 1.0)(this->random) < probability;
+}
+
+bool Sim7000Emulator::registered(uint64_t time)
+{
+    return this->powered &&
+        this->functionality == 1 &&
+        this->profile.rssi > 0 &&
+        this->profile.rssi != 99 &&
+        time >= this->registeredAt;
+}
+
+// The fields of +CGNSINF and +UGNSINF.  The receiver fixes once a second, so the time is
+// always a whole second.
+std::string Sim7000Emulator::gnssInfo(uint64_t time)
+{
+    char info[160];
+    DateTime now((uint32_t)(this->profile.epoch + time / 1000000));
+    char utc[32];
+
+    snprintf(utc, sizeof(utc), "%04d%02d%02d%02d%02d%02d.000",
+             now.year(), now.month(), now.day(), now.hour(), now.minute(), now.second());
+
+    if (!this->gnssOn) {
+        return "0,,,,,,,,,,,,,,,,,,,,";
+    }
+
+    if (time < this->fixAt) {
+        snprintf(info, sizeof(info), "1,0,%s,,,,0.00,0.0,0,,,,,,0,0,,,,,", utc);
+    } else {
+        snprintf(info, sizeof(info), "1,1,%s,%.6f,%.6f,%.3f,0.00,0.0,1,,1.1,1.4,0.9,,12,8,,,35,,",
+                 utc, this->profile.latitude, this->profile.longitude, this->profile.altitude);
+    }
+
+    return info;
+}
+
+static bool startsWith(const std::string& text, const char* pPrefix)
+{
+    return text.compare(0, strlen(pPrefix), pPrefix) == 0;
+}
+
+// The text between the first pair of double quotes
+static std::string quoted(const std::string& text)
+{
+    size_t start = text.find('"');
+    size_t end = text.find('"', start + 1);
+
+    if (start == std::string::npos || end == std::string::npos) {
+        return "";
+    }
+
+    return text.substr(start + 1, end - start - 1);
+}
+
+void Sim7000Emulator::handle(const std::string& command, uint64_t time)
+{
+    char text[64];
+    int status = this->registered(time) ? 1 : 2;
+
+    if (command == "AT" || startsWith(command, "AT+CVHU") || startsWith(command, "AT+CGDCONT") ||
+        startsWith(command, "AT+CSTT") || startsWith(command, "AT+CNCFG") || startsWith(command, "AT+CMNB") ||
+        startsWith(command, "AT+CNMP") || startsWith(command, "AT+SAPBR=3") || startsWith(command, "AT+FTPCID") ||
+        startsWith(command, "AT+FTPSERV") || startsWith(command, "AT+FTPPORT") || startsWith(command, "AT+FTPUN") ||
+        startsWith(command, "AT+FTPPW") || startsWith(command, "AT+FTPPUTPATH") || startsWith(command, "AT+FTPGETPATH") ||
+        command == "AT+FTPQUIT") {
+
+        this->reply(time, "OK");
+    } else if (command == "ATE0" || command == "ATE1") {
+        this->echo = (command == "ATE1");
+        this->reply(time, "OK");
+    } else if (command == "ATI") {
+        this->reply(time, "SIM7000A R1351");
+        this->reply(time, "OK");
+    } else if (startsWith(command, "AT+IPR=")) {
+        // The reply goes out at the old rate
+        this->reply(time, "OK");
+        this->baud = strtoul(command.c_str() + 7, nullptr, 10);
+    } else if (startsWith(command, "AT+CFUN=")) {
+        int functionality = atoi(command.c_str() + 8);
+
+        if (functionality == 1 && this->functionality != 1) {
+            this->registeredAt = time + this->ms(this->profile.registrationDelay);
+            this->registrationReported = false;
+        }
+
+        if (functionality != 1) {
+            this->bearer = false;
+        }
+
+        this->functionality = functionality;
+        this->reply(time, "OK");
+    } else if (command == "AT+CREG?" || command == "AT+CEREG?") {
+        snprintf(text, sizeof(text), "%s: %d,%d", command == "AT+CREG?" ? "+CREG" : "+CEREG", this->cregMode, status);
+        this->reply(time, text);
+        this->reply(time, "OK");
+    } else if (startsWith(command, "AT+CREG=")) {
+        // Registration URCs are only sent on a change
+        this->cregMode = atoi(command.c_str() + 8);
+        this->registrationReported = this->registered(time);
+        this->reply(time, "OK");
+    } else if (command == "AT+CSQ") {
+        snprintf(text, sizeof(text), "+CSQ: %d,99", this->profile.rssi);
+        this->reply(time, text);
+        this->reply(time, "OK");
+    } else if (command == "AT+CGNSPWR?") {
+        this->reply(time, this->gnssOn ? "+CGNSPWR: 1" : "+CGNSPWR: 0");
+        this->reply(time, "OK");
+    } else if (startsWith(command, "AT+CGNSPWR=")) {
+        bool on = atoi(command.c_str() + 11) == 1;
+
+        if (on && !this->gnssOn) {
+            this->fixAt = time + this->ms(this->profile.gpsFixDelay);
+            this->nextGnssUrc = (time / 1000000 + 1) * 1000000;
+        }
+
+        this->gnssOn = on;
+        this->reply(time, "OK");
+    } else if (command == "AT+CGNSINF") {
+        this->reply(time, "+CGNSINF: " + this->gnssInfo(time));
+        this->reply(time, "OK");
+    } else if (startsWith(command, "AT+CGNSURC=")) {
+        this->gnssUrcPeriod = strtoul(command.c_str() + 11, nullptr, 10);
+        this->nextGnssUrc = (time / 1000000 + 1) * 1000000;
+        this->reply(time, "OK");
+    } else if (command == "AT+CIPSHUT") {
+        this->reply(time, "SHUT OK");
+    } else if (command == "AT+CGATT=1") {
+        this->reply(time, status == 1 ? "OK" : "ERROR");
+    } else if (command == "AT+CGATT=0") {
+        this->bearer = false;
+        this->reply(time, "OK");
+    } else if (command == "AT+SAPBR=1,1") {
+        this->bearer = (status == 1);
+        this->reply(time + this->ms(this->profile.bearerDelay), this->bearer ? "OK" : "ERROR");
+    } else if (command == "AT+SAPBR=0,1") {
+        this->bearer = false;
+        this->reply(time, "OK");
+    } else if (startsWith(command, "AT+CNACT=1")) {
+        if (status == 1) {
+            this->bearer = true;
+            this->reply(time, "OK");
+            this->reply(time, "+APP PDP: ACTIVE");
+        } else {
+            this->reply(time, "ERROR");
+        }
+    } else if (startsWith(command, "AT+CNACT=0")) {
+        this->reply(time, "OK");
+        this->reply(time, "+APP PDP: DEACTIVE");
+    } else if (startsWith(command, "AT+FTPPUTNAME=")) {
+        this->ftpName = quoted(command);
+        this->reply(time, "OK");
+    } else if (startsWith(command, "AT+FTPPUTOPT=")) {
+        this->ftpAppend = (quoted(command) == "APPE");
+        this->reply(time, "OK");
+    } else if (command == "AT+FTPPUT=1") {
+        this->reply(time, "OK");
+
+        // Log in, change directory and open the data connection: a few round trips
+        if (!this->bearer) {
+            this->reply(time + this->ms(this->profile.linkLatency), "+FTPPUT: 1,63");
+        } else if (this->lost()) {
+            this->ftpFailures++;
+            this->reply(time + this->ms(3 * this->profile.linkLatency), "+FTPPUT: 1,61");
+        } else {
+            this->ftpOpen = true;
+
+            if (!this->ftpAppend) {
+                this->server[this->ftpName].clear();
+            }
+
+            snprintf(text, sizeof(text), "+FTPPUT: 1,1,%d", (int)FTP_MAX_LENGTH);
+            this->reply(time + this->ms(3 * this->profile.linkLatency), text);
+        }
+    } else if (startsWith(command, "AT+FTPPUT=2,")) {
+        size_t length = strtoul(command.c_str() + 12, nullptr, 10);
+
+        if (!this->ftpOpen) {
+            this->reply(time, "ERROR");
+        } else if (length == 0) {
+            this->ftpOpen = false;
+            this->reply(time, "OK");
+            this->reply(time + this->ms(this->profile.linkLatency), "+FTPPUT: 1,0");
+        } else if (this->suppress) {
+            // A lost request never puts the modem into data mode, otherwise the commands
+            // that follow would be taken as data
+            return;
+        } else {
+            this->ftpExpected = (std::min)(length, FTP_MAX_LENGTH);
+            this->ftpChunk.clear();
+
+            snprintf(text, sizeof(text), "+FTPPUT: 2,%d", (int)this->ftpExpected);
+            this->reply(time, text);
+        }
+    } else if (startsWith(command, "AT+FTPGETNAME=")) {
+        this->ftpGetName = quoted(command);
+        this->reply(time, "OK");
+    } else if (command == "AT+FTPSIZE") {
+        this->reply(time, "OK");
+
+        auto file = this->server.find(this->ftpGetName);
+
+        if (!this->bearer) {
+            this->reply(time + this->ms(this->profile.linkLatency), "+FTPSIZE: 1,63,0");
+        } else if (file == this->server.end()) {
+            this->reply(time + this->ms(2 * this->profile.linkLatency), "+FTPSIZE: 1,77,0");
+        } else {
+            snprintf(text, sizeof(text), "+FTPSIZE: 1,0,%lu", (unsigned long)file->second.size());
+            this->reply(time + this->ms(2 * this->profile.linkLatency), text);
+        }
+    } else if (command == "AT+FTPGET=1") {
+        this->reply(time, "OK");
+
+        auto file = this->server.find(this->ftpGetName);
+
+        // A file the server does not have is an operate error
+        if (!this->bearer) {
+            this->reply(time + this->ms(this->profile.linkLatency), "+FTPGET: 1,63");
+        } else if (this->lost()) {
+            this->ftpFailures++;
+            this->reply(time + this->ms(3 * this->profile.linkLatency), "+FTPGET: 1,61");
+        } else if (file == this->server.end()) {
+            this->reply(time + this->ms(3 * this->profile.linkLatency), "+FTPGET: 1,77");
+        } else {
+            this->ftpGetting = !file->second.empty();
+            this->ftpGetPosition = 0;
+            this->reply(time + this->ms(3 * this->profile.linkLatency), this->ftpGetting ? "+FTPGET: 1,1" : "+FTPGET: 1,0");
+        }
+    } else if (startsWith(command, "AT+FTPGET=2,")) {
+        size_t length = strtoul(command.c_str() + 12, nullptr, 10);
+
+        if (!this->ftpGetting) {
+            this->reply(time, "ERROR");
+        } else if (this->suppress) {
+            return;
+        } else {
+            const std::string& data = this->server[this->ftpGetName];
+
+            // The data comes down at the link bandwidth, then goes out over the UART after
+            // the length
+            length = (std::min)((std::min)(length, FTP_MAX_LENGTH), data.size() - this->ftpGetPosition);
+            snprintf(text, sizeof(text), "+FTPGET: 2,%d\r\n", (int)length);
+
+            uint64_t sendTime = (uint64_t)(length * 1000000 / (this->profile.bandwidth * this->signalQuality()));
+
+            this->reply(time + sendTime, text + data.substr(this->ftpGetPosition, length));
+            this->reply(time + sendTime, "OK");
+            // The end of the file is reported once, after the request that reached it
+            if (length > 0 && this->ftpGetPosition + length == data.size()) {
+                this->reply(time + sendTime + this->ms(this->profile.linkLatency), "+FTPGET: 1,0");
+            }
+
+            this->ftpGetPosition += length;
+        }
+    } else if (command == "AT+CPOWD=1") {
+        this->reply(time, "NORMAL POWER DOWN");
+        this->powered = false;
+        this->bearer = false;
+        this->gnssOn = false;
+        this->ftpOpen = false;
+        this->ftpGetting = false;
+    } else {
+        this->reply(time, "ERROR");
+    }
+}
+
+// A chunk of FTP data has arrived from the sketch.  The modem asks for the next one once
+// this one has reached the server.
+void Sim7000Emulator::finishChunk(uint64_t time)
+{
+    uint64_t sendTime = (uint64_t)(this->ftpChunk.size() * 1000000 / (this->profile.bandwidth * this->signalQuality()));
+
+    this->ftpExpected = 0;
+    this->ftpChunks++;
+    this->trace(time, ">", "<" + std::to_string(this->ftpChunk.size()) + " bytes of data>");
+    this->reply(time, "OK");
+
+    if (this->lost() || this->weakSignalLoss()) {
+        this->ftpFailures++;
+        this->ftpOpen = false;
+        this->reply(time + sendTime + this->ms(this->profile.linkLatency), "+FTPPUT: 1,61");
+
+        return;
+    }
+
+    char text[32];
+
+    this->server[this->ftpName] += this->ftpChunk;
+
+    snprintf(text, sizeof(text), "+FTPPUT: 1,1,%d", (int)FTP_MAX_LENGTH);
+    this->reply(time + sendTime + this->ms(this->profile.linkLatency) / 2, text);
+}
@@ -0,0 +1,181 @@
+/*
+    Emulator of the SIM7000 LTE/GPS modem on the Botletics shield.
+
+    Program Description : Answers the AT commands the radiometer sends
+        (power, CFUN, APN, CREG/CEREG, CSQ, GNSS, IPR, bearer, FTP upload,
+        download and size)
+        on the other end of the modem link.  Replies
+        are timed: the UART runs at the modem baud rate, every reply waits for
+        the response latency, registration and the first GPS fix take a set
+        time from power on, FTP data leaves at the link bandwidth, and replies
+        and data chunks can be lost at random.  A weak signal slows the uplink
+        and loses more chunks.  Used with virtual time the
+        whole daily sync runs in well under a second.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : Sim7000Emulator.h
+*/
+
+#ifndef Sim7000Emulator_h
+#define Sim7000Emulator_h
+
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+
+struct ModemProfile
+{
+    // Times in milliseconds
+    unsigned long bootTime = 2800;            // PWRKEY pulse to accepting AT commands
+    unsigned long responseLatency = 20;       // end of a command to its reply
+    unsigned long registrationDelay = 8000;   // power on (or CFUN=1) to registered
+    unsigned long gpsFixDelay = 25000;        // CGNSPWR=1 to the first fix
+    unsigned long bearerDelay = 1500;         // opening the data bearer
+    unsigned long linkLatency = 250;          // round trip to the FTP server
+
+    unsigned long bandwidth = 8000;           // uplink, bytes/s
+    int rssi = 20;                            // AT+CSQ, 0 or 99 never registers, below 15 slows the uplink
+    double dropProbability = 0.0;             // chance a reply or an FTP chunk is lost
+    unsigned long seed = 1;
+
+    // GPS time at the start of the simulation, and the position reported
+    uint32_t epoch = 1792368000UL + 12 * 3600UL;
+    double latitude = 43.084600;
+    double longitude = -77.674300;
+    double altitude = 160.0;
+
+    uint8_t pwrkeyPin = 6;
+};
+
+class Sim7000Emulator : public hostsim::SerialPeer, public hostsim::PinListener
+{
+public:
+    Sim7000Emulator(const ModemProfile& profile);
+
+    //// hostsim
+    void receive(uint8_t c, unsigned long baud, uint64_t time) override;
+    bool transmit(uint64_t time, unsigned long baud, uint8_t* pByte) override;
+    void pinChanged(uint8_t pin, uint8_t value) override;
+
+    //// Statistics
+    unsigned long getCommands() { return this->commands; }
+    unsigned long getDroppedReplies() { return this->droppedReplies; }
+    unsigned long getBytesIn() { return this->bytesIn; }
+    unsigned long getBytesOut() { return this->bytesOut; }
+    unsigned long getGarbledBytes() { return this->garbledBytes; }
+    unsigned long getFtpChunks() { return this->ftpChunks; }
+    unsigned long getFtpFailures() { return this->ftpFailures; }
+    bool isPowered() { return this->powered; }
+
+    //// Fault injection
+    // Change the signal and the loss rate from now on
+    void setRssi(int rssi) { this->profile.rssi = rssi; }
+    void setDropProbability(double probability) { this->profile.dropProbability = probability; }
+
+    // Write every command and reply to pTrace, with the simulated time
+    void setTrace(FILE* pTrace) { this->pTrace = pTrace; }
+
+    // Contents of a file uploaded to the emulated FTP server
+    const std::string& getUploaded(const std::string& name) { return this->server[name]; }
+
+    // Every file on the emulated FTP server, for a harness to change or add to
+    std::map<std::string, std::string>& getServer() { return this->server; }
+
+private:
+    // Text on its way to the UART, and the baud rate it was sent at
+    struct Event
+    {
+        uint64_t time;
+        unsigned long baud;
+        std::string text;
+    };
+
+    ModemProfile profile;
+    std::mt19937 random;
+    FILE* pTrace = nullptr;
+
+    // Power and UART
+    bool powered = false;
+    bool pwrkeyPressed = false;
+    uint64_t pwrkeyLow = 0;
+    uint64_t readyAt = 0;
+    unsigned long baud = 115200;
+    bool echo = true;
+    std::string line;
+
+    // A line feed straight after a command's carriage return is part of the command.  One
+    // that comes later, after the modem has asked for FTP data, is data.
+    bool lineFeedDue = false;
+    uint64_t commandEnd = 0;
+
+    // Replies to the current command are lost
+    bool suppress = false;
+
+    // Bytes on their way to the sketch: time, baud they were sent at, byte
+    struct OutputByte
+    {
+        uint64_t time;
+        unsigned long baud;
+        uint8_t c;
+    };
+
+    std::deque<OutputByte> output;
+    std::vector<Event> events;
+    uint64_t uartFree = 0;
+
+    // Network
+    int functionality = 1;
+    uint64_t registeredAt = 0;
+    bool registrationReported = false;
+    int cregMode = 0;
+    bool bearer = false;
+
+    // GNSS
+    bool gnssOn = false;
+    uint64_t fixAt = 0;
+    unsigned long gnssUrcPeriod = 0;
+    uint64_t nextGnssUrc = 0;
+
+    // FTP
+    std::string ftpName;
+    bool ftpAppend = false;
+    bool ftpOpen = false;
+    size_t ftpExpected = 0;
+    std::string ftpChunk;
+    std::string ftpGetName;
+    bool ftpGetting = false;
+    size_t ftpGetPosition = 0;
+    std::map<std::string, std::string> server;
+
+    // Statistics
+    unsigned long commands = 0;
+    unsigned long droppedReplies = 0;
+    unsigned long bytesIn = 0;
+    unsigned long bytesOut = 0;
+    unsigned long garbledBytes = 0;
+    unsigned long ftpChunks = 0;
+    unsigned long ftpFailures = 0;
+
+    void update(uint64_t time);
+    void trace(uint64_t time, const char* pDirection, const std::string& text);
+    void schedule(uint64_t time, const std::string& text);
+    void reply(uint64_t time, const std::string& text);
+    void handle(const std::string& command, uint64_t time);
+    void finishChunk(uint64_t time);
+    bool lost();
+    double signalQuality();
+    bool weakSignalLoss();
+    bool registered(uint64_t time);
+    std::string gnssInfo(uint64_t time);
+    uint64_t ms(unsigned long value) { return (uint64_t)value * 1000; }
+};
+
+#endif // Sim7000Emulator_h
@@ -0,0 +1,48 @@
+/*
+    Host simulation of the Arduino SoftwareSerial library.
+
+    Program Description : Every port talks to the peer set with
+        hostsim::setSoftwareSerialPeer() (the modem emulator).  Sending blocks
+        for 10 bit times a byte, and received bytes are lost when the 64 byte
+        receive buffer is full, as on the Uno.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : SoftwareSerial.h
+*/
+
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include <Arduino.h>
+
+class SoftwareSerial : public Stream
+{
+public:
+    SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverseLogic = false);
+
+    void begin(long baud);
+    void end();
+    bool listen();
+    bool overflow();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+private:
+    long baud = 0;
+    uint8_t buffer[64];
+    uint8_t head = 0;
+    uint8_t count = 0;
+    bool overflowed = false;
+
+    void receive();
+};
+
+#endif // SoftwareSerial_h
@@ -0,0 +1,148 @@
+/*
+    Checks of the upload backoff.
+
+    Program Description : Runs UploadScheduler::backOff() through a run of
+        failed attempts, with no signal history, with weak hours to skip and
+        with every hour weak, and checks each wait it returns.  Then tries
+        every time of day against random weak hours and checks that no wait
+        is longer than the longest backoff.  Exits with status 1 if a check
+        fails.
+
+        backoff_check [-s SEED] [-n PATTERNS] [-v]
+
+        -n is the number of random weak hour patterns, -v lists every check
+        with the value it got, in ms for the waits.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : backoff_check.cpp
+*/
+
+#include <random>
+
+#include <unistd.h>
+
+#include "UploadScheduler.h"
+
+// The sketch's settings
+#define MIN_RSSI -100
+#define MIN_BACKOFF 300000UL
+#define MAX_BACKOFF 14400000UL
+#define MAX_DEFERRALS 6
+
+#define WEAK_RSSI -110
+#define GOOD_RSSI -80
+
+static int checks = 0;
+static int passed = 0;
+static bool verbose = false;
+
+static void check(const char* pName, unsigned long value, unsigned long expected)
+{
+    checks++;
+
+    if (value == expected) {
+        passed++;
+    }
+
+    if (verbose || value != expected) {
+        printf("%-48s %9lu, expected %9lu  %s\n", pName, value, expected, (value == expected) ? "" : "FAILED");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long seed = 1;
+    int patterns = 1000;
+    int option;
+    char name[64];
+
+    while ((option = getopt(argc, argv, "s:n:v")) != -1) {
+        switch (option) {
+            case 's': seed = strtoul(optarg, nullptr, 10); break;
+            case 'n': patterns = atoi(optarg); break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "see the header of backoff_check.cpp for the options\n");
+
+                return 2;
+        }
+    }
+
+    // No history, the backoff doubles from the shortest to the longest and stays there
+    {
+        UploadScheduler scheduler(MIN_RSSI, MIN_BACKOFF, MAX_BACKOFF, MAX_DEFERRALS);
+        const unsigned long expected[] = {300000, 600000, 1200000, 2400000, 4800000, 9600000, 14400000, 14400000};
+
+        for (int i = 0; i < 8; i++) {
+            snprintf(name, sizeof(name), "no history, attempt %d", i + 1);
+            check(name, scheduler.backOff(10, 0), expected[i]);
+        }
+
+        scheduler.succeeded();
+        check("no history, after a success", scheduler.backOff(10, 0), MIN_BACKOFF);
+    }
+
+    // Weak hours are skipped to the start of the next hour that is not weak
+    {
+        UploadScheduler scheduler(MIN_RSSI, MIN_BACKOFF, MAX_BACKOFF, MAX_DEFERRALS);
+
+        scheduler.record(12, WEAK_RSSI, true);
+        scheduler.record(13, WEAK_RSSI, true);
+        scheduler.record(14, GOOD_RSSI, true);
+
+        check("11:58, 12:00 and 13:00 weak", scheduler.backOff(11, 58), (2 * 60 + 2) * 60000UL);
+        check("11:00, retry at 11:10 before the weak hours", scheduler.backOff(11, 0), 600000);
+    }
+
+    // The next hour that is not weak is almost a day away, which is past the longest backoff
+    {
+        UploadScheduler scheduler(MIN_RSSI, MIN_BACKOFF, MAX_BACKOFF, MAX_DEFERRALS);
+
+        for (byte hour = 0; hour < 24; hour++) {
+            scheduler.record(hour, (hour == 11) ? GOOD_RSSI : WEAK_RSSI, true);
+        }
+
+        check("12:00, only 11:00 not weak", scheduler.backOff(12, 0), MAX_BACKOFF);
+        check("10:50, only 11:00 not weak", scheduler.backOff(10, 50), 600000);
+    }
+
+    // Every hour weak, the backoff is all there is
+    {
+        UploadScheduler scheduler(MIN_RSSI, MIN_BACKOFF, MAX_BACKOFF, MAX_DEFERRALS);
+
+        for (byte hour = 0; hour < 24; hour++) {
+            scheduler.record(hour, WEAK_RSSI, true);
+        }
+
+        check("every hour weak, attempt 1", scheduler.backOff(3, 30), MIN_BACKOFF);
+        check("every hour weak, attempt 2", scheduler.backOff(3, 35), 2 * MIN_BACKOFF);
+    }
+
+    // No wait at any time of day is past the longest backoff
+    std::mt19937 random(seed);
+    unsigned long tooLong = 0;
+
+    for (int pattern = 0; pattern < patterns; pattern++) {
+        UploadScheduler scheduler(MIN_RSSI, MIN_BACKOFF, MAX_BACKOFF, MAX_DEFERRALS);
+
+        for (byte hour = 0; hour < 24; hour++) {
+            scheduler.record(hour, (random() % 4 == 0) ? GOOD_RSSI : WEAK_RSSI, true);
+        }
+
+        for (int attempt = 0; attempt < 10; attempt++) {
+            unsigned long minute = random() % (24 * 60);
+            tooLong += (scheduler.backOff(minute / 60, minute % 60) > MAX_BACKOFF) ? 1 : 0;
+        }
+    }
+
+    snprintf(name, sizeof(name), "%d weak hour patterns, waits too long", patterns);
+    check(name, tooLong, 0);
+
+    printf("%d of %d checks passed\n", passed, checks);
+
+    return (passed == checks) ? 0 : 1;
+}
@@ -0,0 +1,1201 @@
+/*
+    Host simulation of the Arduino core, SD and RTC libraries.
+
+    Program Description : Implementations behind the host versions of
+        Arduino.h, SD.h, SPI.h and RTClib.h, and the host-only controls in
+        hostsim.h.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : hostsim.cpp
+*/
+
+// Standard library headers go first, Arduino.h defines min() and max() as macros
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// SD.h replaces the POSIX open flags
+static const int POSIX_O_RDWR = O_RDWR;
+static const int POSIX_O_NOCTTY = O_NOCTTY;
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "SD.h"
+#include "RTClib.h"
+#include "SoftwareSerial.h"
+#include "hostsim.h"
+
+HardwareSerial Serial;
+SPIClass SPI;
+SDClass SD;
+
+//// Host state
+namespace
+{
+    int serialIn = 0;
+    int serialOut = 1;
+    unsigned long serialCorruption = 0;
+    unsigned long serialBaud = 0;
+    bool serialPacing = true;
+
+    // Time when the last byte written to Serial has left the simulated UART
+    uint64_t serialBusyUntil = 0;
+    unsigned long serialWritten = 0;
+
+    // Bytes read from the serial descriptor that have not been consumed
+    uint8_t rxBuffer[256];
+    size_t rxHead = 0;
+    size_t rxTail = 0;
+
+    std::string sdRoot = ".";
+
+    // SD card timing and stalls
+    unsigned long sdLatency = 0;
+    double sdStallProbability = 0.0;
+    unsigned long sdStallTime = 0;
+    unsigned long sdStalls = 0;
+    std::mt19937 sdRandom(1);
+
+    // Sector reads, with the one sector the SD library caches
+    unsigned long sdSectorTime = 0;
+    unsigned long sdSectorsRead = 0;
+    std::string sdCachedFile;
+    uint32_t sdCachedSector = 0;
+
+    // RTC reading (s) at the simulated time it was last set, and its rate against that time
+    double rtcBase = -1.0;
+    uint64_t rtcSetAt = 0;
+    double rtcRate = 1.0;
+
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    bool virtualTime = false;
+    unsigned long callCost = 4;
+    uint64_t virtualClock = 0;
+    uint64_t timeLimit = 0;
+
+    hostsim::PinListener* pPinListener = nullptr;
+    hostsim::SerialPeer* pSerialPeer = nullptr;
+    unsigned long softwareSerialOverflows = 0;
+
+    unsigned long ledger[hostsim::LEDGER_ENTRIES] = {};
+
+    void charge(hostsim::LedgerEntry entry, unsigned long count = 1)
+    {
+        ledger[entry] += count;
+    }
+
+    void checkTimeLimit(uint64_t now)
+    {
+        if (timeLimit > 0 && now > timeLimit) {
+            fprintf(stderr, "hostsim: time limit of %.1f s reached\n", timeLimit / 1e6);
+            exit(3);
+        }
+    }
+
+    // Pull whatever is waiting on the serial descriptor into the receive buffer
+    void fillRxBuffer()
+    {
+        if (rxHead == rxTail) {
+            rxHead = 0;
+            rxTail = 0;
+        }
+
+        if (rxTail == sizeof(rxBuffer)) {
+            return;
+        }
+
+        struct pollfd descriptor = { serialIn, POLLIN, 0 };
+
+        if (poll(&descriptor, 1, 0) > 0 && (descriptor.revents & POLLIN)) {
+            ssize_t length = ::read(serialIn, rxBuffer + rxTail, sizeof(rxBuffer) - rxTail);
+
+            if (length > 0) {
+                rxTail += length;
+            }
+        }
+    }
+
+    // The PCF8523 counts from where it was last set, at its own rate
+    double rtcSeconds()
+    {
+        if (rtcBase < 0.0) {
+            rtcBase = (double)::time(nullptr);
+            rtcSetAt = hostsim::clock();
+        }
+
+        return rtcBase + (hostsim::clock() - rtcSetAt) * rtcRate / 1e6;
+    }
+
+    std::string sdPath(const char* pFilename)
+    {
+        std::string name(pFilename);
+
+        while (!name.empty() && name[0] == '/') {
+            name.erase(0, 1);
+        }
+
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+
+        return sdRoot + "/" + name;
+    }
+}
+
+//// hostsim.h
+uint64_t hostsim::clock()
+{
+    if (virtualTime) {
+        return virtualClock;
+    }
+
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void hostsim::advance(uint64_t us)
+{
+    if (virtualTime) {
+        virtualClock += us;
+    } else if (us > 0) {
+        usleep(us);
+    }
+
+    checkTimeLimit(clock());
+}
+
+void hostsim::setVirtualTime(bool enabled, unsigned long cost)
+{
+    virtualClock = clock();
+    virtualTime = enabled;
+    callCost = cost;
+}
+
+void hostsim::setTimeLimit(uint64_t limit)
+{
+    timeLimit = limit;
+}
+
+void hostsim::setPinListener(PinListener* pListener)
+{
+    pPinListener = pListener;
+}
+
+void hostsim::setSoftwareSerialPeer(SerialPeer* pPeer)
+{
+    pSerialPeer = pPeer;
+}
+
+unsigned long hostsim::getSoftwareSerialOverflows()
+{
+    return softwareSerialOverflows;
+}
+
+void hostsim::resetLedger()
+{
+    std::fill(ledger, ledger + LEDGER_ENTRIES, 0UL);
+}
+
+unsigned long hostsim::getLedger(LedgerEntry entry)
+{
+    return ledger[entry];
+}
+
+void hostsim::setSerial(int inFd, int outFd)
+{
+    serialIn = inFd;
+    serialOut = outFd;
+    rxHead = 0;
+    rxTail = 0;
+}
+
+void hostsim::setSerialCorruption(unsigned long every)
+{
+    serialCorruption = every;
+    serialWritten = 0;
+}
+
+void hostsim::setSerialPacing(bool enabled)
+{
+    serialPacing = enabled;
+}
+
+void hostsim::setSdRoot(const char* pPath)
+{
+    sdRoot = pPath;
+}
+
+void hostsim::setSdTiming(unsigned long latency, double stallProbability, unsigned long stallTime, unsigned long seed)
+{
+    sdLatency = latency;
+    sdStallProbability = stallProbability;
+    sdStallTime = stallTime;
+    sdRandom.seed(seed);
+}
+
+unsigned long hostsim::getSdStalls()
+{
+    return sdStalls;
+}
+
+void hostsim::setSdSectorTime(unsigned long time)
+{
+    sdSectorTime = time;
+}
+
+unsigned long hostsim::getSdSectorsRead()
+{
+    return sdSectorsRead;
+}
+
+void hostsim::setRtc(uint32_t unixtime)
+{
+    rtcBase = unixtime;
+    rtcSetAt = clock();
+}
+
+// The drift applies from now on
+void hostsim::setRtcDrift(double ppm)
+{
+    rtcBase = rtcSeconds();
+    rtcSetAt = clock();
+    rtcRate = 1.0 + ppm / 1e6;
+}
+
+const char* hostsim::openSerialPty()
+{
+    static char slaveName[64];
+    int master = posix_openpt(POSIX_O_RDWR | POSIX_O_NOCTTY);
+
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        return nullptr;
+    }
+
+    strncpy(slaveName, ptsname(master), sizeof(slaveName) - 1);
+
+    // Keep the slave side open so the master does not see a hang-up between host tool
+    // runs, and make it raw so nothing written by the sketch is echoed back to it
+    int slave = open(slaveName, POSIX_O_RDWR | POSIX_O_NOCTTY);
+    struct termios settings;
+
+    if (slave < 0 || tcgetattr(slave, &settings) != 0) {
+        return nullptr;
+    }
+
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+
+    setSerial(master, master);
+
+    return slaveName;
+}
+
+//// Pins
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    charge(hostsim::LEDGER_DIGITAL_WRITE);
+
+    if (pPinListener) {
+        pPinListener->pinChanged(pin, value);
+    }
+}
+
+int digitalRead(uint8_t) { return LOW; }
+int analogRead(uint8_t)
+{
+    charge(hostsim::LEDGER_ANALOG_READ);
+
+    return 0;
+}
+
+void attachInterrupt(uint8_t, void (*)(), int) {}
+void detachInterrupt(uint8_t) {}
+void noInterrupts() {}
+void interrupts() {}
+
+//// SPI
+uint8_t SPIClass::transfer(uint8_t)
+{
+    charge(hostsim::LEDGER_SPI_TRANSFER);
+
+    return 0;
+}
+
+//// Time
+unsigned long micros()
+{
+    charge(hostsim::LEDGER_CLOCK_READ);
+
+    if (virtualTime) {
+        hostsim::advance(callCost);
+    }
+
+    return (unsigned long)hostsim::clock();
+}
+
+unsigned long millis()
+{
+    charge(hostsim::LEDGER_CLOCK_READ);
+
+    if (virtualTime) {
+        hostsim::advance(callCost);
+    }
+
+    return (unsigned long)(hostsim::clock() / 1000);
+}
+
+void delay(unsigned long ms)
+{
+    charge(hostsim::LEDGER_DELAY_US, ms * 1000);
+    hostsim::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    charge(hostsim::LEDGER_DELAY_US, us);
+    hostsim::advance(us);
+}
+
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh)
+{
+    return (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+
+char* dtostrf(double value, signed char width, unsigned char precision, char* pBuffer)
+{
+    charge(hostsim::LEDGER_DTOSTRF);
+
+    sprintf(pBuffer, "%*.*f", width, precision, value);
+
+    return pBuffer;
+}
+
+int snprintf_P(char* pBuffer, size_t size, const char* pFormat, ...)
+{
+    va_list arguments;
+
+    va_start(arguments, pFormat);
+    int length = vsnprintf(pBuffer, size, pFormat, arguments);
+    va_end(arguments);
+
+    charge(hostsim::LEDGER_FORMAT);
+    charge(hostsim::LEDGER_FORMAT_BYTE, (length < 0) ? 0 : (std::min)((size_t)length, size > 0 ? size - 1 : 0));
+
+    for (const char* pField = strchr(pFormat, '%'); pField; pField = strchr(pField + 1, '%')) {
+        if (pField[1] == '%') {
+            pField++;
+        } else {
+            charge(hostsim::LEDGER_FORMAT_FIELD);
+        }
+    }
+
+    return length;
+}
+
+//// Print
+size_t Print::write(const uint8_t* pBuffer, size_t size)
+{
+    size_t n = 0;
+
+    while (size--) {
+        n += this->write(*pBuffer++);
+    }
+
+    return n;
+}
+
+size_t Print::write(const char* pString)
+{
+    return this->write((const uint8_t*)pString, strlen(pString));
+}
+
+size_t Print::write(const char* pBuffer, size_t size)
+{
+    return this->write((const uint8_t*)pBuffer, size);
+}
+
+size_t Print::print(const __FlashStringHelper* pString)
+{
+    return this->write((const char*)pString);
+}
+
+size_t Print::print(const char* pString)
+{
+    return this->write(pString);
+}
+
+size_t Print::print(char c)
+{
+    return this->write((uint8_t)c);
+}
+
+size_t Print::print(long n, int base)
+{
+    char buffer[24];
+
+    snprintf(buffer, sizeof(buffer), (base == HEX) ? "%lX" : "%ld", n);
+
+    return this->write(buffer);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    char buffer[24];
+
+    snprintf(buffer, sizeof(buffer), (base == HEX) ? "%lX" : "%lu", n);
+
+    return this->write(buffer);
+}
+
+size_t Print::print(int n, int base)
+{
+    return this->print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+    return this->print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned char n, int base)
+{
+    return this->print((unsigned long)n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+    char buffer[48];
+
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+
+    return this->write(buffer);
+}
+
+size_t Print::println()
+{
+    return this->write("\r\n");
+}
+
+//// Stream
+void Stream::setTimeout(unsigned long timeout)
+{
+    this->timeout = timeout;
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+
+    do {
+        int c = this->read();
+
+        if (c >= 0) {
+            return c;
+        }
+    } while (millis() - start < this->timeout);
+
+    return -1;
+}
+
+size_t Stream::readBytes(char* pBuffer, size_t length)
+{
+    size_t count = 0;
+
+    while (count < length) {
+        int c = this->timedRead();
+
+        if (c < 0) {
+            break;
+        }
+
+        pBuffer[count++] = (char)c;
+    }
+
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* pBuffer, size_t length)
+{
+    size_t count = 0;
+
+    while (count < length) {
+        int c = this->timedRead();
+
+        if (c < 0 || c == terminator) {
+            break;
+        }
+
+        pBuffer[count++] = (char)c;
+    }
+
+    return count;
+}
+
+//// HardwareSerial
+void HardwareSerial::begin(unsigned long baud)
+{
+    serialBaud = baud;
+}
+
+void HardwareSerial::end() {}
+
+int HardwareSerial::available()
+{
+    fillRxBuffer();
+
+    return (int)(rxTail - rxHead);
+}
+
+int HardwareSerial::read()
+{
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    return rxBuffer[rxHead++];
+}
+
+int HardwareSerial::peek()
+{
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    return rxBuffer[rxHead];
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return this->write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* pBuffer, size_t size)
+{
+    charge(hostsim::LEDGER_SERIAL_BYTE, size);
+
+    std::vector<uint8_t> data(pBuffer, pBuffer + size);
+
+    // Simulate line noise
+    if (serialCorruption > 0) {
+        for (size_t i = 0; i < size; i++) {
+            if (++serialWritten % serialCorruption == 0) {
+                data[i] ^= 0xFF;
+            }
+        }
+    }
+
+    // The UART sends at 10 bits a byte from a 64 byte buffer, the sketch is only held
+    // up once the buffer is full
+    if (serialPacing && serialBaud > 0) {
+        uint64_t now = hostsim::clock();
+        uint64_t bufferTime = (64 * 10000000ULL) / serialBaud;
+
+        if (serialBusyUntil < now) {
+            serialBusyUntil = now;
+        }
+
+        serialBusyUntil += (size * 10000000ULL) / serialBaud;
+
+        if (serialBusyUntil > now + bufferTime) {
+            hostsim::advance(serialBusyUntil - now - bufferTime);
+        }
+    }
+
+    size_t written = 0;
+
+    while (written < size) {
+        ssize_t n = ::write(serialOut, data.data() + written, size - written);
+
+        if (n <= 0) {
+            break;
+        }
+
+        written += n;
+    }
+
+    return written;
+}
+
+void HardwareSerial::flush()
+{
+    uint64_t now = hostsim::clock();
+
+    if (serialPacing && serialBusyUntil > now) {
+        hostsim::advance(serialBusyUntil - now);
+    }
+
+    if (isatty(serialOut)) {
+        tcdrain(serialOut);
+    }
+}
+
+//// SoftwareSerial
+SoftwareSerial::SoftwareSerial(uint8_t, uint8_t, bool) {}
+
+void SoftwareSerial::begin(long baud)
+{
+    this->baud = baud;
+    this->head = 0;
+    this->count = 0;
+}
+
+void SoftwareSerial::end()
+{
+    this->baud = 0;
+}
+
+bool SoftwareSerial::listen()
+{
+    return true;
+}
+
+bool SoftwareSerial::overflow()
+{
+    bool overflowed = this->overflowed;
+
+    this->overflowed = false;
+
+    return overflowed;
+}
+
+// Move the bytes that have arrived since the last call into the receive buffer.  No
+// bytes are read in between, so any that find the buffer full are lost.
+void SoftwareSerial::receive()
+{
+    uint8_t c;
+
+    if (!pSerialPeer || this->baud == 0) {
+        return;
+    }
+
+    while (pSerialPeer->transmit(hostsim::clock(), this->baud, &c)) {
+        if (this->count < sizeof(this->buffer)) {
+            this->buffer[(this->head + this->count++) % sizeof(this->buffer)] = c;
+        } else {
+            this->overflowed = true;
+            softwareSerialOverflows++;
+        }
+    }
+}
+
+int SoftwareSerial::available()
+{
+    this->receive();
+
+    return this->count;
+}
+
+int SoftwareSerial::read()
+{
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    uint8_t c = this->buffer[this->head];
+
+    this->head = (this->head + 1) % sizeof(this->buffer);
+    this->count--;
+
+    return c;
+}
+
+int SoftwareSerial::peek()
+{
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    return this->buffer[this->head];
+}
+
+// Sending blocks for the whole byte, as it does on the Uno
+size_t SoftwareSerial::write(uint8_t c)
+{
+    if (this->baud == 0) {
+        return 0;
+    }
+
+    hostsim::advance(10000000ULL / this->baud);
+
+    if (pSerialPeer) {
+        pSerialPeer->receive(c, this->baud, hostsim::clock());
+    }
+
+    return 1;
+}
+
+//// DateTime, using the same 2000-01-01 based day count as RTClib
+namespace
+{
+    const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const uint32_t SECONDS_FROM_1970_TO_2000 = 946684800UL;
+
+    uint16_t dateToDays(uint16_t y, uint8_t m, uint8_t d)
+    {
+        if (y >= 2000) {
+            y -= 2000;
+        }
+
+        uint16_t days = d;
+
+        for (uint8_t i = 1; i < m; i++) {
+            days += daysInMonth[i - 1];
+        }
+
+        if (m > 2 && y % 4 == 0) {
+            days++;
+        }
+
+        return days + 365 * y + (y + 3) / 4 - 1;
+    }
+}
+
+DateTime::DateTime(uint32_t t)
+{
+    t -= SECONDS_FROM_1970_TO_2000;
+
+    this->ss = t % 60;
+    t /= 60;
+    this->mm = t % 60;
+    t /= 60;
+    this->hh = t % 24;
+
+    uint16_t days = t / 24;
+    uint8_t leap;
+
+    for (this->y = 0;; this->y++) {
+        leap = (this->y % 4 == 0);
+
+        if (days < 365 + leap) {
+            break;
+        }
+
+        days -= 365 + leap;
+    }
+
+    for (this->m = 1; this->m < 12; this->m++) {
+        uint8_t length = daysInMonth[this->m - 1];
+
+        if (leap && this->m == 2) {
+            length++;
+        }
+
+        if (days < length) {
+            break;
+        }
+
+        days -= length;
+    }
+
+    this->d = days + 1;
+    this->y += 2000;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+    this->y = year;
+    this->m = month;
+    this->d = day;
+    this->hh = hour;
+    this->mm = minute;
+    this->ss = second;
+}
+
+uint8_t DateTime::dayOfTheWeek() const
+{
+    // 2000-01-01 was a Saturday
+    return (dateToDays(this->y, this->m, this->d) + 6) % 7;
+}
+
+uint32_t DateTime::unixtime() const
+{
+    uint32_t days = dateToDays(this->y, this->m, this->d);
+
+    return ((days * 24UL + this->hh) * 60 + this->mm) * 60 + this->ss + SECONDS_FROM_1970_TO_2000;
+}
+
+//// RTC_PCF8523
+// Setting the PCF8523 also restarts its divider, so the new second starts now
+void RTC_PCF8523::adjust(const DateTime& dt)
+{
+    hostsim::setRtc(dt.unixtime());
+}
+
+DateTime RTC_PCF8523::now()
+{
+    charge(hostsim::LEDGER_RTC_READ);
+
+    return DateTime((uint32_t)floor(rtcSeconds()));
+}
+
+//// SD
+struct HostFile
+{
+    FILE* pFile = nullptr;
+    bool append = false;
+    bool directory = false;
+
+    // Written to since the last flush, so the cached sector and the directory entry go
+    // to the card at the next one
+    bool dirty = false;
+    std::vector<std::string> entries;
+    size_t nextEntry = 0;
+    char name[13] = "";
+    int references = 1;
+};
+
+File::File()
+{
+    this->pHostFile = nullptr;
+}
+
+File::File(HostFile* pHostFile)
+{
+    this->pHostFile = pHostFile;
+}
+
+File::File(const File& other)
+{
+    this->pHostFile = other.pHostFile;
+
+    if (this->pHostFile) {
+        this->pHostFile->references++;
+    }
+}
+
+File& File::operator=(const File& other)
+{
+    if (this != &other) {
+        this->release();
+        this->pHostFile = other.pHostFile;
+
+        if (this->pHostFile) {
+            this->pHostFile->references++;
+        }
+    }
+
+    return *this;
+}
+
+File::~File()
+{
+    this->release();
+}
+
+void File::release()
+{
+    if (this->pHostFile && --this->pHostFile->references == 0) {
+        if (this->pHostFile->pFile) {
+            fclose(this->pHostFile->pFile);
+        }
+
+        delete this->pHostFile;
+    }
+
+    this->pHostFile = nullptr;
+}
+
+size_t File::write(uint8_t c)
+{
+    return this->write(&c, 1);
+}
+
+size_t File::write(const uint8_t* pBuffer, size_t size)
+{
+    if (!this->pHostFile || !this->pHostFile->pFile) {
+        return 0;
+    }
+
+    if (this->pHostFile->append) {
+        fseek(this->pHostFile->pFile, 0, SEEK_END);
+    }
+
+    // The SD library writes a cached sector out when the write moves on to the next one
+    long start = ftell(this->pHostFile->pFile);
+    size_t written = fwrite(pBuffer, 1, size, this->pHostFile->pFile);
+
+    charge(hostsim::LEDGER_SD_BYTE, written);
+    charge(hostsim::LEDGER_SD_SECTOR_WRITE, (start + written) / 512 - start / 512);
+    this->pHostFile->dirty = this->pHostFile->dirty || written > 0;
+
+    return written;
+}
+
+int File::available()
+{
+    if (!this->pHostFile || !this->pHostFile->pFile) {
+        return 0;
+    }
+
+    return (int)(this->size() - this->position());
+}
+
+int File::read()
+{
+    uint8_t c;
+
+    return (this->read(&c, 1) == 1) ? c : -1;
+}
+
+int File::peek()
+{
+    int c = this->read();
+
+    if (c >= 0) {
+        fseek(this->pHostFile->pFile, -1, SEEK_CUR);
+    }
+
+    return c;
+}
+
+void File::flush()
+{
+    if (this->pHostFile && this->pHostFile->pFile) {
+        fflush(this->pHostFile->pFile);
+        this->sync();
+    }
+}
+
+int File::read(void* pBuffer, uint16_t length)
+{
+    if (!this->pHostFile || !this->pHostFile->pFile) {
+        return -1;
+    }
+
+    // Switching from writing to reading needs a positioning call
+    fseek(this->pHostFile->pFile, 0, SEEK_CUR);
+
+    uint32_t position = this->position();
+    int read = (int)fread(pBuffer, 1, length, this->pHostFile->pFile);
+
+    // Every sector the read touches, other than the cached one, is read from the card
+    for (uint32_t sector = position / 512; read > 0 && sector <= (position + read - 1) / 512; sector++) {
+        if (sector != sdCachedSector || sdCachedFile != this->pHostFile->name) {
+            sdCachedFile = this->pHostFile->name;
+            sdCachedSector = sector;
+            sdSectorsRead++;
+            charge(hostsim::LEDGER_SD_SECTOR_READ);
+            hostsim::advance(sdSectorTime);
+        }
+    }
+
+    return read;
+}
+
+bool File::seek(uint32_t position)
+{
+    if (!this->pHostFile || !this->pHostFile->pFile || position > this->size()) {
+        return false;
+    }
+
+    return fseek(this->pHostFile->pFile, position, SEEK_SET) == 0;
+}
+
+uint32_t File::position()
+{
+    if (!this->pHostFile || !this->pHostFile->pFile) {
+        return 0;
+    }
+
+    return (uint32_t)ftell(this->pHostFile->pFile);
+}
+
+uint32_t File::size()
+{
+    if (!this->pHostFile || !this->pHostFile->pFile) {
+        return 0;
+    }
+
+    fflush(this->pHostFile->pFile);
+
+    struct stat status;
+
+    return (fstat(fileno(this->pHostFile->pFile), &status) == 0) ? (uint32_t)status.st_size : 0;
+}
+
+void File::close()
+{
+    if (this->pHostFile && this->pHostFile->pFile) {
+        this->sync();
+        fclose(this->pHostFile->pFile);
+        this->pHostFile->pFile = nullptr;
+    }
+
+    this->release();
+}
+
+// The cached sector and the directory entry with the new size
+void File::sync()
+{
+    if (this->pHostFile->dirty) {
+        charge(hostsim::LEDGER_SD_SECTOR_WRITE, 2);
+        this->pHostFile->dirty = false;
+    }
+}
+
+File::operator bool()
+{
+    return this->pHostFile && (this->pHostFile->pFile || this->pHostFile->directory);
+}
+
+char* File::name()
+{
+    return this->pHostFile ? this->pHostFile->name : (char*)"";
+}
+
+bool File::isDirectory()
+{
+    return this->pHostFile && this->pHostFile->directory;
+}
+
+File File::openNextFile(uint8_t mode)
+{
+    if (!this->isDirectory() || this->pHostFile->nextEntry >= this->pHostFile->entries.size()) {
+        return File();
+    }
+
+    return SD.open(this->pHostFile->entries[this->pHostFile->nextEntry++].c_str(), mode);
+}
+
+void File::rewindDirectory()
+{
+    if (this->isDirectory()) {
+        this->pHostFile->nextEntry = 0;
+    }
+}
+
+bool SDClass::begin(uint8_t)
+{
+    struct stat status;
+
+    charge(hostsim::LEDGER_SD_BEGIN);
+    hostsim::advance(sdLatency);
+
+    if (sdStallProbability > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(sdRandom) < sdStallProbability) {
+        sdStalls++;
+        hostsim::advance((uint64_t)sdStallTime * 1000);
+    }
+
+    return stat(sdRoot.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+void SDClass::end() {}
+
+File SDClass::open(const char* filename, uint8_t mode)
+{
+    HostFile* pHostFile = new HostFile();
+
+    // The root directory
+    if (strcmp(filename, "/") == 0) {
+        DIR* pDirectory = opendir(sdRoot.c_str());
+
+        if (!pDirectory) {
+            delete pHostFile;
+
+            return File();
+        }
+
+        while (struct dirent* pEntry = readdir(pDirectory)) {
+            if (pEntry->d_name[0] != '.' && strlen(pEntry->d_name) <= 12) {
+                pHostFile->entries.push_back(pEntry->d_name);
+            }
+        }
+
+        closedir(pDirectory);
+        std::sort(pHostFile->entries.begin(), pHostFile->entries.end());
+
+        pHostFile->directory = true;
+        strcpy(pHostFile->name, "/");
+
+        return File(pHostFile);
+    }
+
+    std::string path = sdPath(filename);
+    const char* pMode = "rb";
+    struct stat status;
+
+    charge(hostsim::LEDGER_SD_LOOKUP);
+
+    if (mode & O_WRITE) {
+        if (mode & O_TRUNC) {
+            pMode = "w+b";
+        } else if (stat(path.c_str(), &status) == 0) {
+            pMode = "r+b";
+        } else if (mode & O_CREAT) {
+            pMode = "w+b";
+        } else {
+            delete pHostFile;
+
+            return File();
+        }
+    }
+
+    pHostFile->pFile = fopen(path.c_str(), pMode);
+
+    if (!pHostFile->pFile) {
+        delete pHostFile;
+
+        return File();
+    }
+
+    pHostFile->append = (mode & O_APPEND) != 0;
+
+    if (pHostFile->append) {
+        fseek(pHostFile->pFile, 0, SEEK_END);
+    }
+
+    strncpy(pHostFile->name, path.c_str() + path.rfind('/') + 1, sizeof(pHostFile->name) - 1);
+
+    return File(pHostFile);
+}
+
+bool SDClass::exists(const char* filename)
+{
+    struct stat status;
+
+    charge(hostsim::LEDGER_SD_LOOKUP);
+
+    return stat(sdPath(filename).c_str(), &status) == 0;
+}
+
+bool SDClass::remove(const char* filename)
+{
+    return unlink(sdPath(filename).c_str()) == 0;
+}
+
+bool SDClass::mkdir(const char* filename)
+{
+    return ::mkdir(sdPath(filename).c_str(), 0755) == 0;
+}
+
+void SdFile::ls(uint8_t flags)
+{
+    File root = SD.open("/");
+
+    while (File entry = root.openNextFile()) {
+        Serial.print(entry.name());
+
+        if (flags & LS_SIZE) {
+            Serial.print(' ');
+            Serial.print((unsigned long)entry.size());
+        }
+
+        Serial.println();
+    }
+}
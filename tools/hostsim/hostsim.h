@@ -0,0 +1,137 @@
+/*
+    Controls for the host simulation that have no Arduino equivalent.
+
+    Program Description : Host programs use these to connect Serial to a
+        file descriptor, point the SD card at a directory, and inject faults.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : hostsim.h
+*/
+
+#ifndef hostsim_h
+#define hostsim_h
+
+#include <stdint.h>
+
+namespace hostsim
+{
+    //// Time
+    // Microseconds since the start of the simulation, never wraps
+    uint64_t clock();
+
+    // Let simulated time pass, sleeping for it unless time is virtual
+    void advance(uint64_t us);
+
+    // With virtual time delay() returns at once and every millis() or micros() call
+    // costs callCost microseconds, so busy-wait loops still make progress
+    void setVirtualTime(bool enabled, unsigned long callCost = 4);
+
+    // Stop the program with exit code 3 once the simulated time passes limit (us), 0
+    // for no limit
+    void setTimeLimit(uint64_t limit);
+
+    //// Pins
+    class PinListener
+    {
+    public:
+        virtual ~PinListener() {}
+        virtual void pinChanged(uint8_t pin, uint8_t value) = 0;
+    };
+
+    // Called for every digitalWrite()
+    void setPinListener(PinListener* pListener);
+
+    //// Serial
+    // Serial reads from inFd and writes to outFd (stdin and stdout by default)
+    void setSerial(int inFd, int outFd);
+
+    // Flip the bits of every nth byte written to Serial, 0 to turn it off
+    void setSerialCorruption(unsigned long every);
+
+    // Send Serial output no faster than the baud rate passed to Serial.begin() (on by
+    // default)
+    void setSerialPacing(bool enabled);
+
+    //// SD card
+    // Directory that stands in for the SD card
+    void setSdRoot(const char* pPath);
+
+    // Time SD.begin() takes (us), and the chance that it stalls for stallTime (ms) on top,
+    // as a card does while it is busy with wear levelling
+    void setSdTiming(unsigned long latency, double stallProbability = 0.0, unsigned long stallTime = 0, unsigned long seed = 1);
+
+    // SD.begin() calls that stalled
+    unsigned long getSdStalls();
+
+    // Time reading a 512 byte sector takes (us).  As in the SD library one sector is cached,
+    // so reads within it cost nothing.
+    void setSdSectorTime(unsigned long time);
+
+    // Sectors read from the card
+    unsigned long getSdSectorsRead();
+
+    //// RTC
+    // Set the PCF8523 to a time (s since 1970).  Until it is set it starts at the host time.
+    void setRtc(uint32_t unixtime);
+
+    // How fast the PCF8523 runs against the simulated time, in parts per million
+    void setRtcDrift(double ppm);
+
+    // Create a pty with a raw line discipline and connect Serial to its master side.
+    // Returns the path of the slave side for the host tool to open, or nullptr.
+    const char* openSerialPty();
+
+    //// SoftwareSerial
+    // The device on the other end of every SoftwareSerial port
+    class SerialPeer
+    {
+    public:
+        virtual ~SerialPeer() {}
+
+        // A byte from the sketch, sent at baud, has arrived at time (us)
+        virtual void receive(uint8_t c, unsigned long baud, uint64_t time) = 0;
+
+        // The next byte for the sketch if it has arrived by time (us).  The port is
+        // listening at baud.
+        virtual bool transmit(uint64_t time, unsigned long baud, uint8_t* pByte) = 0;
+    };
+
+    void setSoftwareSerialPeer(SerialPeer* pPeer);
+
+    // Bytes dropped because the 64 byte SoftwareSerial receive buffer was full
+    unsigned long getSoftwareSerialOverflows();
+
+    //// Cycle ledger
+    // The calls into the core and the libraries that cost the Uno more than a few cycles
+    // are counted, so a host program can estimate what sketch code takes on the AVR.
+    // Plain arithmetic and string handling between the calls is not counted.
+    enum LedgerEntry
+    {
+        LEDGER_DIGITAL_WRITE,       // digitalWrite()
+        LEDGER_ANALOG_READ,         // analogRead()
+        LEDGER_SPI_TRANSFER,        // SPI.transfer(), one byte
+        LEDGER_CLOCK_READ,          // millis() and micros()
+        LEDGER_DELAY_US,            // microseconds spent in delay() and delayMicroseconds()
+        LEDGER_DTOSTRF,             // dtostrf()
+        LEDGER_FORMAT,              // snprintf_P()
+        LEDGER_FORMAT_FIELD,        // conversions in the snprintf_P() format
+        LEDGER_FORMAT_BYTE,         // characters snprintf_P() wrote
+        LEDGER_SERIAL_BYTE,         // bytes written to Serial
+        LEDGER_RTC_READ,            // RTC_PCF8523::now()
+        LEDGER_SD_BEGIN,            // SD.begin()
+        LEDGER_SD_LOOKUP,           // SD.open() and SD.exists() of a file
+        LEDGER_SD_BYTE,             // bytes written to files
+        LEDGER_SD_SECTOR_READ,      // 512 byte sectors read from the card
+        LEDGER_SD_SECTOR_WRITE,     // 512 byte sectors written to the card
+        LEDGER_ENTRIES
+    };
+
+    void resetLedger();
+    unsigned long getLedger(LedgerEntry entry);
+}
+
+#endif // hostsim_h
@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# Turn the sketch into a C++ file the host compiler takes, as the Arduino build does:
+# prototypes of the sketch functions go after its #include lines, so functions can be
+# called before they are defined.  The #line markers keep errors pointing at the sketch.
+#
+#     tools/hostsim/ino2cpp.sh Radiometer/Radiometer.ino > sketch.cpp
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 SKETCH.ino" >&2
+    exit 2
+fi
+
+awk -v sketch="$1" '
+    # First pass: find the last #include and collect the function definitions, with the
+    # brace on the next line or on the same line
+    FNR == NR {
+        sub(/\r$/, "")
+
+        if ($0 ~ /^#include/) {
+            lastInclude = FNR
+        }
+
+        if ($0 ~ /^\{/ && previous ~ /^[A-Za-z_][A-Za-z0-9_ *&:<>]*[ *&][A-Za-z_][A-Za-z0-9_]*\(.*\)[ \t]*$/) {
+            prototypes = prototypes previous ";\n"
+        } else if ($0 ~ /^[A-Za-z_][A-Za-z0-9_ *&:<>]*[ *&][A-Za-z_][A-Za-z0-9_]*\(.*\)[ \t]*\{[ \t]*$/) {
+            line = $0
+            sub(/[ \t]*\{[ \t]*$/, "", line)
+            prototypes = prototypes line ";\n"
+        }
+
+        previous = $0
+        next
+    }
+
+    # Second pass: copy the sketch with the prototypes after the last #include
+    {
+        sub(/\r$/, "")
+        print
+
+        if (FNR == lastInclude) {
+            printf "#line 1 \"prototypes\"\n%s#line %d \"%s\"\n", prototypes, FNR + 1, sketch
+        }
+    }
+
+    END {
+        if (FNR == 0) {
+            exit 1
+        }
+    }
+' "$1" "$1"
@@ -0,0 +1,344 @@
+/*
+    Power cut recovery of the journaled day file.
+
+    Program Description : Writes a day file of journaled records through
+        AdafruitDataloggingShield, in the logger's record format, then cuts
+        the power at random points of it and runs the boot-time recovery scan
+        on what is left.  A cut either ends the file part way through a line,
+        or leaves the rest of the last sector full of zeros, as when the
+        directory entry got the new size but the data never reached the card.
+        For every cut the recovery must find the last block committed before
+        it, mark everything after that block as discarded and let the next
+        block carry on the sequence.  Reports the sectors the scan read and
+        the simulated time it took, against reading the whole file.
+
+        journal_bench [-r RECORDS] [-b RECORDS_PER_BLOCK] [-c CUTS]
+                      [-t SECTOR_US] [-s SEED] [-o CARD_DIRECTORY] [-v]
+
+        -t is the time to read one 512 byte sector, about 1.5 ms on the Uno
+        with the SPI bus at 4 MHz.  -v lists every cut.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : journal_bench.cpp
+*/
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hostsim.h"
+#include "AdafruitDataloggingShield.h"
+
+int baud = 9600;
+
+// Where each block of the clean file starts and where its commit line ends
+struct Block
+{
+    uint32_t sequence;
+    uint32_t start;
+    uint32_t end;
+};
+
+struct Cut
+{
+    uint32_t offset;
+    uint32_t zeros;
+    JournalRecovery recovery;
+    unsigned long sectors;
+    double milliseconds;
+    bool correct;
+};
+
+static std::string readFile(const std::string& path)
+{
+    std::string data;
+    FILE* pFile = fopen(path.c_str(), "rb");
+
+    if (pFile != nullptr) {
+        char buffer[65536];
+        size_t length;
+
+        while ((length = fread(buffer, 1, sizeof(buffer), pFile)) > 0) {
+            data.append(buffer, length);
+        }
+
+        fclose(pFile);
+    }
+
+    return data;
+}
+
+static bool writeFile(const std::string& path, const std::string& data)
+{
+    FILE* pFile = fopen(path.c_str(), "wb");
+
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    bool written = fwrite(data.data(), 1, data.size(), pFile) == data.size();
+
+    return fclose(pFile) == 0 && written;
+}
+
+// A record as readExtendedADCShield() builds it: 8 channels, 3 temperatures, the date,
+// the sequence number and the interval
+static void buildRecord(unsigned long sequence, std::mt19937* pRandom, char* pRecord, size_t size)
+{
+    int length = 0;
+
+    for (int column = 0; column < 11; column++) {
+        length += snprintf(pRecord + length, size - length, "%6ld,", (long)((*pRandom)() % 500000));
+    }
+
+    unsigned long second = sequence - 1;
+
+    snprintf(pRecord + length, size - length, "2026,10,19,%lu,%lu,%lu.%03lu,%lu,1000",
+             second / 3600 % 24, second / 60 % 60, second % 60, (unsigned long)((*pRandom)() % 1000), sequence);
+}
+
+// The blocks in a clean file, from their marker lines
+static std::vector<Block> findBlocks(const std::string& data)
+{
+    std::vector<Block> blocks;
+    uint32_t start = 0;
+
+    for (size_t line = 0; line < data.size();) {
+        size_t end = data.find('\n', line);
+
+        end = (end == std::string::npos) ? data.size() : end + 1;
+
+        if (data.compare(line, 3, "#B,") == 0) {
+            start = (uint32_t)line;
+        } else if (data.compare(line, 3, "#C,") == 0) {
+            blocks.push_back({(uint32_t)strtoul(data.c_str() + line + 3, nullptr, 10), start, (uint32_t)end});
+        }
+
+        line = end;
+    }
+
+    return blocks;
+}
+
+// Read the whole file in sectors, the cost of a scan from the start
+static void readWholeFile(AdafruitDataloggingShield* pShield, char* pFilename)
+{
+    char buffer[512];
+
+    if (pShield->openForUpdate(pFilename, true)) {
+        uint32_t size = pShield->getOpenFileSize();
+
+        for (uint32_t offset = 0; offset < size; offset += sizeof(buffer)) {
+            pShield->readAt(offset, buffer, sizeof(buffer));
+        }
+
+        pShield->closeUpdate();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long records = 86400;
+    unsigned long blockRecords = 10;
+    int cuts = 200;
+    unsigned long sectorTime = 1500;
+    unsigned long seed = 1;
+    std::string card = "journal_card";
+    bool verbose = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "r:b:c:t:s:o:v")) != -1) {
+        switch (option) {
+            case 'r': records = strtoul(optarg, nullptr, 10); break;
+            case 'b': blockRecords = (std::max)(strtoul(optarg, nullptr, 10), 1UL); break;
+            case 'c': cuts = atoi(optarg); break;
+            case 't': sectorTime = strtoul(optarg, nullptr, 10); break;
+            case 's': seed = strtoul(optarg, nullptr, 10); break;
+            case 'o': card = optarg; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "see the header of journal_bench.cpp for the options\n");
+
+                return 2;
+        }
+    }
+
+    int null = open("/dev/null", O_RDWR);
+
+    mkdir(card.c_str(), 0755);
+    hostsim::setSerial(null, null);
+    hostsim::setSdRoot(card.c_str());
+    hostsim::setVirtualTime(true);
+
+    char filename[] = "JB261019.CSV";
+    char siteName[] = "Bench";
+    std::string path = card + "/" + filename;
+
+    unlink(path.c_str());
+
+    AdafruitDataloggingShield shield(siteName, &Serial, &baud);
+    std::mt19937 random(seed);
+    char record[160];
+
+    // The clean day file, with the heading lines the sketch writes first
+    shield.write(filename, (char*)"Site Name: Bench");
+    shield.write(filename, (char*)"ch1,ch2,tp1,ch3,ch4,tp2,ch5,ch6,ch7,ch8,tp3,Year,Month,Day,Hour,Minutes,Seconds,Sequence,Interval");
+
+    for (unsigned long sequence = 1; sequence <= records; sequence += blockRecords) {
+        shield.openBlock(filename);
+
+        for (unsigned long i = sequence; i < sequence + blockRecords && i <= records; i++) {
+            buildRecord(i, &random, record, sizeof(record));
+            shield.appendToBlock(record);
+        }
+
+        shield.commitBlock();
+    }
+
+    std::string clean = readFile(path);
+    std::vector<Block> blocks = findBlocks(clean);
+
+    hostsim::setSdSectorTime(sectorTime);
+
+    // Recovery of the clean file, and reading all of it
+    JournalRecovery recovery;
+    unsigned long sectors = hostsim::getSdSectorsRead();
+    uint64_t start = hostsim::clock();
+
+    shield.recoverJournal(filename, &recovery);
+
+    double cleanTime = (hostsim::clock() - start) / 1000.0;
+    unsigned long cleanSectors = hostsim::getSdSectorsRead() - sectors;
+    bool cleanCorrect = recovery.sequence == blocks.back().sequence && recovery.discarded == 0;
+
+    sectors = hostsim::getSdSectorsRead();
+    start = hostsim::clock();
+    readWholeFile(&shield, filename);
+
+    double wholeTime = (hostsim::clock() - start) / 1000.0;
+    unsigned long wholeSectors = hostsim::getSdSectorsRead() - sectors;
+
+    printf("%lu records in %zu blocks of %lu, %zu bytes, sector read %lu us\n\n",
+           records, blocks.size(), blockRecords, clean.size(), sectorTime);
+
+    // Cut the power at random points
+    std::vector<Cut> results;
+    std::uniform_int_distribution<uint32_t> offsets(blocks.front().start, (uint32_t)clean.size() - 1);
+
+    if (verbose) {
+        printf("   offset  zeros   block  discarded  scanned  sectors        ms  correct\n");
+    }
+
+    for (int i = 0; i < cuts; i++) {
+        Cut cut;
+
+        cut.offset = offsets(random);
+        cut.zeros = (i % 2 == 1) ? 511 - cut.offset % 512 : 0;
+
+        std::string torn = clean.substr(0, cut.offset) + std::string(cut.zeros, '\0');
+
+        writeFile(path, torn);
+
+        sectors = hostsim::getSdSectorsRead();
+        start = hostsim::clock();
+
+        bool recovered = shield.recoverJournal(filename, &cut.recovery);
+
+        cut.milliseconds = (hostsim::clock() - start) / 1000.0;
+        cut.sectors = hostsim::getSdSectorsRead() - sectors;
+
+        // The last block whose commit line is whole, and the first block started after it
+        uint32_t sequence = 0;
+        uint32_t firstOpen = (uint32_t)torn.size();
+
+        for (const Block& block : blocks) {
+            if (block.end <= cut.offset) {
+                sequence = block.sequence;
+            } else {
+                if (block.start + 2 <= cut.offset) {
+                    firstOpen = block.start;
+                }
+
+                break;
+            }
+        }
+
+        // The marker follows whatever was cut short, then the next block carries on
+        std::string expected = torn;
+        uint32_t discarded = (uint32_t)torn.size() - firstOpen;
+
+        if (discarded > 0 || torn.back() != '\n') {
+            expected += (torn.back() == '\n' ? "" : "\r\n") +
+                        std::string("#R,") + std::to_string(sequence) + "," + std::to_string(discarded) + "\r\n";
+        }
+
+        buildRecord(1, &random, record, sizeof(record));
+        shield.openBlock(filename);
+        shield.appendToBlock(record);
+        shield.commitBlock();
+
+        expected += "#B," + std::to_string(sequence + 1) + "\r\n";
+
+        std::string after = readFile(path);
+
+        cut.correct = recovered &&
+                      cut.recovery.sequence == sequence &&
+                      cut.recovery.discarded == discarded &&
+                      after.compare(0, expected.size(), expected) == 0;
+
+        results.push_back(cut);
+
+        if (verbose) {
+            printf("%9u %6u %7lu %10lu %8lu %8lu %9.1f  %s\n",
+                   cut.offset, cut.zeros, (unsigned long)cut.recovery.sequence,
+                   (unsigned long)cut.recovery.discarded, (unsigned long)cut.recovery.scanned,
+                   cut.sectors, cut.milliseconds, cut.correct ? "yes" : "NO");
+        }
+    }
+
+    writeFile(path, clean);
+
+    // Summary
+    unsigned long correct = 0;
+    unsigned long maxSectors = 0;
+    unsigned long maxScanned = 0;
+    double meanSectors = 0.0;
+    double meanTime = 0.0;
+    double maxTime = 0.0;
+
+    for (const Cut& cut : results) {
+        correct += cut.correct ? 1 : 0;
+        maxSectors = (std::max)(maxSectors, cut.sectors);
+        maxScanned = (std::max)(maxScanned, (unsigned long)cut.recovery.scanned);
+        meanSectors += (double)cut.sectors / results.size();
+        meanTime += cut.milliseconds / results.size();
+        maxTime = (std::max)(maxTime, cut.milliseconds);
+    }
+
+    if (verbose) {
+        printf("\n");
+    }
+
+    printf("                        sectors        ms   bytes scanned\n");
+    printf("clean file               %6lu %9.1f   %13lu  %s\n",
+           cleanSectors, cleanTime, (unsigned long)recovery.scanned, cleanCorrect ? "" : "WRONG");
+
+    if (!results.empty()) {
+        printf("after a cut, mean        %6.1f %9.1f\n", meanSectors, meanTime);
+        printf("after a cut, worst       %6lu %9.1f   %13lu\n", maxSectors, maxTime, maxScanned);
+    }
+
+    printf("reading the whole file   %6lu %9.1f\n\n", wholeSectors, wholeTime);
+    printf("%lu of %zu cuts recovered correctly\n", correct, results.size());
+
+    return (correct == results.size() && cleanCorrect) ? 0 : 1;
+}
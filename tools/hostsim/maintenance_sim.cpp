@@ -0,0 +1,75 @@
+/*
+    Serial maintenance mode running on the host simulation.
+
+    Program Description : Boots the datalogging shield and the serial
+        maintenance mode with Serial on a pty and the SD card in a host
+        directory, so tools/radiodump can be tested without a logger.  The
+        pty path is printed on stderr.
+
+        maintenance_sim [-d SD_DIRECTORY] [-c CORRUPT_EVERY_N_BYTES] [-w WINDOW_MS]
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : maintenance_sim.cpp
+*/
+
+#include <unistd.h>
+
+#include "hostsim.h"
+#include "AdafruitDataloggingShield.h"
+#include "SerialMaintenance.h"
+
+int baud = 9600;
+
+int main(int argc, char** argv)
+{
+    unsigned long window = 60000;
+    int option;
+
+    while ((option = getopt(argc, argv, "d:c:w:")) != -1) {
+        switch (option) {
+            case 'd':
+                hostsim::setSdRoot(optarg);
+
+                break;
+            case 'c':
+                hostsim::setSerialCorruption(strtoul(optarg, nullptr, 10));
+
+                break;
+            case 'w':
+                window = strtoul(optarg, nullptr, 10);
+
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d sd_directory] [-c corrupt_every] [-w window_ms]\n", argv[0]);
+
+                return 2;
+        }
+    }
+
+    const char* pPty = hostsim::openSerialPty();
+
+    if (!pPty) {
+        perror("pty");
+
+        return 1;
+    }
+
+    fprintf(stderr, "%s\n", pPty);
+
+    AdafruitDataloggingShield* pDataloggingShield = new AdafruitDataloggingShield((char*)"Simulation", &Serial, &baud);
+    SerialMaintenance maintenance(&Serial, &baud, pDataloggingShield);
+
+    if (!maintenance.requested(window)) {
+        fprintf(stderr, "no maintenance request\n");
+
+        return 1;
+    }
+
+    maintenance.run();
+
+    return 0;
+}
@@ -0,0 +1,428 @@
+/*
+    Microbenchmarks of the sketch's hot paths, with AVR cycle estimates.
+
+    Program Description : Runs each hot path of the sample loop many times on
+        the host simulation and reports the host time it takes (ns/op) and an
+        estimate of its cost on the 16 MHz Uno (AVR cycles/op).  The paths are
+        one ADC conversion through ExtendedADCShield::analogReadConfigNext(),
+        which covers buildCommand() and codeToVoltage(), the whole sample line
+        of readExtendedADCShield(), its time stamp from addDate(), a record
+        written with AdafruitDataloggingShield::write() to the simulated card,
+        and the GPS position turned into strings for the heading.  The sketch
+        is built from sketch.cpp as for soak, and setup() runs first.
+
+        The AVR figure is the hostsim cycle ledger priced with COSTS below.
+        It counts the calls into the core and the libraries, such as
+        digitalWrite(), SPI.transfer(), dtostrf(), snprintf_P(), the RTC read
+        and the SD card sectors.  The arithmetic and the string handling
+        between them are not counted, which ns/op still shows.
+
+        Results can be written to a baseline file and later compared with it.
+        A benchmark whose cycles/op grew by more than -t percent, or whose
+        ns/op grew by more than -T percent, is a regression, and the exit
+        status is then 1.
+
+        microbench [-r REPEATS] [-w BASELINE] [-c BASELINE] [-t CYCLE_PERCENT]
+                   [-T NS_PERCENT] [-o CARD_DIRECTORY] [-v]
+
+        ns/op is the best of -r repeats.  -T 0 leaves ns/op out of the
+        comparison, as the checked-in baseline was measured on another PC.
+        -v lists the ledger of every benchmark.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : microbench.cpp
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Sim7000Emulator.h"
+#include "hostsim.h"
+#include "ExtendedADCShield.h"
+#include "AdafruitDataloggingShield.h"
+#include "Botletics_LTE_GPS_Shield.h"
+
+// The sketch, built from sketch.cpp
+void setup();
+void readExtendedADCShield();
+void addDate();
+
+extern const AdafruitDataloggingShield* pDataloggingShield;
+extern const Botletics_LTE_GPS_Shield* pBotletics_LTEGPS;
+extern char collectionString[];
+extern unsigned long sampleTime;
+
+char* __brkval = nullptr;
+char* __malloc_heap_start = nullptr;
+
+//// Cycle costs
+// AVR cycles at 16 MHz for each entry of the ledger.  These are estimates worked out from
+// the Arduino core, avr-libc and the library sources, not measurements on a board.
+struct Cost
+{
+    hostsim::LedgerEntry entry;
+    unsigned long cycles;
+    const char* pName;
+};
+
+static const Cost COSTS[] = {
+    // Pin and port tables read from flash, interrupts off around the port write
+    { hostsim::LEDGER_DIGITAL_WRITE, 60, "digitalWrite" },
+    // 13 ADC clocks at 125 kHz, with the ADC prescaler at 128
+    { hostsim::LEDGER_ANALOG_READ, 1700, "analogRead" },
+    // 8 bits at 4 MHz, then the SPIF poll
+    { hostsim::LEDGER_SPI_TRANSFER, 42, "SPI byte" },
+    { hostsim::LEDGER_CLOCK_READ, 35, "millis/micros" },
+    // Busy waiting
+    { hostsim::LEDGER_DELAY_US, 16, "delay us" },
+    // avr-libc's __ftoa_engine for up to 7 digits, then the padding
+    { hostsim::LEDGER_DTOSTRF, 2000, "dtostrf" },
+    // vfprintf() on a string FILE
+    { hostsim::LEDGER_FORMAT, 250, "snprintf_P" },
+    // A %d or %lu, converted with __ultoa_invert
+    { hostsim::LEDGER_FORMAT_FIELD, 250, "format field" },
+    { hostsim::LEDGER_FORMAT_BYTE, 40, "format byte" },
+    // Into the 64 byte transmit buffer, and the UDRE interrupt that sends it.  Not the
+    // wait for a full buffer to drain at 9600 baud.
+    { hostsim::LEDGER_SERIAL_BYTE, 110, "Serial byte" },
+    // PCF8523 over I2C at 100 kHz, the register address out and 7 bytes back, ~1 ms
+    { hostsim::LEDGER_RTC_READ, 15500, "RTC read" },
+    // Card reset at 250 kHz, then the MBR and the boot sector read, ~8 ms on a card that
+    // is already powered.  Cards vary widely.
+    { hostsim::LEDGER_SD_BEGIN, 128000, "SD.begin" },
+    // A root directory sector read and searched
+    { hostsim::LEDGER_SD_LOOKUP, 26000, "SD lookup" },
+    // Copied into the 512 byte block cache
+    { hostsim::LEDGER_SD_BYTE, 15, "SD byte" },
+    // 512 bytes at 4 MHz with the command and the token wait, ~1.5 ms.  Not the time the
+    // card then takes to program a written sector.
+    { hostsim::LEDGER_SD_SECTOR_READ, 24000, "sector read" },
+    { hostsim::LEDGER_SD_SECTOR_WRITE, 24000, "sector write" }
+};
+
+static const int NUMBER_COSTS = sizeof(COSTS) / sizeof(COSTS[0]);
+
+static_assert(NUMBER_COSTS == hostsim::LEDGER_ENTRIES, "every ledger entry needs a cost");
+
+//// Benchmarks
+namespace
+{
+    const int ADC_CHANNELS = 8;
+
+    ExtendedADCShield* pAdc = nullptr;
+    byte adcChannel = 0;
+    volatile float voltage;
+
+    char sdFilename[] = "MB261019.CSV";
+    std::string sdPath;
+
+    // A record as the sketch writes it, 8 channels and 3 temperatures
+    char record[] = "230415,230544,   512,229871,230002,   498,228640,229310,230118,231004,   505,"
+                    "2026,10,19,12,30,15.250,45015,1000";
+
+    char gpsString[GPS_STRING_SIZE];
+}
+
+// One conversion, setting the shield up for the next channel as a scan does
+static void adcConversion()
+{
+    voltage = pAdc->analogReadConfigNext(adcChannel, SINGLE_ENDED, UNIPOLAR, RANGE5V);
+    adcChannel = (adcChannel + 1) % ADC_CHANNELS;
+}
+
+static void sampleLine()
+{
+    readExtendedADCShield();
+}
+
+static void dateStamp()
+{
+    collectionString[0] = '\0';
+    sampleTime = millis();
+    addDate();
+}
+
+static void sdWrite()
+{
+    ((AdafruitDataloggingShield*)pDataloggingShield)->write(sdFilename, record);
+}
+
+// Every repeat starts on a day file holding one record.  Creating the file (with its 5 s
+// delay) happens once a day, so it is left out.
+static void startDayFile()
+{
+    unlink(sdPath.c_str());
+    sdWrite();
+}
+
+static void gpsStrings()
+{
+    Botletics_LTE_GPS_Shield* pShield = (Botletics_LTE_GPS_Shield*)pBotletics_LTEGPS;
+
+    pShield->getLatitudeStr(gpsString);
+    pShield->getLongitudeStr(gpsString);
+    pShield->getAltitudeStr(gpsString);
+}
+
+struct Benchmark
+{
+    const char* pName;
+    void (*pRun)();
+    void (*pPrepare)();
+    unsigned long operations;
+};
+
+static const Benchmark BENCHMARKS[] = {
+    { "adc_conversion", adcConversion, nullptr, 200000 },
+    { "sample_line", sampleLine, nullptr, 5000 },
+    { "add_date", dateStamp, nullptr, 50000 },
+    { "sd_write", sdWrite, startDayFile, 2000 },
+    { "gps_strings", gpsStrings, nullptr, 50000 }
+};
+
+struct Result
+{
+    double nanoseconds = 0.0;
+    double cycles = 0.0;
+    unsigned long ledger[hostsim::LEDGER_ENTRIES] = {};
+};
+
+static Result run(const Benchmark& benchmark, int repeats)
+{
+    Result result;
+
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        if (benchmark.pPrepare) {
+            benchmark.pPrepare();
+        }
+
+        hostsim::resetLedger();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (unsigned long i = 0; i < benchmark.operations; i++) {
+            benchmark.pRun();
+        }
+
+        double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                             benchmark.operations;
+
+        if (repeat == 0 || nanoseconds < result.nanoseconds) {
+            result.nanoseconds = nanoseconds;
+        }
+    }
+
+    // Every repeat does the same work, so the ledger of the last one stands for all
+    double cycles = 0.0;
+
+    for (int i = 0; i < NUMBER_COSTS; i++) {
+        result.ledger[COSTS[i].entry] = hostsim::getLedger(COSTS[i].entry);
+        cycles += (double)hostsim::getLedger(COSTS[i].entry) * COSTS[i].cycles;
+    }
+
+    result.cycles = cycles / benchmark.operations;
+
+    return result;
+}
+
+// Position fix from the emulated modem, so the GPS strings have real digits in them
+static void fixPosition()
+{
+    ModemProfile profile;
+    Sim7000Emulator modem(profile);
+    Botletics_LTE_GPS_Shield* pShield = (Botletics_LTE_GPS_Shield*)pBotletics_LTEGPS;
+
+    hostsim::setSoftwareSerialPeer(&modem);
+    hostsim::setPinListener(&modem);
+
+    pShield->powerOn();
+    pShield->updateGeoData();
+    pShield->powerOff();
+
+    hostsim::setSoftwareSerialPeer(nullptr);
+    hostsim::setPinListener(nullptr);
+}
+
+//// Baselines
+struct Baseline
+{
+    double nanoseconds;
+    double cycles;
+};
+
+static std::map<std::string, Baseline> readBaseline(const char* pPath)
+{
+    std::map<std::string, Baseline> baseline;
+    FILE* pFile = fopen(pPath, "r");
+    char line[160];
+
+    if (!pFile) {
+        fprintf(stderr, "can not read %s\n", pPath);
+        exit(2);
+    }
+
+    while (fgets(line, sizeof(line), pFile)) {
+        char name[64];
+        Baseline entry;
+
+        if (line[0] != '#' && sscanf(line, "%63s %lf %lf", name, &entry.nanoseconds, &entry.cycles) == 3) {
+            baseline[name] = entry;
+        }
+    }
+
+    fclose(pFile);
+
+    return baseline;
+}
+
+static bool writeBaseline(const char* pPath, const Result* pResults)
+{
+    FILE* pFile = fopen(pPath, "w");
+
+    if (!pFile) {
+        return false;
+    }
+
+    fprintf(pFile, "# microbench baseline: name, ns/op on the host, estimated AVR cycles/op\n");
+
+    for (size_t i = 0; i < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); i++) {
+        fprintf(pFile, "%s %.1f %.0f\n", BENCHMARKS[i].pName, pResults[i].nanoseconds, pResults[i].cycles);
+    }
+
+    return fclose(pFile) == 0;
+}
+
+// Growth over the baseline in percent
+static double growth(double value, double baseline)
+{
+    return (baseline > 0.0) ? (value / baseline - 1.0) * 100.0 : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = 5;
+    const char* pWritePath = nullptr;
+    const char* pComparePath = nullptr;
+    double cycleThreshold = 2.0;
+    double nsThreshold = 25.0;
+    std::string card = "microbench_card";
+    bool verbose = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "r:w:c:t:T:o:v")) != -1) {
+        switch (option) {
+            case 'r': repeats = (std::max)(atoi(optarg), 1); break;
+            case 'w': pWritePath = optarg; break;
+            case 'c': pComparePath = optarg; break;
+            case 't': cycleThreshold = atof(optarg); break;
+            case 'T': nsThreshold = atof(optarg); break;
+            case 'o': card = optarg; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "see the header of microbench.cpp for the options\n");
+
+                return 2;
+        }
+    }
+
+    std::map<std::string, Baseline> baseline;
+
+    if (pComparePath) {
+        baseline = readBaseline(pComparePath);
+    }
+
+    int null = open("/dev/null", O_RDWR);
+
+    mkdir(card.c_str(), 0755);
+    sdPath = card + "/" + sdFilename;
+
+    hostsim::setSerial(null, null);
+    hostsim::setSerialPacing(false);
+    hostsim::setSdRoot(card.c_str());
+    hostsim::setVirtualTime(true);
+    hostsim::setRtc(ModemProfile().epoch);
+
+    setup();
+    fixPosition();
+
+    pAdc = new ExtendedADCShield(5, 4, 3, 16);
+
+    const int numberBenchmarks = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+    Result results[numberBenchmarks];
+    bool regressed = false;
+
+    printf("benchmark            operations      ns/op  AVR cycles/op  AVR us/op");
+
+    if (pComparePath) {
+        printf("   ns/op +%%  cycles +%%");
+    }
+
+    printf("\n");
+
+    for (int i = 0; i < numberBenchmarks; i++) {
+        const Benchmark& benchmark = BENCHMARKS[i];
+        Result& result = results[i];
+
+        result = run(benchmark, repeats);
+
+        printf("%-20s %10lu %10.1f %14.0f %10.1f",
+               benchmark.pName, benchmark.operations, result.nanoseconds, result.cycles, result.cycles / 16.0);
+
+        if (pComparePath) {
+            std::map<std::string, Baseline>::const_iterator entry = baseline.find(benchmark.pName);
+
+            if (entry == baseline.end()) {
+                printf("  not in the baseline");
+            } else {
+                double nsGrowth = growth(result.nanoseconds, entry->second.nanoseconds);
+                double cycleGrowth = growth(result.cycles, entry->second.cycles);
+                bool slower = (nsThreshold > 0.0 && nsGrowth > nsThreshold) || cycleGrowth > cycleThreshold;
+
+                printf("  %+9.1f %+10.1f%s", nsGrowth, cycleGrowth, slower ? "  REGRESSION" : "");
+                regressed = regressed || slower;
+            }
+        }
+
+        printf("\n");
+
+        if (verbose) {
+            for (int j = 0; j < NUMBER_COSTS; j++) {
+                unsigned long count = result.ledger[COSTS[j].entry];
+
+                if (count > 0) {
+                    printf("    %-16s %10.2f/op %14.0f\n",
+                           COSTS[j].pName, (double)count / benchmark.operations,
+                           (double)count * COSTS[j].cycles / benchmark.operations);
+                }
+            }
+        }
+    }
+
+    if (pWritePath && !writeBaseline(pWritePath, results)) {
+        fprintf(stderr, "can not write %s\n", pWritePath);
+
+        return 2;
+    }
+
+    if (pComparePath) {
+        printf("\n%s beyond +%.1f%% cycles/op", regressed ? "Regressions" : "No regressions", cycleThreshold);
+
+        if (nsThreshold > 0.0) {
+            printf(" or +%.1f%% ns/op", nsThreshold);
+        }
+
+        printf("\n");
+    }
+
+    return regressed ? 1 : 0;
+}
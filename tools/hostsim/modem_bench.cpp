@@ -0,0 +1,248 @@
+/*
+    Benchmark of the daily modem session against the SIM7000 emulator.
+
+    Program Description : Runs Botletics_LTE_GPS_Shield through power on,
+        the GPS update, an FTP upload in the same 128 byte chunks the sketch
+        uses, and power off, with the modem emulated and time virtual.
+        Reports the simulated time each phase took, the AT traffic and the
+        upload throughput, over a number of runs with different seeds.
+
+        modem_bench [-l RESPONSE_MS] [-r REGISTRATION_MS] [-g FIX_MS] [-R RSSI]
+                    [-B BYTES_PER_S] [-L LINK_MS] [-p DROP_PROBABILITY]
+                    [-u UPLOAD_BYTES] [-c CHUNK_BYTES] [-T soft|uart]
+                    [-n RUNS] [-s SEED] [-v] [-t]
+
+        -T picks the modem link: SoftwareSerial at 9600 baud as on the Uno (the
+        default), or a hardware UART at 115200.  -v shows the sketch's serial
+        output, -t traces the AT traffic on stderr.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : modem_bench.cpp
+*/
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Sim7000Emulator.h"
+#include "HostUartTransport.h"
+#include "hostsim.h"
+#include "Botletics_LTE_GPS_Shield.h"
+#include "SoftwareSerialTransport.h"
+
+int baud = 9600;
+uint8_t FONA_PWRKEY = 6;
+uint8_t FONA_RST = 7;
+uint8_t FONA_RX = 10;
+uint8_t FONA_TX = 11;
+
+// Phases of a session, in simulated seconds
+struct Result
+{
+    double powerOn = 0.0;
+    double geoData = 0.0;
+    double upload = 0.0;
+    double powerOff = 0.0;
+    double total = 0.0;
+    unsigned long uploaded = 0;
+    unsigned long commands = 0;
+    unsigned long bytes = 0;
+    unsigned long overflows = 0;
+    bool intact = false;
+};
+
+static double seconds(uint64_t start)
+{
+    return (hostsim::clock() - start) / 1e6;
+}
+
+// The same loop as uploadData() in the sketch, without the SD card
+static unsigned long upload(Botletics_LTE_GPS_Shield* pShield, const std::string& data, size_t chunkSize)
+{
+    std::vector<char> chunk(chunkSize);
+    unsigned long offset = 0;
+
+    if (!pShield->ftpConnect((char*)"192.0.2.1", 21, (char*)"anonymous", (char*)"")) {
+        return 0;
+    }
+
+    // Reopen and append after a failed chunk, a few times
+    for (int attempt = 0; attempt < 5 && offset < data.size(); attempt++) {
+        if (!pShield->ftpOpen((char*)"BENCH.CSV", offset > 0)) {
+            continue;
+        }
+
+        while (offset < data.size()) {
+            int length = (int)std::min<size_t>(chunkSize, data.size() - offset);
+
+            memcpy(chunk.data(), data.data() + offset, length);
+
+            int sent = pShield->ftpWrite(chunk.data(), length);
+
+            if (sent == 0) {
+                break;
+            }
+
+            offset += sent;
+        }
+
+        pShield->ftpClose();
+    }
+
+    pShield->ftpQuit();
+
+    return offset;
+}
+
+static Result run(const ModemProfile& profile, unsigned long uploadBytes, size_t chunkSize, bool uart, FILE* pTrace)
+{
+    Result result;
+    Sim7000Emulator modem(profile);
+
+    modem.setTrace(pTrace);
+    std::string data;
+
+    for (unsigned long i = 0; data.size() < uploadBytes; i++) {
+        data += std::to_string(i * 7919 % 500000) + (i % 11 == 10 ? "\r\n" : ",");
+    }
+
+    data.resize(uploadBytes);
+
+    hostsim::setSoftwareSerialPeer(&modem);
+    hostsim::setPinListener(&modem);
+
+    // A session that never finishes (no registration, no fix) is stopped after an hour
+    hostsim::setTimeLimit(hostsim::clock() + 3600ULL * 1000000);
+
+    unsigned long overflows = hostsim::getSoftwareSerialOverflows();
+    ModemTransport* pTransport;
+
+    if (uart) {
+        pTransport = new HostUartTransport(&modem);
+    } else {
+        pTransport = new SoftwareSerialTransport(FONA_RX, FONA_TX);
+    }
+
+    Botletics_LTE_GPS_Shield* pShield = new Botletics_LTE_GPS_Shield(&Serial, &baud, &FONA_PWRKEY, &FONA_RST, pTransport);
+    uint64_t start = hostsim::clock();
+    uint64_t phase = start;
+
+    pShield->powerOn();
+    result.powerOn = seconds(phase);
+    phase = hostsim::clock();
+
+    pShield->updateGeoData();
+    result.geoData = seconds(phase);
+    phase = hostsim::clock();
+
+    if (uploadBytes > 0) {
+        result.uploaded = upload(pShield, data, chunkSize);
+        // What reached the server must be exactly what the sketch counted as sent
+        result.intact = modem.getUploaded("BENCH.CSV") == data.substr(0, result.uploaded);
+    }
+
+    result.upload = seconds(phase);
+    phase = hostsim::clock();
+
+    pShield->powerOff();
+    result.powerOff = seconds(phase);
+    result.total = seconds(start);
+
+    result.commands = modem.getCommands();
+    result.bytes = modem.getBytesIn() + modem.getBytesOut();
+    result.overflows = uart ? pTransport->getOverflows() : hostsim::getSoftwareSerialOverflows() - overflows;
+
+    hostsim::setSoftwareSerialPeer(nullptr);
+    hostsim::setPinListener(nullptr);
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    ModemProfile profile;
+    unsigned long uploadBytes = 20000;
+    size_t chunkSize = 128;
+    bool uart = false;
+    int runs = 5;
+    bool verbose = false;
+    FILE* pTrace = nullptr;
+    int option;
+
+    while ((option = getopt(argc, argv, "l:r:g:R:B:L:p:u:c:T:n:s:vt")) != -1) {
+        switch (option) {
+            case 'l': profile.responseLatency = strtoul(optarg, nullptr, 10); break;
+            case 'r': profile.registrationDelay = strtoul(optarg, nullptr, 10); break;
+            case 'g': profile.gpsFixDelay = strtoul(optarg, nullptr, 10); break;
+            case 'R': profile.rssi = atoi(optarg); break;
+            case 'B': profile.bandwidth = strtoul(optarg, nullptr, 10); break;
+            case 'L': profile.linkLatency = strtoul(optarg, nullptr, 10); break;
+            case 'p': profile.dropProbability = atof(optarg); break;
+            case 'u': uploadBytes = strtoul(optarg, nullptr, 10); break;
+            case 'c': chunkSize = strtoul(optarg, nullptr, 10); break;
+            case 'T': uart = (strcmp(optarg, "uart") == 0); break;
+            case 'n': runs = atoi(optarg); break;
+            case 's': profile.seed = strtoul(optarg, nullptr, 10); break;
+            case 'v': verbose = true; break;
+            case 't': pTrace = stderr; break;
+            default:
+                fprintf(stderr, "see the header of modem_bench.cpp for the options\n");
+
+                return 2;
+        }
+    }
+
+    // The sketch's serial output is thrown away unless asked for, but still paced
+    if (!verbose) {
+        int null = open("/dev/null", O_WRONLY);
+
+        hostsim::setSerial(0, null);
+    }
+
+    hostsim::setVirtualTime(true);
+    Serial.begin(baud);
+
+    printf("response %lu ms, registration %lu ms, fix %lu ms, rssi %d, link %lu B/s %lu ms, drop %.3f, upload %lu bytes in %zu byte chunks over %s\n\n",
+           profile.responseLatency, profile.registrationDelay, profile.gpsFixDelay, profile.rssi,
+           profile.bandwidth, profile.linkLatency, profile.dropProbability, uploadBytes, chunkSize,
+           uart ? "a UART at 115200" : "SoftwareSerial at 9600");
+    printf("run  power on  geo data    upload  power off     total  uploaded      B/s  AT cmds  UART bytes  overflows  intact\n");
+
+    std::vector<Result> results;
+    unsigned long seed = profile.seed;
+
+    for (int i = 0; i < runs; i++) {
+        profile.seed = seed + i;
+
+        Result result = run(profile, uploadBytes, chunkSize, uart, pTrace);
+
+        results.push_back(result);
+
+        printf("%3d %8.2fs %8.2fs %8.2fs %9.2fs %8.2fs %9lu %8.0f %8lu %11lu %10lu  %s\n",
+               i + 1, result.powerOn, result.geoData, result.upload, result.powerOff, result.total,
+               result.uploaded, result.upload > 0 ? result.uploaded / result.upload : 0.0,
+               result.commands, result.bytes, result.overflows,
+               uploadBytes == 0 ? "-" : (result.intact ? "yes" : "NO"));
+    }
+
+    Result mean;
+
+    for (const Result& result : results) {
+        mean.powerOn += result.powerOn / runs;
+        mean.geoData += result.geoData / runs;
+        mean.upload += result.upload / runs;
+        mean.powerOff += result.powerOff / runs;
+        mean.total += result.total / runs;
+    }
+
+    printf("\nmean %7.2fs %8.2fs %8.2fs %9.2fs %8.2fs\n",
+           mean.powerOn, mean.geoData, mean.upload, mean.powerOff, mean.total);
+
+    return 0;
+}
@@ -0,0 +1,572 @@
+/*
+    Multi-day soak of the whole sketch under virtual time.
+
+    Program Description : Runs the unmodified sketch, turned into C++ by
+        ino2cpp.sh, on the host simulation with the modem emulated by
+        Sim7000Emulator.  setup() and loop() run for days of simulated time,
+        which takes seconds, so the day rollover, the clock re-sync, the new
+        day file and the upload come round once per simulated day.  Faults are
+        injected on the way: the PCF8523 drifts, SD.begin() stalls at random,
+        and on some days the modem has no signal or a lossy link.  At the end
+        the day files, the clock log and the upload log on the simulated card
+        are read back.  The report gives the records written per day, the gaps
+        between them, the rollover latency, the clock offsets found at each
+        sync and the uploads.  Heap use is counted by replacing operator new.
+
+        soak [-d DAYS] [-D DRIFT_PPM] [-e RTC_ERROR_S] [-l SD_LATENCY_US]
+             [-S SD_STALL_PROBABILITY] [-t SD_STALL_MS] [-m OUTAGE_PROBABILITY]
+             [-p DROP_PROBABILITY] [-s SEED] [-o CARD_DIRECTORY] [-v]
+
+        -m is the chance that a day has no signal at all, -p the chance that a
+        reply or an FTP chunk is lost.  -e sets the RTC that far off the GPS
+        time at the start.  The card directory is emptied first.  -v shows the
+        sketch's serial output.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : soak.cpp
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Sim7000Emulator.h"
+#include "hostsim.h"
+#include "RTClib.h"
+
+// The sketch, built from sketch.cpp
+void setup();
+void loop();
+
+char* __brkval = nullptr;
+char* __malloc_heap_start = nullptr;
+
+//// Heap accounting
+// Every block carries its size in front of it, so delete can count it back.  Only the
+// sketch is counted: the emulator's own memory is left out by CountedModem below.
+namespace
+{
+    const size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    struct BlockHeader
+    {
+        size_t size;
+        bool counted;
+    };
+
+    bool heapCounting = false;
+    size_t heapLive = 0;
+    size_t heapPeak = 0;
+    unsigned long allocations = 0;
+
+    // Kept out of line, so the compiler can not trace a pointer from operator new to the
+    // free() of its header here and take it for a mismatched or out of bounds free
+    __attribute__((noinline)) void releaseBlock(void* pMemory)
+    {
+        BlockHeader* pHeader = (BlockHeader*)((char*)pMemory - HEADER_SIZE);
+
+        if (pHeader->counted) {
+            heapLive -= pHeader->size;
+        }
+
+        free(pHeader);
+    }
+}
+
+void* operator new(size_t size)
+{
+    char* pBlock = (char*)malloc(size + HEADER_SIZE);
+
+    if (pBlock == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    BlockHeader* pHeader = (BlockHeader*)pBlock;
+
+    pHeader->size = size;
+    pHeader->counted = heapCounting;
+
+    if (heapCounting) {
+        heapLive += size;
+        heapPeak = (std::max)(heapPeak, heapLive);
+        allocations++;
+    }
+
+    return pBlock + HEADER_SIZE;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+    if (pMemory != nullptr) {
+        releaseBlock(pMemory);
+    }
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+    operator delete(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+    operator delete(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+    operator delete(pMemory);
+}
+
+// Passes the serial line and the pins through to the emulator with the heap count paused
+class CountedModem : public hostsim::SerialPeer, public hostsim::PinListener
+{
+public:
+    CountedModem(Sim7000Emulator* pModem) : pModem(pModem) {}
+
+    void receive(uint8_t c, unsigned long baud, uint64_t time) override
+    {
+        bool counting = this->pause();
+
+        this->pModem->receive(c, baud, time);
+        heapCounting = counting;
+    }
+
+    bool transmit(uint64_t time, unsigned long baud, uint8_t* pByte) override
+    {
+        bool counting = this->pause();
+        bool sent = this->pModem->transmit(time, baud, pByte);
+
+        heapCounting = counting;
+
+        return sent;
+    }
+
+    void pinChanged(uint8_t pin, uint8_t value) override
+    {
+        bool counting = this->pause();
+
+        this->pModem->pinChanged(pin, value);
+        heapCounting = counting;
+    }
+
+private:
+    Sim7000Emulator* pModem;
+
+    bool pause()
+    {
+        bool counting = heapCounting;
+
+        heapCounting = false;
+
+        return counting;
+    }
+};
+
+//// Reading the card back
+struct DayReport
+{
+    std::string name;
+    unsigned long records = 0;
+    unsigned long gaps = 0;
+    unsigned long missing = 0;
+    long longestGap = 0;
+
+    // Time of the first and the last record (ms since 1970)
+    int64_t first = -1;
+    int64_t last = -1;
+
+    bool trailer = false;
+    unsigned long trailerMissed = 0;
+    // Bytes on the card and bytes on the server, which must be the start of the file
+    size_t size = 0;
+    size_t uploaded = 0;
+    bool intact = false;
+};
+
+static std::string readFile(const std::string& path)
+{
+    std::string data;
+    FILE* pFile = fopen(path.c_str(), "rb");
+
+    if (pFile != nullptr) {
+        char buffer[65536];
+        size_t length;
+
+        while ((length = fread(buffer, 1, sizeof(buffer), pFile)) > 0) {
+            data.append(buffer, length);
+        }
+
+        fclose(pFile);
+    }
+
+    return data;
+}
+
+static std::vector<std::string> lines(const std::string& data)
+{
+    std::vector<std::string> result;
+    size_t start = 0;
+
+    while (start < data.size()) {
+        size_t end = data.find('\n', start);
+
+        if (end == std::string::npos) {
+            end = data.size();
+        }
+
+        std::string line = data.substr(start, end - start);
+
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        result.push_back(line);
+        start = end + 1;
+    }
+
+    return result;
+}
+
+// Milliseconds since 1970 of a record, from the date fields at the end of the line
+static bool recordTime(const std::string& line, int64_t* pTime)
+{
+    std::vector<std::string> fields;
+    size_t start = 0;
+
+    for (size_t comma; (comma = line.find(',', start)) != std::string::npos; start = comma + 1) {
+        fields.push_back(line.substr(start, comma - start));
+    }
+
+    fields.push_back(line.substr(start));
+
+    if (fields.size() < 8) {
+        return false;
+    }
+
+    const std::string* pDate = &fields[fields.size() - 8];
+    int year = atoi(pDate[0].c_str());
+    int month = atoi(pDate[1].c_str());
+    int day = atoi(pDate[2].c_str());
+    double seconds = atof(pDate[5].c_str());
+
+    if (year < 2000 || month < 1 || month > 12 || day < 1) {
+        return false;
+    }
+
+    DateTime date(year, month, day, atoi(pDate[3].c_str()), atoi(pDate[4].c_str()), 0);
+
+    *pTime = (int64_t)date.unixtime() * 1000 + (int64_t)lround(seconds * 1000.0);
+
+    return true;
+}
+
+static DayReport readDayFile(const std::string& directory, const std::string& name)
+{
+    DayReport report;
+    std::vector<int64_t> times;
+
+    report.name = name;
+
+    for (const std::string& line : lines(readFile(directory + "/" + name))) {
+        int64_t time;
+
+        if (line.compare(0, 9, "Samples: ") == 0) {
+            report.trailer = true;
+            sscanf(line.c_str(), "Samples: %*u, Missed: %lu", &report.trailerMissed);
+        } else if (!line.empty() && (isdigit(line[0]) || line[0] == ' ' || line[0] == '-') && recordTime(line, &time)) {
+            times.push_back(time);
+        }
+    }
+
+    report.records = times.size();
+
+    if (times.empty()) {
+        return report;
+    }
+
+    report.first = times.front();
+    report.last = times.back();
+
+    // The usual interval is the period.  Anything over one and a half periods is a gap.
+    std::vector<int64_t> intervals;
+
+    for (size_t i = 1; i < times.size(); i++) {
+        intervals.push_back(times[i] - times[i - 1]);
+    }
+
+    if (intervals.empty()) {
+        return report;
+    }
+
+    std::vector<int64_t> sorted(intervals);
+
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+
+    int64_t period = (std::max)(sorted[sorted.size() / 2], (int64_t)1);
+
+    for (int64_t interval : intervals) {
+        if (interval * 2 > period * 3) {
+            report.gaps++;
+            report.missing += (unsigned long)((interval + period / 2) / period - 1);
+            report.longestGap = (std::max)(report.longestGap, (long)interval);
+        }
+    }
+
+    return report;
+}
+
+static std::vector<std::string> listCard(const std::string& directory)
+{
+    std::vector<std::string> names;
+    DIR* pDirectory = opendir(directory.c_str());
+
+    if (pDirectory == nullptr) {
+        return names;
+    }
+
+    while (struct dirent* pEntry = readdir(pDirectory)) {
+        if (pEntry->d_name[0] != '.') {
+            names.push_back(pEntry->d_name);
+        }
+    }
+
+    closedir(pDirectory);
+    std::sort(names.begin(), names.end());
+
+    return names;
+}
+
+// Time of day of a time in ms since 1970
+static std::string clockText(int64_t time)
+{
+    char text[16];
+
+    if (time < 0) {
+        return "-";
+    }
+
+    long ms = (long)(time % 86400000);
+
+    snprintf(text, sizeof(text), "%02ld:%02ld:%06.3f", ms / 3600000, ms / 60000 % 60, (ms % 60000) / 1000.0);
+
+    return text;
+}
+
+int main(int argc, char** argv)
+{
+    ModemProfile profile;
+    int days = 7;
+    double driftPpm = 20.0;
+    long rtcError = 5;
+    unsigned long sdLatency = 2000;
+    double sdStallProbability = 0.0005;
+    unsigned long sdStallTime = 1500;
+    double outageProbability = 0.2;
+    unsigned long seed = 1;
+    std::string card = "soak_card";
+    bool verbose = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "d:D:e:l:S:t:m:p:s:o:v")) != -1) {
+        switch (option) {
+            case 'd': days = atoi(optarg); break;
+            case 'D': driftPpm = atof(optarg); break;
+            case 'e': rtcError = atol(optarg); break;
+            case 'l': sdLatency = strtoul(optarg, nullptr, 10); break;
+            case 'S': sdStallProbability = atof(optarg); break;
+            case 't': sdStallTime = strtoul(optarg, nullptr, 10); break;
+            case 'm': outageProbability = atof(optarg); break;
+            case 'p': profile.dropProbability = atof(optarg); break;
+            case 's': seed = strtoul(optarg, nullptr, 10); break;
+            case 'o': card = optarg; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "see the header of soak.cpp for the options\n");
+
+                return 2;
+        }
+    }
+
+    // Start on an empty card
+    mkdir(card.c_str(), 0755);
+
+    for (const std::string& name : listCard(card)) {
+        unlink((card + "/" + name).c_str());
+    }
+
+    int null = open("/dev/null", O_RDWR);
+
+    hostsim::setSerial(null, verbose ? 1 : null);
+    hostsim::setSdRoot(card.c_str());
+    hostsim::setSdTiming(sdLatency, sdStallProbability, sdStallTime, seed);
+    hostsim::setVirtualTime(true);
+
+    // GPS time is the true time.  The RTC starts off by rtcError and drifts from there.
+    profile.seed = seed;
+
+    Sim7000Emulator modem(profile);
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    uint64_t start = hostsim::clock();
+    uint64_t end = start + (uint64_t)days * 86400 * 1000000;
+
+    CountedModem countedModem(&modem);
+
+    hostsim::setSoftwareSerialPeer(&countedModem);
+    hostsim::setPinListener(&countedModem);
+    hostsim::setRtc(profile.epoch + rtcError);
+    hostsim::setRtcDrift(driftPpm);
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    std::map<long, bool> outages;
+
+    heapCounting = true;
+    setup();
+
+    size_t heapAfterSetup = heapLive;
+    unsigned long allocationsAfterSetup = allocations;
+    size_t heapPeakAfterSetup = heapLive;
+    long today = -1;
+
+    while (hostsim::clock() < end) {
+        loop();
+
+        // A new day (GPS time) may bring an outage
+        long day = (long)((profile.epoch + (hostsim::clock() - start) / 1000000) / 86400);
+
+        if (day != today) {
+            heapCounting = false;
+            today = day;
+            outages[day] = chance(random) < outageProbability;
+            modem.setRssi(outages[day] ? 0 : profile.rssi);
+            heapCounting = true;
+        }
+
+        heapPeakAfterSetup = (std::max)(heapPeakAfterSetup, heapLive);
+    }
+
+    heapCounting = false;
+
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    // Read the card back
+    std::vector<DayReport> reports;
+    std::string clockLog;
+    std::string linkLog;
+
+    for (const std::string& name : listCard(card)) {
+        if (name.size() == 12 && name.compare(8, 4, ".CSV") == 0 && isdigit(name[2])) {
+            DayReport report = readDayFile(card, name);
+
+            // The sketch names the files in lower case on the server
+            std::string uploadName = name.substr(0, 8) + ".csv";
+            const std::string& uploaded = modem.getUploaded(uploadName);
+            std::string data = readFile(card + "/" + name);
+
+            report.size = data.size();
+            report.uploaded = uploaded.size();
+            report.intact = data.compare(0, uploaded.size(), uploaded) == 0;
+            reports.push_back(report);
+        } else if (name.find("CLOCK") != std::string::npos) {
+            clockLog = readFile(card + "/" + name);
+        } else if (name.find("LINK") != std::string::npos) {
+            linkLog = readFile(card + "/" + name);
+        }
+    }
+
+    printf("%d days simulated in %.1f s (%.0fx), RTC drift %.1f ppm, SD stall chance %.4f (%lu stalls of %lu ms), "
+           "modem outage chance %.2f, drop %.3f\n\n",
+           days, wallTime, days * 86400.0 / wallTime, driftPpm, sdStallProbability,
+           hostsim::getSdStalls(), sdStallTime, outageProbability, profile.dropProbability);
+
+    printf("file          records  gaps  missing  longest gap  first record  last record   trailer missed     bytes  uploaded\n");
+
+    for (size_t i = 0; i < reports.size(); i++) {
+        const DayReport& report = reports[i];
+
+        printf("%-12s %8lu %5lu %8lu %10.1fs  %12s  %12s  %7s %6lu %9zu  %5.1f%%%s\n",
+               report.name.c_str(), report.records, report.gaps, report.missing, report.longestGap / 1000.0,
+               clockText(report.first).c_str(), clockText(report.last).c_str(),
+               report.trailer ? "yes" : "no", report.trailerMissed, report.size,
+               report.size > 0 ? 100.0 * report.uploaded / report.size : 0.0,
+               report.intact ? "" : " DIFFERS");
+    }
+
+    // Rollover latency: from the last record of one day to the first of the next
+    printf("\nrollover             gap   new day starts\n");
+
+    for (size_t i = 1; i < reports.size(); i++) {
+        if (reports[i - 1].last >= 0 && reports[i].first >= 0) {
+            int64_t gap = reports[i].first - reports[i - 1].last;
+
+            printf("%-12s  %9.1fs   %s\n", reports[i].name.c_str(), gap / 1000.0, clockText(reports[i].first).c_str());
+        }
+    }
+
+    // Clock syncs and upload attempts
+    unsigned long syncs = 0;
+    long maxOffset = 0;
+
+    for (const std::string& line : lines(clockLog)) {
+        const char* pOffset = strstr(line.c_str(), "Offset: ");
+        long offset;
+
+        if (pOffset != nullptr && sscanf(pOffset, "Offset: %ld", &offset) == 1) {
+            syncs++;
+            maxOffset = (std::max)(maxOffset, labs(offset));
+        }
+    }
+
+    std::map<std::string, unsigned long> results;
+
+    for (const std::string& line : lines(linkLog)) {
+        const char* pResults[] = {"Uploaded", "Partial", "Verifying", "Failed", "Weak signal", "No network", "Abandoned"};
+
+        for (const char* pResult : pResults) {
+            if (line.find(std::string(", ") + pResult + ",") != std::string::npos) {
+                results[pResult]++;
+            }
+        }
+    }
+
+    unsigned long outageDays = 0;
+
+    for (const std::pair<const long, bool>& outage : outages) {
+        outageDays += outage.second ? 1 : 0;
+    }
+
+    printf("\nclock syncs %lu, largest offset corrected %ld ms\n", syncs, maxOffset);
+    printf("upload attempts: %lu uploaded, %lu partial, %lu verifying, %lu failed, %lu weak signal, %lu no network "
+           "(%lu days without signal), %lu verifications abandoned\n",
+           results["Uploaded"], results["Partial"], results["Verifying"], results["Failed"], results["Weak signal"],
+           results["No network"], outageDays, results["Abandoned"]);
+    printf("heap: %zu bytes after setup() in %lu allocations, peak %zu bytes, %zu bytes at the end "
+           "(host sizes, pointers are 8 bytes instead of 2)\n",
+           heapAfterSetup, allocationsAfterSetup, heapPeakAfterSetup, heapLive);
+
+    hostsim::setSoftwareSerialPeer(nullptr);
+    hostsim::setPinListener(nullptr);
+
+    return 0;
+}
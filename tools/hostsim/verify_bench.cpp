@@ -0,0 +1,366 @@
+/*
+    Verified, incremental uploads of a day file.
+
+    Program Description : Writes a day file through AdafruitDataloggingShield
+        with its CRC index kept as the records go in, and checks the index
+        against one computed on the host.  Then, for a number of trials, it
+        leaves a damaged copy of the file on the emulated FTP server: an
+        upload cut short at a random point, with the manifest's position up
+        to a checkpoint behind it, and a few blocks of what did arrive
+        corrupted.  Upload sessions run through BlockUploader and the SIM7000
+        emulator as in the sketch, each followed by the server's check with
+        the same code as tools/blockcrc, until the manifest marks the file
+        done.  Reports the bytes sent to finish and repair the file against
+        what it costs without the block CRCs: resuming from the manifest's
+        position, and sending the whole file again once the copy is found to
+        be wrong.
+
+        verify_bench [-r RECORDS] [-n TRIALS] [-c MAX_CORRUPT_BLOCKS]
+                     [-m MAX_SESSIONS] [-p DROP_PROBABILITY] [-T soft|uart]
+                     [-s SEED] [-o CARD_DIRECTORY] [-v]
+
+        -m is how many sessions a trial gets to finish the file, which a
+        lossy link (-p) needs more of.  -T picks the modem link as in
+        modem_bench.  -v lists every trial.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : verify_bench.cpp
+*/
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Sim7000Emulator.h"
+#include "HostUartTransport.h"
+#include "hostsim.h"
+#include "AdafruitDataloggingShield.h"
+#include "Botletics_LTE_GPS_Shield.h"
+#include "BlockUploader.h"
+#include "SoftwareSerialTransport.h"
+#include "UploadManifest.h"
+#include "../blockcrc/blockcrc.h"
+
+int baud = 9600;
+uint8_t FONA_PWRKEY = 6;
+uint8_t FONA_RST = 7;
+uint8_t FONA_RX = 10;
+uint8_t FONA_TX = 11;
+
+// Same as the sketch on the Uno
+const int CHUNK_SIZE = 128;
+const unsigned long CHECKPOINT = 4096;
+
+struct Trial
+{
+    unsigned long cut;
+    unsigned long checkpoint;
+    int corrupt;
+    int sessions;
+    unsigned long sent;
+    unsigned long resent;
+    unsigned long naive;
+    bool intact;
+};
+
+static std::string readFile(const std::string& path)
+{
+    std::string data;
+    FILE* pFile = fopen(path.c_str(), "rb");
+
+    if (pFile != nullptr) {
+        char buffer[65536];
+        size_t length;
+
+        while ((length = fread(buffer, 1, sizeof(buffer), pFile)) > 0) {
+            data.append(buffer, length);
+        }
+
+        fclose(pFile);
+    }
+
+    return data;
+}
+
+// A record as readExtendedADCShield() builds it
+static void buildRecord(unsigned long sequence, std::mt19937* pRandom, char* pRecord, size_t size)
+{
+    int length = 0;
+
+    for (int column = 0; column < 11; column++) {
+        length += snprintf(pRecord + length, size - length, "%6ld,", (long)((*pRandom)() % 500000));
+    }
+
+    unsigned long second = sequence - 1;
+
+    snprintf(pRecord + length, size - length, "2026,10,19,%lu,%lu,%lu.%03lu,%lu,1000",
+             second / 3600 % 24, second / 60 % 60, second % 60, (unsigned long)((*pRandom)() % 1000), sequence);
+}
+
+// What blockcrc check does on the server, on the emulator's files
+static void checkServer(std::map<std::string, std::string>* pServer, const std::string& name)
+{
+    auto index = pServer->find(name + ".CRC");
+    std::vector<uint32_t> crcs;
+    std::map<uint32_t, std::string> patches;
+
+    if (index == pServer->end() || !blockcrc::parseIndex(index->second, &crcs)) {
+        return;
+    }
+
+    for (auto file = pServer->begin(); file != pServer->end();) {
+        if (file->first.compare(0, name.size() + 2, name + ".B") == 0 && file->first.size() == name.size() + 7) {
+            patches[strtoul(file->first.c_str() + name.size() + 2, nullptr, 10)] = file->second;
+            file = pServer->erase(file);
+        } else {
+            file++;
+        }
+    }
+
+    blockcrc::Check result = blockcrc::check(&(*pServer)[name], crcs, patches);
+
+    (*pServer)[name + ".BAD"] = blockcrc::formatReport(crcs.size(), result.bad);
+}
+
+// One upload session as uploadData() runs it, with no budget
+static bool session(Botletics_LTE_GPS_Shield* pModem, UploadManifest* pManifest, BlockUploader* pUploader)
+{
+    ManifestEntry entry;
+    int index;
+    bool complete = true;
+
+    pUploader->startSession(CHUNK_SIZE, CHECKPOINT, 0xFFFFFFFFUL, 0xFFFFFFFFUL);
+
+    if (!pModem->ftpConnect((char*)"192.0.2.1", 21, (char*)"anonymous", (char*)"")) {
+        return false;
+    }
+
+    for (index = pManifest->next(UPLOAD_OLDEST_FIRST, &entry); index >= 0; index = pManifest->next(UPLOAD_OLDEST_FIRST, &entry)) {
+        if (!pUploader->upload(index, &entry)) {
+            complete = false;
+
+            break;
+        }
+    }
+
+    for (index = pManifest->find(MANIFEST_VERIFY, 0, &entry);
+         index >= 0 && complete;
+         index = pManifest->find(MANIFEST_VERIFY, index + 1, &entry)) {
+
+        complete = pUploader->verify(index, &entry) != VERIFY_FAILED;
+    }
+
+    pUploader->endSession();
+    pModem->ftpQuit();
+
+    return complete;
+}
+
+int main(int argc, char** argv)
+{
+    ModemProfile profile;
+    unsigned long records = 8640;
+    int trials = 10;
+    int maxSessions = 10;
+    int maxCorrupt = 3;
+    bool uart = false;
+    std::string card = "verify_card";
+    bool verbose = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "r:n:c:m:p:T:s:o:v")) != -1) {
+        switch (option) {
+            case 'r': records = strtoul(optarg, nullptr, 10); break;
+            case 'n': trials = atoi(optarg); break;
+            case 'c': maxCorrupt = atoi(optarg); break;
+            case 'm': maxSessions = atoi(optarg); break;
+            case 'p': profile.dropProbability = atof(optarg); break;
+            case 'T': uart = (strcmp(optarg, "uart") == 0); break;
+            case 's': profile.seed = strtoul(optarg, nullptr, 10); break;
+            case 'o': card = optarg; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "see the header of verify_bench.cpp for the options\n");
+
+                return 2;
+        }
+    }
+
+    int null = open("/dev/null", O_RDWR);
+
+    mkdir(card.c_str(), 0755);
+    hostsim::setSerial(null, null);
+    hostsim::setSdRoot(card.c_str());
+    hostsim::setVirtualTime(true);
+
+    char filename[] = "VB261019.CSV";
+    char indexName[13];
+    char siteName[] = "Bench";
+    std::mt19937 random(profile.seed);
+    char record[160];
+
+    AdafruitDataloggingShield shield(siteName, &Serial, &baud);
+
+    shield.crcIndexName(filename, indexName);
+    unlink((card + "/" + filename).c_str());
+    unlink((card + "/" + indexName).c_str());
+
+    // The day file, written as the sketch writes it, with the index kept from the start
+    shield.openCrcIndex(filename);
+    shield.write(filename, (char*)"Site Name: Bench");
+    shield.write(filename, (char*)"ch1,ch2,tp1,ch3,ch4,tp2,ch5,ch6,ch7,ch8,tp3,Year,Month,Day,Hour,Minutes,Seconds,Sequence,Interval");
+
+    for (unsigned long sequence = 1; sequence <= records; sequence += 10) {
+        shield.openBlock(filename);
+
+        for (unsigned long i = sequence; i < sequence + 10 && i <= records; i++) {
+            buildRecord(i, &random, record, sizeof(record));
+            shield.appendToBlock(record);
+        }
+
+        shield.commitBlock();
+    }
+
+    shield.closeCrcIndex();
+
+    std::string data = readFile(card + "/" + filename);
+    std::string loggerIndex = readFile(card + "/" + indexName);
+    bool indexCorrect = loggerIndex == blockcrc::formatIndex(blockcrc::index(data));
+
+    // Rebuilding the index from the card, as after a restart, gives the same
+    unlink((card + "/" + indexName).c_str());
+    shield.openCrcIndex(filename);
+    shield.closeCrcIndex();
+    indexCorrect = indexCorrect && readFile(card + "/" + indexName) == loggerIndex;
+
+    printf("%lu records, %zu bytes in %zu blocks, index %zu bytes, %s\n\n",
+           records, data.size(), (data.size() + CRC_BLOCK_SIZE - 1) / CRC_BLOCK_SIZE, loggerIndex.size(),
+           indexCorrect ? "the logger's index matches the host's" : "the logger's index is WRONG");
+
+    // The modem
+    Sim7000Emulator modem(profile);
+    ModemTransport* pTransport;
+
+    hostsim::setSoftwareSerialPeer(&modem);
+    hostsim::setPinListener(&modem);
+
+    if (uart) {
+        pTransport = new HostUartTransport(&modem);
+    } else {
+        pTransport = new SoftwareSerialTransport(FONA_RX, FONA_TX);
+    }
+
+    Botletics_LTE_GPS_Shield* pModem = new Botletics_LTE_GPS_Shield(&Serial, &baud, &FONA_PWRKEY, &FONA_RST, pTransport);
+    std::vector<Trial> results;
+    uint64_t start = hostsim::clock();
+
+    pModem->powerOn();
+
+    if (verbose) {
+        printf("      cut  manifest  corrupt  sessions      sent   resent     naive  intact\n");
+    }
+
+    for (int i = 0; i < trials; i++) {
+        Trial trial;
+        std::map<std::string, std::string>& server = modem.getServer();
+
+        // The earlier upload got to cut, and the manifest saved a position up to a
+        // checkpoint before it, on a chunk boundary
+        trial.cut = std::uniform_int_distribution<unsigned long>(0, data.size())(random);
+        trial.checkpoint = (trial.cut - (std::min)(trial.cut, (unsigned long)(random() % CHECKPOINT))) / CHUNK_SIZE * CHUNK_SIZE;
+        trial.corrupt = (trial.cut > 0) ? (int)(random() % (maxCorrupt + 1)) : 0;
+
+        server.clear();
+        server[filename] = data.substr(0, trial.cut);
+
+        for (int c = 0; c < trial.corrupt; c++) {
+            server[filename][random() % trial.cut] ^= 0x20;
+        }
+
+        // A new manifest, with the one entry
+        unlink((card + "/" MANIFEST_FILENAME).c_str());
+
+        UploadManifest manifest(&shield);
+        BlockUploader uploader(&shield, pModem, &manifest);
+
+        manifest.add(filename, data.size());
+        manifest.update(0, trial.checkpoint, MANIFEST_PENDING);
+
+        // Sessions, each followed by the server's check, until the file is done
+        ManifestEntry entry;
+
+        trial.sent = 0;
+        trial.resent = 0;
+
+        for (trial.sessions = 0; trial.sessions < maxSessions && manifest.find(MANIFEST_DONE, 0, &entry) < 0;) {
+            trial.sessions++;
+            session(pModem, &manifest, &uploader);
+            trial.sent += uploader.getUploaded();
+            trial.resent += uploader.getResent();
+            checkServer(&server, filename);
+        }
+
+        trial.intact = manifest.find(MANIFEST_DONE, 0, &entry) == 0 && server[filename] == data;
+
+        // Without block CRCs the rest is appended from the manifest's position, and a copy
+        // that is wrong anywhere has to be sent again in full
+        trial.naive = data.size() - trial.checkpoint;
+
+        if (trial.checkpoint < trial.cut || trial.corrupt > 0) {
+            trial.naive += data.size();
+        }
+
+        results.push_back(trial);
+
+        if (verbose) {
+            printf("%9lu %9lu %8d %9d %9lu %8lu %9lu  %s\n",
+                   trial.cut, trial.checkpoint, trial.corrupt, trial.sessions,
+                   trial.sent, trial.resent, trial.naive, trial.intact ? "yes" : "NO");
+        }
+    }
+
+    pModem->powerOff();
+    hostsim::setSoftwareSerialPeer(nullptr);
+    hostsim::setPinListener(nullptr);
+
+    // Summary
+    double sent = 0.0;
+    double resent = 0.0;
+    double naive = 0.0;
+    double remaining = 0.0;
+    int intact = 0;
+    int mostSessions = 0;
+
+    for (const Trial& trial : results) {
+        sent += (double)trial.sent / results.size();
+        resent += (double)trial.resent / results.size();
+        naive += (double)trial.naive / results.size();
+        remaining += (double)(data.size() - (std::min)(trial.cut, (unsigned long)data.size())) / results.size();
+        intact += trial.intact ? 1 : 0;
+        mostSessions = (std::max)(mostSessions, trial.sessions);
+    }
+
+    if (verbose) {
+        printf("\n");
+    }
+
+    printf("mean bytes per trial                     bytes   of the file\n");
+    printf("missing from the server copy         %9.0f   %9.1f %%\n", remaining, 100.0 * remaining / data.size());
+    printf("sent with block verification         %9.0f   %9.1f %%\n", sent, 100.0 * sent / data.size());
+    printf("  of which blocks sent again         %9.0f   %9.1f %%\n", resent, 100.0 * resent / data.size());
+    printf("sent without (resume + whole file)   %9.0f   %9.1f %%\n", naive, 100.0 * naive / data.size());
+    printf("saved                                %9.0f   %9.1f %%\n\n", naive - sent, 100.0 * (naive - sent) / data.size());
+    printf("%d of %zu files repaired intact, in at most %d sessions, %.0f s simulated\n",
+           intact, results.size(), mostSessions, (hostsim::clock() - start) / 1e6);
+
+    return (intact == (int)results.size() && indexCorrect) ? 0 : 1;
+}
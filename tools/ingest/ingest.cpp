@@ -0,0 +1,1121 @@
+/*
+    Fleet ingest of the radiometer day files.
+
+    Program Description : Parses the SSYYMMDD.csv day files written by the
+        loggers into columnar files the server side can load directly.  Each
+        day file is memory mapped and parsed in place: lines are found with
+        memchr(), and fields with a word-at-a-time (SWAR) comma search and an
+        eight-digit SWAR number conversion, so the inner loop has no
+        per-character branches.  A pool of threads, one per core by default,
+        takes files off a shared list.  The header lines (site name, position
+        and column headings) and the sample-loss trailer are read into the
+        header of the output file.  A day file can have the header lines more
+        than once, after the logger restarted during the day.  Records in a
+        journal block ("#B" ... "#C") that was never committed, because the
+        power was cut while it was written, are left out and counted.
+
+        ingest [-j THREADS] [-o DIRECTORY] [-v] FILE ...
+        ingest -b [-j MAX_THREADS] [-n PASSES] FILE ...
+        ingest -g DAYS [-o DIRECTORY]
+        ingest -d FILE.col
+
+        -b benchmarks the parser without writing anything, at 1, 2, 4 ...
+        threads up to MAX_THREADS, and reports rows/s and GB/s.  -g writes
+        synthetic day files in the logger's exact format to try it on, and -d
+        prints a columnar file back as CSV.
+
+        Columnar file layout, little-endian:
+            header        128 bytes, struct ColumnFileHeader
+            descriptors   32 bytes per column, struct ColumnDescriptor
+            columns       one array per column at its descriptor's offset,
+                          each starting on an 8 byte boundary
+        The columns are the channel and temperature values as recorded (int32),
+        the sample time in milliseconds since 1970 UTC (int64), and the
+        sequence number and sample interval (uint32).
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : ingest.cpp
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+const char COLUMN_FILE_MAGIC[8] = "RADCOL1";
+const uint16_t COLUMN_FILE_HEADER_SIZE = 128;
+
+// Column types
+const uint8_t COLUMN_INT32 = 1;
+const uint8_t COLUMN_INT64 = 2;
+const uint8_t COLUMN_UINT32 = 3;
+
+// Trailer counters of a day that has no trailer
+const uint32_t NO_TRAILER = 0xFFFFFFFF;
+
+// Rows at the start of the journal block being read, when there is none
+const size_t NO_BLOCK = (size_t)-1;
+
+// Records the logger writes to the card at a time, as journal blocks
+const int GENERATED_BLOCK = 10;
+
+// Fields after the value columns: year, month, day, hour, minutes, seconds.milliseconds,
+// sequence and interval
+const int DATE_FIELDS = 6;
+const int TRAILING_FIELDS = DATE_FIELDS + 2;
+
+const uint64_t ONES = 0x0101010101010101ULL;
+const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+const uint64_t LOW_SEVEN = 0x7F7F7F7F7F7F7F7FULL;
+const uint64_t ASCII_ZEROS = 0x3030303030303030ULL;
+const uint64_t ASCII_SPACES = 0x2020202020202020ULL;
+
+#pragma pack(push, 1)
+struct ColumnFileHeader
+{
+    char magic[8];
+    uint32_t rows;
+    uint16_t columns;
+    uint16_t headerSize;
+    char site[32];
+    double latitude;
+    double longitude;
+    double altitude;
+    uint32_t samples;
+    uint32_t missed;
+    uint32_t late;
+    uint32_t malformed;
+    uint32_t uncommitted;
+    uint8_t reserved[36];
+};
+
+struct ColumnDescriptor
+{
+    char name[16];
+    uint8_t type;
+    uint8_t width;
+    uint8_t reserved[6];
+    uint64_t offset;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ColumnFileHeader) == 128, "column file header must be 128 bytes");
+static_assert(sizeof(ColumnDescriptor) == 32, "column descriptor must be 32 bytes");
+
+// A parsed day file
+struct DayFile
+{
+    std::string site;
+    double latitude = 0.0;
+    double longitude = 0.0;
+    double altitude = 0.0;
+    uint32_t samples = NO_TRAILER;
+    uint32_t missed = NO_TRAILER;
+    uint32_t late = NO_TRAILER;
+
+    std::vector<std::string> names;
+    std::vector<std::vector<int32_t>> values;
+    std::vector<int64_t> time;
+    std::vector<uint32_t> sequence;
+    std::vector<uint32_t> interval;
+
+    unsigned long rows = 0;
+    unsigned long malformed = 0;
+    unsigned long headings = 0;
+    unsigned long uncommitted = 0;
+
+    // Rows before the journal block being read
+    size_t blockStart = NO_BLOCK;
+
+    // Date of the last row, and its start in milliseconds since 1970
+    int64_t date = -1;
+    int64_t dateTime = 0;
+};
+
+struct Totals
+{
+    unsigned long files = 0;
+    unsigned long failed = 0;
+    unsigned long rows = 0;
+    unsigned long malformed = 0;
+    uint64_t bytes = 0;
+};
+
+//// SWAR helpers
+
+// High bit set in every byte of word equal to c, and only those
+static inline uint64_t byteMask(uint64_t word, uint8_t c)
+{
+    uint64_t t = word ^ (ONES * c);
+
+    return ~(((t & LOW_SEVEN) + LOW_SEVEN) | t | LOW_SEVEN);
+}
+
+// The next comma at or after p, or pEnd.  Eight bytes are tested at a time while there are
+// eight left before pLimit, the end of the mapped data.
+static inline const char* nextComma(const char* p, const char* pEnd, const char* pLimit)
+{
+    while (p + 8 <= pLimit && p < pEnd) {
+        uint64_t word;
+
+        memcpy(&word, p, 8);
+
+        uint64_t mask = byteMask(word, ',');
+
+        if (mask != 0) {
+            const char* pComma = p + (__builtin_ctzll(mask) >> 3);
+
+            return pComma < pEnd ? pComma : pEnd;
+        }
+
+        p += 8;
+    }
+
+    while (p < pEnd && *p != ',') {
+        p++;
+    }
+
+    return p < pEnd ? p : pEnd;
+}
+
+// Digits, optionally after spaces and a minus sign, as written by dtostrf() and printf().
+// The n characters of the field are in the low bytes of chunk, the first in the lowest, and
+// are converted all at once.
+static inline bool convertWord(uint64_t chunk, size_t n, int64_t* pValue)
+{
+    // Move the field to the top of the word and pad it with spaces, as dtostrf() does
+    if (n < 8) {
+        int shift = (int)(8 - n) * 8;
+
+        chunk = (chunk << shift) | (ASCII_SPACES >> (64 - shift));
+    }
+
+    // The spaces and the sign have to be a prefix, with the sign last and a digit at the end
+    uint64_t spaces = byteMask(chunk, ' ');
+    uint64_t minus = byteMask(chunk, '-');
+    uint64_t prefix = ((spaces | minus) >> 7) * 0xFF;
+
+    if ((prefix & (prefix + 1)) != 0 || (prefix >> 56) != 0) {
+        return false;
+    }
+
+    if (minus != 0 && ((minus >> 7) * 0xFF) != (prefix & ~(prefix >> 8))) {
+        return false;
+    }
+
+    chunk += (spaces >> 7) * 0x10 + (minus >> 7) * 0x03;
+
+    if ((((chunk + 0x4646464646464646ULL) | (chunk - ASCII_ZEROS)) & HIGH_BITS) != 0) {
+        return false;
+    }
+
+    chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    chunk = ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+
+    *pValue = minus ? -(int64_t)chunk : (int64_t)chunk;
+
+    return true;
+}
+
+// A field of any length.  Fields of up to eight characters are converted a word at a time.
+static inline bool parseNumber(const char* p, const char* pEnd, const char* pLimit, int64_t* pValue)
+{
+    size_t n = pEnd - p;
+
+    if (n == 0) {
+        return false;
+    }
+
+    if (n <= 8 && p + 8 <= pLimit) {
+        uint64_t chunk;
+
+        memcpy(&chunk, p, 8);
+
+        return convertWord(chunk, n, pValue);
+    }
+
+    // Long fields, and the last few bytes of the mapping
+    bool negative = false;
+    int64_t value = 0;
+
+    while (p < pEnd && *p == ' ') {
+        p++;
+    }
+
+    if (p < pEnd && *p == '-') {
+        negative = true;
+        p++;
+    }
+
+    if (p == pEnd || pEnd - p > 18) {
+        return false;
+    }
+
+    for (; p < pEnd; p++) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+
+        value = value * 10 + (*p - '0');
+    }
+
+    *pValue = negative ? -value : value;
+
+    return true;
+}
+
+// The number at p, ending at the next comma or pEnd.  The comma search and the conversion
+// share one load for fields of up to eight characters.  Returns the end of the field, or
+// nullptr if it is not a number.
+static inline const char* parseField(const char* p, const char* pEnd, const char* pLimit, int64_t* pValue)
+{
+    if (p + 8 <= pLimit) {
+        uint64_t chunk;
+
+        memcpy(&chunk, p, 8);
+
+        uint64_t commas = byteMask(chunk, ',');
+        size_t n = commas ? (__builtin_ctzll(commas) >> 3) : 8;
+
+        if (n > (size_t)(pEnd - p)) {
+            n = pEnd - p;
+        }
+
+        if (n > 0 && (p + n == pEnd || p[n] == ',')) {
+            return convertWord(chunk, n, pValue) ? p + n : nullptr;
+        }
+    }
+
+    const char* pComma = nextComma(p, pEnd, pLimit);
+
+    return parseNumber(p, pComma, pLimit, pValue) ? pComma : nullptr;
+}
+
+//// Time
+
+// Days since 1970-01-01 of a civil date
+static int64_t daysFromCivil(int64_t year, int64_t month, int64_t day)
+{
+    year -= month <= 2;
+
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static void civilFromDays(int64_t days, int* pYear, int* pMonth, int* pDay)
+{
+    days += 719468;
+
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t mp = (5 * dayOfYear + 2) / 153;
+
+    *pDay = (int)(dayOfYear - (153 * mp + 2) / 5 + 1);
+    *pMonth = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *pYear = (int)(yearOfEra + era * 400 + (*pMonth <= 2));
+}
+
+//// Parsing
+
+// "ch1,ch2,tp1,...,Year,Month,Day,Hour,Minutes,Seconds,Sequence,Interval"
+static bool parseHeading(const char* p, const char* pEnd, DayFile* pDay)
+{
+    std::vector<std::string> names;
+
+    while (p < pEnd) {
+        const char* pComma = (const char*)memchr(p, ',', pEnd - p);
+
+        if (pComma == nullptr) {
+            pComma = pEnd;
+        }
+
+        names.push_back(std::string(p, pComma));
+        p = pComma + 1;
+    }
+
+    if (names.size() <= (size_t)TRAILING_FIELDS || names[names.size() - TRAILING_FIELDS] != "Year") {
+        return false;
+    }
+
+    names.resize(names.size() - TRAILING_FIELDS);
+
+    // A restart during the day repeats the heading.  The channel map can not change.
+    if (pDay->headings > 0) {
+        return names == pDay->names;
+    }
+
+    pDay->names = names;
+    pDay->values.resize(names.size());
+
+    return true;
+}
+
+// One record: the value columns, the date, the sequence number and the interval
+static bool parseRow(const char* p, const char* pEnd, const char* pLimit, DayFile* pDay, int64_t* pFields)
+{
+    size_t columns = pDay->names.size();
+    size_t count = columns + TRAILING_FIELDS;
+
+    for (size_t i = 0; i < count; i++) {
+        const char* pComma;
+
+        // The seconds have the milliseconds after a point
+        if (i == columns + DATE_FIELDS - 1) {
+            pComma = nextComma(p, pEnd, pLimit);
+
+            const char* pPoint = (const char*)memchr(p, '.', pComma - p);
+            int64_t milliseconds;
+
+            if (pPoint == nullptr || pComma - pPoint != 4 ||
+                !parseNumber(p, pPoint, pLimit, &pFields[i]) ||
+                !parseNumber(pPoint + 1, pComma, pLimit, &milliseconds)) {
+
+                return false;
+            }
+
+            pFields[i] = pFields[i] * 1000 + milliseconds;
+        } else {
+            pComma = parseField(p, pEnd, pLimit, &pFields[i]);
+
+            if (pComma == nullptr) {
+                return false;
+            }
+        }
+
+        if ((pComma == pEnd) != (i == count - 1)) {
+            return false;
+        }
+
+        p = pComma + 1;
+    }
+
+    const int64_t* pDate = pFields + columns;
+
+    if (pDate[1] < 1 || pDate[1] > 12 || pDate[2] < 1 || pDate[2] > 31 ||
+        pDate[3] > 23 || pDate[4] > 59 || pDate[5] >= 61000 ||
+        pFields[count - 2] < 0 || pFields[count - 1] < 0) {
+
+        return false;
+    }
+
+    for (size_t i = 0; i < columns; i++) {
+        if (pFields[i] < INT32_MIN || pFields[i] > INT32_MAX) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < columns; i++) {
+        pDay->values[i].push_back((int32_t)pFields[i]);
+    }
+
+    // The date only changes at midnight, or between a restart and a clock sync
+    int64_t date = (pDate[0] * 16 + pDate[1]) * 32 + pDate[2];
+
+    if (date != pDay->date) {
+        pDay->date = date;
+        pDay->dateTime = daysFromCivil(pDate[0], pDate[1], pDate[2]) * 86400000LL;
+    }
+
+    pDay->time.push_back(pDay->dateTime + (pDate[3] * 3600 + pDate[4] * 60) * 1000 + pDate[5]);
+    pDay->sequence.push_back((uint32_t)pFields[count - 2]);
+    pDay->interval.push_back((uint32_t)pFields[count - 1]);
+
+    return true;
+}
+
+// Drop the rows of a journal block that was never committed
+static void dropBlock(DayFile* pDay)
+{
+    if (pDay->blockStart == NO_BLOCK) {
+        return;
+    }
+
+    size_t rows = pDay->blockStart;
+
+    for (std::vector<int32_t>& column : pDay->values) {
+        column.resize(rows);
+    }
+
+    pDay->time.resize(rows);
+    pDay->sequence.resize(rows);
+    pDay->interval.resize(rows);
+
+    pDay->uncommitted += pDay->rows - rows;
+    pDay->rows = rows;
+    pDay->blockStart = NO_BLOCK;
+}
+
+static bool startsWith(const char* p, const char* pEnd, const char* pPrefix)
+{
+    size_t length = strlen(pPrefix);
+
+    return (size_t)(pEnd - p) >= length && memcmp(p, pPrefix, length) == 0;
+}
+
+// Parse a day file held in memory.  Lines end in CR LF as written by println().
+static void parseDayFile(const char* pData, size_t size, DayFile* pDay)
+{
+    const char* p = pData;
+    const char* pLimit = pData + size;
+    size_t lines = 0;
+
+    // Size the columns from the line count, so they are filled without reallocating
+    for (const char* q = p; q < pLimit; q++) {
+        q = (const char*)memchr(q, '\n', pLimit - q);
+
+        if (q == nullptr) {
+            break;
+        }
+
+        lines++;
+    }
+
+    std::vector<int64_t> fields;
+
+    while (p < pLimit) {
+        const char* pNewline = (const char*)memchr(p, '\n', pLimit - p);
+        const char* pNext = pNewline ? pNewline + 1 : pLimit;
+        const char* pEnd = pNewline ? pNewline : pLimit;
+
+        if (pEnd > p && pEnd[-1] == '\r') {
+            pEnd--;
+        }
+
+        if (pEnd == p) {
+            // The file is created with an empty heading line
+        } else if (*p == ' ' || *p == '-' || (*p >= '0' && *p <= '9')) {
+            if (pDay->headings == 0 || !parseRow(p, pEnd, pLimit, pDay, fields.data())) {
+                pDay->malformed++;
+            } else {
+                pDay->rows++;
+            }
+        } else if (startsWith(p, pEnd, "#B,")) {
+            // A block opened after one that was never committed
+            dropBlock(pDay);
+            pDay->blockStart = pDay->rows;
+        } else if (startsWith(p, pEnd, "#C,")) {
+            pDay->blockStart = NO_BLOCK;
+        } else if (startsWith(p, pEnd, "#R,")) {
+            // The logger found the block cut short when it restarted
+            dropBlock(pDay);
+        } else if (startsWith(p, pEnd, "Site Name: ")) {
+            pDay->site.assign(p + 11, pEnd);
+        } else if (startsWith(p, pEnd, "Latitude: ")) {
+            std::string line(p, pEnd);
+
+            sscanf(line.c_str(), "Latitude: %lf, Longitude: %lf, Altitude %lf",
+                   &pDay->latitude, &pDay->longitude, &pDay->altitude);
+        } else if (startsWith(p, pEnd, "Samples: ")) {
+            std::string line(p, pEnd);
+            unsigned long samples;
+            unsigned long missed;
+            unsigned long late;
+            const char* pLate = strstr(line.c_str(), "Late: ");
+
+            if (sscanf(line.c_str(), "Samples: %lu, Missed: %lu", &samples, &missed) == 2 &&
+                pLate != nullptr && sscanf(pLate, "Late: %lu", &late) == 1) {
+
+                pDay->samples = (uint32_t)samples;
+                pDay->missed = (uint32_t)missed;
+                pDay->late = (uint32_t)late;
+            } else {
+                pDay->malformed++;
+            }
+        } else if (parseHeading(p, pEnd, pDay)) {
+            if (pDay->headings++ == 0) {
+                fields.resize(pDay->names.size() + TRAILING_FIELDS);
+
+                for (std::vector<int32_t>& column : pDay->values) {
+                    column.reserve(lines);
+                }
+
+                pDay->time.reserve(lines);
+                pDay->sequence.reserve(lines);
+                pDay->interval.reserve(lines);
+            }
+        } else {
+            pDay->malformed++;
+        }
+
+        p = pNext;
+    }
+
+    // The power was cut and the logger has not restarted since
+    dropBlock(pDay);
+}
+
+// Map a file and parse it
+static bool ingestFile(const std::string& path, DayFile* pDay, uint64_t* pBytes)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat status;
+
+    if (fd < 0 || fstat(fd, &status) != 0) {
+        perror(path.c_str());
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return false;
+    }
+
+    *pBytes = status.st_size;
+
+    if (status.st_size == 0) {
+        close(fd);
+
+        return true;
+    }
+
+    void* pMap = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (pMap == MAP_FAILED) {
+        perror(path.c_str());
+
+        return false;
+    }
+
+    madvise(pMap, status.st_size, MADV_SEQUENTIAL);
+    parseDayFile((const char*)pMap, status.st_size, pDay);
+    munmap(pMap, status.st_size);
+
+    return true;
+}
+
+//// Columnar output
+
+static std::string outputPath(const std::string& directory, const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    size_t dot = name.find_last_of('.');
+
+    if (dot != std::string::npos) {
+        name.resize(dot);
+    }
+
+    return directory + "/" + name + ".col";
+}
+
+static bool writeColumns(const std::string& path, const DayFile& day)
+{
+    struct Column
+    {
+        std::string name;
+        uint8_t type;
+        uint8_t width;
+        const void* pData;
+    };
+
+    std::vector<Column> columns;
+
+    for (size_t i = 0; i < day.names.size(); i++) {
+        columns.push_back({day.names[i], COLUMN_INT32, 4, day.values[i].data()});
+    }
+
+    columns.push_back({"time", COLUMN_INT64, 8, day.time.data()});
+    columns.push_back({"sequence", COLUMN_UINT32, 4, day.sequence.data()});
+    columns.push_back({"interval", COLUMN_UINT32, 4, day.interval.data()});
+
+    ColumnFileHeader header;
+    std::vector<ColumnDescriptor> descriptors(columns.size());
+    uint64_t offset = COLUMN_FILE_HEADER_SIZE + columns.size() * sizeof(ColumnDescriptor);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMN_FILE_MAGIC, sizeof(header.magic));
+    header.rows = (uint32_t)day.rows;
+    header.columns = (uint16_t)columns.size();
+    header.headerSize = COLUMN_FILE_HEADER_SIZE;
+    strncpy(header.site, day.site.c_str(), sizeof(header.site) - 1);
+    header.latitude = day.latitude;
+    header.longitude = day.longitude;
+    header.altitude = day.altitude;
+    header.samples = day.samples;
+    header.missed = day.missed;
+    header.late = day.late;
+    header.malformed = (uint32_t)day.malformed;
+    header.uncommitted = (uint32_t)day.uncommitted;
+
+    std::vector<struct iovec> parts;
+    static const uint8_t padding[8] = {0};
+
+    parts.push_back({&header, sizeof(header)});
+    parts.push_back({descriptors.data(), descriptors.size() * sizeof(ColumnDescriptor)});
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        size_t length = day.rows * columns[i].width;
+
+        memset(&descriptors[i], 0, sizeof(ColumnDescriptor));
+        strncpy(descriptors[i].name, columns[i].name.c_str(), sizeof(descriptors[i].name) - 1);
+        descriptors[i].type = columns[i].type;
+        descriptors[i].width = columns[i].width;
+        descriptors[i].offset = offset;
+
+        parts.push_back({(void*)columns[i].pData, length});
+
+        if (length % 8 != 0) {
+            parts.push_back({(void*)padding, 8 - length % 8});
+        }
+
+        offset += (length + 7) / 8 * 8;
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        perror(path.c_str());
+
+        return false;
+    }
+
+    // writev() takes a limited number of parts at a time
+    bool written = true;
+
+    for (size_t i = 0; i < parts.size() && written; i += 512) {
+        size_t count = std::min<size_t>(512, parts.size() - i);
+        size_t expected = 0;
+
+        for (size_t j = i; j < i + count; j++) {
+            expected += parts[j].iov_len;
+        }
+
+        written = writev(fd, &parts[i], (int)count) == (ssize_t)expected;
+    }
+
+    if (!written) {
+        perror(path.c_str());
+    }
+
+    close(fd);
+
+    return written;
+}
+
+// Print a columnar file as CSV
+static bool dumpColumns(const char* pPath)
+{
+    FILE* pFile = fopen(pPath, "rb");
+    ColumnFileHeader header;
+
+    if (pFile == nullptr) {
+        perror(pPath);
+
+        return false;
+    }
+
+    if (fread(&header, sizeof(header), 1, pFile) != 1 || memcmp(header.magic, COLUMN_FILE_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s: not a columnar day file\n", pPath);
+        fclose(pFile);
+
+        return false;
+    }
+
+    std::vector<ColumnDescriptor> descriptors(header.columns);
+    std::vector<std::vector<uint8_t>> data(header.columns);
+
+    fseek(pFile, header.headerSize, SEEK_SET);
+
+    if (fread(descriptors.data(), sizeof(ColumnDescriptor), header.columns, pFile) != header.columns) {
+        fclose(pFile);
+
+        return false;
+    }
+
+    for (size_t i = 0; i < descriptors.size(); i++) {
+        data[i].resize((size_t)header.rows * descriptors[i].width);
+        fseek(pFile, descriptors[i].offset, SEEK_SET);
+
+        if (fread(data[i].data(), 1, data[i].size(), pFile) != data[i].size()) {
+            fclose(pFile);
+
+            return false;
+        }
+    }
+
+    fclose(pFile);
+
+    printf("# site %s, latitude %.6f, longitude %.6f, altitude %.6f\n",
+           header.site, header.latitude, header.longitude, header.altitude);
+
+    if (header.samples != NO_TRAILER) {
+        printf("# samples %u, missed %u, late %u\n", header.samples, header.missed, header.late);
+    }
+
+    printf("# rows %u, malformed lines %u, uncommitted rows %u\n", header.rows, header.malformed, header.uncommitted);
+
+    for (size_t i = 0; i < descriptors.size(); i++) {
+        printf(i == 0 ? "%s" : ",%s", descriptors[i].name);
+    }
+
+    printf("\n");
+
+    for (uint32_t row = 0; row < header.rows; row++) {
+        for (size_t i = 0; i < descriptors.size(); i++) {
+            const uint8_t* pValue = data[i].data() + (size_t)row * descriptors[i].width;
+
+            if (i > 0) {
+                putchar(',');
+            }
+
+            if (descriptors[i].type == COLUMN_INT64) {
+                int64_t value;
+
+                memcpy(&value, pValue, 8);
+                printf("%lld", (long long)value);
+            } else if (descriptors[i].type == COLUMN_UINT32) {
+                uint32_t value;
+
+                memcpy(&value, pValue, 4);
+                printf("%u", value);
+            } else {
+                int32_t value;
+
+                memcpy(&value, pValue, 4);
+                printf("%d", value);
+            }
+        }
+
+        putchar('\n');
+    }
+
+    return true;
+}
+
+//// Thread pool
+
+// Parse every file on threads taking the next file off a shared counter.  Files are only
+// written if pDirectory is set.
+static Totals ingestFiles(const std::vector<std::string>& paths, int threads, const char* pDirectory, bool verbose)
+{
+    std::atomic<size_t> next(0);
+    std::vector<Totals> totals(threads);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t]() {
+            Totals* pTotals = &totals[t];
+
+            for (size_t i = next++; i < paths.size(); i = next++) {
+                DayFile day;
+                uint64_t bytes = 0;
+                bool ok = ingestFile(paths[i], &day, &bytes);
+
+                if (ok && pDirectory != nullptr) {
+                    ok = writeColumns(outputPath(pDirectory, paths[i]), day);
+                }
+
+                if (ok && day.headings == 0 && bytes > 0) {
+                    fprintf(stderr, "%s: no column headings\n", paths[i].c_str());
+                    ok = false;
+                }
+
+                if (verbose) {
+                    printf("%-24s %8lu rows %6lu malformed %6lu uncommitted\n",
+                           paths[i].c_str(), day.rows, day.malformed, day.uncommitted);
+                }
+
+                pTotals->files++;
+                pTotals->failed += ok ? 0 : 1;
+                pTotals->rows += day.rows;
+                pTotals->malformed += day.malformed;
+                pTotals->bytes += bytes;
+            }
+        }));
+    }
+
+    Totals total;
+
+    for (int t = 0; t < threads; t++) {
+        workers[t].join();
+
+        total.files += totals[t].files;
+        total.failed += totals[t].failed;
+        total.rows += totals[t].rows;
+        total.malformed += totals[t].malformed;
+        total.bytes += totals[t].bytes;
+    }
+
+    return total;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Parse the files at 1, 2, 4 ... threads, best of a number of passes each
+static void benchmark(const std::vector<std::string>& paths, int maxThreads, int passes)
+{
+    std::vector<int> counts;
+
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+
+    counts.push_back(maxThreads);
+
+    // Warm the page cache, so the passes measure the parser and not the disk
+    Totals total = ingestFiles(paths, maxThreads, nullptr, false);
+
+    printf("%lu files, %lu rows, %.1f MB, %lu malformed lines\n\n",
+           total.files, total.rows, total.bytes / 1e6, total.malformed);
+    printf("threads   seconds        rows/s      GB/s  speedup\n");
+
+    double single = 0.0;
+
+    for (int threads : counts) {
+        double best = 0.0;
+
+        for (int pass = 0; pass < passes; pass++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            ingestFiles(paths, threads, nullptr, false);
+
+            double seconds = secondsSince(start);
+
+            if (pass == 0 || seconds < best) {
+                best = seconds;
+            }
+        }
+
+        if (threads == 1) {
+            single = best;
+        }
+
+        printf("%7d %9.3f %13.0f %9.3f %8.2f\n",
+               threads, best, total.rows / best, total.bytes / best / 1e9, single > 0.0 ? single / best : 1.0);
+    }
+}
+
+//// Synthetic day files
+
+// CRC-16/XMODEM of a journal block, as the logger writes it
+static unsigned int crc16(const std::string& data)
+{
+    uint16_t crc = 0;
+
+    for (unsigned char c : data) {
+        crc ^= (uint16_t)c << 8;
+
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+// Days of data in the logger's format, with the sketch's default channel map (8 channels,
+// temperatures after channels 2, 4 and 8)
+static bool generate(const std::string& directory, int days)
+{
+    const int channels = 8;
+    const bool temperature[channels] = {false, true, false, true, false, false, false, true};
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0.0, 40.0);
+    std::uniform_int_distribution<int> jitter(0, 12);
+    int64_t startDay = daysFromCivil(2026, 1, 1);
+    unsigned long sequence = 1;
+
+    for (int d = 0; d < days; d++) {
+        int year;
+        int month;
+        int day;
+        char name[32];
+
+        civilFromDays(startDay + d, &year, &month, &day);
+        snprintf(name, sizeof(name), "H1%02d%02d%02d.csv", year % 100, month, day);
+
+        std::string path = directory + "/" + name;
+        FILE* pFile = fopen(path.c_str(), "wb");
+
+        if (pFile == nullptr) {
+            perror(path.c_str());
+
+            return false;
+        }
+
+        // buildTitleString(), buildPositionString() and buildHeading()
+        fprintf(pFile, "Site Name: Henrietta 1\r\n");
+        fprintf(pFile, "Latitude: 43.084600, Longitude: -77.674300, Altitude 160.000000\r\n");
+
+        for (int c = 0, t = 0; c < channels; c++) {
+            fprintf(pFile, "ch%d,", c + 1);
+
+            if (temperature[c]) {
+                fprintf(pFile, "tp%d,", ++t);
+            }
+        }
+
+        fprintf(pFile, "Year,Month,Day,Hour,Minutes,Seconds,Sequence,Interval\r\n");
+
+        // readExtendedADCShield(): dtostrf(value, 6, 0) for every column, then addDate()
+        // and addSequence(), in journal blocks as openBlock() and commitBlock() write them
+        std::string block;
+        unsigned long blocks = 0;
+
+        for (int second = 0; second < 86400; second++) {
+            double sun = std::max(0.0, sin((second - 21600) * M_PI / 43200.0));
+            unsigned long interval = 994 + jitter(random);
+            char field[64];
+
+            for (int c = 0; c < channels; c++) {
+                long value = lround(sun * (400000.0 - c * 30000.0) + noise(random));
+
+                snprintf(field, sizeof(field), "%6ld,", value);
+                block += field;
+
+                if (temperature[c]) {
+                    snprintf(field, sizeof(field), "%6d,", 480 + (int)(sun * 60.0) + c);
+                    block += field;
+                }
+            }
+
+            snprintf(field, sizeof(field), "%d,%d,%d,%d,%d,%d.%03d,%lu,%lu\r\n",
+                     year, month, day, second / 3600, second / 60 % 60, second % 60,
+                     (int)((interval * 7) % 1000), sequence++, interval);
+            block += field;
+
+            if ((second + 1) % GENERATED_BLOCK == 0 || second == 86399) {
+                blocks++;
+                fprintf(pFile, "#B,%lu\r\n%s#C,%lu,%zu,%04X\r\n",
+                        blocks, block.c_str(), blocks, block.size(), crc16(block));
+                block.clear();
+            }
+        }
+
+        fprintf(pFile, "Samples: 86400, Missed: 0 (SD 0, Modem 0, Rollover 0, Other 0), "
+                       "Late: 0 (SD 0, Modem 0, Rollover 0, Other 0), Jitter: 6 ms max, 3 ms mean, Bursts dropped: 0\r\n");
+
+        if (fclose(pFile) != 0) {
+            perror(path.c_str());
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void usage(const char* pProgram)
+{
+    fprintf(stderr,
+            "usage: %s [-j threads] [-o directory] [-v] file ...\n"
+            "       %s -b [-j max_threads] [-n passes] file ...\n"
+            "       %s -g days [-o directory]\n"
+            "       %s -d file.col\n",
+            pProgram, pProgram, pProgram, pProgram);
+}
+
+int main(int argc, char** argv)
+{
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::string directory = ".";
+    bool bench = false;
+    bool verbose = false;
+    int passes = 3;
+    int days = 0;
+    const char* pDump = nullptr;
+    int option;
+
+    while ((option = getopt(argc, argv, "j:o:bn:g:d:v")) != -1) {
+        switch (option) {
+            case 'j':
+                threads = std::max(1, atoi(optarg));
+
+                break;
+            case 'o':
+                directory = optarg;
+
+                break;
+            case 'b':
+                bench = true;
+
+                break;
+            case 'n':
+                passes = std::max(1, atoi(optarg));
+
+                break;
+            case 'g':
+                days = atoi(optarg);
+
+                break;
+            case 'd':
+                pDump = optarg;
+
+                break;
+            case 'v':
+                verbose = true;
+
+                break;
+            default:
+                usage(argv[0]);
+
+                return 2;
+        }
+    }
+
+    if (pDump != nullptr) {
+        return dumpColumns(pDump) ? 0 : 1;
+    }
+
+    if (days > 0) {
+        return generate(directory, days) ? 0 : 1;
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+
+        return 2;
+    }
+
+    std::vector<std::string> paths(argv + optind, argv + argc);
+
+    if (bench) {
+        benchmark(paths, threads, passes);
+
+        return 0;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Totals total = ingestFiles(paths, threads, directory.c_str(), verbose);
+    double seconds = secondsSince(start);
+
+    printf("%lu files, %lu rows, %lu malformed lines, %.1f MB in %.3f s (%.0f rows/s, %.3f GB/s)\n",
+           total.files, total.rows, total.malformed, total.bytes / 1e6, seconds,
+           total.rows / seconds, total.bytes / seconds / 1e9);
+
+    if (total.failed > 0) {
+        fprintf(stderr, "%lu file(s) failed\n", total.failed);
+    }
+
+    return total.failed > 0 ? 1 : 0;
+}
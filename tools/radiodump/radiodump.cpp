@@ -0,0 +1,491 @@
+/*
+    Host side of the radiometer serial maintenance mode.
+
+    Program Description : Puts a logger into maintenance mode over its USB
+        serial port, then lists or fetches the files on its SD card using the
+        XMODEM-CRC block protocol in Radiometer/SerialMaintenance.  Reports
+        the throughput achieved for every file and the blocks that had to be
+        sent again.  Works the same against a pty from
+        tools/hostsim/maintenance_sim.
+
+        radiodump [-b BOOT_BAUD] [-o DIRECTORY] [-l] DEVICE [FILE ...]
+
+        With no files every file on the card is fetched.  -l only lists them.
+    Created By : Benjamin Kleynhans
+    Creation Date : October 19, 2026
+    Authors : Benjamin Kleynhans
+
+    Last Modified By : Benjamin Kleynhans
+    Last Modified Date : October 19, 2026
+    Filename : radiodump.cpp
+*/
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Block framing, as in SerialMaintenance.h
+const int BLOCK_SIZE = 128;
+const uint8_t SOH = 0x01;
+const uint8_t EOT = 0x04;
+const uint8_t ACK = 0x06;
+const uint8_t NAK = 0x15;
+const uint8_t CAN = 0x18;
+const uint8_t CRC = 'C';
+
+const int BLOCK_TIMEOUT = 3000;
+const int RETRIES = 10;
+
+struct CardFile
+{
+    std::string name;
+    unsigned long size;
+};
+
+struct Transfer
+{
+    unsigned long bytes = 0;
+    unsigned long blocks = 0;
+    unsigned long retries = 0;
+    double seconds = 0.0;
+};
+
+class Port
+{
+public:
+    bool open(const char* pPath, long baud)
+    {
+        this->fd = ::open(pPath, O_RDWR | O_NOCTTY);
+
+        if (this->fd < 0) {
+            perror(pPath);
+
+            return false;
+        }
+
+        return this->setBaud(baud);
+    }
+
+    bool setBaud(long baud)
+    {
+        struct termios settings;
+        speed_t speed;
+
+        switch (baud) {
+            case 9600: speed = B9600; break;
+            case 19200: speed = B19200; break;
+            case 38400: speed = B38400; break;
+            case 57600: speed = B57600; break;
+            case 115200: speed = B115200; break;
+            case 230400: speed = B230400; break;
+            default:
+                fprintf(stderr, "unsupported baud rate %ld\n", baud);
+
+                return false;
+        }
+
+        if (tcgetattr(this->fd, &settings) != 0) {
+            perror("tcgetattr");
+
+            return false;
+        }
+
+        cfmakeraw(&settings);
+        cfsetispeed(&settings, speed);
+        cfsetospeed(&settings, speed);
+        settings.c_cc[VMIN] = 0;
+        settings.c_cc[VTIME] = 0;
+
+        this->baud = baud;
+
+        return tcsetattr(this->fd, TCSANOW, &settings) == 0;
+    }
+
+    long getBaud()
+    {
+        return this->baud;
+    }
+
+    // Returns -1 on a timeout
+    int readByte(int timeout)
+    {
+        uint8_t c;
+        struct pollfd descriptor = { this->fd, POLLIN, 0 };
+
+        if (poll(&descriptor, 1, timeout) <= 0 || ::read(this->fd, &c, 1) != 1) {
+            return -1;
+        }
+
+        return c;
+    }
+
+    bool readExact(uint8_t* pBuffer, int length, int timeout)
+    {
+        for (int i = 0; i < length; i++) {
+            int c = this->readByte(timeout);
+
+            if (c < 0) {
+                return false;
+            }
+
+            pBuffer[i] = (uint8_t)c;
+        }
+
+        return true;
+    }
+
+    bool readLine(std::string* pLine, int timeout)
+    {
+        pLine->clear();
+
+        for (;;) {
+            int c = this->readByte(timeout);
+
+            if (c < 0) {
+                return false;
+            }
+
+            if (c == '\n') {
+                return true;
+            }
+
+            if (c != '\r') {
+                pLine->push_back((char)c);
+            }
+        }
+    }
+
+    void write(const void* pData, size_t length)
+    {
+        if (::write(this->fd, pData, length) != (ssize_t)length) {
+            perror("write");
+        }
+    }
+
+    void writeByte(uint8_t c)
+    {
+        this->write(&c, 1);
+    }
+
+    void writeLine(const std::string& line)
+    {
+        std::string data = line + "\n";
+
+        this->write(data.data(), data.size());
+    }
+
+    // Throw away anything the logger sends until it has been quiet for timeout ms
+    void drain(int timeout)
+    {
+        while (this->readByte(timeout) >= 0) {
+        }
+    }
+
+private:
+    int fd = -1;
+    long baud = 0;
+};
+
+static uint16_t crc16(const uint8_t* pData, int length)
+{
+    uint16_t crc = 0;
+
+    while (length--) {
+        crc ^= (uint16_t)*pData++ << 8;
+
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Send MAINT until the logger answers with its maintenance baud rate.  The logger only
+// listens for a few seconds after a reset, opening the port resets most boards.
+static bool enterMaintenance(Port* pPort)
+{
+    std::string line;
+    double deadline = now() + 30.0;
+    double lastRequest = 0.0;
+
+    while (now() < deadline) {
+        if (now() - lastRequest > 0.5) {
+            pPort->writeLine("MAINT");
+            lastRequest = now();
+        }
+
+        if (pPort->readLine(&line, 100) && line.compare(0, 6, "MAINT ") == 0) {
+            long baud = strtol(line.c_str() + 6, nullptr, 10);
+
+            if (!pPort->setBaud(baud)) {
+                return false;
+            }
+
+            // Answers to any MAINT still in flight
+            pPort->drain(200);
+
+            return true;
+        }
+    }
+
+    fprintf(stderr, "the logger did not enter maintenance mode\n");
+
+    return false;
+}
+
+static bool listFiles(Port* pPort, std::vector<CardFile>* pFiles)
+{
+    std::string line;
+
+    pPort->writeLine("LIST");
+
+    while (pPort->readLine(&line, 5000)) {
+        if (line == "END") {
+            return true;
+        }
+
+        size_t space = line.rfind(' ');
+
+        if (space != std::string::npos) {
+            CardFile file;
+
+            file.name = line.substr(0, space);
+            file.size = strtoul(line.c_str() + space + 1, nullptr, 10);
+            pFiles->push_back(file);
+        }
+    }
+
+    fprintf(stderr, "no answer to LIST\n");
+
+    return false;
+}
+
+static bool fetchFile(Port* pPort, const std::string& name, const std::string& directory, Transfer* pTransfer)
+{
+    std::string line;
+    std::vector<uint8_t> data;
+    uint8_t block[BLOCK_SIZE + 4];
+    uint8_t expected = 1;
+    int errors = 0;
+    double startTime = now();
+
+    pPort->writeLine("GET " + name);
+
+    if (!pPort->readLine(&line, 5000) || line.compare(0, 3, "OK ") != 0) {
+        fprintf(stderr, "%s: %s\n", name.c_str(), line.empty() ? "no answer" : line.c_str());
+
+        return false;
+    }
+
+    unsigned long size = strtoul(line.c_str() + 3, nullptr, 10);
+
+    data.reserve(size);
+    pPort->writeByte(CRC);
+
+    for (;;) {
+        int c = pPort->readByte(BLOCK_TIMEOUT);
+
+        if (c == SOH) {
+            bool valid = pPort->readExact(block, BLOCK_SIZE + 4, BLOCK_TIMEOUT) &&
+                (uint8_t)(block[0] ^ block[1]) == 0xFF &&
+                crc16(block + 2, BLOCK_SIZE) == ((block[BLOCK_SIZE + 2] << 8) | block[BLOCK_SIZE + 3]);
+
+            if (!valid) {
+                pTransfer->retries++;
+
+                if (++errors > RETRIES) {
+                    break;
+                }
+
+                pPort->drain(50);
+                pPort->writeByte(NAK);
+
+                continue;
+            }
+
+            if (block[0] == expected) {
+                unsigned long length = std::min<unsigned long>(BLOCK_SIZE, size - data.size());
+
+                data.insert(data.end(), block + 2, block + 2 + length);
+                expected++;
+                pTransfer->blocks++;
+                errors = 0;
+            } else if (block[0] != (uint8_t)(expected - 1)) {
+                // Out of step, the transfer cannot recover
+                pPort->writeByte(CAN);
+                pPort->writeByte(CAN);
+
+                break;
+            }
+
+            // A repeat of the last block means our ACK was lost, acknowledge it again
+            pPort->writeByte(ACK);
+        } else if (c == EOT) {
+            pPort->writeByte(ACK);
+
+            pTransfer->seconds = now() - startTime;
+            pTransfer->bytes = data.size();
+
+            if (data.size() != size) {
+                fprintf(stderr, "%s: got %zu of %lu bytes\n", name.c_str(), data.size(), size);
+
+                return false;
+            }
+
+            std::string path = directory + "/" + name;
+            FILE* pFile = fopen(path.c_str(), "wb");
+
+            if (!pFile) {
+                perror(path.c_str());
+
+                return false;
+            }
+
+            fwrite(data.data(), 1, data.size(), pFile);
+            fclose(pFile);
+
+            return true;
+        } else if (c == CAN) {
+            break;
+        } else if (c < 0) {
+            pTransfer->retries++;
+
+            if (++errors > RETRIES) {
+                break;
+            }
+
+            // Ask again, the logger may have missed the start request
+            pPort->writeByte(data.empty() && expected == 1 ? CRC : NAK);
+        }
+    }
+
+    fprintf(stderr, "%s: transfer failed\n", name.c_str());
+
+    return false;
+}
+
+static void report(const char* pName, const Transfer& transfer, long baud)
+{
+    double rate = transfer.seconds > 0.0 ? transfer.bytes / transfer.seconds : 0.0;
+
+    // 10 bits per byte on the wire
+    double efficiency = baud > 0 ? 100.0 * rate * 10.0 / baud : 0.0;
+
+    printf(
+        "%-12s %10lu bytes %8.2f s %9.1f B/s %5.1f%% of line rate %6lu blocks %4lu retries\n",
+        pName,
+        transfer.bytes,
+        transfer.seconds,
+        rate,
+        efficiency,
+        transfer.blocks,
+        transfer.retries
+    );
+}
+
+int main(int argc, char** argv)
+{
+    long bootBaud = 9600;
+    std::string directory = ".";
+    bool listOnly = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "b:o:l")) != -1) {
+        switch (option) {
+            case 'b':
+                bootBaud = strtol(optarg, nullptr, 10);
+
+                break;
+            case 'o':
+                directory = optarg;
+
+                break;
+            case 'l':
+                listOnly = true;
+
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b boot_baud] [-o directory] [-l] device [file ...]\n", argv[0]);
+
+                return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-b boot_baud] [-o directory] [-l] device [file ...]\n", argv[0]);
+
+        return 2;
+    }
+
+    Port port;
+
+    if (!port.open(argv[optind], bootBaud) || !enterMaintenance(&port)) {
+        return 1;
+    }
+
+    std::vector<CardFile> files;
+    int failed = 0;
+
+    if (listOnly || optind + 1 == argc) {
+        if (!listFiles(&port, &files)) {
+            return 1;
+        }
+    }
+
+    if (listOnly) {
+        for (const CardFile& file : files) {
+            printf("%-12s %10lu\n", file.name.c_str(), file.size);
+        }
+    } else {
+        std::vector<std::string> names;
+        Transfer total;
+
+        for (int i = optind + 1; i < argc; i++) {
+            names.push_back(argv[i]);
+        }
+
+        for (const CardFile& file : files) {
+            names.push_back(file.name);
+        }
+
+        for (const std::string& name : names) {
+            Transfer transfer;
+
+            if (fetchFile(&port, name, directory, &transfer)) {
+                report(name.c_str(), transfer, port.getBaud());
+            } else {
+                failed++;
+            }
+
+            total.bytes += transfer.bytes;
+            total.blocks += transfer.blocks;
+            total.retries += transfer.retries;
+            total.seconds += transfer.seconds;
+        }
+
+        report("Total", total, port.getBaud());
+
+        if (failed > 0) {
+            fprintf(stderr, "%d file(s) failed\n", failed);
+        }
+    }
+
+    port.writeLine("EXIT");
+
+    return failed > 0 ? 1 : 0;
+}